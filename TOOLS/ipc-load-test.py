@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+
+"""
+Open many simulated clients on mpv's JSON IPC socket, and measure request
+latency and throughput.
+
+Start mpv with e.g.:
+
+    mpv --input-ipc-server=/tmp/mpvsock --idle --force-window=no
+
+and then run:
+
+    TOOLS/ipc-load-test.py /tmp/mpvsock --clients 500 --requests 200
+
+Each client observes a few properties (so that it receives a stream of
+property change events like a typical monitoring client), and then sends
+--requests get_property requests, keeping up to --pipeline of them in flight.
+"""
+
+import argparse
+import asyncio
+import json
+import time
+
+OBSERVED = ["time-pos", "pause", "playlist-pos", "volume"]
+
+class Stats:
+    def __init__(self):
+        self.latencies = []
+        self.events = 0
+        self.errors = 0
+
+async def run_client(args, stats, start_barrier, reader, writer):
+    pending = {}
+    done = asyncio.Event()
+    remaining = args.requests
+
+    async def read_loop():
+        nonlocal remaining
+        while True:
+            line = await reader.readline()
+            if not line:
+                break
+            # Avoid parsing events; the test client should not be the
+            # bottleneck. (mpv always writes the "event" field first.)
+            if line.startswith(b'{"event"'):
+                stats.events += 1
+                continue
+            msg = json.loads(line)
+            req = msg.get("request_id", 0)
+            sent = pending.pop(req, None)
+            if sent is None:
+                continue  # observe_property replies etc.
+            if msg.get("error") != "success":
+                stats.errors += 1
+            stats.latencies.append(time.monotonic() - sent)
+            remaining -= 1
+            if remaining <= 0:
+                done.set()
+
+    reader_task = asyncio.ensure_future(read_loop())
+
+    for n, name in enumerate(OBSERVED):
+        cmd = {"command": ["observe_property", n + 1, name]}
+        writer.write((json.dumps(cmd) + "\n").encode())
+
+    await start_barrier.wait()
+
+    next_id = 1
+    while next_id <= args.requests:
+        while len(pending) < args.pipeline and next_id <= args.requests:
+            cmd = {"command": ["get_property", args.property],
+                   "request_id": next_id}
+            pending[next_id] = time.monotonic()
+            writer.write((json.dumps(cmd) + "\n").encode())
+            next_id += 1
+        await writer.drain()
+        await asyncio.sleep(0)
+        while len(pending) >= args.pipeline:
+            await asyncio.sleep(0.001)
+
+    if args.requests > 0:
+        await done.wait()
+    writer.close()
+    reader_task.cancel()
+
+def percentile(values, p):
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("socket", help="path of the mpv IPC socket")
+    parser.add_argument("--clients", type=int, default=100,
+                        help="number of simultaneous connections")
+    parser.add_argument("--requests", type=int, default=100,
+                        help="number of requests per client")
+    parser.add_argument("--pipeline", type=int, default=1,
+                        help="number of requests in flight per client")
+    parser.add_argument("--property", default="time-pos",
+                        help="property to request")
+    parser.add_argument("--json", action="store_true",
+                        help="print results as JSON")
+    args = parser.parse_args()
+
+    stats = Stats()
+    barrier = asyncio.Event()
+    clients = []
+    # Connect one by one. Connecting all at once could overflow the listen
+    # backlog, which asyncio doesn't handle well with unix sockets.
+    for _ in range(args.clients):
+        reader, writer = await asyncio.open_unix_connection(args.socket,
+                                                            limit=1 << 20)
+        clients.append(asyncio.ensure_future(
+            run_client(args, stats, barrier, reader, writer)))
+    await asyncio.sleep(0.5)
+    start = time.monotonic()
+    barrier.set()
+    await asyncio.gather(*clients)
+    elapsed = time.monotonic() - start
+
+    total = len(stats.latencies)
+    res = {
+        "clients": args.clients,
+        "requests": total,
+        "errors": stats.errors,
+        "events": stats.events,
+        "seconds": elapsed,
+        "requests_per_second": total / elapsed if elapsed > 0 else 0,
+        "latency_ms_p50": percentile(stats.latencies, 50) * 1e3,
+        "latency_ms_p99": percentile(stats.latencies, 99) * 1e3,
+        "latency_ms_max": max(stats.latencies, default=0) * 1e3,
+    }
+    if args.json:
+        print(json.dumps(res))
+    else:
+        for k, v in res.items():
+            print("%-22s %s" % (k, round(v, 3) if isinstance(v, float) else v))
+
+if __name__ == "__main__":
+    asyncio.get_event_loop().run_until_complete(main())
@@ -3,6 +3,7 @@ from pyqtgraph.Qt import QtGui, QtCore
 import pyqtgraph as pg
 import sys
 import re
+import json
 
 filename = sys.argv[1]
 
@@ -13,26 +14,22 @@ event_regex = re.compile(events)
 
 """
 This script is meant to display stats written by mpv --dump-stats=filename.
-In general, each line in that file is an event of the form:
+The file uses the Chrome trace event format (a JSON array of event objects),
+so it can also be loaded into chrome://tracing or https://ui.perfetto.dev.
 
-    <timestamp in microseconds> <text> '#' <comment>
+Events are recorded with the MP_STATS_*() macros in common/msg.h. The
+following event phases ("ph" field) are used:
 
-e.g.:
+    'B'     start of the named event (MP_STATS_START)
+    'E'     end of the named event (MP_STATS_END)
+    'C'     a normal value (as opposed to event), in args.value
+            (MP_STATS_VALUE)
+    'i'     singular event (MP_STATS_SIGNAL)
+    'M'     metadata, like thread names
 
-    10474959 start flip #cplayer
-
-<text> is what MP_STATS(log, "...") writes. The rest is added by msg.c.
-
-Currently, the following event types are supported:
-
-    'signal' <name>             singular event
-    'start' <name>              start of the named event
-    'end' <name>                end of the named event
-    'value' <float> <name>      a normal value (as opposed to event)
-    'event-timed' <ts> <name>   singular event at the given timestamp
-    'value-timed' <ts> <float> <name>       a value for an event at the given timestamp
-    'range-timed' <ts1> <ts2> <name>        like start/end, but explicit times
-    <name>                      singular event (same as 'signal')
+Events are written in batches per thread, so they are sorted by timestamp
+first. Start/end events are kept apart per thread ("name [thread]"), because
+the same event can be active on several threads at once.
 
 """
 
@@ -72,54 +69,45 @@ def mkColor(t):
 
 SCALE = 1e6 # microseconds to seconds
 
-for line in [line.split("#")[0].strip() for line in open(filename, "r")]:
-    line = line.strip()
-    if not line:
+def read_events(filename):
+    data = open(filename, "r").read().strip()
+    # The closing bracket is missing if mpv didn't exit cleanly.
+    if not data.endswith("]"):
+        data = data.rstrip(",") + "]"
+    return json.loads(data)
+
+thread_names = {}
+trace = []
+for ev in read_events(filename):
+    if ev["ph"] == "M":
+        if ev["name"] == "thread_name":
+            thread_names[ev["tid"]] = ev["args"]["name"]
         continue
-    ts, event = line.split(" ", 1)
-    ts = int(ts) / SCALE
+    trace.append(ev)
+trace.sort(key=lambda ev: ev["ts"])
+
+for ev in trace:
+    ph = ev["ph"]
+    ts = ev["ts"] / SCALE
     if G.start is None:
         G.start = ts
     ts = ts - G.start
-    if event.startswith("start "):
-        e = get_event(event[6:], "event")
+    name = ev["name"]
+    if ph in ("B", "E"):
+        name = "%s [%s]" % (name, thread_names.get(ev["tid"], ev["tid"]))
+    if ph == "B":
+        e = get_event(name, "event")
         e.vals.append((ts, 0))
         e.vals.append((ts, 1))
-    elif event.startswith("end "):
-        e = get_event(event[4:], "event")
+    elif ph == "E":
+        e = get_event(name, "event")
         e.vals.append((ts, 1))
         e.vals.append((ts, 0))
-    elif event.startswith("value "):
-        _, val, name = event.split(" ", 2)
-        val = float(val)
+    elif ph == "C":
         e = get_event(name, "value")
-        e.vals.append((ts, val))
-    elif event.startswith("event-timed "):
-        _, val, name = event.split(" ", 2)
-        val = int(val) / SCALE - G.start
-        e = get_event(name, "event-signal")
-        e.vals.append((val, 1))
-    elif event.startswith("range-timed "):
-        _, ts1, ts2, name = event.split(" ", 3)
-        ts1 = int(ts1) / SCALE - G.start
-        ts2 = int(ts2) / SCALE - G.start
-        e = get_event(name, "event")
-        e.vals.append((ts1, 0))
-        e.vals.append((ts1, 1))
-        e.vals.append((ts2, 1))
-        e.vals.append((ts2, 0))
-    elif event.startswith("value-timed "):
-        _, tsval, val, name = event.split(" ", 3)
-        tsval = int(tsval) / SCALE - G.start
-        val = float(val)
-        e = get_event(name, "value")
-        e.vals.append((tsval, val))
-    elif event.startswith("signal "):
-        name = event.split(" ", 2)[1]
-        e = get_event(name, "event-signal")
-        e.vals.append((ts, 1))
+        e.vals.append((ts, float(ev["args"]["value"])))
     else:
-        e = get_event(event, "event-signal")
+        e = get_event(name, "event-signal")
         e.vals.append((ts, 1))
 
 # deterministically sort them; make sure the legend is sorted too
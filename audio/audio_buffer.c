@@ -25,6 +25,10 @@
 #include "audio_buffer.h"
 #include "format.h"
 
+// The buffer is a ring: the readable data starts at rpos, and might wrap
+// around at the end of the allocation. Each plane has additional space (guard)
+// after the end of the ring, which is used by mp_audio_buffer_peek_linear() to
+// return wrapped data as a single contiguous region.
 struct mp_audio_buffer {
     int format;
     struct mp_chmap channels;
@@ -32,8 +36,11 @@ struct mp_audio_buffer {
     int sstride;
     int num_planes;
     uint8_t *data[MP_NUM_CHANNELS];
-    int allocated;
+    int allocated;      // ring size in samples (excluding guard)
+    int guard;          // guard size in samples
+    int rpos;           // start of readable data
     int num_samples;
+    uint8_t *peek[MP_NUM_CHANNELS]; // returned by peek functions
 };
 
 struct mp_audio_buffer *mp_audio_buffer_create(void *talloc_ctx)
@@ -52,6 +59,8 @@ void mp_audio_buffer_reinit_fmt(struct mp_audio_buffer *ab, int format,
     ab->channels = *channels;
     ab->srate = srate;
     ab->allocated = 0;
+    ab->guard = 0;
+    ab->rpos = 0;
     ab->num_samples = 0;
     ab->sstride = af_fmt_to_bytes(ab->format);
     ab->num_planes = 1;
@@ -62,44 +71,83 @@ void mp_audio_buffer_reinit_fmt(struct mp_audio_buffer *ab, int format,
     }
 }
 
-// Make the total size of the internal buffer at least this number of samples.
-void mp_audio_buffer_preallocate_min(struct mp_audio_buffer *ab, int samples)
+// Position of the given sample (relative to the read position) in the ring.
+static int ring_pos(struct mp_audio_buffer *ab, int offset)
 {
-    if (samples > ab->allocated) {
-        for (int n = 0; n < ab->num_planes; n++) {
-            ab->data[n] = talloc_realloc(ab, ab->data[n], char,
-                                         ab->sstride * samples);
-        }
-        ab->allocated = samples;
+    int pos = ab->rpos + offset;
+    return pos >= ab->allocated ? pos - ab->allocated : pos;
+}
+
+// Copy samples between the ring and a linear buffer. The ring range starts at
+// the ring position pos, and may wrap around.
+static void copy_to_ring(struct mp_audio_buffer *ab, int pos, uint8_t **src,
+                         int length)
+{
+    int part = MPMIN(length, ab->allocated - pos);
+    for (int n = 0; n < ab->num_planes; n++) {
+        memcpy(ab->data[n] + pos * ab->sstride, src[n], part * ab->sstride);
+        memcpy(ab->data[n], src[n] + part * ab->sstride,
+               (length - part) * ab->sstride);
     }
 }
 
-// Get number of samples that can be written without forcing a resize of the
-// internal buffer.
-int mp_audio_buffer_get_write_available(struct mp_audio_buffer *ab)
+static void copy_from_ring(struct mp_audio_buffer *ab, uint8_t **dst, int pos,
+                           int length)
 {
-    return ab->allocated - ab->num_samples;
+    int part = MPMIN(length, ab->allocated - pos);
+    for (int n = 0; n < ab->num_planes; n++) {
+        memcpy(dst[n], ab->data[n] + pos * ab->sstride, part * ab->sstride);
+        memcpy(dst[n] + part * ab->sstride, ab->data[n],
+               (length - part) * ab->sstride);
+    }
 }
 
-// All integer parameters are in samples.
-// dst and src can overlap.
-static void copy_planes(struct mp_audio_buffer *ab,
-                        uint8_t **dst, int dst_offset,
-                        uint8_t **src, int src_offset, int length)
+// Reallocate the planes, and move the readable data to the start of the ring.
+static void realloc_ring(struct mp_audio_buffer *ab, int samples, int guard)
 {
+    uint8_t *data[MP_NUM_CHANNELS] = {0};
+    for (int n = 0; n < ab->num_planes; n++)
+        data[n] = talloc_size(ab, (samples + guard) * (size_t)ab->sstride);
+    if (ab->num_samples)
+        copy_from_ring(ab, data, ab->rpos, ab->num_samples);
     for (int n = 0; n < ab->num_planes; n++) {
-        memmove((char *)dst[n] + dst_offset * ab->sstride,
-                (char *)src[n] + src_offset * ab->sstride,
-                length * ab->sstride);
+        talloc_free(ab->data[n]);
+        ab->data[n] = data[n];
     }
+    ab->allocated = samples;
+    ab->guard = guard;
+    ab->rpos = 0;
+}
+
+// Make the total size of the internal buffer at least this number of samples.
+void mp_audio_buffer_preallocate_min(struct mp_audio_buffer *ab, int samples)
+{
+    if (samples > ab->allocated)
+        realloc_ring(ab, samples, ab->guard);
+}
+
+// Like mp_audio_buffer_preallocate_min(), but grow exponentially, because
+// resizing always copies the buffered data.
+static void reserve(struct mp_audio_buffer *ab, int samples)
+{
+    if (samples > ab->allocated)
+        realloc_ring(ab, MPMAX(samples, ab->allocated + ab->allocated / 2),
+                     ab->guard);
+}
+
+// Get number of samples that can be written without forcing a resize of the
+// internal buffer.
+int mp_audio_buffer_get_write_available(struct mp_audio_buffer *ab)
+{
+    return ab->allocated - ab->num_samples;
 }
 
 // Append data to the end of the buffer.
 // If the buffer is not large enough, it is transparently resized.
 void mp_audio_buffer_append(struct mp_audio_buffer *ab, void **ptr, int samples)
 {
-    mp_audio_buffer_preallocate_min(ab, ab->num_samples + samples);
-    copy_planes(ab, ab->data, ab->num_samples, (uint8_t **)ptr, 0, samples);
+    reserve(ab, ab->num_samples + samples);
+    copy_to_ring(ab, ring_pos(ab, ab->num_samples), (uint8_t **)ptr, samples);
     ab->num_samples += samples;
 }
 
@@ -107,40 +155,89 @@ void mp_audio_buffer_append(struct mp_audio_buffer *ab, void **ptr, int samples)
 void mp_audio_buffer_prepend_silence(struct mp_audio_buffer *ab, int samples)
 {
     assert(samples >= 0);
-    mp_audio_buffer_preallocate_min(ab, ab->num_samples + samples);
-    copy_planes(ab, ab->data, samples, ab->data, 0, ab->num_samples);
+    reserve(ab, ab->num_samples + samples);
+    ab->rpos -= samples;
+    if (ab->rpos < 0)
+        ab->rpos += ab->allocated;
     ab->num_samples += samples;
-    for (int n = 0; n < ab->num_planes; n++)
-        af_fill_silence(ab->data[n], samples * ab->sstride, ab->format);
+    int part = MPMIN(samples, ab->allocated - ab->rpos);
+    for (int n = 0; n < ab->num_planes; n++) {
+        af_fill_silence(ab->data[n] + ab->rpos * ab->sstride,
+                        part * ab->sstride, ab->format);
+        af_fill_silence(ab->data[n], (samples - part) * ab->sstride, ab->format);
+    }
 }
 
 void mp_audio_buffer_duplicate(struct mp_audio_buffer *ab, int samples)
 {
     assert(samples >= 0 && samples <= ab->num_samples);
-    mp_audio_buffer_preallocate_min(ab, ab->num_samples + samples);
-    copy_planes(ab, ab->data, ab->num_samples,
-                ab->data, ab->num_samples - samples, samples);
+    reserve(ab, ab->num_samples + samples);
+    // Source and destination can both wrap, so copy in up to 3 pieces.
+    int done = 0;
+    while (done < samples) {
+        int src = ring_pos(ab, ab->num_samples - samples + done);
+        int dst = ring_pos(ab, ab->num_samples + done);
+        int len = MPMIN(samples - done, ab->allocated - MPMAX(src, dst));
+        for (int n = 0; n < ab->num_planes; n++) {
+            memcpy(ab->data[n] + dst * ab->sstride,
+                   ab->data[n] + src * ab->sstride, len * ab->sstride);
+        }
+        done += len;
+    }
     ab->num_samples += samples;
 }
 
-// Get the start of the current readable buffer.
+// Get the start of the current readable buffer. Since the buffer is a ring,
+// this returns only the data up to the point where it wraps around. The
+// remaining data can be read with another call after mp_audio_buffer_skip().
+// The returned pointers are valid until the buffer is changed.
 void mp_audio_buffer_peek(struct mp_audio_buffer *ab, uint8_t ***ptr,
                           int *samples)
 {
-    *ptr = ab->data;
-    *samples = ab->num_samples;
+    for (int n = 0; n < ab->num_planes; n++)
+        ab->peek[n] = ab->data[n] + ab->rpos * ab->sstride;
+    *ptr = ab->peek;
+    *samples = MPMIN(ab->num_samples, ab->allocated - ab->rpos);
+}
+
+// Return a pointer to the first samples of the readable data (at most
+// mp_audio_buffer_samples() of them), as a single contiguous region. If the
+// data wraps around, the wrapped part is copied to the end of the ring, so
+// this is cheap as long as samples is small compared to the buffer size.
+// The returned pointers are valid until the buffer is changed.
+uint8_t **mp_audio_buffer_peek_linear(struct mp_audio_buffer *ab, int samples)
+{
+    samples = MPMIN(samples, ab->num_samples);
+    int wrapped = samples - (ab->allocated - ab->rpos);
+    if (wrapped > 0) {
+        if (wrapped > ab->guard)
+            realloc_ring(ab, ab->allocated, wrapped);
+        // (realloc_ring() unwraps the data, so this might be a no-op now.)
+        if (ab->rpos + samples > ab->allocated) {
+            for (int n = 0; n < ab->num_planes; n++) {
+                memcpy(ab->data[n] + ab->allocated * ab->sstride, ab->data[n],
+                       wrapped * ab->sstride);
+            }
+        }
+    }
+    for (int n = 0; n < ab->num_planes; n++)
+        ab->peek[n] = ab->data[n] + ab->rpos * ab->sstride;
+    return ab->peek;
 }
 
 // Skip leading samples. (Used with mp_audio_buffer_peek() to read data.)
 void mp_audio_buffer_skip(struct mp_audio_buffer *ab, int samples)
 {
     assert(samples >= 0 && samples <= ab->num_samples);
-    copy_planes(ab, ab->data, 0, ab->data, samples, ab->num_samples - samples);
+    ab->rpos = ring_pos(ab, samples);
     ab->num_samples -= samples;
+    if (!ab->num_samples)
+        ab->rpos = 0;
 }
 
 void mp_audio_buffer_clear(struct mp_audio_buffer *ab)
 {
+    ab->rpos = 0;
     ab->num_samples = 0;
 }
 
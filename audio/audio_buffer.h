@@ -18,6 +18,8 @@
 #ifndef MP_AUDIO_BUFFER_H
 #define MP_AUDIO_BUFFER_H
 
+#include <stdint.h>
+
 struct mp_audio_buffer;
 struct mp_chmap;
 
@@ -31,6 +33,7 @@ void mp_audio_buffer_prepend_silence(struct mp_audio_buffer *ab, int samples);
 void mp_audio_buffer_duplicate(struct mp_audio_buffer *ab, int samples);
 void mp_audio_buffer_peek(struct mp_audio_buffer *ab, uint8_t ***ptr,
                           int *samples);
+uint8_t **mp_audio_buffer_peek_linear(struct mp_audio_buffer *ab, int samples);
 void mp_audio_buffer_skip(struct mp_audio_buffer *ab, int samples);
 void mp_audio_buffer_clear(struct mp_audio_buffer *ab);
 int mp_audio_buffer_samples(struct mp_audio_buffer *ab);
@@ -176,7 +176,9 @@ static bool send_packet(struct mp_filter *da, struct demux_packet *mpkt)
     AVPacket pkt;
     mp_set_av_packet(&pkt, mpkt, &priv->codec_timebase);
 
+    MP_STATS_START(da, "audio-decode-send");
     int ret = avcodec_send_packet(avctx, mpkt ? &pkt : NULL);
+    MP_STATS_END(da, "audio-decode-send");
 
     if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
         return false;
@@ -191,7 +193,9 @@ static bool receive_frame(struct mp_filter *da, struct mp_frame *out)
     struct priv *priv = da->priv;
     AVCodecContext *avctx = priv->avctx;
 
+    MP_STATS_START(da, "audio-decode");
     int ret = avcodec_receive_frame(avctx, priv->avframe);
+    MP_STATS_END(da, "audio-decode");
 
     if (ret == AVERROR_EOF) {
         // If flushing was initialized earlier and has ended now, make it start
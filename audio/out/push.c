@@ -37,16 +37,30 @@
 #include "osdep/timer.h"
 #include "osdep/atomic.h"
 
-#include "audio/audio_buffer.h"
+#include "misc/ring.h"
 
 struct ao_push_state {
     pthread_t thread;
     pthread_mutex_t lock;
     pthread_cond_t wakeup;
 
+    // Audio data, one ring per plane. Written by play() without holding the
+    // lock (there is only 1 producer), and read by the AO thread.
+    struct mp_ring *buffers[MP_NUM_CHANNELS];
+
+    // If true, the AO thread keeps the device buffer full, and will pick up
+    // new data from the buffers without being woken up, so play() can skip
+    // locking. Only set with the lock held. See update_streaming().
+    atomic_bool streaming;
+
     // --- protected by lock
 
-    struct mp_audio_buffer *buffer;
+    // Data taken from the buffers, but not yet accepted by the driver (the AO
+    // thread needs a linear buffer, and has to keep data the driver rejects).
+    uint8_t *staging[MP_NUM_CHANNELS];
+    int staging_alloc;      // allocated size in samples
+    int staged;             // number of valid samples
+    bool device_full;       // last ao_play_data() filled the device buffer
 
     uint8_t *silence[MP_NUM_CHANNELS];
     int silence_samples;
@@ -65,6 +79,41 @@ struct ao_push_state {
     int wakeup_pipe[2];
 };
 
+// Number of samples that can be read by the AO thread (lock-free).
+static int ring_buffered(struct ao *ao)
+{
+    struct ao_push_state *p = ao->api_priv;
+    // The last plane is written last by play().
+    return mp_ring_buffered(p->buffers[ao->num_planes - 1]) / ao->sstride;
+}
+
+// Number of samples that can be written by play() (lock-free).
+static int ring_available(struct ao *ao)
+{
+    struct ao_push_state *p = ao->api_priv;
+    // The last plane is read last by the AO thread.
+    return mp_ring_available(p->buffers[ao->num_planes - 1]) / ao->sstride;
+}
+
+// lock must be held
+static int buffered_samples(struct ao *ao)
+{
+    struct ao_push_state *p = ao->api_priv;
+    return p->staged + ring_buffered(ao);
+}
+
+// lock must be held
+// Must be called when any of the state the condition depends on changes.
+static void update_streaming(struct ao *ao)
+{
+    struct ao_push_state *p = ao->api_priv;
+    // If the device buffer is not full (e.g. because the producer can't keep
+    // up), play() wakes up the AO thread on new data as usual.
+    atomic_store(&p->streaming, p->wait_on_ao && p->device_full &&
+                 p->still_playing && !p->paused && !p->final_chunk &&
+                 !p->terminate);
+}
+
 // lock must be held
 static void wakeup_playthread(struct ao *ao)
 {
@@ -89,11 +138,10 @@ static int control(struct ao *ao, enum aocontrol cmd, void *arg)
 
 static double unlocked_get_delay(struct ao *ao)
 {
-    struct ao_push_state *p = ao->api_priv;
     double driver_delay = 0;
     if (ao->driver->get_delay)
         driver_delay = ao->driver->get_delay(ao);
-    return driver_delay + mp_audio_buffer_seconds(p->buffer);
+    return driver_delay + buffered_samples(ao) / (double)ao->samplerate;
 }
 
 static double get_delay(struct ao *ao)
@@ -111,11 +159,17 @@ static void reset(struct ao *ao)
     pthread_mutex_lock(&p->lock);
     if (ao->driver->reset)
         ao->driver->reset(ao);
-    mp_audio_buffer_clear(p->buffer);
+    // The producer is the caller's thread, and the AO thread reads the
+    // buffers with the lock held only, so this is safe.
+    for (int n = 0; n < ao->num_planes; n++)
+        mp_ring_reset(p->buffers[n]);
+    p->staged = 0;
+    p->device_full = false;
     p->paused = false;
     if (p->still_playing)
         wakeup_playthread(ao);
     p->still_playing = false;
+    update_streaming(ao);
     pthread_mutex_unlock(&p->lock);
 }
 
@@ -126,6 +180,7 @@ static void audio_pause(struct ao *ao)
     if (ao->driver->pause)
         ao->driver->pause(ao);
     p->paused = true;
+    update_streaming(ao);
     wakeup_playthread(ao);
     pthread_mutex_unlock(&p->lock);
 }
@@ -138,6 +193,7 @@ static void resume(struct ao *ao)
         ao->driver->resume(ao);
     p->paused = false;
     p->expected_end_time = 0;
+    update_streaming(ao);
     wakeup_playthread(ao);
     pthread_mutex_unlock(&p->lock);
 }
@@ -154,13 +210,14 @@ static void drain(struct ao *ao)
         goto done;
 
     p->final_chunk = true;
+    update_streaming(ao);
     wakeup_playthread(ao);
 
     // Wait until everything is done. Since the audio API (especially ALSA)
     // can't be trusted to do this right, and we're hard-blocking here, apply
     // an upper bound timeout.
     struct timespec until = mp_rel_time_to_timespec(maxbuffer);
-    while (p->still_playing && mp_audio_buffer_samples(p->buffer) > 0) {
+    while (p->still_playing && buffered_samples(ao) > 0) {
         if (pthread_cond_timedwait(&p->wakeup, &p->lock, &until)) {
             MP_WARN(ao, "Draining is taking too long, aborting.\n");
             goto done;
@@ -182,15 +239,14 @@ done:
 
 static int unlocked_get_space(struct ao *ao)
 {
-    struct ao_push_state *p = ao->api_priv;
-    int space = mp_audio_buffer_get_write_available(p->buffer);
+    int space = ring_available(ao);
     if (ao->driver->get_space) {
         int align = af_format_sample_alignment(ao->format);
         // The following code attempts to keep the total buffered audio to
         // ao->buffer in order to improve latency.
         int device_space = ao->driver->get_space(ao);
         int device_buffered = ao->device_buffer - device_space;
-        int soft_buffered = mp_audio_buffer_samples(p->buffer);
+        int soft_buffered = buffered_samples(ao);
         // The extra margin helps avoiding too many wakeups if the AO is fully
         // byte based and doesn't do proper chunked processing.
         int min_buffer = ao->buffer + 64;
@@ -227,10 +283,9 @@ static int play(struct ao *ao, void **data, int samples, int flags)
 {
     struct ao_push_state *p = ao->api_priv;
 
-    pthread_mutex_lock(&p->lock);
-
-    int write_samples = mp_audio_buffer_get_write_available(p->buffer);
-    write_samples = MPMIN(write_samples, samples);
+    int write_samples = MPMIN(ring_available(ao), samples);
+    for (int n = 0; n < ao->num_planes; n++)
+        mp_ring_write(p->buffers[n], data[n], write_samples * ao->sstride);
 
     MP_TRACE(ao, "samples=%d flags=%d r=%d\n", samples, flags, write_samples);
 
@@ -238,7 +293,13 @@ static int play(struct ao *ao, void **data, int samples, int flags)
         flags = flags & ~AOPLAY_FINAL_CHUNK;
     bool is_final = flags & AOPLAY_FINAL_CHUNK;
 
-    mp_audio_buffer_append(p->buffer, data, samples);
+    // The AO thread will see the new data on its own. This must be checked
+    // after writing the data; the AO thread does the reverse before it goes
+    // to sleep (see playthread()).
+    if (!is_final && atomic_load(&p->streaming))
+        return write_samples;
+
+    pthread_mutex_lock(&p->lock);
 
     bool got_data = write_samples > 0 || p->paused || p->final_chunk != is_final;
 
@@ -252,6 +313,7 @@ static int play(struct ao *ao, void **data, int samples, int flags)
         // will send new data as soon as it's available.
         wakeup_playthread(ao);
     }
+    update_streaming(ao);
     pthread_mutex_unlock(&p->lock);
     return write_samples;
 }
@@ -278,6 +340,51 @@ static bool realloc_silence(struct ao *ao, int samples)
     return true;
 }
 
+// Move up to the given number of samples from the ring buffers to the staging
+// buffer. Returns the number of samples in the staging buffer.
+// called locked
+static int fill_staging(struct ao *ao, int samples)
+{
+    struct ao_push_state *p = ao->api_priv;
+
+    if (samples > p->staging_alloc) {
+        for (int n = 0; n < ao->num_planes; n++) {
+            p->staging[n] = talloc_realloc(p, p->staging[n], uint8_t,
+                                           samples * ao->sstride);
+        }
+        p->staging_alloc = samples;
+    }
+
+    int read = MPMIN(ring_buffered(ao), samples - p->staged);
+    if (read > 0) {
+        for (int n = 0; n < ao->num_planes; n++) {
+            mp_ring_read(p->buffers[n], p->staging[n] + p->staged * ao->sstride,
+                         read * ao->sstride);
+        }
+        p->staged += read;
+    }
+    return p->staged;
+}
+
+// Remove the given number of samples from the start of the buffered data.
+// called locked
+static void consume_samples(struct ao *ao, int samples)
+{
+    struct ao_push_state *p = ao->api_priv;
+
+    int staged = MPMIN(samples, p->staged);
+    p->staged -= staged;
+    for (int n = 0; n < ao->num_planes; n++) {
+        // Usually the driver accepts everything, so this is rarely needed.
+        if (p->staged) {
+            memmove(p->staging[n], p->staging[n] + staged * ao->sstride,
+                    p->staged * ao->sstride);
+        }
+        if (samples > staged)
+            mp_ring_drain(p->buffers[n], (samples - staged) * ao->sstride);
+    }
+}
+
 // called locked
 static void ao_play_data(struct ao *ao)
 {
@@ -293,9 +400,10 @@ static void ao_play_data(struct ao *ao)
         planes = p->silence;
         samples = realloc_silence(ao, space) ? space : 0;
     } else {
-        mp_audio_buffer_peek(p->buffer, &planes, &samples);
+        planes = p->staging;
+        samples = fill_staging(ao, space);
     }
-    int max = samples;
+    int max = play_silence ? samples : buffered_samples(ao);
     if (samples > space)
         samples = space;
     int flags = 0;
@@ -304,12 +412,12 @@ static void ao_play_data(struct ao *ao)
     } else {
         samples = samples / ao->period_size * ao->period_size;
     }
-    MP_STATS(ao, "start ao fill");
+    MP_STATS_START(ao, "ao fill");
     ao_post_process_data(ao, (void **)planes, samples);
     int r = 0;
     if (samples)
         r = ao->driver->play(ao, (void **)planes, samples, flags);
-    MP_STATS(ao, "end ao fill");
+    MP_STATS_END(ao, "ao fill");
     if (r > samples) {
         MP_ERR(ao, "Audio device returned nonsense value.\n");
         r = samples;
@@ -328,7 +436,7 @@ static void ao_play_data(struct ao *ao)
         r = max;
     }
     if (!play_silence)
-        mp_audio_buffer_skip(p->buffer, r);
+        consume_samples(ao, r);
     if (r > 0)
         p->expected_end_time = 0;
     // Nothing written, but more input data than space - this must mean the
@@ -340,6 +448,7 @@ static void ao_play_data(struct ao *ao)
     // so the AO wakes us up properly if it needs more data.
     p->wait_on_ao = space == 0 || r > 0 || stuck;
     p->still_playing |= r > 0 && !play_silence;
+    p->device_full = r == space;
     // If we just filled the AO completely (r == space), don't refill for a
     // while. Prevents wakeup feedback with byte-granular AOs.
     int needed = unlocked_get_space(ao);
@@ -347,6 +456,7 @@ static void ao_play_data(struct ao *ao)
                 !(flags & AOPLAY_FINAL_CHUNK);
     if (more)
         ao->wakeup_cb(ao->wakeup_ctx); // request more data
+    update_streaming(ao);
     MP_TRACE(ao, "in=%d flags=%d space=%d r=%d wa/pl=%d/%d needed=%d more=%d\n",
              max, flags, space, r, p->wait_on_ao, p->still_playing, needed, more);
 }
@@ -363,13 +473,22 @@ static void *playthread(void *arg)
         if (playing)
             ao_play_data(ao);
 
+        if (!p->wait_on_ao || !playing) {
+            // play() doesn't wake us up if streaming is set. Clear it before
+            // checking for new data, so that play() either takes the lock
+            // and wakes us up, or its data is visible here.
+            atomic_store(&p->streaming, false);
+            if (playing && p->still_playing && !p->paused && ring_buffered(ao))
+                p->need_wakeup = true;
+        }
+
         if (!p->need_wakeup) {
-            MP_STATS(ao, "start audio wait");
+            MP_STATS_START(ao, "audio wait");
             if (!p->wait_on_ao || !playing) {
                 // Avoid busy waiting, because the audio API will still report
                 // that it needs new data, even if we're not ready yet, or if
                 // get_space() decides that the amount of audio buffered in the
-                // device is enough, and p->buffer can be empty.
+                // device is enough, and the buffers can be empty.
                 // The most important part is that the decoder is woken up, so
                 // that the decoder will wake up us in turn.
                 MP_TRACE(ao, "buffer inactive.\n");
@@ -377,7 +496,7 @@ static void *playthread(void *arg)
                 bool was_playing = p->still_playing;
                 double timeout = -1;
                 if (p->still_playing && !p->paused && p->final_chunk &&
-                    !mp_audio_buffer_samples(p->buffer))
+                    !buffered_samples(ao))
                 {
                     double now = mp_time_sec();
                     if (!p->expected_end_time)
@@ -413,7 +532,7 @@ static void *playthread(void *arg)
                     }
                 }
             }
-            MP_STATS(ao, "end audio wait");
+            MP_STATS_END(ao, "audio wait");
         }
         p->need_wakeup = false;
     }
@@ -443,6 +562,7 @@ static void uninit(struct ao *ao)
 
     pthread_mutex_lock(&p->lock);
     p->terminate = true;
+    update_streaming(ao);
     wakeup_playthread(ao);
     pthread_mutex_unlock(&p->lock);
 
@@ -464,10 +584,8 @@ static int init(struct ao *ao)
         goto err;
     }
 
-    p->buffer = mp_audio_buffer_create(ao);
-    mp_audio_buffer_reinit_fmt(p->buffer, ao->format,
-                               &ao->channels, ao->samplerate);
-    mp_audio_buffer_preallocate_min(p->buffer, ao->buffer);
+    for (int n = 0; n < ao->num_planes; n++)
+        p->buffers[n] = mp_ring_new(ao, ao->buffer * ao->sstride);
     if (pthread_create(&p->thread, NULL, playthread, ao))
         goto err;
     return 0;
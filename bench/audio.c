@@ -0,0 +1,161 @@
+#include "bench.h"
+
+#include "audio/aframe.h"
+#include "audio/audio_buffer.h"
+#include "audio/chmap.h"
+#include "audio/format.h"
+#include "filters/f_swresample.h"
+#include "filters/filter.h"
+#include "filters/frame.h"
+#include "libmpv/client.h"
+#include "player/client.h"
+
+// Audio output buffering (mp_audio_buffer, as used by the AO push API) and
+// sample format conversion/resampling (mp_swresample, as inserted by the
+// audio output chain).
+
+#define FRAME_SAMPLES 1024
+
+struct buffer_ctx {
+    struct mp_audio_buffer *ab;
+    void *data[MP_NUM_CHANNELS];
+};
+
+static void run_buffer(void *p, int64_t n)
+{
+    struct buffer_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        mp_audio_buffer_append(c->ab, c->data, FRAME_SAMPLES);
+        // Read back in 2 parts, to cover the ring buffer wrapping around.
+        mp_audio_buffer_peek_linear(c->ab, FRAME_SAMPLES / 3);
+        mp_audio_buffer_skip(c->ab, FRAME_SAMPLES / 3);
+        int left = mp_audio_buffer_samples(c->ab) - FRAME_SAMPLES;
+        mp_audio_buffer_peek_linear(c->ab, left);
+        mp_audio_buffer_skip(c->ab, left);
+    }
+}
+
+static void bench_buffer(struct bench *b, int format, int channels)
+{
+    struct mp_chmap map;
+    mp_chmap_from_channels(&map, channels);
+
+    struct buffer_ctx c = {.ab = mp_audio_buffer_create(NULL)};
+    mp_audio_buffer_reinit_fmt(c.ab, format, &map, 48000);
+    int planes = af_fmt_is_planar(format) ? channels : 1;
+    int bytes = af_fmt_to_bytes(format) * channels / planes * FRAME_SAMPLES;
+    for (int n = 0; n < planes; n++)
+        c.data[n] = talloc_zero_size(c.ab, bytes);
+    // Keep a frame in the buffer, so reads never start at the buffer start.
+    mp_audio_buffer_append(c.ab, c.data, FRAME_SAMPLES);
+
+    char name[80];
+    snprintf(name, sizeof(name), "audio_buffer/%s/%dch",
+             af_fmt_to_str(format), channels);
+    bench_run(b, name, run_buffer, &c, bytes * (double)planes);
+
+    talloc_free(c.ab);
+}
+
+struct convert_ctx {
+    struct mp_filter *root;
+    struct mp_swresample *s;
+    struct mp_aframe *src;
+    double pts;
+};
+
+static void run_convert(void *p, int64_t n)
+{
+    struct convert_ctx *c = p;
+    struct mp_pin *in = c->s->f->pins[0];
+    struct mp_pin *out = c->s->f->pins[1];
+    for (int64_t i = 0; i < n;) {
+        // Drain output; this also requests new data if there is none.
+        struct mp_frame frame = mp_pin_out_read(out);
+        if (frame.type) {
+            if (frame.type != MP_FRAME_AUDIO)
+                abort();
+            mp_frame_unref(&frame);
+            continue;
+        }
+        if (mp_pin_in_needs_data(in)) {
+            struct mp_aframe *fr = mp_aframe_new_ref(c->src);
+            mp_aframe_set_pts(fr, c->pts);
+            c->pts += mp_aframe_duration(fr);
+            mp_pin_in_write(in, MAKE_FRAME(MP_FRAME_AUDIO, fr));
+            i++;
+        }
+        mp_filter_run(c->root);
+    }
+}
+
+static void bench_convert(struct bench *b, struct mpv_global *global,
+                          int in_format, int in_rate, int out_format,
+                          int out_rate, int channels)
+{
+    struct mp_chmap map;
+    mp_chmap_from_channels(&map, channels);
+
+    struct convert_ctx c = {
+        .root = mp_filter_create_root(global),
+        .src = mp_aframe_create(),
+    };
+    struct mp_resample_opts opts = MP_RESAMPLE_OPTS_DEF;
+    c.s = mp_swresample_create(c.root, &opts);
+    if (!c.s)
+        abort();
+    c.s->out_format = out_format;
+    c.s->out_rate = out_rate;
+    mp_pin_set_manual_connection(c.s->f->pins[0], true);
+    mp_pin_set_manual_connection(c.s->f->pins[1], true);
+
+    mp_aframe_set_format(c.src, in_format);
+    mp_aframe_set_chmap(c.src, &map);
+    mp_aframe_set_rate(c.src, in_rate);
+    struct mp_aframe_pool *pool = mp_aframe_pool_create(NULL);
+    if (mp_aframe_pool_allocate(pool, c.src, FRAME_SAMPLES) < 0)
+        abort();
+    mp_aframe_set_silence(c.src, 0, FRAME_SAMPLES);
+    // Something that is not all zero. (Only the first plane, but good enough.)
+    uint8_t *data = mp_aframe_get_data_rw(c.src)[0];
+    size_t size = mp_aframe_get_sstride(c.src) * FRAME_SAMPLES;
+    for (size_t n = 0; n < size; n++)
+        data[n] = n * 0x9E3779B1u >> 24;
+
+    char name[80];
+    snprintf(name, sizeof(name), "swresample/%s-%d/%s-%d/%dch",
+             af_fmt_to_str(in_format), in_rate, af_fmt_to_str(out_format),
+             out_rate, channels);
+    size_t planes = mp_aframe_get_planes(c.src);
+    bench_run(b, name, run_convert, &c, size * (double)planes);
+
+    talloc_free(c.root);
+    talloc_free(c.src);
+    talloc_free(pool);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "audio");
+
+    bench_buffer(&b, AF_FORMAT_S16, 2);
+    bench_buffer(&b, AF_FORMAT_FLOAT, 2);
+    bench_buffer(&b, AF_FORMAT_FLOATP, 6);
+
+    // Needed for the filter root only.
+    mpv_handle *ctx = mpv_create();
+    if (!ctx || mpv_set_option_string(ctx, "config", "no") < 0 ||
+        mpv_set_option_string(ctx, "terminal", "no") < 0 ||
+        mpv_initialize(ctx) < 0)
+        abort();
+    struct mpv_global *global = mp_client_get_global(ctx);
+
+    bench_convert(&b, global, AF_FORMAT_S16, 48000, AF_FORMAT_FLOAT, 48000, 2);
+    bench_convert(&b, global, AF_FORMAT_FLOATP, 48000, AF_FORMAT_S16, 48000, 6);
+    bench_convert(&b, global, AF_FORMAT_S16, 44100, AF_FORMAT_FLOAT, 48000, 2);
+    bench_convert(&b, global, AF_FORMAT_FLOATP, 48000, AF_FORMAT_FLOAT, 44100, 6);
+
+    mpv_terminate_destroy(ctx);
+    return 0;
+}
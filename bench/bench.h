@@ -0,0 +1,119 @@
+#ifndef MP_BENCH_H
+#define MP_BENCH_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/common.h"
+#include "misc/bstr.h"
+#include "misc/json.h"
+#include "mpv_talloc.h"
+#include "osdep/timer.h"
+
+/*
+ * Micro-benchmark harness. A benchmark is a function which performs the
+ * measured operation n times. bench_run() picks n such that a single run
+ * takes at least MPV_BENCH_TIME seconds (default 0.2), repeats the run
+ * BENCH_RUNS times, and reports the fastest run as one JSON object per line
+ * on stdout:
+ *
+ *  {"suite":"json","name":"parse/small","iterations":123456,"runs":5,
+ *   "ns_per_op":812.5,"mb_per_s":140.2}
+ *
+ * "mb_per_s" (in 10^6 bytes/s) is only present if the benchmark passed the
+ * number of bytes processed per operation. Nothing else is written to stdout,
+ * so the output of all bench/ programs can be concatenated and fed to CI.
+ *
+ * If MPV_BENCH_FILTER is set, only benchmarks whose "suite/name" contains
+ * it as substring are run.
+ */
+
+#define BENCH_RUNS 5
+
+struct bench {
+    const char *suite;
+    int64_t min_us;     // minimum duration of a run
+    const char *filter;
+};
+
+typedef void (*bench_fn)(void *ctx, int64_t n);
+
+static inline void bench_init(struct bench *b, const char *suite)
+{
+    mp_time_init();
+    *b = (struct bench){
+        .suite = suite,
+        .min_us = 200 * 1000,
+        .filter = getenv("MPV_BENCH_FILTER"),
+    };
+    const char *t = getenv("MPV_BENCH_TIME");
+    if (t && atof(t) > 0)
+        b->min_us = atof(t) * 1e6;
+}
+
+static inline bool bench_enabled(struct bench *b, const char *name)
+{
+    if (!b->filter || !b->filter[0])
+        return true;
+    char full[256];
+    snprintf(full, sizeof(full), "%s/%s", b->suite, name);
+    return strstr(full, b->filter);
+}
+
+static inline int64_t bench_time(bench_fn fn, void *ctx, int64_t n)
+{
+    int64_t start = mp_time_us();
+    fn(ctx, n);
+    return mp_time_us() - start;
+}
+
+// Run and report a benchmark. bytes is the amount of data processed by each
+// operation, or 0 if throughput makes no sense for it.
+static inline void bench_run(struct bench *b, const char *name, bench_fn fn,
+                             void *ctx, double bytes)
+{
+    if (!bench_enabled(b, name))
+        return;
+
+    // Calibrate. This also warms up caches and lazily initialized state.
+    int64_t n = 1;
+    while (1) {
+        int64_t t = bench_time(fn, ctx, n);
+        if (t >= b->min_us || n >= INT64_MAX / 100)
+            break;
+        double next = t > 0 ? n * 1.2 * b->min_us / t : n * 100.0;
+        n = MPCLAMP(next, n + 1, n * 100);
+    }
+
+    double best = INFINITY;
+    for (int r = 0; r < BENCH_RUNS; r++)
+        best = MPMIN(best, bench_time(fn, ctx, n) * 1e3 / n);
+
+    struct bstr out = {0};
+    struct json_writer w = {.dst = &out};
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "suite");
+    json_writer_string(&w, b->suite);
+    json_writer_key(&w, "name");
+    json_writer_string(&w, name);
+    json_writer_key(&w, "iterations");
+    json_writer_int64(&w, n);
+    json_writer_key(&w, "runs");
+    json_writer_int64(&w, BENCH_RUNS);
+    json_writer_key(&w, "ns_per_op");
+    json_writer_double(&w, best);
+    if (bytes > 0) {
+        json_writer_key(&w, "mb_per_s");
+        json_writer_double(&w, bytes / best * 1e3);
+    }
+    json_writer_end_object(&w);
+    printf("%.*s\n", BSTR_P(out));
+    fflush(stdout);
+    talloc_free(out.start);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "bench.h"
+
+#include "demux/demux.h"
+#include "demux/packet.h"
+#include "demux/stheader.h"
+#include "libmpv/client.h"
+#include "misc/thread_tools.h"
+#include "player/client.h"
+
+// Demuxer packet queue: read many small packets from a memory stream through
+// demux_rawvideo, so that the cost is dominated by packet allocation, queuing
+// and dequeuing in demux.c, rather than actual demuxing or I/O.
+
+#define PACKET_SIZE "4096"
+#define STREAM_SIZE (4 * 1024 * 1024)
+
+struct demux_ctx {
+    struct demuxer *demuxer;
+    struct sh_stream *sh;
+};
+
+static void run_read(void *p, int64_t n)
+{
+    struct demux_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        struct demux_packet *pkt = demux_read_packet(c->sh);
+        if (!pkt) {
+            // EOF; restart from the beginning.
+            demux_seek(c->demuxer, 0, 0);
+            pkt = demux_read_packet(c->sh);
+            if (!pkt)
+                abort();
+        }
+        talloc_free(pkt);
+    }
+}
+
+static void bench_read(struct bench *b, struct mpv_global *global,
+                       const char *url, bool threaded)
+{
+    struct mp_cancel *cancel = mp_cancel_new(NULL);
+    struct demuxer_params params = {.force_format = "rawvideo"};
+    struct demux_ctx c = {
+        .demuxer = demux_open_url(url, &params, cancel, global),
+    };
+    if (!c.demuxer)
+        abort();
+    c.sh = demux_get_stream(c.demuxer, 0);
+    demuxer_select_track(c.demuxer, c.sh, MP_NOPTS_VALUE, true);
+    if (threaded)
+        demux_start_thread(c.demuxer);
+
+    bench_run(b, threaded ? "read/thread" : "read/sync", run_read, &c,
+              atoi(PACKET_SIZE));
+
+    demux_free(c.demuxer);
+    talloc_free(cancel);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "demux");
+
+    mpv_handle *ctx = mpv_create();
+    if (!ctx || mpv_set_option_string(ctx, "config", "no") < 0 ||
+        mpv_set_option_string(ctx, "terminal", "no") < 0 ||
+        mpv_set_option_string(ctx, "demuxer-rawvideo-size", PACKET_SIZE) < 0 ||
+        mpv_initialize(ctx) < 0)
+        abort();
+    struct mpv_global *global = mp_client_get_global(ctx);
+
+    char *url = talloc_size(NULL, STREAM_SIZE + 10);
+    strcpy(url, "memory://");
+    memset(url + strlen(url), 'x', STREAM_SIZE);
+    url[STREAM_SIZE + 9] = '\0';
+
+    bench_read(&b, global, url, false);
+    bench_read(&b, global, url, true);
+
+    talloc_free(url);
+    mpv_terminate_destroy(ctx);
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "bench.h"
+
+#include "sub/draw_bmp.h"
+#include "sub/osd.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+
+// Blend subtitle bitmaps onto video frames, as done by vo_image, screenshots,
+// the software render API and --blend-subtitles=video with software VOs.
+
+struct blend_ctx {
+    struct mp_image *dst;
+    struct sub_bitmaps sbs;
+    struct mp_draw_sub_cache *cache;
+};
+
+static void run_blend(void *p, int64_t n)
+{
+    struct blend_ctx *c = p;
+    for (int64_t i = 0; i < n; i++)
+        mp_draw_sub_bitmaps(&c->cache, c->dst, &c->sbs);
+}
+
+// Two lines of text near the bottom of the screen: many small glyph bitmaps
+// for libass, or one bitmap per line for RGBA (like image subtitles).
+static void gen_parts(void *ta_ctx, struct sub_bitmaps *sbs, int w, int h,
+                      bool rgba, bool scaled)
+{
+    int glyph_w = 36, glyph_h = 54, glyphs = 30;
+    for (int line = 0; line < 2; line++) {
+        int line_w = glyph_w * glyphs;
+        int x0 = (w - line_w) / 2;
+        int y0 = h - (2 - line) * glyph_h * 3 / 2 - glyph_h;
+        int num = rgba ? 1 : glyphs;
+        for (int g = 0; g < num; g++) {
+            struct sub_bitmap sb = {
+                .w = rgba ? line_w : glyph_w,
+                .h = glyph_h,
+                .x = x0 + g * glyph_w,
+                .y = y0,
+                .libass.color = 0xFFFFFF00,
+            };
+            sb.dw = sb.w;
+            sb.dh = sb.h;
+            if (scaled) {
+                // Source bitmap at half resolution.
+                sb.w /= 2;
+                sb.h /= 2;
+            }
+            struct mp_image *bmp =
+                mp_image_alloc(rgba ? IMGFMT_BGRA : IMGFMT_Y8, sb.w, sb.h);
+            if (!bmp)
+                abort();
+            talloc_steal(ta_ctx, bmp);
+            for (int y = 0; y < sb.h; y++) {
+                uint8_t *px = bmp->planes[0] + y * bmp->stride[0];
+                for (int x = 0; x < sb.w; x++) {
+                    // Rough glyph shape: opaque core, antialiased edges.
+                    int a = (x * 7 + y * 13) % 64 < 40 ? 255 : (x * 31) & 0xFF;
+                    if (rgba) {
+                        // premultiplied BGRA
+                        px[x * 4 + 0] = a;
+                        px[x * 4 + 1] = a * 3 / 4;
+                        px[x * 4 + 2] = a / 2;
+                        px[x * 4 + 3] = a;
+                    } else {
+                        px[x] = a;
+                    }
+                }
+            }
+            sb.bitmap = bmp->planes[0];
+            sb.stride = bmp->stride[0];
+            MP_TARRAY_APPEND(ta_ctx, sbs->parts, sbs->num_parts, sb);
+        }
+    }
+}
+
+static void bench_blend(struct bench *b, int imgfmt, bool rgba, bool scaled)
+{
+    int w = 1920, h = 1080;
+    void *ta_ctx = talloc_new(NULL);
+    struct blend_ctx c = {
+        .dst = mp_image_alloc(imgfmt, w, h),
+        .sbs = {
+            .format = rgba ? SUBBITMAP_RGBA : SUBBITMAP_LIBASS,
+            .change_id = 1,
+        },
+    };
+    if (!c.dst)
+        abort();
+    talloc_steal(ta_ctx, c.dst);
+    mp_image_clear(c.dst, 0, 0, w, h);
+    gen_parts(ta_ctx, &c.sbs, w, h, rgba, scaled);
+
+    size_t bytes = 0;
+    for (int n = 0; n < c.sbs.num_parts; n++)
+        bytes += c.sbs.parts[n].dw * (size_t)c.sbs.parts[n].dh;
+
+    char name[80];
+    snprintf(name, sizeof(name), "%s%s/%s/%dx%d", rgba ? "rgba" : "libass",
+             scaled ? "-scaled" : "", mp_imgfmt_to_name(imgfmt), w, h);
+    // Throughput is in covered screen pixels.
+    bench_run(b, name, run_blend, &c, bytes);
+
+    talloc_free(c.cache);
+    talloc_free(ta_ctx);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "draw_bmp");
+
+    int fmts[] = {IMGFMT_420P, IMGFMT_BGR0, IMGFMT_P010};
+    for (int n = 0; n < MP_ARRAY_SIZE(fmts); n++) {
+        bench_blend(&b, fmts[n], false, false);
+        bench_blend(&b, fmts[n], true, false);
+        bench_blend(&b, fmts[n], true, true);
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#include "demux/demux.h"
+#include "libmpv/client.h"
+#include "misc/thread_tools.h"
+#include "player/client.h"
+
+// Synthetic EDLs with many segments, which reference many copies of the same
+// clip, so that each file needs its own demuxer: opening the EDL (parallel
+// source opening and source lookup by filename), with and without !lazy_open,
+// and seeking across the timeline (segment lookup).
+
+#define NUM_FILES 200
+#define NUM_PARTS 4000
+#define PART_LEN 0.5
+#define CLIP_LEN 10 // must match the source
+#define SOURCE "av://lavfi:testsrc=duration=10:size=160x90:rate=10"
+
+struct edl_ctx {
+    struct mpv_global *global;
+    const char *path;
+    struct demuxer *demuxer;
+    int64_t seeks;
+};
+
+static struct demuxer *open_edl(struct edl_ctx *c, struct mp_cancel *cancel)
+{
+    struct demuxer *d = demux_open_url(c->path, &(struct demuxer_params){0},
+                                       cancel, c->global);
+    if (!d)
+        abort();
+    return d;
+}
+
+static void run_open(void *p, int64_t n)
+{
+    struct edl_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        struct mp_cancel *cancel = mp_cancel_new(NULL);
+        demux_free(open_edl(c, cancel));
+        talloc_free(cancel);
+    }
+}
+
+// Each op seeks to a different segment, spread over the whole timeline.
+static void run_seek(void *p, int64_t n)
+{
+    struct edl_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        int part = (c->seeks++ * 997) % NUM_PARTS;
+        demux_seek(c->demuxer, part * PART_LEN, 0);
+    }
+}
+
+static char *write_edl(const char *dir, bool lazy)
+{
+    char *path = talloc_asprintf(NULL, "%s/%s.edl", dir, lazy ? "lazy" : "full");
+    FILE *f = fopen(path, "w");
+    if (!f)
+        abort();
+    fprintf(f, "# mpv EDL v0\n");
+    if (lazy)
+        fprintf(f, "!lazy_open\n");
+    int per_file = CLIP_LEN / PART_LEN;
+    for (int n = 0; n < NUM_PARTS; n++) {
+        fprintf(f, "%d.mkv,%f,%f\n", n % NUM_FILES,
+                (n / NUM_FILES % per_file) * PART_LEN, PART_LEN);
+    }
+    if (fclose(f))
+        abort();
+    return path;
+}
+
+static bool encode_clip(const char *path)
+{
+    mpv_handle *ctx = mpv_create();
+    if (!ctx)
+        abort();
+    // Encoding support is optional.
+    bool ok = mpv_set_option_string(ctx, "config", "no") >= 0 &&
+              mpv_set_option_string(ctx, "terminal", "no") >= 0 &&
+              mpv_set_option_string(ctx, "o", path) >= 0 &&
+              mpv_set_option_string(ctx, "ovc", "mpeg4") >= 0 &&
+              mpv_set_option_string(ctx, "ovcopts", "g=5") >= 0 &&
+              mpv_initialize(ctx) >= 0;
+    if (ok) {
+        const char *cmd[] = {"loadfile", SOURCE, NULL};
+        ok = mpv_command(ctx, cmd) >= 0;
+        while (ok) {
+            mpv_event *ev = mpv_wait_event(ctx, -1);
+            if (ev->event_id == MPV_EVENT_END_FILE) {
+                mpv_event_end_file *end = ev->data;
+                ok = end->reason == MPV_END_FILE_REASON_EOF;
+                break;
+            }
+        }
+    }
+    mpv_terminate_destroy(ctx);
+    return ok && access(path, R_OK) == 0;
+}
+
+static void copy_file(const char *src, const char *dst)
+{
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    if (!in || !out)
+        abort();
+    char buf[64 * 1024];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, len, out) != len)
+            abort();
+    }
+    fclose(in);
+    if (fclose(out))
+        abort();
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "edl");
+
+    char dir[] = "/tmp/mpv-bench-XXXXXX";
+    if (!mkdtemp(dir))
+        abort();
+    void *tmp = talloc_new(NULL);
+
+    char *clip = talloc_asprintf(tmp, "%s/clip.mkv", dir);
+    if (!encode_clip(clip)) {
+        fprintf(stderr, "edl: encoding not available, skipping\n");
+        unlink(clip);
+        rmdir(dir);
+        talloc_free(tmp);
+        return 0;
+    }
+    char **files = talloc_array(tmp, char *, NUM_FILES);
+    for (int n = 0; n < NUM_FILES; n++) {
+        files[n] = talloc_asprintf(tmp, "%s/%d.mkv", dir, n);
+        copy_file(clip, files[n]);
+    }
+
+    mpv_handle *ctx = mpv_create();
+    if (!ctx || mpv_set_option_string(ctx, "config", "no") < 0 ||
+        mpv_set_option_string(ctx, "terminal", "no") < 0 ||
+        mpv_initialize(ctx) < 0)
+        abort();
+
+    struct edl_ctx c = {.global = mp_client_get_global(ctx)};
+    char *full = talloc_steal(tmp, write_edl(dir, false));
+    char *lazy = talloc_steal(tmp, write_edl(dir, true));
+
+    c.path = full;
+    bench_run(&b, "open/full-4000", run_open, &c, 0);
+    c.path = lazy;
+    bench_run(&b, "open/lazy-4000", run_open, &c, 0);
+
+    c.path = full;
+    struct mp_cancel *cancel = mp_cancel_new(tmp);
+    c.demuxer = open_edl(&c, cancel);
+    bench_run(&b, "seek/full-4000", run_seek, &c, 0);
+    demux_free(c.demuxer);
+
+    mpv_terminate_destroy(ctx);
+
+    unlink(full);
+    unlink(lazy);
+    for (int n = 0; n < NUM_FILES; n++)
+        unlink(files[n]);
+    unlink(clip);
+    rmdir(dir);
+    talloc_free(tmp);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "bench.h"
+
+#include "video/img_format.h"
+#include "video/mp_image.h"
+
+// Image copies and clears, as done for every frame by filters, screenshots,
+// the software render API and so on.
+
+struct copy_ctx {
+    struct mp_image *src, *dst;
+    int line_bytes, h;
+};
+
+static void run_image_copy(void *p, int64_t n)
+{
+    struct copy_ctx *c = p;
+    for (int64_t i = 0; i < n; i++)
+        mp_image_copy(c->dst, c->src);
+}
+
+static void run_image_clear(void *p, int64_t n)
+{
+    struct copy_ctx *c = p;
+    for (int64_t i = 0; i < n; i++)
+        mp_image_clear(c->dst, 0, 0, c->dst->w, c->dst->h);
+}
+
+static void run_memcpy_pic(void *p, int64_t n)
+{
+    struct copy_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        memcpy_pic(c->dst->planes[0], c->src->planes[0], c->line_bytes, c->h,
+                   c->dst->stride[0], c->src->stride[0]);
+    }
+}
+
+static size_t image_bytes(struct mp_image *img)
+{
+    size_t bytes = 0;
+    for (int p = 0; p < img->num_planes; p++) {
+        bytes += (mp_image_plane_w(img, p) * (size_t)img->fmt.bpp[p] + 7) / 8 *
+                 mp_image_plane_h(img, p);
+    }
+    return bytes;
+}
+
+static void bench_format(struct bench *b, int imgfmt, int w, int h)
+{
+    struct copy_ctx c = {
+        .src = mp_image_alloc(imgfmt, w, h),
+        .dst = mp_image_alloc(imgfmt, w, h),
+    };
+    if (!c.src || !c.dst)
+        abort();
+    mp_image_clear(c.src, 0, 0, w, h);
+
+    char name[80];
+    size_t bytes = image_bytes(c.src);
+    snprintf(name, sizeof(name), "mp_image_copy/%s/%dx%d",
+             mp_imgfmt_to_name(imgfmt), w, h);
+    bench_run(b, name, run_image_copy, &c, bytes);
+    snprintf(name, sizeof(name), "mp_image_clear/%s/%dx%d",
+             mp_imgfmt_to_name(imgfmt), w, h);
+    bench_run(b, name, run_image_clear, &c, bytes);
+
+    talloc_free(c.src);
+    talloc_free(c.dst);
+}
+
+static void bench_memcpy_pic(struct bench *b, int w, int h, int pad)
+{
+    struct copy_ctx c = {
+        .src = mp_image_alloc(IMGFMT_Y8, w, h),
+        .dst = mp_image_alloc(IMGFMT_Y8, w + pad, h),
+        .line_bytes = w,
+        .h = h,
+    };
+    if (!c.src || !c.dst)
+        abort();
+    memset(c.src->planes[0], 0x80, c.src->stride[0] * (size_t)h);
+
+    // With the same stride on both sides, memcpy_pic() does a single memcpy.
+    char name[80];
+    snprintf(name, sizeof(name), "memcpy_pic/%dx%d/%s", w, h,
+             c.dst->stride[0] == c.src->stride[0] ? "packed" : "strided");
+    bench_run(b, name, run_memcpy_pic, &c, w * (size_t)h);
+
+    talloc_free(c.src);
+    talloc_free(c.dst);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "image");
+
+    bench_format(&b, IMGFMT_420P, 1920, 1080);
+    bench_format(&b, IMGFMT_420P, 3840, 2160);
+    bench_format(&b, IMGFMT_RGB0, 1920, 1080);
+    bench_format(&b, IMGFMT_P010, 3840, 2160);
+
+    bench_memcpy_pic(&b, 1920, 1080, 0);
+    bench_memcpy_pic(&b, 1920, 1080, 128);
+    bench_memcpy_pic(&b, 3840, 2160, 0);
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "bench.h"
+
+#include "libmpv/client.h"
+#include "misc/bstr.h"
+#include "misc/json.h"
+
+// JSON parsing and writing, as used by the JSON IPC and scripts.
+
+#define MAX_DEPTH 20
+
+struct json_ctx {
+    char *text;         // original document
+    char *buf;          // copy for parsing (the parser mutates its input)
+    size_t len;
+    struct mpv_node node;
+    struct json_arena *arena;
+};
+
+static void run_parse(void *p, int64_t n)
+{
+    struct json_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        memcpy(c->buf, c->text, c->len + 1);
+        void *tmp = talloc_new(NULL);
+        struct mpv_node node;
+        char *src = c->buf;
+        if (json_parse(tmp, &node, &src, MAX_DEPTH) < 0)
+            abort();
+        talloc_free(tmp);
+    }
+}
+
+static void run_parse_arena(void *p, int64_t n)
+{
+    struct json_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        memcpy(c->buf, c->text, c->len + 1);
+        struct mpv_node node;
+        char *src = c->buf;
+        if (json_parse_arena(c->arena, &node, &src, MAX_DEPTH) < 0)
+            abort();
+        json_arena_reset(c->arena);
+    }
+}
+
+static void run_write(void *p, int64_t n)
+{
+    struct json_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        char *s = talloc_strdup(NULL, "");
+        if (json_write(&s, &c->node) < 0)
+            abort();
+        talloc_free(s);
+    }
+}
+
+static void run_writer(void *p, int64_t n)
+{
+    struct json_ctx *c = p;
+    struct bstr out = {0};
+    for (int64_t i = 0; i < n; i++) {
+        out.len = 0;
+        struct json_writer w = {.dst = &out};
+        if (json_writer_node(&w, &c->node) < 0)
+            abort();
+    }
+    talloc_free(out.start);
+}
+
+static void bench_doc(struct bench *b, const char *name, char *text)
+{
+    struct json_ctx c = {
+        .text = text,
+        .len = strlen(text),
+        .arena = json_arena_create(NULL),
+    };
+    c.buf = talloc_size(c.arena, c.len + 1);
+    // The tree for the write benchmarks points into its own copy of the text.
+    void *tmp = talloc_new(NULL);
+    char *src = talloc_strdup(tmp, text);
+    if (json_parse(tmp, &c.node, &src, MAX_DEPTH) < 0)
+        abort();
+
+    char full[80];
+    snprintf(full, sizeof(full), "parse/%s", name);
+    bench_run(b, full, run_parse, &c, c.len);
+    snprintf(full, sizeof(full), "parse_arena/%s", name);
+    bench_run(b, full, run_parse_arena, &c, c.len);
+    snprintf(full, sizeof(full), "write/%s", name);
+    bench_run(b, full, run_write, &c, c.len);
+    snprintf(full, sizeof(full), "writer/%s", name);
+    bench_run(b, full, run_writer, &c, c.len);
+
+    talloc_free(tmp);
+    talloc_free(c.arena);
+}
+
+// Something like the "track-list" property of a file with many tracks.
+static char *gen_track_list(void *ta_ctx, int num)
+{
+    struct bstr out = {0};
+    struct json_writer w = {.dst = &out};
+    const char *types[] = {"video", "audio", "sub"};
+    json_writer_begin_array(&w);
+    for (int n = 0; n < num; n++) {
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "id");
+        json_writer_int64(&w, n + 1);
+        json_writer_key(&w, "type");
+        json_writer_string(&w, types[n % 3]);
+        json_writer_key(&w, "src-id");
+        json_writer_int64(&w, n);
+        json_writer_key(&w, "title");
+        json_writer_string(&w, "Commentary \"track\" \xc3\xa9\\ with escapes");
+        json_writer_key(&w, "lang");
+        json_writer_string(&w, "eng");
+        json_writer_key(&w, "default");
+        json_writer_flag(&w, n < 3);
+        json_writer_key(&w, "external");
+        json_writer_flag(&w, false);
+        json_writer_key(&w, "codec");
+        json_writer_string(&w, "h264");
+        json_writer_key(&w, "demux-fps");
+        json_writer_double(&w, 23.976023976);
+        json_writer_key(&w, "demux-w");
+        json_writer_int64(&w, 1920);
+        json_writer_key(&w, "demux-h");
+        json_writer_int64(&w, 1080);
+        json_writer_key(&w, "ff-index");
+        json_writer_null(&w);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_array(&w);
+    char *res = bstrto0(ta_ctx, out);
+    talloc_free(out.start);
+    return res;
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "json");
+
+    void *ta_ctx = talloc_new(NULL);
+
+    char ipc[] = "{\"command\": [\"get_property\", \"time-pos\"], "
+                 "\"request_id\": 123, \"async\": true}";
+    bench_doc(&b, "ipc", ipc);
+    bench_doc(&b, "track-list/10", gen_track_list(ta_ctx, 10));
+    bench_doc(&b, "track-list/1000", gen_track_list(ta_ctx, 1000));
+
+    talloc_free(ta_ctx);
+    return 0;
+}
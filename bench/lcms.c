@@ -0,0 +1,87 @@
+#include <libavutil/cpu.h>
+
+#include "bench.h"
+
+#include "config.h"
+
+#if HAVE_LCMS2
+
+#include <lcms2.h>
+
+#include "common/msg.h"
+#include "video/out/gpu/lcms.h"
+
+// 3D LUT generation for --icc-profile (as done by vo_gpu), against the number
+// of threads.
+
+struct lcms_ctx {
+    struct gl_lcms *lcms;
+};
+
+static void run_lut(void *p, int64_t n)
+{
+    struct lcms_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        gl_lcms_update_options(c->lcms); // force regeneration
+        struct lut3d *lut = NULL;
+        if (!gl_lcms_get_lut3d(c->lcms, &lut, MP_CSP_PRIM_BT_2020,
+                               MP_CSP_TRC_BT_1886, NULL) || !lut)
+            abort();
+        talloc_free(lut);
+    }
+}
+
+static void bench_lut(struct bench *b, const char *size, int threads)
+{
+    struct mp_icc_opts opts = {
+        .profile_auto = 1,
+        .size_str = (char *)size,
+        .intent = MP_INTENT_RELATIVE_COLORIMETRIC,
+    };
+    struct lcms_ctx c = {
+        .lcms = gl_lcms_init(NULL, mp_null_log, NULL, &opts),
+    };
+
+    // sRGB as display profile, with BT.2020/BT.1886 video, so that the
+    // transform is not trivial.
+    cmsHPROFILE srgb = cmsCreate_sRGBProfile();
+    cmsUInt32Number len = 0;
+    if (!srgb || !cmsSaveProfileToMem(srgb, NULL, &len))
+        abort();
+    void *data = talloc_size(NULL, len);
+    if (!cmsSaveProfileToMem(srgb, data, &len))
+        abort();
+    cmsCloseProfile(srgb);
+    if (!gl_lcms_set_memory_profile(c.lcms, (bstr){data, len}))
+        abort();
+    gl_lcms_set_threads(c.lcms, threads);
+
+    char name[80];
+    snprintf(name, sizeof(name), "lut3d/%s/%d-threads", size, threads);
+    bench_run(b, name, run_lut, &c, 0);
+
+    talloc_free(c.lcms);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "lcms");
+
+    int cpus = MPMAX(av_cpu_count(), 1);
+    static const int counts[] = {1, 2, 4};
+    for (int n = 0; n < MP_ARRAY_SIZE(counts); n++)
+        bench_lut(&b, "64x64x64", counts[n]);
+    if (cpus > 4)
+        bench_lut(&b, "64x64x64", cpus);
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif
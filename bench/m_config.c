@@ -0,0 +1,98 @@
+#include <stddef.h>
+
+#include "bench.h"
+
+#include "common/global.h"
+#include "options/m_config.h"
+#include "options/m_option.h"
+
+// Option lookup by name, and propagation of option changes to caches, with a
+// group that has many string options, and a frequently changed option, like a
+// script setting a single option on every frame.
+
+#define NUM_STRINGS 200
+#define NUM_CACHES 16
+
+struct group_opts {
+    char *strings[NUM_STRINGS];
+    int value;
+};
+
+struct config_ctx {
+    struct m_config *config;
+    struct m_config_option *co;
+    struct m_config_cache *caches[NUM_CACHES];
+    const char *names[NUM_STRINGS];
+    int value;
+};
+
+static void run_lookup(void *p, int64_t n)
+{
+    struct config_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        if (!m_config_get_co(c->config, bstr0(c->names[i % NUM_STRINGS])))
+            abort();
+    }
+}
+
+static void run_change(void *p, int64_t n)
+{
+    struct config_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        *(int *)c->co->data = ++c->value;
+        m_config_notify_change_co(c->config, c->co);
+        for (int x = 0; x < NUM_CACHES; x++) {
+            if (!m_config_cache_update(c->caches[x]))
+                abort();
+        }
+    }
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "m_config");
+
+    void *tmp = talloc_new(NULL);
+    struct m_option *opts = talloc_zero_array(tmp, struct m_option,
+                                              NUM_STRINGS + 2);
+    struct config_ctx c = {0};
+    for (int n = 0; n < NUM_STRINGS; n++) {
+        c.names[n] = talloc_asprintf(tmp, "string-%d", n);
+        opts[n] = (struct m_option){
+            .name = c.names[n],
+            .type = &m_option_type_string,
+            .offset = offsetof(struct group_opts, strings[n]),
+        };
+    }
+    opts[NUM_STRINGS] = (struct m_option){
+        .name = "value",
+        .type = &m_option_type_int,
+        .offset = offsetof(struct group_opts, value),
+    };
+
+    struct mpv_global *global = talloc_zero(tmp, struct mpv_global);
+    c.config = m_config_new(global, NULL, sizeof(struct group_opts), NULL, opts);
+    c.config->global = global;
+    m_config_create_shadow(c.config);
+    for (int n = 0; n < NUM_STRINGS; n++) {
+        char *val = talloc_asprintf(tmp, "some string value %d", n);
+        if (m_config_set_option_raw(c.config,
+                m_config_get_co(c.config, bstr0(c.names[n])), &val, 0) < 0)
+            abort();
+    }
+    for (int n = 0; n < NUM_CACHES; n++)
+        c.caches[n] = m_config_cache_alloc(tmp, global, GLOBAL_CONFIG);
+    c.co = m_config_get_co(c.config, bstr0("value"));
+    if (!c.co)
+        abort();
+
+    bench_run(&b, "lookup/201", run_lookup, &c, 0);
+    bench_run(&b, "change/201/16-caches", run_change, &c, 0);
+
+    for (int n = 0; n < NUM_CACHES; n++)
+        talloc_free(c.caches[n]);
+    talloc_free(c.config);
+    talloc_free(tmp);
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#include "common/playlist.h"
+#include "demux/demux.h"
+#include "libmpv/client.h"
+#include "misc/thread_tools.h"
+#include "player/client.h"
+
+// Playlist file parsing (demux_playlist) on large synthetic playlists: the
+// time until the player can start playing ("first", the incremental mode used
+// by the player), and until all entries are read ("full", as with --playlist).
+// Also operations on the in-memory playlist ("ops").
+
+#define NUM_ENTRIES 200000
+#define NUM_OPS_ENTRIES 100000
+
+struct playlist_ctx {
+    struct mpv_global *global;
+    const char *path;
+    bool incremental;
+    bool read_all;
+};
+
+static void run_open(void *p, int64_t n)
+{
+    struct playlist_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        struct mp_cancel *cancel = mp_cancel_new(NULL);
+        struct demuxer_params params = {
+            .force_format = "playlist",
+            .playlist_incremental = c->incremental,
+        };
+        struct demuxer *demuxer =
+            demux_open_url(c->path, &params, cancel, c->global);
+        if (!demuxer || !demuxer->playlist)
+            abort();
+        struct playlist *pl = demuxer->playlist;
+        if (c->read_all && demuxer->playlist_incomplete) {
+            while (1) {
+                struct demux_ctrl_read_playlist r = {.pl = pl};
+                if (demux_control(demuxer, DEMUXER_CTRL_READ_PLAYLIST, &r) !=
+                    CONTROL_OK || r.eof)
+                    break;
+            }
+        }
+        if (c->read_all && pl->num_entries != NUM_ENTRIES)
+            abort();
+        demux_free(demuxer);
+        talloc_free(cancel);
+    }
+}
+
+static size_t write_playlist(const char *path, const char *format)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        abort();
+    bool m3u = strcmp(format, "m3u") == 0;
+    fprintf(f, m3u ? "#EXTM3U\n" : "[playlist]\n");
+    for (int n = 0; n < NUM_ENTRIES; n++) {
+        // Relative paths, so that the base path is added to every entry.
+        if (m3u) {
+            fprintf(f, "#EXTINF:%d,Artist %d - Title %d\n", 180 + n % 200,
+                    n / 12, n);
+            fprintf(f, "music/artist %d/track %05d.flac\n", n / 12, n);
+        } else {
+            fprintf(f, "File%d=music/artist %d/track %05d.flac\n", n + 1,
+                    n / 12, n);
+            fprintf(f, "Title%d=Artist %d - Title %d\n", n + 1, n / 12, n);
+        }
+    }
+    if (!m3u)
+        fprintf(f, "NumberOfEntries=%d\nVersion=2\n", NUM_ENTRIES);
+    long size = ftell(f);
+    if (fclose(f) || size < 0)
+        abort();
+    return size;
+}
+
+static void bench_playlist(struct bench *b, struct mpv_global *global,
+                           const char *dir, const char *format)
+{
+    char *path = talloc_asprintf(NULL, "%s/list.%s", dir, format);
+    size_t size = write_playlist(path, format);
+
+    struct playlist_ctx c = {.global = global, .path = path};
+    char name[80];
+
+    snprintf(name, sizeof(name), "full/%s-200k", format);
+    c.read_all = true;
+    bench_run(b, name, run_open, &c, size);
+
+    snprintf(name, sizeof(name), "first/%s-200k", format);
+    c.incremental = true;
+    c.read_all = false;
+    bench_run(b, name, run_open, &c, 0);
+
+    // Total cost of reading everything in chunks.
+    snprintf(name, sizeof(name), "incremental/%s-200k", format);
+    c.read_all = true;
+    bench_run(b, name, run_open, &c, size);
+
+    unlink(path);
+    talloc_free(path);
+}
+
+static void add_entries(struct playlist *pl)
+{
+    for (int n = 0; n < NUM_OPS_ENTRIES; n++) {
+        char name[20];
+        snprintf(name, sizeof(name), "%d", n);
+        playlist_add(pl, playlist_entry_new(name));
+    }
+}
+
+static void run_add_clear(void *p, int64_t n)
+{
+    struct playlist *pl = p;
+    for (int64_t i = 0; i < n; i++) {
+        add_entries(pl);
+        playlist_clear(pl);
+    }
+}
+
+static void run_shuffle(void *p, int64_t n)
+{
+    struct playlist *pl = p;
+    for (int64_t i = 0; i < n; i++)
+        playlist_shuffle(pl);
+}
+
+// Like reading the "playlist" and "playlist-pos" properties.
+static void run_index(void *p, int64_t n)
+{
+    struct playlist *pl = p;
+    for (int64_t i = 0; i < n; i++) {
+        struct playlist_entry *e =
+            playlist_entry_from_index(pl, rand() % NUM_OPS_ENTRIES);
+        if (playlist_entry_to_index(pl, e) < 0)
+            abort();
+    }
+}
+
+// Like the "playlist-move" command.
+static void run_move(void *p, int64_t n)
+{
+    struct playlist *pl = p;
+    for (int64_t i = 0; i < n; i++) {
+        playlist_move(pl, pl->entries[rand() % NUM_OPS_ENTRIES],
+                      pl->entries[rand() % NUM_OPS_ENTRIES]);
+    }
+}
+
+static void bench_ops(struct bench *b)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    bench_run(b, "ops/add+clear-100k", run_add_clear, pl, 0);
+    add_entries(pl);
+    bench_run(b, "ops/shuffle-100k", run_shuffle, pl, 0);
+    bench_run(b, "ops/index-100k", run_index, pl, 0);
+    bench_run(b, "ops/move-100k", run_move, pl, 0);
+    talloc_free(pl);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "playlist");
+
+    mpv_handle *ctx = mpv_create();
+    if (!ctx || mpv_set_option_string(ctx, "config", "no") < 0 ||
+        mpv_set_option_string(ctx, "terminal", "no") < 0 ||
+        mpv_initialize(ctx) < 0)
+        abort();
+    struct mpv_global *global = mp_client_get_global(ctx);
+
+    char dir[] = "/tmp/mpv-bench-XXXXXX";
+    if (!mkdtemp(dir))
+        abort();
+
+    bench_playlist(&b, global, dir, "m3u");
+    bench_playlist(&b, global, dir, "pls");
+    bench_ops(&b);
+
+    rmdir(dir);
+    mpv_terminate_destroy(ctx);
+    return 0;
+}
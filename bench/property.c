@@ -0,0 +1,143 @@
+#include "bench.h"
+
+#include "libmpv/client.h"
+
+// Property access through the client API, the way scripts and frontends
+// poll the player state. Each call is a roundtrip to the playloop thread.
+
+#define SOURCE "av://lavfi:testsrc=duration=100:size=320x240:rate=25"
+
+struct prop_ctx {
+    mpv_handle *mpv;
+    const char *name;
+    mpv_format format;
+};
+
+static void run_get(void *p, int64_t n)
+{
+    struct prop_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        union {
+            int flag;
+            int64_t int64;
+            double d;
+            char *s;
+            mpv_node node;
+        } val;
+        if (mpv_get_property(c->mpv, c->name, c->format, &val) < 0)
+            abort();
+        if (c->format == MPV_FORMAT_STRING)
+            mpv_free(val.s);
+        if (c->format == MPV_FORMAT_NODE)
+            mpv_free_node_contents(&val.node);
+    }
+}
+
+static void run_set(void *p, int64_t n)
+{
+    struct prop_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        double v = 50 + (i & 1);
+        if (mpv_set_property(c->mpv, c->name, MPV_FORMAT_DOUBLE, &v) < 0)
+            abort();
+    }
+}
+
+// A typical dashboard poll.
+static const char *const poll_names[] = {
+    "pause", "time-pos", "duration", "percent-pos", "filename", "media-title",
+    "volume", "mute", "speed", "playlist-pos", "playlist-count", "chapter",
+    "video-params", "audio-params", "estimated-vf-fps", "frame-drop-count",
+    "demuxer-cache-duration", "cache-buffering-state", "paused-for-cache",
+    "idle-active", NULL
+};
+
+static void run_poll_single(void *p, int64_t n)
+{
+    struct prop_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        for (int j = 0; poll_names[j]; j++) {
+            mpv_node val;
+            if (mpv_get_property(c->mpv, poll_names[j], MPV_FORMAT_NODE,
+                                 &val) >= 0)
+                mpv_free_node_contents(&val);
+        }
+    }
+}
+
+static void run_poll_bulk(void *p, int64_t n)
+{
+    struct prop_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        mpv_node val;
+        if (mpv_get_properties(c->mpv, (const char **)poll_names, &val) < 0)
+            abort();
+        mpv_free_node_contents(&val);
+    }
+}
+
+static void bench_get(struct bench *b, mpv_handle *mpv, const char *name,
+                      mpv_format format)
+{
+    const char *fmt_names[] = {
+        [MPV_FORMAT_STRING] = "string",
+        [MPV_FORMAT_FLAG] = "flag",
+        [MPV_FORMAT_INT64] = "int64",
+        [MPV_FORMAT_DOUBLE] = "double",
+        [MPV_FORMAT_NODE] = "node",
+    };
+    struct prop_ctx c = {mpv, name, format};
+    char full[80];
+    snprintf(full, sizeof(full), "get/%s/%s", name, fmt_names[format]);
+    bench_run(b, full, run_get, &c, 0);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "property");
+
+    mpv_handle *mpv = mpv_create();
+    if (!mpv)
+        abort();
+    const char *opts[][2] = {
+        {"config", "no"}, {"terminal", "no"}, {"vo", "null"}, {"ao", "null"},
+        {"pause", "yes"},
+    };
+    for (int n = 0; n < MP_ARRAY_SIZE(opts); n++) {
+        if (mpv_set_option_string(mpv, opts[n][0], opts[n][1]) < 0)
+            abort();
+    }
+    if (mpv_initialize(mpv) < 0)
+        abort();
+    const char *cmd[] = {"loadfile", SOURCE, NULL};
+    if (mpv_command(mpv, cmd) < 0)
+        abort();
+    while (1) {
+        mpv_event *ev = mpv_wait_event(mpv, -1);
+        if (ev->event_id == MPV_EVENT_PLAYBACK_RESTART)
+            break;
+        if (ev->event_id == MPV_EVENT_END_FILE)
+            abort();
+    }
+
+    bench_get(&b, mpv, "pause", MPV_FORMAT_FLAG);
+    bench_get(&b, mpv, "time-pos", MPV_FORMAT_DOUBLE);
+    bench_get(&b, mpv, "time-pos", MPV_FORMAT_STRING);
+    bench_get(&b, mpv, "estimated-frame-number", MPV_FORMAT_INT64);
+    bench_get(&b, mpv, "filename", MPV_FORMAT_STRING);
+    bench_get(&b, mpv, "track-list", MPV_FORMAT_NODE);
+    bench_get(&b, mpv, "video-params", MPV_FORMAT_NODE);
+    bench_get(&b, mpv, "playlist", MPV_FORMAT_NODE);
+    bench_get(&b, mpv, "track-list/count", MPV_FORMAT_INT64);
+
+    struct prop_ctx poll = {mpv};
+    bench_run(&b, "poll/20/get_property", run_poll_single, &poll, 0);
+    bench_run(&b, "poll/20/get_properties", run_poll_bulk, &poll, 0);
+
+    struct prop_ctx set = {mpv, "volume", MPV_FORMAT_DOUBLE};
+    bench_run(&b, "set/volume/double", run_set, &set, 0);
+
+    mpv_terminate_destroy(mpv);
+    return 0;
+}
@@ -0,0 +1,86 @@
+-- Cost of mp.get_property_native() calls from Lua scripts, the way osc.lua and
+-- stats.lua poll the player state. Run with:
+--
+--  mpv --no-config --idle=once --vo=null --ao=null --script=bench/property.lua
+--
+-- Output uses the same format as the C programs in bench/ (see bench.h), and
+-- MPV_BENCH_FILTER and MPV_BENCH_TIME work the same.
+
+local utils = require 'mp.utils'
+
+local SOURCE = "av://lavfi:testsrc=duration=100:size=320x240:rate=25"
+local RUNS = 5
+
+local min_time = tonumber(os.getenv("MPV_BENCH_TIME") or "")
+if not min_time or min_time <= 0 then
+    min_time = 0.2
+end
+local filter = os.getenv("MPV_BENCH_FILTER") or ""
+
+local function time_run(fn, n)
+    local start = mp.get_time()
+    fn(n)
+    return mp.get_time() - start
+end
+
+local function bench_run(name, fn)
+    if filter ~= "" and not ("lua-property/" .. name):find(filter, 1, true) then
+        return
+    end
+
+    local n = 1
+    while true do
+        local t = time_run(fn, n)
+        if t >= min_time then
+            break
+        end
+        local want = t > 0 and n * 1.2 * min_time / t or n * 100
+        n = math.floor(math.max(n + 1, math.min(want, n * 100)))
+    end
+
+    local best = math.huge
+    for r = 1, RUNS do
+        best = math.min(best, time_run(fn, n) * 1e9 / n)
+    end
+
+    io.write(utils.format_json({
+        suite = "lua-property",
+        name = name,
+        iterations = n,
+        runs = RUNS,
+        ns_per_op = best,
+    }) .. "\n")
+    io.flush()
+end
+
+local function bench_get(name)
+    bench_run("get/" .. name, function(n)
+        for i = 1, n do
+            if mp.get_property_native(name) == nil then
+                error("could not get " .. name)
+            end
+        end
+    end)
+end
+
+local function run()
+    bench_get("pause")
+    bench_get("time-pos")
+    bench_get("video-params")
+    bench_get("track-list")
+    bench_get("track-list/count")
+    bench_get("playlist")
+    bench_get("metadata")
+
+    mp.commandv("quit")
+end
+
+local function on_restart()
+    mp.unregister_event(on_restart)
+    run()
+end
+
+mp.register_event("playback-restart", on_restart)
+
+mp.set_property_bool("pause", true)
+mp.commandv("loadfile", SOURCE)
@@ -0,0 +1,73 @@
+#include "bench.h"
+
+#include "video/img_format.h"
+#include "video/mp_image.h"
+#include "video/sws_utils.h"
+
+// Software scaling and format conversion with libswscale (as used for
+// screenshots, vo_image, software VOs and the software render API), with and
+// without slice threading (--sws-threads).
+
+#define W 3840
+#define H 2160
+
+struct sws_ctx {
+    struct mp_sws_context *sws;
+    struct mp_image *src, *dst;
+};
+
+static void run_scale(void *p, int64_t n)
+{
+    struct sws_ctx *c = p;
+    for (int64_t i = 0; i < n; i++) {
+        if (mp_sws_scale(c->sws, c->dst, c->src) < 0)
+            abort();
+    }
+}
+
+static void bench_scale(struct bench *b, int src_fmt, int dst_fmt, int dst_w,
+                        int dst_h, int threads)
+{
+    struct sws_ctx c = {
+        .sws = mp_sws_alloc(NULL),
+        .src = mp_image_alloc(src_fmt, W, H),
+        .dst = mp_image_alloc(dst_fmt, dst_w, dst_h),
+    };
+    if (!c.src || !c.dst)
+        abort();
+    mp_image_clear(c.src, 0, 0, W, H);
+    c.sws->flags = mp_sws_fast_flags;
+    c.sws->threads = threads;
+
+    char name[80];
+    snprintf(name, sizeof(name), "%s/%s/%dx%d/%s",
+             mp_imgfmt_to_name(src_fmt), mp_imgfmt_to_name(dst_fmt), dst_w,
+             dst_h, threads == 1 ? "single" : "sliced");
+    bench_run(b, name, run_scale, &c, 0);
+
+    talloc_free(c.sws);
+    talloc_free(c.src);
+    talloc_free(c.dst);
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "sws");
+
+    static const struct {
+        int src, dst, w, h;
+    } convs[] = {
+        // Conversions without vertical filtering, which can be sliced.
+        {IMGFMT_NV12, IMGFMT_420P, W, H},
+        {IMGFMT_P010, IMGFMT_420P, W, H},
+        {IMGFMT_444P, IMGFMT_BGR0, W, H},
+        {IMGFMT_BGR0, IMGFMT_RGB0, W, H},
+    };
+    for (int n = 0; n < MP_ARRAY_SIZE(convs); n++) {
+        // Single-threaded, and one slice per CPU.
+        bench_scale(&b, convs[n].src, convs[n].dst, convs[n].w, convs[n].h, 1);
+        bench_scale(&b, convs[n].src, convs[n].dst, convs[n].w, convs[n].h, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "bench.h"
+
+// talloc allocation overhead, without and with memory accounting
+// (MPV_MEMORY_ACCOUNTING).
+
+static void run_alloc(void *p, int64_t n)
+{
+    for (int64_t i = 0; i < n; i++)
+        talloc_free(talloc_size(p, 64));
+}
+
+static void run_tree(void *p, int64_t n)
+{
+    for (int64_t i = 0; i < n; i++) {
+        void *parent = talloc_new(p);
+        for (int c = 0; c < 16; c++)
+            talloc_size(parent, 64);
+        talloc_free(parent);
+    }
+}
+
+int main(void)
+{
+    struct bench b;
+    bench_init(&b, "ta");
+
+    void *root = talloc_new(NULL);
+    bench_run(&b, "alloc+free/plain", run_alloc, root, 0);
+    bench_run(&b, "tree-16/plain", run_tree, root, 0);
+    talloc_free(root);
+
+    // Can't be disabled again.
+    ta_enable_accounting();
+    root = talloc_new(NULL);
+    talloc_set_account(root, "bench");
+    bench_run(&b, "alloc+free/accounted", run_alloc, root, 0);
+    bench_run(&b, "tree-16/accounted", run_tree, root, 0);
+    talloc_free(root);
+    return 0;
+}
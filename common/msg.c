@@ -36,12 +36,14 @@
 #include "options/path.h"
 #include "osdep/terminal.h"
 #include "osdep/io.h"
+#include "osdep/threads.h"
 #include "osdep/timer.h"
 
 #include "libmpv/client.h"
 
 #include "msg.h"
 #include "msg_control.h"
+#include "trace.h"
 
 struct mp_log_root {
     struct mpv_global *global;
@@ -60,7 +62,11 @@ struct mp_log_root {
     struct mp_log_buffer **buffers;
     int num_buffers;
     FILE *log_file;
+    // --- protected by mp_msg_lock and log_file_lock (either for reading)
+    struct mp_log_file_writer *log_file_writer;
+    // --- protected by mp_msg_lock
     FILE *stats_file;
+    struct mp_trace *trace;     // created with the first stats_file, then kept
     char *log_path;
     char *stats_path;
     // --- must be accessed atomically
@@ -68,6 +74,9 @@ struct mp_log_root {
      * (This is perhaps better than maintaining a globally accessible and
      * synchronized mp_log tree.) */
     atomic_ulong reload_counter;
+    // Whether log_file_writer is set. Only a hint for mp_msg_va(), which
+    // rechecks it under the lock.
+    atomic_bool log_file_async;
     // --- protected by mp_msg_lock
     bstr buffer;
 };
@@ -86,13 +95,38 @@ struct mp_log_buffer {
     struct mp_log_root *root;
     struct mp_ring *ring;
     int level;
+    int dropped;                // messages lost since the last write (locked)
     void (*wakeup_cb)(void *ctx);
     void *wakeup_cb_ctx;
 };
 
+// Writes --log-file output on a separate thread. The logging threads format
+// each message once, before taking mp_msg_lock, use the same text for the
+// terminal, and queue it after releasing the lock. The writer thread adds the
+// line prefixes and does the actual file I/O (which can block for a long time
+// on slow disks) without any locks shared with the logging threads. If the
+// writer can't keep up, messages are dropped and counted, instead of blocking
+// the caller or using unbounded memory.
+struct mp_log_file_writer {
+    FILE *file;
+    struct mp_log_buffer *queue;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    bool pending;               // new entries in queue (protected by lock)
+    bool terminate;             // (protected by lock)
+};
+
+// Maximum number of queued log file messages.
+#define LOG_FILE_QUEUE_SIZE 4096
+
 // Protects some (not all) state in mp_log_root
 static pthread_mutex_t mp_msg_lock = PTHREAD_MUTEX_INITIALIZER;
 
+// Serializes writing to the log file writer queue. If both are needed,
+// mp_msg_lock must be locked first.
+static pthread_mutex_t log_file_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static const struct mp_log null_log = {0};
 struct mp_log *const mp_null_log = (struct mp_log *)&null_log;
 
@@ -121,7 +155,7 @@ static void update_loglevel(struct mp_log *log)
         log->level = MPMAX(log->level, log->root->buffers[n]->level);
     if (log->root->log_file)
         log->level = MPMAX(log->level, MSGL_DEBUG);
-    if (log->root->stats_file)
+    if (log->root->stats_file && log->root->trace)
         log->level = MPMAX(log->level, MSGL_STATS);
     atomic_store(&log->reload_counter, atomic_load(&log->root->reload_counter));
     pthread_mutex_unlock(&mp_msg_lock);
@@ -281,18 +315,97 @@ static void print_terminal_line(struct mp_log *log, int lev,
     fflush(stream);
 }
 
+// Append an entry to the buffer, which takes over ownership of it. There is
+// only a single writer per buffer, serialized by mp_msg_lock (log_file_lock for
+// the log file writer queue). If the buffer is
+// full, the message is dropped, and the number of lost messages is reported
+// once there is room again. The last free slot is reserved for this notice.
+static void log_buffer_write(struct mp_log_buffer *buffer,
+                             struct mp_log_buffer_entry *entry)
+{
+    int avail = mp_ring_available(buffer->ring) / sizeof(void *);
+    if (buffer->dropped && avail >= 2) {
+        struct mp_log_buffer_entry *e = talloc_ptrtype(NULL, e);
+        *e = (struct mp_log_buffer_entry) {
+            .prefix = "overflow",
+            .level = MSGL_FATAL,
+            .time = mp_time_us(),
+            .text = talloc_asprintf(e, "log message buffer overflow: "
+                                    "%d messages skipped\n", buffer->dropped),
+        };
+        mp_ring_write(buffer->ring, (unsigned char *)&e, sizeof(e));
+        buffer->dropped = 0;
+        avail--;
+    }
+    if (avail >= 2) {
+        mp_ring_write(buffer->ring, (unsigned char *)&entry, sizeof(entry));
+    } else {
+        buffer->dropped++;
+        talloc_free(entry);
+    }
+    if (buffer->wakeup_cb)
+        buffer->wakeup_cb(buffer->wakeup_cb_ctx);
+}
+
+static bool want_log_file(struct mp_log *log, int lev)
+{
+    return log->root->log_file && lev <= MPMAX(MSGL_DEBUG, log->terminal_level);
+}
+
+// Queue a message to the log file writer, which adds the line prefixes. Takes
+// over ownership of text (a talloc allocation), and uses the first len bytes of
+// it, which must be complete lines. Called without mp_msg_lock held.
+static void queue_log_file(struct mp_log *log, int lev, int64_t time,
+                           char *text, size_t len)
+{
+    struct mp_log_buffer_entry *entry = talloc_ptrtype(NULL, entry);
+    *entry = (struct mp_log_buffer_entry) {
+        .prefix = talloc_strdup(entry, log->verbose_prefix),
+        .level = lev,
+        .text = talloc_steal(entry, text),
+        .time = time,
+    };
+    text[len] = '\0';
+
+    struct mp_log_root *root = log->root;
+    pthread_mutex_lock(&log_file_lock);
+    if (root->log_file_writer) {
+        log_buffer_write(root->log_file_writer->queue, entry);
+    } else {
+        talloc_free(entry); // log file was closed meanwhile
+    }
+    pthread_mutex_unlock(&log_file_lock);
+}
+
+// Write a line to the log file with mp_msg_lock held. If the log file writer
+// is used, this is only a fallback for messages that were not queued with
+// queue_log_file() because the writer was created concurrently.
 static void write_log_file(struct mp_log *log, int lev, char *text)
 {
     struct mp_log_root *root = log->root;
 
-    if (!root->log_file || lev > MPMAX(MSGL_DEBUG, log->terminal_level))
+    if (!want_log_file(log, lev))
         return;
 
-    fprintf(root->log_file, "[%8.3f][%c][%s] %s",
-            (mp_time_us() - MP_START_TIME) / 1e6,
-            mp_log_levels[lev][0],
-            log->verbose_prefix, text);
-    fflush(root->log_file);
+    if (!root->log_file_writer) {
+        fprintf(root->log_file, "[%8.3f][%c][%s] %s",
+                (mp_time_us() - MP_START_TIME) / 1e6,
+                mp_log_levels[lev][0],
+                log->verbose_prefix, text);
+        fflush(root->log_file);
+        return;
+    }
+
+    struct mp_log_buffer_entry *entry = talloc_ptrtype(NULL, entry);
+    *entry = (struct mp_log_buffer_entry) {
+        .prefix = talloc_strdup(entry, log->verbose_prefix),
+        .level = lev,
+        .text = talloc_strdup(entry, text),
+        .time = mp_time_us(),
+    };
+    pthread_mutex_lock(&log_file_lock);
+    log_buffer_write(root->log_file_writer->queue, entry);
+    pthread_mutex_unlock(&log_file_lock);
 }
 
 static void write_msg_to_buffers(struct mp_log *log, int lev, char *text)
@@ -304,66 +417,72 @@ static void write_msg_to_buffers(struct mp_log *log, int lev, char *text)
         if (buffer_level == MP_LOG_BUFFER_MSGL_TERM)
             buffer_level = log->terminal_level;
         if (lev <= buffer_level && lev != MSGL_STATUS) {
-            // Assuming a single writer (serialized by msg lock)
-            int avail = mp_ring_available(buffer->ring) / sizeof(void *);
-            if (avail < 1)
-                continue;
             struct mp_log_buffer_entry *entry = talloc_ptrtype(NULL, entry);
-            if (avail > 1) {
-                *entry = (struct mp_log_buffer_entry) {
-                    .prefix = talloc_strdup(entry, log->verbose_prefix),
-                    .level = lev,
-                    .text = talloc_strdup(entry, text),
-                };
-            } else {
-                // write overflow message to signal that messages might be lost
-                *entry = (struct mp_log_buffer_entry) {
-                    .prefix = "overflow",
-                    .level = MSGL_FATAL,
-                    .text = "log message buffer overflow\n",
-                };
-            }
-            mp_ring_write(buffer->ring, (unsigned char *)&entry, sizeof(entry));
-            if (buffer->wakeup_cb)
-                buffer->wakeup_cb(buffer->wakeup_cb_ctx);
+            *entry = (struct mp_log_buffer_entry) {
+                .prefix = talloc_strdup(entry, log->verbose_prefix),
+                .level = lev,
+                .text = talloc_strdup(entry, text),
+            };
+            log_buffer_write(buffer, entry);
         }
     }
 }
 
-static void dump_stats(struct mp_log *log, int lev, char *text)
-{
-    struct mp_log_root *root = log->root;
-    if (lev == MSGL_STATS && root->stats_file)
-        fprintf(root->stats_file, "%"PRId64" %s\n", mp_time_us(), text);
-}
-
 void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
 {
     if (!mp_msg_test(log, lev))
         return; // do not display
 
-    pthread_mutex_lock(&mp_msg_lock);
-
     struct mp_log_root *root = log->root;
 
-    root->buffer.len = 0;
-
-    if (log->partial[0])
-        bstr_xappend_asprintf(root, &root->buffer, "%s", log->partial);
-    log->partial[0] = '\0';
+    // If the log file writer is used, the message is formatted before taking
+    // the lock, into a buffer that is used for the terminal and log buffers,
+    // and then handed to the log file writer after releasing the lock. The
+    // timestamp is the time of logging.
+    bool own_text = lev != MSGL_STATS && atomic_load(&root->log_file_async);
+    bstr msg = {0};
+    int64_t msg_time = 0;
+    if (own_text) {
+        // Preallocate, so that vsnprintf() runs only once for most messages.
+        msg.start = talloc_size(NULL, 256);
+        bstr_xappend_vasprintf(NULL, &msg, format, va);
+        msg_time = mp_time_us();
+    }
+    bool queue_file = false;
 
-    bstr_xappend_vasprintf(root, &root->buffer, format, va);
+    pthread_mutex_lock(&mp_msg_lock);
 
-    char *text = root->buffer.start;
+    char *text;
+    if (own_text) {
+        // Rare; normally messages end with a full line.
+        if (log->partial[0]) {
+            bstr full = {0};
+            bstr_xappend(NULL, &full, bstr0(log->partial));
+            bstr_xappend(NULL, &full, msg);
+            talloc_free(msg.start);
+            msg = full;
+        }
+        text = (char *)msg.start;
+    } else {
+        root->buffer.len = 0;
+        if (log->partial[0])
+            bstr_xappend_asprintf(root, &root->buffer, "%s", log->partial);
+        bstr_xappend_vasprintf(root, &root->buffer, format, va);
+        text = root->buffer.start;
+    }
+    log->partial[0] = '\0';
 
     if (lev == MSGL_STATS) {
-        dump_stats(log, lev, text);
+        /* discard; stats are recorded in binary form with mp_msg_stats() */
     } else if (lev == MSGL_STATUS && !test_terminal_level(log, lev)) {
         /* discard */
     } else {
         if (lev == MSGL_STATUS && root->termosd)
             prepare_status_line(root, text);
 
+        queue_file = own_text && root->log_file_writer &&
+                     want_log_file(log, lev);
+
         // Split away each line. Normally we require full lines; buffer partial
         // lines if they happen.
         while (1) {
@@ -374,7 +493,8 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
             char saved = next[0];
             next[0] = '\0';
             print_terminal_line(log, lev, text, "");
-            write_log_file(log, lev, text);
+            if (!queue_file)
+                write_log_file(log, lev, text);
             write_msg_to_buffers(log, lev, text);
             next[0] = saved;
             text = next;
@@ -392,6 +512,14 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
     }
 
     pthread_mutex_unlock(&mp_msg_lock);
+
+    // Only the complete lines; text points to the partial line at the end.
+    char *msg_text = (char *)msg.start;
+    if (queue_file && text > msg_text) {
+        queue_log_file(log, lev, msg_time, msg_text, text - msg_text);
+    } else {
+        talloc_free(msg.start);
+    }
 }
 
 static void destroy_log(void *ptr)
@@ -462,13 +590,184 @@ void mp_msg_init(struct mpv_global *global)
     global->log = log;
 }
 
+static struct mp_log_buffer *log_buffer_alloc(struct mp_log_root *root,
+                                              int size, int level,
+                                              void (*wakeup_cb)(void *ctx),
+                                              void *wakeup_cb_ctx)
+{
+    struct mp_log_buffer *buffer = talloc_ptrtype(NULL, buffer);
+    *buffer = (struct mp_log_buffer) {
+        .root = root,
+        .level = level,
+        .ring = mp_ring_new(buffer, sizeof(void *) * size),
+        .wakeup_cb = wakeup_cb,
+        .wakeup_cb_ctx = wakeup_cb_ctx,
+    };
+    if (!buffer->ring)
+        abort();
+    return buffer;
+}
+
+static void log_buffer_free(struct mp_log_buffer *buffer)
+{
+    while (1) {
+        struct mp_log_buffer_entry *e = mp_msg_log_buffer_read(buffer);
+        if (!e)
+            break;
+        talloc_free(e);
+    }
+    talloc_free(buffer);
+}
+
+static void log_file_wakeup(void *ctx)
+{
+    struct mp_log_file_writer *w = ctx;
+    pthread_mutex_lock(&w->lock);
+    w->pending = true;
+    pthread_cond_signal(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Write all lines of the entry, each with the usual prefix.
+static void write_log_file_entry(FILE *f, struct mp_log_buffer_entry *e)
+{
+    double time = (e->time - MP_START_TIME) / 1e6;
+    char *text = e->text;
+    while (text[0]) {
+        char *end = strchr(text, '\n');
+        int len = end ? end - text + 1 : strlen(text);
+        fprintf(f, "[%8.3f][%c][%s] %.*s", time, mp_log_levels[e->level][0],
+                e->prefix, len, text);
+        text += len;
+    }
+}
+
+static void *log_file_thread(void *p)
+{
+    struct mp_log_file_writer *w = p;
+
+    mpthread_set_name("log-file");
+
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        // Read this before draining: the caller stops queuing messages before
+        // requesting termination, so the queue is empty after the next drain.
+        bool terminate = w->terminate;
+        w->pending = false;
+        pthread_mutex_unlock(&w->lock);
+
+        bool unflushed = false;
+        while (1) {
+            struct mp_log_buffer_entry *e = mp_msg_log_buffer_read(w->queue);
+            if (!e)
+                break;
+            write_log_file_entry(w->file, e);
+            // Errors are often followed by a crash or exit; don't let them
+            // sit in the stdio buffer.
+            bool important = e->level <= MSGL_ERR;
+            talloc_free(e);
+            unflushed = !important;
+            if (important)
+                fflush(w->file);
+        }
+        // Flush when the queue is drained, not per line.
+        if (unflushed)
+            fflush(w->file);
+
+        pthread_mutex_lock(&w->lock);
+        if (terminate)
+            break;
+        if (!w->pending)
+            pthread_cond_wait(&w->wakeup, &w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return NULL;
+}
+
+// Returns NULL if asynchronous writing is not possible; then the file must be
+// written directly.
+// Must be called with mp_msg_lock held.
+static struct mp_log_file_writer *log_file_writer_create(struct mp_log_root *root,
+                                                         FILE *file)
+{
+#if HAVE_ATOMICS
+    struct mp_log_file_writer *w = talloc_zero(NULL, struct mp_log_file_writer);
+    w->file = file;
+    w->queue = log_buffer_alloc(root, LOG_FILE_QUEUE_SIZE, MSGL_MAX,
+                                log_file_wakeup, w);
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wakeup, NULL);
+
+    if (pthread_create(&w->thread, NULL, log_file_thread, w)) {
+        log_buffer_free(w->queue);
+        pthread_cond_destroy(&w->wakeup);
+        pthread_mutex_destroy(&w->lock);
+        talloc_free(w);
+        return NULL;
+    }
+
+    return w;
+#else
+    return NULL;
+#endif
+}
+
+// Write all queued messages and stop the thread. The FILE is not closed.
+// Must be called with mp_msg_lock held (so that nothing is queued anymore).
+static void log_file_writer_destroy(struct mp_log_file_writer *w)
+{
+    if (!w)
+        return;
+
+    pthread_mutex_lock(&w->lock);
+    w->terminate = true;
+    pthread_cond_signal(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_join(w->thread, NULL);
+
+    log_buffer_free(w->queue);
+    pthread_cond_destroy(&w->wakeup);
+    pthread_mutex_destroy(&w->lock);
+    talloc_free(w);
+}
+
+// Must be called with mp_msg_lock held.
+static void set_log_file(struct mp_log_root *root, FILE *file)
+{
+    struct mp_log_file_writer *w = file ? log_file_writer_create(root, file)
+                                        : NULL;
+
+    pthread_mutex_lock(&log_file_lock);
+    struct mp_log_file_writer *old = root->log_file_writer;
+    root->log_file_writer = w;
+    pthread_mutex_unlock(&log_file_lock);
+    atomic_store(&root->log_file_async, !!w);
+
+    log_file_writer_destroy(old);
+}
+
+static void set_stats_file(struct mp_log_root *root, FILE *file)
+{
+    if (file && !root->trace)
+        root->trace = mp_trace_create();
+    if (root->trace)
+        mp_trace_set_file(root->trace, file);
+}
+
 // If opt is different from *current_path, reopen *file and update *current_path.
 // If there's an error, _append_ it to err_buf.
 // *current_path and *file are, rather trickily, only accessible under the
 // mp_msg_lock.
+// set_file is called with NULL before closing the old file, and with the new
+// file after opening it, so that the owner of the file can stop or start
+// writing to it.
 static void reopen_file(char *opt, char **current_path, FILE **file,
+                        void (*set_file)(struct mp_log_root *root, FILE *file),
                         const char *type, struct mpv_global *global)
 {
+    struct mp_log_root *root = global->log->root;
     void *tmp = talloc_new(NULL);
     bool fail = false;
 
@@ -480,6 +779,7 @@ static void reopen_file(char *opt, char **current_path, FILE **file,
 
     char *old_path = *current_path ? *current_path : "";
     if (strcmp(old_path, new_path) != 0) {
+        set_file(root, NULL);
         if (*file)
             fclose(*file);
         *file = NULL;
@@ -489,6 +789,8 @@ static void reopen_file(char *opt, char **current_path, FILE **file,
             *file = fopen(new_path, "wb");
             fail = !*file;
         }
+        if (*file)
+            set_file(root, *file);
     }
 
     pthread_mutex_unlock(&mp_msg_lock);
@@ -522,10 +824,10 @@ void mp_msg_update_msglevels(struct mpv_global *global, struct MPOpts *opts)
     pthread_mutex_unlock(&mp_msg_lock);
 
     reopen_file(opts->log_file, &root->log_path, &root->log_file,
-                "log", global);
+                set_log_file, "log", global);
 
     reopen_file(opts->dump_stats, &root->stats_path, &root->stats_file,
-                "stats", global);
+                set_stats_file, "stats", global);
 }
 
 void mp_msg_force_stderr(struct mpv_global *global, bool force_stderr)
@@ -551,9 +853,11 @@ bool mp_msg_has_log_file(struct mpv_global *global)
 void mp_msg_uninit(struct mpv_global *global)
 {
     struct mp_log_root *root = global->log->root;
+    mp_trace_destroy(root->trace);
     if (root->stats_file)
         fclose(root->stats_file);
     talloc_free(root->stats_path);
+    log_file_writer_destroy(root->log_file_writer);
     if (root->log_file)
         fclose(root->log_file);
     talloc_free(root->log_path);
@@ -575,16 +879,8 @@ struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
 
     pthread_mutex_lock(&mp_msg_lock);
 
-    struct mp_log_buffer *buffer = talloc_ptrtype(NULL, buffer);
-    *buffer = (struct mp_log_buffer) {
-        .root = root,
-        .level = level,
-        .ring = mp_ring_new(buffer, sizeof(void *) * size),
-        .wakeup_cb = wakeup_cb,
-        .wakeup_cb_ctx = wakeup_cb_ctx,
-    };
-    if (!buffer->ring)
-        abort();
+    struct mp_log_buffer *buffer =
+        log_buffer_alloc(root, size, level, wakeup_cb, wakeup_cb_ctx);
 
     MP_TARRAY_APPEND(root, root->buffers, root->num_buffers, buffer);
 
@@ -613,13 +909,7 @@ void mp_msg_log_buffer_destroy(struct mp_log_buffer *buffer)
 
 found:
 
-    while (1) {
-        struct mp_log_buffer_entry *e = mp_msg_log_buffer_read(buffer);
-        if (!e)
-            break;
-        talloc_free(e);
-    }
-    talloc_free(buffer);
+    log_buffer_free(buffer);
 
     atomic_fetch_add(&root->reload_counter, 1);
     pthread_mutex_unlock(&mp_msg_lock);
@@ -649,6 +939,21 @@ void mp_msg(struct mp_log *log, int lev, const char *format, ...)
     va_end(va);
 }
 
+// Record an event for --dump-stats. See mp_trace_record() for details.
+// Thread-safety: see mp_msg().
+void mp_msg_stats(struct mp_log *log, int type, const char *name, double value)
+{
+    if (!mp_msg_test(log, MSGL_STATS))
+        return;
+
+    // The log level includes MSGL_STATS only after the trace was created under
+    // mp_msg_lock, and the trace is not destroyed before mp_msg_uninit(). It
+    // can still be NULL if it could not be created.
+    struct mp_trace *trace = log->root->trace;
+    if (trace)
+        mp_trace_record(trace, type, name, value);
+}
+
 const char *const mp_log_levels[MSGL_MAX + 1] = {
     [MSGL_FATAL]        = "fatal",
     [MSGL_ERR]          = "error",
@@ -24,6 +24,7 @@
 #include <stdint.h>
 
 #include "osdep/compiler.h"
+#include "common/trace.h"
 
 struct mp_log;
 
@@ -81,9 +82,18 @@ static inline bool mp_msg_test(struct mp_log *log, int lev)
 #define MP_DBG(obj, ...)        MP_MSG(obj, MSGL_DEBUG, __VA_ARGS__)
 #define MP_TRACE(obj, ...)      MP_MSG(obj, MSGL_TRACE, __VA_ARGS__)
 
-// This is a bit special. See TOOLS/stats-conv.py what rules text passed
-// to these functions should follow. Also see --dump-stats.
-#define mp_stats(obj, ...)      mp_msg(obj, MSGL_STATS, __VA_ARGS__)
-#define MP_STATS(obj, ...)      MP_MSG(obj, MSGL_STATS, __VA_ARGS__)
+// Record timing events for --dump-stats. These are very cheap if disabled, and
+// don't format any text when enabled. name must be a string literal.
+// See TOOLS/stats-conv.py for a viewer.
+void mp_msg_stats(struct mp_log *log, int type, const char *name, double value);
+
+#define MP_STATS_START(obj, name)       \
+    mp_msg_stats((obj)->log, MP_TRACE_EV_START, name, 0)
+#define MP_STATS_END(obj, name)         \
+    mp_msg_stats((obj)->log, MP_TRACE_EV_END, name, 0)
+#define MP_STATS_VALUE(obj, name, val)  \
+    mp_msg_stats((obj)->log, MP_TRACE_EV_VALUE, name, val)
+#define MP_STATS_SIGNAL(obj, name)      \
+    mp_msg_stats((obj)->log, MP_TRACE_EV_SIGNAL, name, 0)
 
 #endif /* MPLAYER_MP_MSG_H */
@@ -2,6 +2,7 @@
 #define MP_MSG_CONTROL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 struct mpv_global;
 struct MPOpts;
@@ -18,6 +19,7 @@ struct mp_log_buffer_entry {
     char *prefix;
     int level;
     char *text;
+    int64_t time; // mp_time_us() when logged (only used for the log file)
 };
 
 // Use --msg-level option for log level of this log buffer
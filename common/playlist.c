@@ -16,6 +16,8 @@
  */
 
 #include <assert.h>
+#include <string.h>
+
 #include "config.h"
 #include "playlist.h"
 #include "common/common.h"
@@ -28,10 +30,26 @@
 #include "stream/stream.h"
 
 struct playlist_entry *playlist_entry_new(const char *filename)
+{
+    return playlist_entry_new_relative((bstr){0}, bstr0(filename));
+}
+
+// Like playlist_entry_new(), but resolve filename relative to base_path (unless
+// it's a URL or base_path is empty or "."). This is done in one go, so that
+// playlist parsers don't need to allocate the filename twice.
+struct playlist_entry *playlist_entry_new_relative(bstr base_path, bstr filename)
 {
     struct playlist_entry *e = talloc_zero(NULL, struct playlist_entry);
-    char *local_filename = mp_file_url_to_filename(e, bstr0(filename));
-    e->filename = local_filename ? local_filename : talloc_strdup(e, filename);
+    char *local_filename = mp_file_url_to_filename(e, filename);
+    if (local_filename)
+        filename = bstr0(local_filename);
+    if (base_path.len && !bstr_equals0(base_path, ".") && !mp_is_url(filename)) {
+        e->filename = mp_path_join_bstr(e, base_path, filename);
+        talloc_free(local_filename);
+    } else {
+        e->filename = local_filename ? local_filename : bstrto0(e, filename);
+    }
+    e->pl_index = -1;
     return e;
 }
 
@@ -49,37 +67,35 @@ void playlist_entry_add_params(struct playlist_entry *e,
         playlist_entry_add_param(e, params[n].name, params[n].value);
 }
 
+// Renumber the entries in the index range [start, end).
+static void playlist_update_indexes(struct playlist *pl, int start, int end)
+{
+    start = MPMAX(start, 0);
+    end = end < 0 ? pl->num_entries : MPMIN(end, pl->num_entries);
+
+    for (int n = start; n < end; n++)
+        pl->entries[n]->pl_index = n;
+}
+
 // Add entry "add" after entry "after".
 // If "after" is NULL, add as first entry.
-// Post condition: add->prev == after
+// Post condition: playlist_entry_get_rel(add, -1) == after
 void playlist_insert(struct playlist *pl, struct playlist_entry *after,
                      struct playlist_entry *add)
 {
-    assert(pl && add->pl == NULL && add->next == NULL && add->prev == NULL);
-    if (after) {
-        assert(after->pl == pl);
-        assert(pl->first && pl->last);
-    }
-    add->prev = after;
-    if (after) {
-        add->next = after->next;
-        after->next = add;
-    } else {
-        add->next = pl->first;
-        pl->first = add;
-    }
-    if (add->next) {
-        add->next->prev = add;
-    } else {
-        pl->last = add;
-    }
+    assert(pl && add->pl == NULL && add->pl_index < 0);
+    assert(!after || after->pl == pl);
+
+    int at = after ? after->pl_index + 1 : 0;
+    MP_TARRAY_INSERT_AT(pl, pl->entries, pl->num_entries, at, add);
     add->pl = pl;
+    playlist_update_indexes(pl, at, -1);
     talloc_steal(pl, add);
 }
 
 void playlist_add(struct playlist *pl, struct playlist_entry *add)
 {
-    playlist_insert(pl, pl->last, add);
+    playlist_insert(pl, playlist_get_last(pl), add);
 }
 
 static void playlist_unlink(struct playlist *pl, struct playlist_entry *entry)
@@ -87,23 +103,15 @@ static void playlist_unlink(struct playlist *pl, struct playlist_entry *entry)
     assert(pl && entry->pl == pl);
 
     if (pl->current == entry) {
-        pl->current = entry->next;
+        pl->current = playlist_entry_get_rel(entry, 1);
         pl->current_was_replaced = true;
     }
 
-    if (entry->next) {
-        entry->next->prev = entry->prev;
-    } else {
-        pl->last = entry->prev;
-    }
-    if (entry->prev) {
-        entry->prev->next = entry->next;
-    } else {
-        pl->first = entry->next;
-    }
-    entry->next = entry->prev = NULL;
+    MP_TARRAY_REMOVE_AT(pl->entries, pl->num_entries, entry->pl_index);
+    playlist_update_indexes(pl, entry->pl_index, -1);
     // xxx: we'd want to reset the talloc parent of entry
     entry->pl = NULL;
+    entry->pl_index = -1;
 }
 
 void playlist_entry_unref(struct playlist_entry *e)
@@ -122,8 +130,9 @@ void playlist_remove(struct playlist *pl, struct playlist_entry *entry)
 
 void playlist_clear(struct playlist *pl)
 {
-    while (pl->first)
-        playlist_remove(pl, pl->first);
+    // Remove from the end, so that no entries need to be moved.
+    for (int n = pl->num_entries - 1; n >= 0; n--)
+        playlist_remove(pl, pl->entries[n]);
     assert(!pl->current);
     pl->current_was_replaced = false;
 }
@@ -135,14 +144,24 @@ void playlist_move(struct playlist *pl, struct playlist_entry *entry,
     if (entry == at)
         return;
 
-    struct playlist_entry *save_current = pl->current;
-    bool save_replaced = pl->current_was_replaced;
+    assert(entry->pl == pl && (!at || at->pl == pl));
 
-    playlist_unlink(pl, entry);
-    playlist_insert(pl, at ? at->prev : pl->last, entry);
+    int index = entry->pl_index;
+    int dest = at ? at->pl_index : pl->num_entries;
+    if (dest > index)
+        dest--;
 
-    pl->current = save_current;
-    pl->current_was_replaced = save_replaced;
+    // Rotate the range between the old and new position by 1 entry, which
+    // only affects the indexes of that range.
+    if (dest > index) {
+        memmove(&pl->entries[index], &pl->entries[index + 1],
+                (dest - index) * sizeof(pl->entries[0]));
+    } else {
+        memmove(&pl->entries[dest + 1], &pl->entries[dest],
+                (index - dest) * sizeof(pl->entries[0]));
+    }
+    pl->entries[dest] = entry;
+    playlist_update_indexes(pl, MPMIN(index, dest), MPMAX(index, dest) + 1);
 }
 
 void playlist_add_file(struct playlist *pl, const char *filename)
@@ -150,34 +169,24 @@ void playlist_add_file(struct playlist *pl, const char *filename)
     playlist_add(pl, playlist_entry_new(filename));
 }
 
-static int playlist_count(struct playlist *pl)
+void playlist_shuffle(struct playlist *pl)
 {
-    int c = 0;
-    for (struct playlist_entry *e = pl->first; e; e = e->next)
-        c++;
-    return c;
+    for (int n = 0; n < pl->num_entries - 1; n++) {
+        int j = (int)((double)(pl->num_entries - n) * rand() / (RAND_MAX + 1.0));
+        MPSWAP(struct playlist_entry *, pl->entries[n], pl->entries[n + j]);
+    }
+    playlist_update_indexes(pl, 0, -1);
 }
 
-void playlist_shuffle(struct playlist *pl)
+// Return the entry at direction (-1 or +1) relative to e, or NULL if e is the
+// first or last entry, or not in a playlist.
+struct playlist_entry *playlist_entry_get_rel(struct playlist_entry *e,
+                                              int direction)
 {
-    struct playlist_entry *save_current = pl->current;
-    bool save_replaced = pl->current_was_replaced;
-    int count = playlist_count(pl);
-    struct playlist_entry **arr = talloc_array(NULL, struct playlist_entry *,
-                                               count);
-    for (int n = 0; n < count; n++) {
-        arr[n] = pl->first;
-        playlist_unlink(pl, pl->first);
-    }
-    for (int n = 0; n < count - 1; n++) {
-        int j = (int)((double)(count - n) * rand() / (RAND_MAX + 1.0));
-        MPSWAP(struct playlist_entry *, arr[n], arr[n + j]);
-    }
-    for (int n = 0; n < count; n++)
-        playlist_add(pl, arr[n]);
-    talloc_free(arr);
-    pl->current = save_current;
-    pl->current_was_replaced = save_replaced;
+    assert(direction == -1 || direction == +1);
+    if (!e->pl)
+        return NULL;
+    return playlist_entry_from_index(e->pl, e->pl_index + direction);
 }
 
 struct playlist_entry *playlist_get_next(struct playlist *pl, int direction)
@@ -187,27 +196,26 @@ struct playlist_entry *playlist_get_next(struct playlist *pl, int direction)
         return NULL;
     assert(pl->current->pl == pl);
     if (direction < 0)
-        return pl->current->prev;
-    return pl->current_was_replaced ? pl->current : pl->current->next;
+        return playlist_entry_get_rel(pl->current, -1);
+    return pl->current_was_replaced ? pl->current :
+           playlist_entry_get_rel(pl->current, 1);
 }
 
-void playlist_add_base_path(struct playlist *pl, bstr base_path)
+struct playlist_entry *playlist_get_first(struct playlist *pl)
 {
-    if (base_path.len == 0 || bstrcmp0(base_path, ".") == 0)
-        return;
-    for (struct playlist_entry *e = pl->first; e; e = e->next) {
-        if (!mp_is_url(bstr0(e->filename))) {
-            char *new_file = mp_path_join_bstr(e, base_path, bstr0(e->filename));
-            talloc_free(e->filename);
-            e->filename = new_file;
-        }
-    }
+    return pl->num_entries ? pl->entries[0] : NULL;
+}
+
+struct playlist_entry *playlist_get_last(struct playlist *pl)
+{
+    return pl->num_entries ? pl->entries[pl->num_entries - 1] : NULL;
 }
 
 // Add redirected_from as new redirect entry to each item in pl.
 void playlist_add_redirect(struct playlist *pl, const char *redirected_from)
 {
-    for (struct playlist_entry *e = pl->first; e; e = e->next) {
+    for (int n = 0; n < pl->num_entries; n++) {
+        struct playlist_entry *e = pl->entries[n];
         if (e->num_redirects >= 10) // arbitrary limit for sanity
             break;
         char *s = talloc_strdup(e, redirected_from);
@@ -216,63 +224,75 @@ void playlist_add_redirect(struct playlist *pl, const char *redirected_from)
     }
 }
 
+// Move all entries from source_pl to pl, inserting them at the given index.
+// source_pl will be empty, and all entries have changed ownership to pl.
+void playlist_transfer_entries_to(struct playlist *pl, int at,
+                                  struct playlist *source_pl)
+{
+    assert(pl != source_pl);
+    assert(at >= 0 && at <= pl->num_entries);
+    int count = source_pl->num_entries;
+    if (!count)
+        return;
+
+    MP_TARRAY_GROW(pl, pl->entries, pl->num_entries + count);
+    memmove(&pl->entries[at + count], &pl->entries[at],
+            (pl->num_entries - at) * sizeof(pl->entries[0]));
+    for (int n = 0; n < count; n++) {
+        struct playlist_entry *e = source_pl->entries[n];
+        pl->entries[at + n] = e;
+        e->pl = pl;
+        talloc_steal(pl, e);
+    }
+    pl->num_entries += count;
+    playlist_update_indexes(pl, at, -1);
+
+    // Same as if the entries were removed one by one with playlist_unlink().
+    if (source_pl->current) {
+        source_pl->current = NULL;
+        source_pl->current_was_replaced = true;
+    }
+    source_pl->num_entries = 0;
+}
+
 // Move all entries from source_pl to pl, appending them after the current entry
 // of pl. source_pl will be empty, and all entries have changed ownership to pl.
 void playlist_transfer_entries(struct playlist *pl, struct playlist *source_pl)
 {
     struct playlist_entry *add_after = pl->current;
     if (pl->current && pl->current_was_replaced)
-        add_after = pl->current->next;
+        add_after = playlist_entry_get_rel(pl->current, 1);
     if (!add_after)
-        add_after = pl->last;
+        add_after = playlist_get_last(pl);
 
-    while (source_pl->first) {
-        struct playlist_entry *e = source_pl->first;
-        playlist_unlink(source_pl, e);
-        playlist_insert(pl, add_after, e);
-        add_after = e;
-    }
+    playlist_transfer_entries_to(pl, add_after ? add_after->pl_index + 1 : 0,
+                                 source_pl);
 }
 
 void playlist_append_entries(struct playlist *pl, struct playlist *source_pl)
 {
-    while (source_pl->first) {
-        struct playlist_entry *e = source_pl->first;
-        playlist_unlink(source_pl, e);
-        playlist_add(pl, e);
-    }
+    playlist_transfer_entries_to(pl, pl->num_entries, source_pl);
 }
 
 // Return number of entries between list start and e.
 // Return -1 if e is not on the list, or if e is NULL.
 int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e)
 {
-    struct playlist_entry *cur = pl->first;
-    int pos = 0;
-    if (!e)
+    if (!e || e->pl != pl)
         return -1;
-    while (cur && cur != e) {
-        cur = cur->next;
-        pos++;
-    }
-    return cur == e ? pos : -1;
+    return e->pl_index;
 }
 
 int playlist_entry_count(struct playlist *pl)
 {
-    return playlist_entry_to_index(pl, pl->last) + 1;
+    return pl->num_entries;
 }
 
 // Return entry for which playlist_entry_to_index() would return index.
 // Return NULL if not found.
 struct playlist_entry *playlist_entry_from_index(struct playlist *pl, int index)
 {
-    struct playlist_entry *e = pl->first;
-    for (int n = 0; ; n++) {
-        if (!e || n == index)
-            return e;
-        e = e->next;
-    }
+    return index >= 0 && index < pl->num_entries ? pl->entries[index] : NULL;
 }
 
 struct playlist *playlist_parse_file(const char *file, struct mp_cancel *cancel,
@@ -305,7 +325,7 @@ struct playlist *playlist_parse_file(const char *file, struct mp_cancel *cancel,
         mp_err(log, "Error while parsing playlist\n");
     }
 
-    if (ret && !ret->first)
+    if (ret && !ret->num_entries)
         mp_warn(log, "Warning: empty playlist\n");
 
     talloc_free(log);
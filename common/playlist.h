@@ -26,8 +26,9 @@ struct playlist_param {
 };
 
 struct playlist_entry {
-    struct playlist_entry *prev, *next;
+    // Invariant: (pl && pl->entries[pl_index] == this) || (!pl && pl_index < 0)
     struct playlist *pl;
+    int pl_index;
 
     char *filename;
 
@@ -62,7 +63,8 @@ struct playlist_entry {
 };
 
 struct playlist {
-    struct playlist_entry *first, *last;
+    struct playlist_entry **entries;
+    int num_entries;
 
     // This provides some sort of stable iterator. If this entry is removed from
     // the playlist, current is set to the next element (or NULL), and
@@ -79,6 +81,7 @@ void playlist_entry_add_params(struct playlist_entry *e,
                                int params_count);
 
 struct playlist_entry *playlist_entry_new(const char *filename);
+struct playlist_entry *playlist_entry_new_relative(bstr base_path, bstr filename);
 
 void playlist_insert(struct playlist *pl, struct playlist_entry *after,
                      struct playlist_entry *add);
@@ -92,14 +95,19 @@ void playlist_move(struct playlist *pl, struct playlist_entry *entry,
 void playlist_add_file(struct playlist *pl, const char *filename);
 void playlist_shuffle(struct playlist *pl);
 struct playlist_entry *playlist_get_next(struct playlist *pl, int direction);
-void playlist_add_base_path(struct playlist *pl, bstr base_path);
 void playlist_add_redirect(struct playlist *pl, const char *redirected_from);
 void playlist_transfer_entries(struct playlist *pl, struct playlist *source_pl);
+void playlist_transfer_entries_to(struct playlist *pl, int at,
+                                  struct playlist *source_pl);
 void playlist_append_entries(struct playlist *pl, struct playlist *source_pl);
 
 int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e);
 int playlist_entry_count(struct playlist *pl);
 struct playlist_entry *playlist_entry_from_index(struct playlist *pl, int index);
+struct playlist_entry *playlist_get_first(struct playlist *pl);
+struct playlist_entry *playlist_get_last(struct playlist *pl);
+struct playlist_entry *playlist_entry_get_rel(struct playlist_entry *e,
+                                              int direction);
 
 struct mp_cancel;
 struct mpv_global;
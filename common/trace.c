@@ -0,0 +1,314 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "config.h"
+
+#include "mpv_talloc.h"
+#include "common/common.h"
+#include "osdep/atomic.h"
+#include "osdep/getpid.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
+
+#include "trace.h"
+
+// Number of events a thread can record before the writer drains its buffer.
+// The writer runs every FLUSH_INTERVAL seconds, so this allows for a sustained
+// rate of some 100000 events per second per thread.
+#define BUFFER_EVENTS 8192
+#define FLUSH_INTERVAL 0.05
+
+struct event {
+    int64_t ts;             // mp_time_us()
+    const char *name;
+    double value;
+    int type;               // enum mp_trace_type
+};
+
+// Ring buffer written by exactly one thread, read by the writer thread.
+struct thread_buffer {
+    struct event events[BUFFER_EVENTS];
+    atomic_ullong rpos, wpos;
+    atomic_ulong dropped;   // events lost because the buffer was full
+    atomic_bool dead;       // owner thread exited
+    // --- accessed by the writer thread only (or with mp_trace.lock held)
+    int tid;
+    char name[80];
+    bool name_written;
+};
+
+struct mp_trace {
+    pthread_key_t key;
+    atomic_bool active;     // file != NULL
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    // --- protected by lock
+    bool terminate;
+    FILE *file;
+    bool first_event;       // no event written to file yet
+    struct thread_buffer **buffers;
+    int num_buffers;
+    int next_tid;
+    unsigned long dropped;
+};
+
+static void thread_exit(void *p)
+{
+    struct thread_buffer *b = p;
+    atomic_store(&b->dead, true);
+}
+
+static struct thread_buffer *register_thread(struct mp_trace *t)
+{
+    struct thread_buffer *b = talloc_zero(NULL, struct thread_buffer);
+#if HAVE_GLIBC_THREAD_NAME
+    if (pthread_getname_np(pthread_self(), b->name, sizeof(b->name)))
+        b->name[0] = '\0';
+#endif
+
+    pthread_mutex_lock(&t->lock);
+    b->tid = ++t->next_tid;
+    if (!b->name[0])
+        snprintf(b->name, sizeof(b->name), "thread %d", b->tid);
+    MP_TARRAY_APPEND(t, t->buffers, t->num_buffers, b);
+    pthread_mutex_unlock(&t->lock);
+
+    pthread_setspecific(t->key, b);
+    return b;
+}
+
+void mp_trace_record(struct mp_trace *t, enum mp_trace_type type,
+                     const char *name, double value)
+{
+    if (!atomic_load_explicit(&t->active, memory_order_relaxed))
+        return;
+
+    struct thread_buffer *b = pthread_getspecific(t->key);
+    if (!b)
+        b = register_thread(t);
+
+    unsigned long long wpos = atomic_load_explicit(&b->wpos, memory_order_relaxed);
+    if (wpos - atomic_load(&b->rpos) >= BUFFER_EVENTS) {
+        atomic_fetch_add(&b->dropped, 1);
+        return;
+    }
+
+    b->events[wpos % BUFFER_EVENTS] = (struct event){
+        .ts = mp_time_us(),
+        .name = name,
+        .value = value,
+        .type = type,
+    };
+    atomic_store(&b->wpos, wpos + 1);
+}
+
+static void write_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Begin a new JSON event object, and write the fields common to all events.
+static void begin_event(struct mp_trace *t, const char *name, const char *ph,
+                        int tid, int64_t ts)
+{
+    FILE *f = t->file;
+    fprintf(f, "%s{\"name\":", t->first_event ? "" : ",\n");
+    t->first_event = false;
+    write_json_string(f, name);
+    fprintf(f, ",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%"PRId64,
+            ph, (int)mp_getpid(), tid, ts);
+}
+
+static void write_event(struct mp_trace *t, struct thread_buffer *b,
+                        struct event *e)
+{
+    FILE *f = t->file;
+    switch (e->type) {
+    case MP_TRACE_EV_START:
+        begin_event(t, e->name, "B", b->tid, e->ts);
+        break;
+    case MP_TRACE_EV_END:
+        begin_event(t, e->name, "E", b->tid, e->ts);
+        break;
+    case MP_TRACE_EV_VALUE:
+        begin_event(t, e->name, "C", b->tid, e->ts);
+        fprintf(f, ",\"args\":{\"value\":%.17g}", e->value);
+        break;
+    case MP_TRACE_EV_SIGNAL:
+        begin_event(t, e->name, "i", b->tid, e->ts);
+        fprintf(f, ",\"s\":\"t\"");
+        break;
+    }
+    fputc('}', f);
+}
+
+static void flush_locked(struct mp_trace *t)
+{
+    for (int n = 0; n < t->num_buffers; n++) {
+        struct thread_buffer *b = t->buffers[n];
+
+        // Read this first: once the thread is dead, no more events can appear.
+        bool dead = atomic_load(&b->dead);
+
+        if (t->file && !b->name_written) {
+            begin_event(t, "thread_name", "M", b->tid, 0);
+            fprintf(t->file, ",\"args\":{\"name\":");
+            write_json_string(t->file, b->name);
+            fprintf(t->file, "}}");
+            b->name_written = true;
+        }
+
+        unsigned long long rpos = atomic_load(&b->rpos);
+        unsigned long long wpos = atomic_load(&b->wpos);
+        if (t->file) {
+            for (unsigned long long i = rpos; i < wpos; i++)
+                write_event(t, b, &b->events[i % BUFFER_EVENTS]);
+        }
+        atomic_store(&b->rpos, wpos);
+
+        unsigned long dropped = atomic_exchange(&b->dropped, 0);
+        if (dropped && t->file) {
+            t->dropped += dropped;
+            begin_event(t, "trace-dropped-events", "C", b->tid, mp_time_us());
+            fprintf(t->file, ",\"args\":{\"value\":%lu}}", t->dropped);
+        }
+
+        if (dead) {
+            MP_TARRAY_REMOVE_AT(t->buffers, t->num_buffers, n);
+            talloc_free(b);
+            n--;
+        }
+    }
+
+    if (t->file)
+        fflush(t->file);
+}
+
+static void *trace_thread(void *p)
+{
+    struct mp_trace *t = p;
+
+    mpthread_set_name("trace");
+
+    pthread_mutex_lock(&t->lock);
+    while (!t->terminate) {
+        flush_locked(t);
+        if (t->file) {
+            struct timespec ts = mp_rel_time_to_timespec(FLUSH_INTERVAL);
+            pthread_cond_timedwait(&t->wakeup, &t->lock, &ts);
+        } else {
+            // Nothing can be recorded; sleep until a file is set.
+            pthread_cond_wait(&t->wakeup, &t->lock);
+        }
+    }
+    flush_locked(t);
+    pthread_mutex_unlock(&t->lock);
+
+    return NULL;
+}
+
+struct mp_trace *mp_trace_create(void)
+{
+    struct mp_trace *t = talloc_zero(NULL, struct mp_trace);
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->wakeup, NULL);
+
+    if (pthread_key_create(&t->key, thread_exit))
+        goto error_key;
+
+    if (pthread_create(&t->thread, NULL, trace_thread, t))
+        goto error_thread;
+
+    return t;
+
+error_thread:
+    pthread_key_delete(t->key);
+error_key:
+    pthread_cond_destroy(&t->wakeup);
+    pthread_mutex_destroy(&t->lock);
+    talloc_free(t);
+    return NULL;
+}
+
+void mp_trace_destroy(struct mp_trace *t)
+{
+    if (!t)
+        return;
+
+    mp_trace_set_file(t, NULL);
+
+    pthread_mutex_lock(&t->lock);
+    t->terminate = true;
+    pthread_cond_signal(&t->wakeup);
+    pthread_mutex_unlock(&t->lock);
+
+    pthread_join(t->thread, NULL);
+
+    // Threads which are still alive can't record anymore, so it's safe to free
+    // their buffers.
+    pthread_key_delete(t->key);
+    for (int n = 0; n < t->num_buffers; n++)
+        talloc_free(t->buffers[n]);
+    pthread_cond_destroy(&t->wakeup);
+    pthread_mutex_destroy(&t->lock);
+    talloc_free(t);
+}
+
+void mp_trace_set_file(struct mp_trace *t, FILE *file)
+{
+    pthread_mutex_lock(&t->lock);
+
+    flush_locked(t);
+
+    if (t->file) {
+        fprintf(t->file, "\n]\n");
+        fflush(t->file);
+    }
+
+    t->file = file;
+    t->first_event = true;
+    t->dropped = 0;
+    for (int n = 0; n < t->num_buffers; n++)
+        t->buffers[n]->name_written = false;
+
+    if (t->file)
+        fprintf(t->file, "[\n");
+
+    atomic_store(&t->active, !!file);
+    pthread_cond_signal(&t->wakeup);
+
+    pthread_mutex_unlock(&t->lock);
+}
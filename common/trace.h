@@ -0,0 +1,41 @@
+#ifndef MP_TRACE_H_
+#define MP_TRACE_H_
+
+#include <stdio.h>
+
+// Low overhead recording of timing events, used for --dump-stats.
+//
+// Events are stored in binary form into a per-thread lock-free ring buffer.
+// A background thread drains all buffers and writes the events as Chrome trace
+// JSON (as understood by chrome://tracing, Perfetto, and TOOLS/stats-conv.py).
+
+enum mp_trace_type {
+    MP_TRACE_EV_START,  // start of the named time range
+    MP_TRACE_EV_END,    // end of the named time range (same thread as start)
+    MP_TRACE_EV_VALUE,  // sample of a named value
+    MP_TRACE_EV_SIGNAL, // singular event
+};
+
+struct mp_trace;
+
+// Create a recorder. Recording does nothing until a file is set.
+struct mp_trace *mp_trace_create(void);
+
+// Write all pending events, stop the background thread, and free it. The
+// caller must make sure no other threads can call mp_trace_record() anymore.
+void mp_trace_destroy(struct mp_trace *t);
+
+// Write all pending events to the old file, and switch to the new file. The
+// trace does not take ownership of the files: the caller must close them, but
+// only after it was removed with mp_trace_set_file(t, NULL).
+void mp_trace_set_file(struct mp_trace *t, FILE *file);
+
+// Record an event. name must be a string that is never freed (usually a string
+// literal), because only the pointer is stored. value is used with
+// MP_TRACE_EV_VALUE only.
+// Thread-safety: can be called from any thread. Each thread gets its own
+//                buffer, which is allocated on the first call.
+void mp_trace_record(struct mp_trace *t, enum mp_trace_type type,
+                     const char *name, double value);
+
+#endif
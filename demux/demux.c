@@ -1622,13 +1622,17 @@ static bool read_packet(struct demux_internal *in)
 
     struct demuxer *demux = in->d_thread;
 
+    MP_STATS_START(in, "demux-read");
     bool eof = true;
     if (demux->desc->fill_buffer && !demux_cancel_test(demux))
         eof = demux->desc->fill_buffer(demux) <= 0;
+    MP_STATS_END(in, "demux-read");
     update_cache(in);
 
     pthread_mutex_lock(&in->lock);
 
+    MP_STATS_VALUE(in, "demux-fw-bytes", in->fw_bytes);
+
     if (!in->seeking) {
         if (eof) {
             for (int n = 0; n < in->num_streams; n++) {
@@ -2158,6 +2162,7 @@ static void demux_copy(struct demuxer *dst, struct demuxer *src)
     dst->num_attachments = src->num_attachments;
     dst->matroska_data = src->matroska_data;
     dst->playlist = src->playlist;
+    dst->playlist_incomplete = src->playlist_incomplete;
     dst->seekable = src->seekable;
     dst->partially_seekable = src->partially_seekable;
     dst->filetype = src->filetype;
@@ -2342,6 +2347,7 @@ static struct demuxer *open_given_type(struct mpv_global *global,
         return NULL;
 
     struct demuxer *demuxer = talloc_ptrtype(NULL, demuxer);
+    talloc_set_account(demuxer, "demuxer");
     struct demux_opts *opts = mp_get_config_group(demuxer, global, &demux_conf);
     *demuxer = (struct demuxer) {
         .desc = desc,
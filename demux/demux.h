@@ -38,6 +38,13 @@ enum demux_ctrl {
     DEMUXER_CTRL_GET_READER_STATE,
     DEMUXER_CTRL_GET_BITRATE_STATS, // double[STREAM_TYPE_COUNT]
     DEMUXER_CTRL_REPLACE_STREAM,
+    DEMUXER_CTRL_READ_PLAYLIST,     // struct demux_ctrl_read_playlist*
+};
+
+// Read more entries of a playlist file, if demuxer->playlist_incomplete is set.
+struct demux_ctrl_read_playlist {
+    struct playlist *pl;    // new entries are appended to this
+    bool eof;               // set to true if there are no more entries
 };
 
 #define MAX_SEEK_RANGES 10
@@ -179,6 +186,7 @@ struct demuxer_params {
     bool skip_lavf_probing;
     bool does_not_own_stream; // if false, stream is free'd on demux_free()
     bool stream_record; // if true, enable stream recording if option is set
+    bool playlist_incremental; // allow returning only the first playlist entries
     // -- demux_open_url() only
     int stream_flags;
     // result
@@ -222,6 +230,9 @@ typedef struct demuxer {
 
     // If the file is a playlist file
     struct playlist *playlist;
+    // If true, the playlist contains the first entries of the file only. The
+    // rest can be read with DEMUXER_CTRL_READ_PLAYLIST.
+    bool playlist_incomplete;
 
     struct mp_tags *metadata;
 
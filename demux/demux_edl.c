@@ -22,6 +22,7 @@
 #include <string.h>
 #include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "mpv_talloc.h"
 
@@ -30,11 +31,16 @@
 #include "common/msg.h"
 #include "options/path.h"
 #include "misc/bstr.h"
+#include "misc/thread_pool.h"
 #include "common/common.h"
 #include "stream/stream.h"
 
 #define HEADER "# mpv EDL v0\n"
 
+// Opening sources is mostly waiting for I/O, so this is not tied to the
+// number of CPUs.
+#define MAX_OPEN_THREADS 16
+
 struct tl_part {
     char *filename;             // what is stream_open()ed
     double offset;              // offset into the source file
@@ -46,6 +52,7 @@ struct tl_part {
 
 struct tl_parts {
     bool dash;
+    bool lazy_open;
     char *init_fragment_url;
     struct tl_part *parts;
     int num_parts;
@@ -145,6 +152,8 @@ static struct tl_parts *parse_edl(bstr str)
                 tl->dash = true;
                 if (nparam > 1 && bstr_equals0(param_names[1], "init"))
                     tl->init_fragment_url = bstrto0(tl, param_vals[1]);
+            } else if (bstr_equals0(type, "lazy_open")) {
+                tl->lazy_open = true;
             }
             continue;
         }
@@ -160,23 +169,111 @@ error:
     return NULL;
 }
 
-static struct demuxer *open_source(struct timeline *tl, char *filename)
+struct source {
+    char *filename;
+    bool needed;
+    bool opened;                // d was opened by open_sources()
+    struct demuxer *d;
+};
+
+struct sources {
+    struct timeline *tl;
+    struct source **list;
+    int num_list;
+    // Open addressing hash table of indexes into list (-1 for unused entries).
+    int *table;
+    int table_size;                 // power of 2
+    // For open_thread().
+    pthread_mutex_t lock;
+    int next_open;
+};
+
+static uint32_t hash_filename(const char *s)
 {
-    for (int n = 0; n < tl->num_sources; n++) {
-        struct demuxer *d = tl->sources[n];
-        if (strcmp(d->stream->url, filename) == 0)
-            return d;
+    uint32_t h = 2166136261u; // FNV-1a
+    for (; *s; s++)
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    return h;
+}
+
+// Return the source entry for the filename, adding a new one if needed.
+// The table must be large enough to never get full.
+static struct source *get_source(struct sources *src, char *filename)
+{
+    uint32_t mask = src->table_size - 1;
+    for (uint32_t i = hash_filename(filename) & mask; ; i = (i + 1) & mask) {
+        int index = src->table[i];
+        if (index < 0) {
+            struct source *e = talloc_ptrtype(src, e);
+            *e = (struct source){ .filename = filename };
+            src->table[i] = src->num_list;
+            MP_TARRAY_APPEND(src, src->list, src->num_list, e);
+            return e;
+        }
+        if (strcmp(src->list[index]->filename, filename) == 0)
+            return src->list[index];
+    }
+}
+
+static void open_thread(void *ctx)
+{
+    struct sources *src = ctx;
+    struct timeline *tl = src->tl;
+
+    while (1) {
+        struct source *e = NULL;
+        pthread_mutex_lock(&src->lock);
+        while (src->next_open < src->num_list && !e) {
+            struct source *cur = src->list[src->next_open++];
+            if (cur->needed && !cur->d)
+                e = cur;
+        }
+        pthread_mutex_unlock(&src->lock);
+        if (!e)
+            break;
+
+        struct demuxer_params params = {
+            .init_fragment = tl->init_fragment,
+        };
+        e->d = demux_open_url(e->filename, &params, tl->cancel, tl->global);
+        e->opened = true;
+    }
+}
+
+// Open all needed sources, in parallel. The caller is supposed to report
+// failures, as only it knows which part needed the source first.
+static void open_sources(struct sources *src)
+{
+    int num_open = 0;
+    for (int n = 0; n < src->num_list; n++)
+        num_open += src->list[n]->needed && !src->list[n]->d;
+    if (!num_open)
+        return;
+
+    MP_VERBOSE(src->tl, "EDL: opening %d source files...\n", num_open);
+
+    int threads = MPMIN(num_open, MAX_OPEN_THREADS);
+
+    // This thread opens files too, so it works even if no worker threads can
+    // be created. Freeing the pool waits for the workers.
+    pthread_mutex_init(&src->lock, NULL);
+    src->next_open = 0;
+    struct mp_thread_pool *pool = NULL;
+    if (threads > 1)
+        pool = mp_thread_pool_create(NULL, 0, 0, threads - 1);
+    for (int n = 0; pool && n < threads - 1; n++) {
+        if (!mp_thread_pool_queue(pool, open_thread, src))
+            break;
     }
-    struct demuxer_params params = {
-        .init_fragment = tl->init_fragment,
-    };
-    struct demuxer *d = demux_open_url(filename, &params, tl->cancel, tl->global);
-    if (d) {
-        MP_TARRAY_APPEND(tl, tl->sources, tl->num_sources, d);
-    } else {
-        MP_ERR(tl, "EDL: Could not open source file '%s'.\n", filename);
+    open_thread(src);
+    talloc_free(pool);
+    pthread_mutex_destroy(&src->lock);
+
+    for (int n = 0; n < src->num_list; n++) {
+        struct source *e = src->list[n];
+        if (e->opened && e->d)
+            MP_TARRAY_APPEND(src->tl, src->tl->sources, src->tl->num_sources, e->d);
     }
-    return d;
 }
 
 static double demuxer_chapter_time(struct demuxer *demuxer, int n)
@@ -223,6 +320,8 @@ static void resolve_timestamps(struct tl_part *part, struct demuxer *demuxer)
 
 static void build_timeline(struct timeline *tl, struct tl_parts *parts)
 {
+    struct sources *src = NULL;
+
     tl->track_layout = NULL;
     tl->dash = parts->dash;
 
@@ -246,11 +345,48 @@ static void build_timeline(struct timeline *tl, struct tl_parts *parts)
         }
     }
 
+    // Map each part to a source file. Parts that need no information from the
+    // file can be opened lazily by demux_timeline on playback, if requested.
+    src = talloc_zero(NULL, struct sources);
+    src->tl = tl;
+    src->table_size = 16;
+    while (src->table_size < (parts->num_parts + tl->num_sources) * 2)
+        src->table_size *= 2;
+    src->table = talloc_array(src, int, src->table_size);
+    for (int n = 0; n < src->table_size; n++)
+        src->table[n] = -1;
+    for (int n = 0; n < tl->num_sources; n++) {
+        struct demuxer *d = tl->sources[n];
+        get_source(src, d->stream->url)->d = d;
+    }
+    struct source **part_sources = talloc_array(src, struct source *,
+                                                parts->num_parts);
+    for (int n = 0; n < parts->num_parts; n++) {
+        struct tl_part *part = &parts->parts[n];
+        struct source *e = get_source(src, part->filename);
+        if (tl->dash) {
+            e->needed |= n == 0 && !tl->track_layout;
+        } else {
+            // The first part defines the track layout.
+            e->needed |= !parts->lazy_open || n == 0 || !part->offset_set ||
+                         part->length < 0 || part->chapter_ts;
+        }
+        part_sources[n] = e;
+    }
+    open_sources(src);
+
     tl->parts = talloc_array_ptrtype(tl, tl->parts, parts->num_parts + 1);
     double starttime = 0;
     for (int n = 0; n < parts->num_parts; n++) {
         struct tl_part *part = &parts->parts[n];
-        struct demuxer *source = NULL;
+        struct source *e = part_sources[n];
+        // For DASH, only the first segment is used for the track layout.
+        struct demuxer *source = tl->dash && n > 0 ? NULL : e->d;
+
+        if (e->needed && !e->d) {
+            MP_ERR(tl, "EDL: Could not open source file '%s'.\n", part->filename);
+            goto error;
+        }
 
         if (tl->dash) {
             part->offset = starttime;
@@ -259,41 +395,33 @@ static void build_timeline(struct timeline *tl, struct tl_parts *parts)
             if (part->offset_set)
                 MP_WARN(tl, "Offsets are ignored.\n");
             tl->demuxer->is_network = true;
-
-            if (!tl->track_layout) {
-                source = open_source(tl, part->filename);
-                if (!source)
-                    goto error;
-            }
         } else {
-            MP_VERBOSE(tl, "Opening segment %d...\n", n);
-
-            source = open_source(tl, part->filename);
-            if (!source)
-                goto error;
-
-            resolve_timestamps(part, source);
-
-            double end_time = source->duration;
-            if (end_time >= 0)
-                end_time += source->start_time;
-
-            // Unknown length => use rest of the file. If duration is unknown, make
-            // something up.
-            if (part->length < 0) {
-                if (end_time < 0) {
-                    MP_WARN(tl, "EDL: source file '%s' has unknown duration.\n",
-                            part->filename);
-                    end_time = 1;
-                }
-                part->length = end_time - part->offset;
-            } else if (end_time >= 0) {
-                double end_part = part->offset + part->length;
-                if (end_part > end_time) {
-                    MP_WARN(tl, "EDL: entry %d uses %f "
-                            "seconds, but file has only %f seconds.\n",
-                            n, end_part, end_time);
+            if (source) {
+                resolve_timestamps(part, source);
+
+                double end_time = source->duration;
+                if (end_time >= 0)
+                    end_time += source->start_time;
+
+                // Unknown length => use rest of the file. If duration is
+                // unknown, make something up.
+                if (part->length < 0) {
+                    if (end_time < 0) {
+                        MP_WARN(tl, "EDL: source file '%s' has unknown "
+                                "duration.\n", part->filename);
+                        end_time = 1;
+                    }
+                    part->length = end_time - part->offset;
+                } else if (end_time >= 0) {
+                    double end_part = part->offset + part->length;
+                    if (end_part > end_time) {
+                        MP_WARN(tl, "EDL: entry %d uses %f "
+                                "seconds, but file has only %f seconds.\n",
+                                n, end_part, end_time);
+                    }
                 }
+            } else {
+                MP_VERBOSE(tl, "Segment %d will be opened on demand.\n", n);
             }
 
             // Add a chapter between each file.
@@ -305,8 +433,10 @@ static void build_timeline(struct timeline *tl, struct tl_parts *parts)
             MP_TARRAY_APPEND(tl, tl->chapters, tl->num_chapters, ch);
 
             // Also copy the source file's chapters for the relevant parts
-            copy_chapters(&tl->chapters, &tl->num_chapters, source, part->offset,
-                          part->length, starttime);
+            if (source) {
+                copy_chapters(&tl->chapters, &tl->num_chapters, source,
+                              part->offset, part->length, starttime);
+            }
         }
 
         tl->parts[n] = (struct timeline_part) {
@@ -327,11 +457,13 @@ static void build_timeline(struct timeline *tl, struct tl_parts *parts)
     }
     tl->parts[parts->num_parts] = (struct timeline_part) {.start = starttime};
     tl->num_parts = parts->num_parts;
+    talloc_free(src);
     return;
 
 error:
     tl->num_parts = 0;
     tl->num_chapters = 0;
+    talloc_free(src);
 }
 
 // For security, don't allow relative or absolute paths, only plain filenames.
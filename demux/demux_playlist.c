@@ -33,6 +33,11 @@
 
 #define PROBE_SIZE (8 * 1024)
 
+// With demuxer_params.playlist_incremental, stop parsing after this many
+// entries, and continue in chunks of the same size on DEMUXER_CTRL_READ_PLAYLIST.
+// Large enough that normal playlists are always read in one go.
+#define PLAYLIST_CHUNK 5000
+
 static bool check_mimetype(struct stream *s, const char *const *list)
 {
     if (s->mime_type) {
@@ -53,10 +58,12 @@ struct pl_parser {
     bool error;
     bool probing;
     bool force;
-    bool add_base;
+    bstr base_path; // relative entries are resolved against this
+    int max_entries; // stop parsing once pl has this many entries (if not 0)
     enum demux_check check_level;
     struct stream *real_stream;
     char *format;
+    const struct pl_format *fmt;
 };
 
 static char *pl_get_line0(struct pl_parser *p)
@@ -77,11 +84,11 @@ static bstr pl_get_line(struct pl_parser *p)
     return bstr0(pl_get_line0(p));
 }
 
-static void pl_add(struct pl_parser *p, bstr entry)
+static struct playlist_entry *pl_add(struct pl_parser *p, bstr entry)
 {
-    char *s = bstrto0(NULL, entry);
-    playlist_add_file(p->pl, s);
-    talloc_free(s);
+    struct playlist_entry *e = playlist_entry_new_relative(p->base_path, entry);
+    playlist_add(p->pl, e);
+    return e;
 }
 
 static bool pl_eof(struct pl_parser *p)
@@ -89,6 +96,12 @@ static bool pl_eof(struct pl_parser *p)
     return p->error || p->s->eof;
 }
 
+// Whether the parser should return early (see pl_format.parse_more).
+static bool pl_full(struct pl_parser *p)
+{
+    return p->max_entries && p->pl->num_entries >= p->max_entries;
+}
+
 static bool maybe_text(bstr d)
 {
     for (int n = 0; n < d.len; n++) {
@@ -99,6 +112,31 @@ static bool maybe_text(bstr d)
     return true;
 }
 
+static void parse_m3u_lines(struct pl_parser *p, bstr line)
+{
+    char *title = NULL;
+    while (line.len || !pl_eof(p)) {
+        if (bstr_eatstart0(&line, "#EXTINF:")) {
+            bstr duration, btitle;
+            if (bstr_split_tok(line, ",", &duration, &btitle) && btitle.len) {
+                talloc_free(title);
+                title = bstrto0(NULL, btitle);
+            }
+        } else if (bstr_startswith0(line, "#EXT-X-")) {
+            p->format = "hls";
+        } else if (line.len > 0 && !bstr_startswith0(line, "#")) {
+            struct playlist_entry *e = pl_add(p, line);
+            e->title = talloc_steal(e, title);
+            title = NULL;
+            // Stop only here, so no #EXTINF title is pending.
+            if (pl_full(p))
+                return;
+        }
+        line = bstr_strip(pl_get_line(p));
+    }
+    talloc_free(title);
+}
+
 static int parse_m3u(struct pl_parser *p)
 {
     bstr line = bstr_strip(pl_get_line(p));
@@ -122,30 +160,16 @@ ok:
     if (p->probing)
         return 0;
 
-    char *title = NULL;
-    while (line.len || !pl_eof(p)) {
-        if (bstr_eatstart0(&line, "#EXTINF:")) {
-            bstr duration, btitle;
-            if (bstr_split_tok(line, ",", &duration, &btitle) && btitle.len) {
-                talloc_free(title);
-                title = bstrto0(NULL, btitle);
-            }
-        } else if (bstr_startswith0(line, "#EXT-X-")) {
-            p->format = "hls";
-        } else if (line.len > 0 && !bstr_startswith0(line, "#")) {
-            char *fn = bstrto0(NULL, line);
-            struct playlist_entry *e = playlist_entry_new(fn);
-            talloc_free(fn);
-            e->title = talloc_steal(e, title);
-            title = NULL;
-            playlist_add(p->pl, e);
-        }
-        line = bstr_strip(pl_get_line(p));
-    }
-    talloc_free(title);
+    // If there's no header, the first line is an entry.
+    parse_m3u_lines(p, line);
     return 0;
 }
 
+static void parse_m3u_more(struct pl_parser *p)
+{
+    parse_m3u_lines(p, bstr_strip(pl_get_line(p)));
+}
+
 static int parse_ref_init(struct pl_parser *p)
 {
     bstr line = bstr_strip(pl_get_line(p));
@@ -178,18 +202,11 @@ static int parse_ref_init(struct pl_parser *p)
     return 0;
 }
 
-static int parse_ini_thing(struct pl_parser *p, const char *header,
-                           const char *entry)
+// Note that the entries are added in file order, not by their index.
+static void parse_ini_lines(struct pl_parser *p, const char *entry)
 {
-    bstr line = {0};
-    while (!line.len && !pl_eof(p))
-        line = bstr_strip(pl_get_line(p));
-    if (bstrcasecmp0(line, header) != 0)
-        return -1;
-    if (p->probing)
-        return 0;
-    while (!pl_eof(p)) {
-        line = bstr_strip(pl_get_line(p));
+    while (!pl_eof(p) && !pl_full(p)) {
+        bstr line = bstr_strip(pl_get_line(p));
         bstr key, value;
         if (bstr_split_tok(line, "=", &key, &value) &&
             bstr_case_startswith(key, bstr0(entry)))
@@ -200,6 +217,19 @@ static int parse_ini_thing(struct pl_parser *p, const char *header,
             pl_add(p, value);
         }
     }
+}
+
+static int parse_ini_thing(struct pl_parser *p, const char *header,
+                           const char *entry)
+{
+    bstr line = {0};
+    while (!line.len && !pl_eof(p))
+        line = bstr_strip(pl_get_line(p));
+    if (bstrcasecmp0(line, header) != 0)
+        return -1;
+    if (p->probing)
+        return 0;
+    parse_ini_lines(p, entry);
     return 0;
 }
 
@@ -208,11 +238,26 @@ static int parse_pls(struct pl_parser *p)
     return parse_ini_thing(p, "[playlist]", "File");
 }
 
+static void parse_pls_more(struct pl_parser *p)
+{
+    parse_ini_lines(p, "File");
+}
+
 static int parse_url(struct pl_parser *p)
 {
     return parse_ini_thing(p, "[InternetShortcut]", "URL");
 }
 
+static void parse_txt_more(struct pl_parser *p)
+{
+    while (!pl_eof(p) && !pl_full(p)) {
+        bstr line = bstr_strip(pl_get_line(p));
+        if (line.len == 0)
+            continue;
+        pl_add(p, line);
+    }
+}
+
 static int parse_txt(struct pl_parser *p)
 {
     if (!p->force)
@@ -220,12 +265,7 @@ static int parse_txt(struct pl_parser *p)
     if (p->probing)
         return 0;
     MP_WARN(p, "Reading plaintext playlist.\n");
-    while (!pl_eof(p)) {
-        bstr line = bstr_strip(pl_get_line(p));
-        if (line.len == 0)
-            continue;
-        pl_add(p, line);
-    }
+    parse_txt_more(p);
     return 0;
 }
 
@@ -310,8 +350,6 @@ static int parse_dir(struct pl_parser *p)
     for (int n = 0; n < num_files; n++)
         playlist_add_file(p->pl, files[n]);
 
-    p->add_base = false;
-
     return num_files > 0 ? 0 : -1;
 }
 
@@ -322,17 +360,22 @@ struct pl_format {
     const char *name;
     int (*parse)(struct pl_parser *p);
     const char *const *mime_types;
+    // If set, parse() stops early if pl_full() is true, and parse_more()
+    // continues where it stopped (with the same semantics).
+    void (*parse_more)(struct pl_parser *p);
 };
 
 static const struct pl_format formats[] = {
     {"directory", parse_dir},
     {"m3u", parse_m3u,
-     MIME_TYPES("audio/mpegurl", "audio/x-mpegurl", "application/x-mpegurl")},
+     MIME_TYPES("audio/mpegurl", "audio/x-mpegurl", "application/x-mpegurl"),
+     .parse_more = parse_m3u_more},
     {"ini", parse_ref_init},
     {"pls", parse_pls,
-     MIME_TYPES("audio/x-scpls")},
+     MIME_TYPES("audio/x-scpls"),
+     .parse_more = parse_pls_more},
     {"url", parse_url},
-    {"txt", parse_txt},
+    {"txt", parse_txt, .parse_more = parse_txt_more},
 };
 
 static const struct pl_format *probe_pl(struct pl_parser *p)
@@ -363,7 +406,6 @@ static int open_file(struct demuxer *demuxer, enum demux_check check)
     p->log = demuxer->log;
     p->pl = talloc_zero(p, struct playlist);
     p->real_stream = demuxer->stream;
-    p->add_base = true;
 
     bstr probe_buf = stream_peek(demuxer->stream, PROBE_SIZE);
     p->s = open_memory_stream(probe_buf.start, probe_buf.len);
@@ -384,18 +426,48 @@ static int open_file(struct demuxer *demuxer, enum demux_check check)
     p->error = false;
     p->s = demuxer->stream;
     p->utf16 = stream_skip_bom(p->s);
+    p->base_path = mp_dirname(demuxer->filename);
+    p->fmt = fmt;
+    if (fmt->parse_more && demuxer->params &&
+        demuxer->params->playlist_incremental)
+        p->max_entries = PLAYLIST_CHUNK;
     bool ok = fmt->parse(p) >= 0 && !p->error;
-    if (p->add_base)
-        playlist_add_base_path(p->pl, mp_dirname(demuxer->filename));
     demuxer->playlist = talloc_steal(demuxer, p->pl);
     demuxer->filetype = p->format ? p->format : fmt->name;
+    if (ok && pl_full(p) && !pl_eof(p)) {
+        // Keep the parser and the stream for DEMUXER_CTRL_READ_PLAYLIST.
+        MP_VERBOSE(demuxer, "Reading rest of the playlist later.\n");
+        demuxer->playlist_incomplete = true;
+        demuxer->priv = talloc_steal(demuxer, p);
+        return 0;
+    }
     demuxer->fully_read = true;
     talloc_free(p);
     return ok ? 0 : -1;
 }
 
+static int control(struct demuxer *demuxer, int cmd, void *arg)
+{
+    struct pl_parser *p = demuxer->priv;
+    if (cmd != DEMUXER_CTRL_READ_PLAYLIST || !p)
+        return CONTROL_UNKNOWN;
+
+    struct demux_ctrl_read_playlist *c = arg;
+    p->pl = c->pl;
+    p->max_entries = c->pl->num_entries + PLAYLIST_CHUNK;
+    if (!pl_eof(p)) {
+        p->fmt->parse_more(p);
+        if (p->error)
+            MP_ERR(demuxer, "Error while reading the rest of the playlist.\n");
+    }
+    c->eof = !pl_full(p) || pl_eof(p);
+    p->pl = NULL;
+    return CONTROL_OK;
+}
+
 const struct demuxer_desc demuxer_desc_playlist = {
     .name = "playlist",
     .desc = "Playlist file",
     .open = open_file,
+    .control = control,
 };
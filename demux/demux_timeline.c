@@ -17,15 +17,41 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include "common/common.h"
 #include "common/msg.h"
+#include "misc/thread_tools.h"
+#include "options/m_config.h"
+#include "options/m_option.h"
+#include "osdep/atomic.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
 
 #include "demux.h"
 #include "timeline.h"
 #include "stheader.h"
 #include "stream/stream.h"
 
+// Number of packets read ahead from a pre-opened segment.
+#define PREBUFFER_PACKETS 32
+
+struct demux_timeline_opts {
+    double preopen_secs;
+};
+
+#define OPT_BASE_STRUCT struct demux_timeline_opts
+const struct m_sub_options demux_timeline_conf = {
+    .opts = (const struct m_option[]) {
+        OPT_DOUBLE("preopen-secs", preopen_secs, M_OPT_MIN, .min = 0),
+        {0}
+    },
+    .size = sizeof(struct demux_timeline_opts),
+    .defaults = &(const struct demux_timeline_opts){
+        .preopen_secs = 10,
+    },
+};
+
 struct segment {
     int index;
     double start, end;
@@ -33,6 +59,9 @@ struct segment {
     char *url;
     bool lazy;
     struct demuxer *d;
+    // For lazy segments opened by preopen_thread(). Needs to stay valid as
+    // long as d does.
+    struct mp_cancel *cancel;
     // stream_map[sh_stream.index] = index into priv.streams, where sh_stream
     // is a stream from the source d. It's used to map the streams of the
     // source onto the set of streams of the virtual timeline.
@@ -49,8 +78,27 @@ struct virtual_stream {
     int eos_packets;            // deal with b-frame delay
 };
 
+// Background open of a lazy segment, before playback reaches it.
+struct preopen {
+    struct segment *seg;
+    pthread_t thread;
+    // Read-only for the thread.
+    char *url;
+    bstr init_fragment;
+    bool dash;
+    double ts_offset;
+    struct mpv_global *global;
+    // Written by the thread, valid once done is set (or after joining).
+    struct demuxer *d;
+    struct demux_packet **packets;
+    int num_packets;
+    int64_t open_time;
+    atomic_bool done;
+};
+
 struct priv {
     struct timeline *tl;
+    struct demux_timeline_opts *opts;
 
     double duration;
     bool dash;
@@ -66,6 +114,13 @@ struct priv {
     // Total number of packets received past end of segment. Used
     // to be clever about determining when to switch segments.
     int eos_packets;
+
+    // Segment being pre-opened, if any (always the one after current).
+    struct preopen *preopen;
+    // Packets read ahead from a pre-opened segment, returned before reading
+    // from current->d. Positioned at current->start.
+    struct demux_packet **prebuf;
+    int num_prebuf;
 };
 
 static bool target_stream_used(struct segment *seg, int target_index)
@@ -139,11 +194,192 @@ static void reselect_streams(struct demuxer *demuxer)
     }
 }
 
+static void *preopen_thread(void *arg)
+{
+    struct preopen *po = arg;
+    struct segment *seg = po->seg;
+
+    mpthread_set_name("preopen");
+
+    int64_t start = mp_time_us();
+
+    // Must open the segment the same way as reopen_lazy_segments().
+    struct demuxer_params params = {
+        .init_fragment = po->init_fragment,
+        .skip_lavf_probing = po->dash,
+    };
+    struct demuxer *d = demux_open_url(po->url, &params, seg->cancel, po->global);
+    if (d) {
+        demux_disable_cache(d);
+
+        // We don't know which streams will be used yet (the stream map is
+        // created on the demux thread), so read ahead with all of them.
+        int num_streams = demux_get_num_stream(d);
+        for (int n = 0; n < num_streams; n++)
+            demuxer_select_track(d, demux_get_stream(d, n), MP_NOPTS_VALUE, true);
+
+        // Same as what switch_segment() does for a normal segment transition.
+        if (!po->dash) {
+            demux_set_ts_offset(d, po->ts_offset);
+            demux_seek(d, seg->start, SEEK_HR);
+        }
+
+        while (po->num_packets < PREBUFFER_PACKETS && !mp_cancel_test(seg->cancel)) {
+            struct demux_packet *pkt = demux_read_any_packet(d);
+            if (!pkt)
+                break;
+            MP_TARRAY_APPEND(po, po->packets, po->num_packets, pkt);
+        }
+    }
+
+    po->d = d;
+    po->open_time = mp_time_us() - start;
+    atomic_store(&po->done, true);
+    return NULL;
+}
+
+static void start_preopen(struct demuxer *demuxer, struct segment *seg)
+{
+    struct priv *p = demuxer->priv;
+
+    assert(!p->preopen);
+
+    if (!seg->cancel) {
+        seg->cancel = mp_cancel_new(seg);
+        mp_cancel_set_parent(seg->cancel, demuxer->cancel);
+    }
+    mp_cancel_reset(seg->cancel);
+
+    struct preopen *po = talloc_ptrtype(NULL, po);
+    *po = (struct preopen){
+        .seg = seg,
+        .url = seg->url,
+        .init_fragment = p->tl->init_fragment,
+        .dash = p->dash,
+        .ts_offset = seg->start - seg->d_start,
+        .global = demuxer->global,
+        .done = ATOMIC_VAR_INIT(false),
+    };
+
+    MP_VERBOSE(demuxer, "pre-opening segment %d\n", seg->index);
+
+    if (pthread_create(&po->thread, NULL, preopen_thread, po)) {
+        MP_WARN(demuxer, "failed to start pre-open thread\n");
+        talloc_free(po);
+        return;
+    }
+
+    p->preopen = po;
+}
+
+static void free_packets(struct demux_packet **packets, int num_packets)
+{
+    for (int n = 0; n < num_packets; n++)
+        talloc_free(packets[n]);
+}
+
+// Wait for the pre-open thread and return the struct, owned by the caller.
+static struct preopen *join_preopen(struct demuxer *demuxer, bool cancel)
+{
+    struct priv *p = demuxer->priv;
+    struct preopen *po = p->preopen;
+
+    if (!po)
+        return NULL;
+
+    if (cancel)
+        mp_cancel_trigger(po->seg->cancel);
+    pthread_join(po->thread, NULL);
+    p->preopen = NULL;
+    return po;
+}
+
+// Abort the pre-open (if any), and throw away what was read.
+static void stop_preopen(struct demuxer *demuxer)
+{
+    struct preopen *po = join_preopen(demuxer, true);
+
+    if (!po)
+        return;
+
+    MP_VERBOSE(demuxer, "dropping pre-opened segment %d\n", po->seg->index);
+    free_packets(po->packets, po->num_packets);
+    demux_free(po->d);
+    talloc_free(po);
+}
+
+static void drop_prebuf(struct demuxer *demuxer)
+{
+    struct priv *p = demuxer->priv;
+
+    free_packets(p->prebuf, p->num_prebuf);
+    p->num_prebuf = 0;
+}
+
+// Take over a pre-opened demuxer for seg, waiting for it if it's not done.
+// Returns whether seg->d is positioned at seg->start with p->prebuf set.
+static bool take_preopen(struct demuxer *demuxer, struct segment *seg)
+{
+    struct priv *p = demuxer->priv;
+
+    if (!p->preopen)
+        return false;
+
+    if (p->preopen->seg != seg) {
+        // Keep it if it's still the segment after the new one.
+        if (p->preopen->seg->index != seg->index + 1)
+            stop_preopen(demuxer);
+        return false;
+    }
+
+    bool was_done = atomic_load(&p->preopen->done);
+    struct preopen *po = join_preopen(demuxer, false);
+
+    MP_VERBOSE(demuxer, "segment %d was pre-opened in %.1f ms%s\n",
+               seg->index, po->open_time / 1e3,
+               was_done ? "" : " (had to wait)");
+
+    if (!seg->d && po->d) {
+        seg->d = po->d;
+        po->d = NULL;
+        drop_prebuf(demuxer);
+        for (int n = 0; n < po->num_packets; n++)
+            MP_TARRAY_APPEND(p, p->prebuf, p->num_prebuf, po->packets[n]);
+        po->num_packets = 0;
+    }
+
+    bool ok = seg->d && !po->d;
+    free_packets(po->packets, po->num_packets);
+    demux_free(po->d);
+    talloc_free(po);
+    return ok;
+}
+
+// Start opening the next lazy segment if reading gets close to the end of
+// the current one.
+static void check_preopen(struct demuxer *demuxer, double pts)
+{
+    struct priv *p = demuxer->priv;
+    struct segment *seg = p->current;
+
+    if (!p->opts->preopen_secs || p->preopen || pts == MP_NOPTS_VALUE ||
+        pts < seg->end - p->opts->preopen_secs)
+        return;
+
+    if (seg->index + 1 >= p->num_segments)
+        return;
+
+    struct segment *next = p->segments[seg->index + 1];
+    if (next->lazy && !next->d)
+        start_preopen(demuxer, next);
+}
+
 static void close_lazy_segments(struct demuxer *demuxer)
 {
     struct priv *p = demuxer->priv;
 
-    // unload previous segment
+    // unload previous segment (a pre-opened segment is owned by p->preopen
+    // until it's switched to)
     for (int n = 0; n < p->num_segments; n++) {
         struct segment *seg = p->segments[n];
         if (seg != p->current && seg->d && seg->lazy) {
@@ -157,14 +393,17 @@ static void reopen_lazy_segments(struct demuxer *demuxer)
 {
     struct priv *p = demuxer->priv;
 
-    if (p->current->d)
-        return;
-
     close_lazy_segments(demuxer);
 
+    if (p->current->d) {
+        associate_streams(demuxer, p->current);
+        return;
+    }
+
     struct demuxer_params params = {
         .init_fragment = p->tl->init_fragment,
-        .skip_lavf_probing = true,
+        // Segments are expected to be all the same for DASH.
+        .skip_lavf_probing = p->dash,
     };
     p->current->d = demux_open_url(p->current->url, &params,
                                    demuxer->cancel, demuxer->global);
@@ -185,6 +424,17 @@ static void switch_segment(struct demuxer *demuxer, struct segment *new,
 
     MP_VERBOSE(demuxer, "switch to segment %d\n", new->index);
 
+    int64_t start = mp_time_us();
+
+    drop_prebuf(demuxer);
+    bool preopened = take_preopen(demuxer, new);
+    // The pre-open thread read from the segment start; only useful if that's
+    // where we're going (and not if this is a seek into the segment).
+    if (preopened && !init) {
+        drop_prebuf(demuxer);
+        preopened = false;
+    }
+
     p->current = new;
     reopen_lazy_segments(demuxer);
     if (!new->d)
@@ -192,9 +442,15 @@ static void switch_segment(struct demuxer *demuxer, struct segment *new,
     reselect_streams(demuxer);
     if (!p->dash)
         demux_set_ts_offset(new->d, new->start - new->d_start);
-    if (!p->dash || !init)
+    if ((!p->dash || !init) && !preopened)
         demux_seek(new->d, start_pts, flags);
 
+    if (new->lazy) {
+        MP_VERBOSE(demuxer, "segment switch took %.1f ms%s\n",
+                   (mp_time_us() - start) / 1e3,
+                   preopened ? " (pre-opened)" : "");
+    }
+
     for (int n = 0; n < p->num_streams; n++) {
         struct virtual_stream *vs = p->streams[n];
         vs->eos_packets = 0;
@@ -211,13 +467,17 @@ static void d_seek(struct demuxer *demuxer, double seek_pts, int flags)
 
     flags &= SEEK_FORWARD | SEEK_HR;
 
-    struct segment *new = p->segments[p->num_segments - 1];
-    for (int n = 0; n < p->num_segments; n++) {
-        if (pts < p->segments[n]->end) {
-            new = p->segments[n];
-            break;
+    // Binary search for the first segment with pts < end (or the last one).
+    int lo = 0, hi = p->num_segments - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (pts < p->segments[mid]->end) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
         }
     }
+    struct segment *new = p->segments[lo];
 
     switch_segment(demuxer, new, pts, flags, false);
 }
@@ -233,10 +493,19 @@ static int d_fill_buffer(struct demuxer *demuxer)
     if (!seg || !seg->d)
         return 0;
 
-    struct demux_packet *pkt = demux_read_any_packet(seg->d);
+    struct demux_packet *pkt = NULL;
+    if (p->num_prebuf) {
+        pkt = p->prebuf[0];
+        MP_TARRAY_REMOVE_AT(p->prebuf, p->num_prebuf, 0);
+    } else {
+        pkt = demux_read_any_packet(seg->d);
+    }
     if (!pkt || pkt->pts >= seg->end)
         p->eos_packets += 1;
 
+    if (pkt)
+        check_preopen(demuxer, pkt->pts);
+
     // Test for EOF. Do this here to properly run into EOF even if other
     // streams are disabled etc. If it somehow doesn't manage to reach the end
     // after demuxing a high (bit arbitrary) number of packets, assume one of
@@ -259,15 +528,9 @@ static int d_fill_buffer(struct demuxer *demuxer)
     if (eos_reached || !pkt) {
         talloc_free(pkt);
 
-        struct segment *next = NULL;
-        for (int n = 0; n < p->num_segments - 1; n++) {
-            if (p->segments[n] == seg) {
-                next = p->segments[n + 1];
-                break;
-            }
-        }
-        if (!next)
+        if (seg->index + 1 >= p->num_segments)
             return 0;
+        struct segment *next = p->segments[seg->index + 1];
         switch_segment(demuxer, next, next->start, 0, true);
         return 1; // reader will retry
     }
@@ -320,6 +583,10 @@ static void print_timeline(struct demuxer *demuxer)
 {
     struct priv *p = demuxer->priv;
 
+    // Quadratic in the number of segments.
+    if (!mp_msg_test(demuxer->log, MSGL_V))
+        return;
+
     MP_VERBOSE(demuxer, "Timeline segments:\n");
     for (int n = 0; n < p->num_segments; n++) {
         struct segment *seg = p->segments[n];
@@ -344,6 +611,7 @@ static void print_timeline(struct demuxer *demuxer)
 static int d_open(struct demuxer *demuxer, enum demux_check check)
 {
     struct priv *p = demuxer->priv = talloc_zero(demuxer, struct priv);
+    p->opts = mp_get_config_group(p, demuxer->global, &demux_timeline_conf);
     p->tl = demuxer->params ? demuxer->params->timeline : NULL;
     if (!p->tl || p->tl->num_parts < 1)
         return -1;
@@ -428,6 +696,8 @@ static void d_close(struct demuxer *demuxer)
 {
     struct priv *p = demuxer->priv;
     struct demuxer *master = p->tl->demuxer;
+    stop_preopen(demuxer);
+    drop_prebuf(demuxer);
     p->current = NULL;
     close_lazy_segments(demuxer);
     timeline_destroy(p->tl);
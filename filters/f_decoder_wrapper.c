@@ -404,7 +404,7 @@ static void process_audio_frame(struct priv *p, struct mp_aframe *aframe)
     double frame_pts = mp_aframe_get_pts(aframe);
     if (frame_pts != MP_NOPTS_VALUE) {
         if (p->pts != MP_NOPTS_VALUE)
-            MP_STATS(p, "value %f audio-pts-err", p->pts - frame_pts);
+            MP_STATS_VALUE(p, "audio-pts-err", p->pts - frame_pts);
 
         double diff = fabs(p->pts - frame_pts);
 
@@ -464,6 +464,11 @@ static void feed_packet(struct priv *p)
             mp_filter_internal_mark_failed(p->f);
             return;
         }
+        if (p->packet.type == MP_FRAME_PACKET) {
+            struct demux_packet *pkt = p->packet.data;
+            p->public.num_packets += 1;
+            p->public.packet_bytes += pkt->len;
+        }
     }
 
     // Flush current data if the packet is a new segment.
@@ -492,6 +497,9 @@ static void feed_packet(struct priv *p)
             packet->pts < start_pts - .005 && !p->has_broken_packet_pts)
             framedrop_type = 2;
 
+        if (p->public.keyframes_only)
+            framedrop_type = 3;
+
         p->decoder->control(p->decoder->f, VDCTRL_SET_FRAMEDROP, &framedrop_type);
     }
 
@@ -588,6 +596,13 @@ static void read_frame(struct priv *p)
     }
     p->packets_without_output = 0;
 
+    if (frame.type == MP_FRAME_VIDEO) {
+        p->public.num_frames += 1;
+    } else if (frame.type == MP_FRAME_AUDIO) {
+        p->public.num_frames += 1;
+        p->public.num_samples += mp_aframe_get_size(frame.data);
+    }
+
     bool segment_ended = process_decoded_frame(p, &frame);
 
     // If there's a new segment, start it as soon as we're drained/finished.
@@ -645,6 +660,7 @@ struct mp_decoder_wrapper *mp_decoder_wrapper_create(struct mp_filter *parent,
     struct mp_filter *f = mp_filter_create(parent, &decode_wrapper_filter);
     if (!f)
         return NULL;
+    talloc_set_account(f, "decoder");
 
     struct priv *p = f->priv;
     struct mp_decoder_wrapper *w = &p->public;
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "filter.h"
 
@@ -38,6 +39,11 @@ struct mp_decoder_wrapper {
     // Can be set by user.
     struct mp_recorder_sink *recorder_sink;
 
+    // Throughput counters (informational, not reset on seeks).
+    int64_t num_packets, packet_bytes;  // packets read from the demuxer
+    int64_t num_frames;                 // frames returned by the decoder
+    int64_t num_samples;                // audio samples returned by the decoder
+
     // --- for STREAM_VIDEO
 
     // FPS from demuxer or from user override
@@ -47,6 +53,9 @@ struct mp_decoder_wrapper {
     int attempt_framedrops; // try dropping this many frames
     int dropped_frames; // total frames _probably_ dropped
 
+    // Decode keyframes only, and skip all other frames (e.g. for thumbnails).
+    bool keyframes_only;
+
     // --- for STREAM_AUDIO
 
     // Prefer spdif wrapper over real decoders.
@@ -74,7 +83,7 @@ enum dec_ctrl {
     VDCTRL_GET_HWDEC,
     VDCTRL_REINIT,
     VDCTRL_GET_BFRAMES,
-    // framedrop mode: 0=none, 1=standard, 2=hrseek
+    // framedrop mode: 0=none, 1=standard, 2=hrseek, 3=keyframes only
     VDCTRL_SET_FRAMEDROP,
 };
 
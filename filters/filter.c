@@ -3,6 +3,7 @@
 #include "common/common.h"
 #include "common/global.h"
 #include "common/msg.h"
+#include "osdep/timer.h"
 #include "video/hwdec.h"
 
 #include "filter.h"
@@ -87,6 +88,11 @@ struct filter_runner {
     // by async_lock.
     struct mp_filter **async_pending;
     int num_async_pending;
+
+    // Time spent in process() per filter type, if enabled.
+    bool stats_enabled;
+    struct mp_filter_stats *stats;
+    int num_stats;
 };
 
 struct mp_filter_internal {
@@ -173,6 +179,25 @@ static void flush_async_notifications(struct filter_runner *r)
     pthread_mutex_unlock(&r->async_lock);
 }
 
+static void add_stats(struct filter_runner *r, const char *name, int64_t us)
+{
+    struct mp_filter_stats *st = NULL;
+    for (int n = 0; n < r->num_stats; n++) {
+        if (strcmp(r->stats[n].name, name) == 0) {
+            st = &r->stats[n];
+            break;
+        }
+    }
+    if (!st) {
+        // Copy the name, as the filter might be gone by the time it's read.
+        struct mp_filter_stats new = {.name = talloc_strdup(r, name)};
+        MP_TARRAY_APPEND(r, r->stats, r->num_stats, new);
+        st = &r->stats[r->num_stats - 1];
+    }
+    st->calls += 1;
+    st->time_us += us;
+}
+
 bool mp_filter_run(struct mp_filter *filter)
 {
     struct filter_runner *r = filter->in->runner;
@@ -190,8 +215,15 @@ bool mp_filter_run(struct mp_filter *filter)
         r->num_pending -= 1;
         next->in->pending = false;
 
-        if (next->in->info->process)
-            next->in->info->process(next);
+        if (next->in->info->process) {
+            if (r->stats_enabled) {
+                int64_t start = mp_time_us();
+                next->in->info->process(next);
+                add_stats(r, next->in->info->name, mp_time_us() - start);
+            } else {
+                next->in->info->process(next);
+            }
+        }
     }
 
     r->filtering = false;
@@ -768,6 +800,20 @@ void mp_filter_root_set_wakeup_cb(struct mp_filter *root,
     pthread_mutex_unlock(&r->async_lock);
 }
 
+void mp_filter_root_set_stats(struct mp_filter *root, bool enable)
+{
+    struct filter_runner *r = root->in->runner;
+    r->stats_enabled = enable;
+}
+
+int mp_filter_root_get_stats(struct mp_filter *root,
+                             struct mp_filter_stats **out)
+{
+    struct filter_runner *r = root->in->runner;
+    *out = r->stats;
+    return r->num_stats;
+}
+
 static const char *filt_name(struct mp_filter *f)
 {
     return f ? f->in->info->name : "-";
@@ -426,5 +426,23 @@ struct mp_filter *mp_filter_create_root(struct mpv_global *global);
 void mp_filter_root_set_wakeup_cb(struct mp_filter *root,
                                   void (*wakeup_cb)(void *ctx), void *ctx);
 
+// Time spent in process() of each filter type (mp_filter_info.name), summed
+// over all filters of the root's graph, including filters which have been
+// destroyed since.
+struct mp_filter_stats {
+    const char *name;
+    int64_t calls;
+    int64_t time_us;
+};
+
+// Enable collecting mp_filter_stats (off by default, as it costs 2 timer calls
+// per process() call).
+void mp_filter_root_set_stats(struct mp_filter *root, bool enable);
+
+// Return the number of entries written to *out. The array is valid until the
+// next mp_filter_run() call, or until the root filter is destroyed.
+int mp_filter_root_get_stats(struct mp_filter *root,
+                             struct mp_filter_stats **out);
+
 // Debugging internal stuff.
 void mp_filter_dump_states(struct mp_filter *f);
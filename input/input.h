@@ -219,9 +219,20 @@ void mp_uninit_ipc(struct mp_ipc_ctx *ctx);
 struct mpv_event;
 char *mp_json_encode_event(struct mpv_event *event);
 
+// Like mp_json_encode_event(), but append the JSON (and a newline) to *dst,
+// which must be NULL or a talloc'ed buffer (see bstr_xappend()).
+int mp_json_write_event(bstr *dst, struct mpv_event *event);
+
 // Given the raw IPC input buffer "buf", remove the first newline-separated
 // command, execute it and return the result (if any) as an allocated string.
 struct mpv_handle;
 char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf);
 
+// Execute a single command line (without trailing newline). line is modified.
+// The reply (if any) is appended to *out (see mp_json_write_event()). The
+// arena (see misc/json.h) is used for temporary data, and is reset on return.
+struct json_arena;
+void mp_ipc_run_line(struct mpv_handle *client, struct json_arena *arena,
+                     char *line, bstr *out);
+
 #endif /* MPLAYER_INPUT_H */
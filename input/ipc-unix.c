@@ -28,6 +28,7 @@
 
 #include "config.h"
 
+#include "osdep/atomic.h"
 #include "osdep/io.h"
 #include "osdep/threads.h"
 
@@ -36,14 +37,30 @@
 #include "common/msg.h"
 #include "input/input.h"
 #include "libmpv/client.h"
+#include "misc/json.h"
+#include "misc/thread_pool.h"
 #include "options/m_config.h"
 #include "options/options.h"
 #include "options/path.h"
 #include "player/client.h"
 
-#ifndef MSG_NOSIGNAL
-#define MSG_NOSIGNAL 0
-#endif
+// Number of bytes read from a client socket at once.
+#define READ_CHUNK (64 * 1024)
+
+// If more output than this is queued for a client, stop reading events and
+// commands for it until the client has read some of the data. (This replaces
+// the blocking write, which had the same effect with a thread per client.)
+#define MAX_OUTPUT_BACKLOG (4 * 1024 * 1024)
+
+// If a client's output buffer grew larger than this, free it once all data
+// was written, instead of keeping it around for reuse.
+#define MAX_IDLE_OUTPUT_BUFFER (64 * 1024)
+
+// Maximum number of worker threads running client commands. If more clients
+// have commands blocking on the player core, the rest is queued.
+#define MAX_COMMAND_THREADS 16
+
+struct client_arg;
 
 struct mp_ipc_ctx {
     struct mp_log *log;
@@ -52,10 +69,29 @@ struct mp_ipc_ctx {
 
     pthread_t thread;
     int death_pipe[2];
+
+    // Shared by all clients. Written to by mpv wakeup callbacks.
+    int wakeup_pipe[2];
+    atomic_bool wakeup_pending;
+
+    // Runs the commands sent by clients.
+    struct mp_thread_pool *pool;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    bool stopping;          // the IPC thread stopped listening
+    bool orphaned;          // the IPC thread keeps serving existing clients,
+                            // and frees the context when they're gone
+
+    // --- accessed by the IPC thread only (after it was started)
+    struct client_arg **clients;
+    int num_clients;
+    int client_num;
 };
 
 struct client_arg {
     struct mp_log *log;
+    struct mp_ipc_ctx *ctx;
     struct mpv_handle *client;
 
     char *client_name;
@@ -63,170 +99,297 @@ struct client_arg {
     bool close_client_fd;
 
     bool writable;
+
+    atomic_bool wakeup;     // set by the mpv wakeup callback
+    bool events_pending;    // events might be queued in client
+    bool dead;              // disconnect and destroy on next opportunity
+
+    bstr read_buf;          // received data not yet processed
+    bool read_eof;
+
+    // Commands are run on a worker thread, so that a command blocking on the
+    // player core does not stall the other clients. Only one batch of lines
+    // is in flight per client, which keeps replies and events in order. The
+    // fields below are owned by the worker while busy is set.
+    bool busy;
+    atomic_bool commands_done;  // set by the worker when it's finished
+    bstr cmd_buf;           // complete lines handed to the worker
+    size_t cmd_pos;         // bytes of cmd_buf consumed by the worker
+    bstr cmd_out;           // replies written by the worker
+    struct json_arena *arena; // for parsing commands
+
+    // Queued output. Replies and events are serialized directly into this
+    // buffer. The first out_pos bytes were already written.
+    bstr out_buf;
+    size_t out_pos;
 };
 
-static int ipc_write_str(struct client_arg *client, const char *buf)
+static void wakeup_ipc_thread(struct mp_ipc_ctx *ctx)
 {
-    size_t count = strlen(buf);
-    while (count > 0) {
-        ssize_t rc = send(client->client_fd, buf, count, MSG_NOSIGNAL);
-        if (rc <= 0) {
-            if (rc == 0)
-                return -1;
-
-            if (errno == EBADF || errno == ENOTSOCK) {
-                client->writable = false;
-                return 0;
-            }
-
-            if (errno == EINTR || errno == EAGAIN)
-                continue;
-
-            return rc;
-        }
-
-        count -= rc;
-        buf   += rc;
-    }
-
-    return 0;
+    if (!atomic_exchange(&ctx->wakeup_pending, true))
+        (void)write(ctx->wakeup_pipe[1], &(char){0}, 1);
 }
 
-static void *client_thread(void *p)
+static void wakeup_ipc_client(void *p)
 {
-    pthread_detach(pthread_self());
-
-    // We don't use MSG_NOSIGNAL because the moldy fruit OS doesn't support it.
-    struct sigaction sa = { .sa_handler = SIG_IGN, .sa_flags = SA_RESTART };
-    sigfillset(&sa.sa_mask);
-    sigaction(SIGPIPE, &sa, NULL);
-
-    int rc;
-
     struct client_arg *arg = p;
-    bstr client_msg = { talloc_strdup(NULL, ""), 0 };
+    atomic_store(&arg->wakeup, true);
+    wakeup_ipc_thread(arg->ctx);
+}
 
-    mpthread_set_name(arg->client_name);
+static bool client_throttled(struct client_arg *arg)
+{
+    return arg->out_buf.len - arg->out_pos >= MAX_OUTPUT_BACKLOG;
+}
 
-    int pipe_fd = mpv_get_wakeup_pipe(arg->client);
-    if (pipe_fd < 0) {
-        MP_ERR(arg, "Could not get wakeup pipe\n");
-        goto done;
+static void discard_output(struct client_arg *arg)
+{
+    if (talloc_get_size(arg->out_buf.start) > MAX_IDLE_OUTPUT_BUFFER) {
+        talloc_free(arg->out_buf.start);
+        arg->out_buf.start = NULL;
     }
+    arg->out_buf.len = arg->out_pos = 0;
+}
 
-    MP_VERBOSE(arg, "Client connected\n");
-
-    struct pollfd fds[2] = {
-        {.events = POLLIN, .fd = pipe_fd},
-        {.events = POLLIN, .fd = arg->client_fd},
-    };
-
-    fcntl(arg->client_fd, F_SETFL, fcntl(arg->client_fd, F_GETFL, 0) | O_NONBLOCK);
+// Write as much queued output as possible without blocking.
+static void flush_output(struct client_arg *arg)
+{
+    if (!arg->writable) {
+        discard_output(arg);
+        return;
+    }
 
-    while (1) {
-        rc = poll(fds, 2, 0);
-        if (rc == 0)
-            rc = poll(fds, 2, -1);
+    while (arg->out_pos < arg->out_buf.len && !arg->dead) {
+        ssize_t rc = write(arg->client_fd, arg->out_buf.start + arg->out_pos,
+                           arg->out_buf.len - arg->out_pos);
         if (rc < 0) {
-            MP_ERR(arg, "Poll error\n");
-            continue;
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == EBADF || errno == ENOTSOCK) {
+                // Not a writable FD (e.g. --input-file).
+                arg->writable = false;
+            } else {
+                MP_ERR(arg, "Write error (%s)\n", mp_strerror(errno));
+                arg->dead = true;
+            }
+            discard_output(arg);
+            return;
         }
+        arg->out_pos += rc;
+    }
 
-        if (fds[0].revents & POLLIN) {
-            mp_flush_wakeup_pipe(pipe_fd);
+    if (arg->out_pos == arg->out_buf.len) {
+        discard_output(arg);
+    } else if (arg->out_pos >= arg->out_buf.len / 2) {
+        // Partial write; drop the written data, so the buffer doesn't grow
+        // with a client that never reads everything.
+        memmove(arg->out_buf.start, arg->out_buf.start + arg->out_pos,
+                arg->out_buf.len - arg->out_pos);
+        arg->out_buf.len -= arg->out_pos;
+        arg->out_pos = 0;
+    }
+}
 
-            while (1) {
-                mpv_event *event = mpv_wait_event(arg->client, 0);
+static void read_input(struct client_arg *arg)
+{
+    // Limit the amount read in one go, so that other clients get a chance.
+    for (int i = 0; i < 16; i++) {
+        MP_TARRAY_GROW(arg, arg->read_buf.start, arg->read_buf.len + READ_CHUNK);
+        ssize_t bytes = read(arg->client_fd, arg->read_buf.start + arg->read_buf.len,
+                             READ_CHUNK);
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+            if (errno == ECONNRESET) {
+                MP_VERBOSE(arg, "Client disconnected\n");
+                arg->dead = true;
+                return;
+            }
 
-                if (event->event_id == MPV_EVENT_NONE)
-                    break;
+            MP_ERR(arg, "Read error (%s)\n", mp_strerror(errno));
+            arg->dead = true;
+            return;
+        }
 
-                if (event->event_id == MPV_EVENT_SHUTDOWN)
-                    goto done;
+        if (bytes == 0) {
+            MP_VERBOSE(arg, "Client disconnected\n");
+            arg->read_eof = true;
+            return;
+        }
 
-                if (!arg->writable)
-                    continue;
+        arg->read_buf.len += bytes;
+    }
+}
 
-                char *event_msg = mp_json_encode_event(event);
-                if (!event_msg) {
-                    MP_ERR(arg, "Encoding error\n");
-                    goto done;
-                }
+// Runs on a worker thread.
+static void run_commands(void *p)
+{
+    struct client_arg *arg = p;
+    struct mp_ipc_ctx *ctx = arg->ctx;
+
+    while (arg->cmd_pos < arg->cmd_buf.len &&
+           arg->cmd_out.len < MAX_OUTPUT_BACKLOG)
+    {
+        char *line = arg->cmd_buf.start + arg->cmd_pos;
+        // cmd_buf always ends with a newline.
+        char *nl = memchr(line, '\n', arg->cmd_buf.len - arg->cmd_pos);
+        *nl = '\0';
+        mp_ipc_run_line(arg->client, arg->arena, line, &arg->cmd_out);
+        arg->cmd_pos = nl + 1 - (char *)arg->cmd_buf.start;
+    }
 
-                rc = ipc_write_str(arg, event_msg);
-                talloc_free(event_msg);
-                if (rc < 0) {
-                    MP_ERR(arg, "Write error (%s)\n", mp_strerror(errno));
-                    goto done;
-                }
-            }
-        }
+    atomic_store(&arg->commands_done, true);
+    // arg can be destroyed from here on. (ctx can't, because freeing the
+    // thread pool waits until this function has returned.)
+    wakeup_ipc_thread(ctx);
+}
 
-        if (fds[1].revents & (POLLIN | POLLHUP)) {
-            while (1) {
-                char buf[128];
-                bstr append = { buf, 0 };
+// Hand all complete lines received so far to a worker thread.
+static void start_commands(struct client_arg *arg)
+{
+    if (arg->busy || arg->dead || client_throttled(arg))
+        return;
 
-                ssize_t bytes = read(arg->client_fd, buf, sizeof(buf));
-                if (bytes < 0) {
-                    if (errno == EAGAIN)
-                        break;
+    int nl = bstrrchr(arg->read_buf, '\n');
+    if (nl < 0)
+        return;
 
-                    MP_ERR(arg, "Read error (%s)\n", mp_strerror(errno));
-                    goto done;
-                }
+    // Swap the buffers, so that only the incomplete last line is copied.
+    bstr lines = {arg->read_buf.start, nl + 1};
+    bstr rest = bstr_cut(arg->read_buf, nl + 1);
+    arg->read_buf = (bstr){arg->cmd_buf.start, 0};
+    MP_TARRAY_GROW(arg, arg->read_buf.start, rest.len);
+    memcpy(arg->read_buf.start, rest.start, rest.len);
+    arg->read_buf.len = rest.len;
+
+    arg->cmd_buf = lines;
+    arg->cmd_pos = 0;
+    arg->busy = true;
+    atomic_store(&arg->commands_done, false);
+    mp_thread_pool_queue(arg->ctx->pool, run_commands, arg);
+}
 
-                if (bytes == 0) {
-                    MP_VERBOSE(arg, "Client disconnected\n");
-                    goto done;
-                }
+// Queue the replies of the commands run by the worker thread, once it's done.
+static void finish_commands(struct client_arg *arg)
+{
+    if (!arg->busy || !atomic_load(&arg->commands_done))
+        return;
+    arg->busy = false;
 
-                append.len = bytes;
+    bstr_xappend(NULL, &arg->out_buf, arg->cmd_out);
+    if (talloc_get_size(arg->cmd_out.start) > MAX_IDLE_OUTPUT_BUFFER) {
+        talloc_free(arg->cmd_out.start);
+        arg->cmd_out.start = NULL;
+    }
+    arg->cmd_out.len = 0;
+
+    // The worker stops early if the client is throttled. Put the lines it
+    // didn't get to back in front of the received data.
+    bstr rest = bstr_cut(arg->cmd_buf, arg->cmd_pos);
+    if (rest.len) {
+        MP_TARRAY_GROW(arg, arg->read_buf.start, arg->read_buf.len + rest.len);
+        memmove(arg->read_buf.start + rest.len, arg->read_buf.start,
+                arg->read_buf.len);
+        memcpy(arg->read_buf.start, rest.start, rest.len);
+        arg->read_buf.len += rest.len;
+    }
+    arg->cmd_buf.len = arg->cmd_pos = 0;
+}
 
-                bstr_xappend(NULL, &client_msg, append);
+static void process_events(struct client_arg *arg)
+{
+    if (atomic_exchange(&arg->wakeup, false))
+        arg->events_pending = true;
+
+    // While commands are running, leave the events queued, so that they're
+    // sent in the same order relative to the replies as with synchronous
+    // command execution.
+    while (arg->events_pending && !arg->busy && !arg->dead &&
+           !client_throttled(arg))
+    {
+        mpv_event *event = mpv_wait_event(arg->client, 0);
+
+        if (event->event_id == MPV_EVENT_NONE) {
+            arg->events_pending = false;
+            break;
+        }
 
-                while (bstrchr(client_msg, '\n') != -1) {
-                    char *reply_msg = mp_ipc_consume_next_command(arg->client,
-                        NULL, &client_msg);
+        if (event->event_id == MPV_EVENT_SHUTDOWN) {
+            arg->dead = true;
+            break;
+        }
 
-                    if (reply_msg && arg->writable) {
-                        rc = ipc_write_str(arg, reply_msg);
-                        if (rc < 0) {
-                            MP_ERR(arg, "Write error (%s)\n", mp_strerror(errno));
-                            talloc_free(reply_msg);
-                            goto done;
-                        }
-                    }
+        if (!arg->writable)
+            continue;
 
-                    talloc_free(reply_msg);
-                }
-            }
+        if (mp_json_write_event(&arg->out_buf, event) < 0) {
+            MP_ERR(arg, "Encoding error\n");
+            arg->dead = true;
+            break;
         }
     }
+}
+
+static void process_client(struct client_arg *arg, short revents)
+{
+    if ((revents & (POLLIN | POLLHUP | POLLERR)) && !arg->read_eof &&
+        !arg->busy && !client_throttled(arg))
+        read_input(arg);
+    // On POLLHUP/POLLERR, the write fails and marks the client as dead.
+    if (revents & (POLLOUT | POLLHUP | POLLERR))
+        flush_output(arg);
+
+    finish_commands(arg);
+
+    // Loop because writing out data might unthrottle the client.
+    while (!arg->dead) {
+        process_events(arg);
+        start_commands(arg);
+        flush_output(arg);
+        if (arg->busy || client_throttled(arg) ||
+            (!arg->events_pending && bstrchr(arg->read_buf, '\n') < 0))
+            break;
+    }
+
+    if (arg->read_eof && !arg->busy && bstrchr(arg->read_buf, '\n') < 0)
+        arg->dead = true;
+}
 
-done:
-    if (client_msg.len > 0)
+static void destroy_client(struct client_arg *arg)
+{
+    if (arg->read_buf.len > 0)
         MP_WARN(arg, "Ignoring unterminated command on disconnect.\n");
-    talloc_free(client_msg.start);
     if (arg->close_client_fd)
         close(arg->client_fd);
+    mpv_set_wakeup_callback(arg->client, NULL, NULL);
     mpv_destroy(arg->client);
+    talloc_free(arg->out_buf.start);
+    talloc_free(arg->cmd_out.start);
     talloc_free(arg);
-    return NULL;
 }
 
+// Must be called on the IPC thread, or before it was started.
 static void ipc_start_client(struct mp_ipc_ctx *ctx, struct client_arg *client)
 {
+    client->ctx = ctx;
     client->client = mp_new_client(ctx->client_api, client->client_name);
     if (!client->client)
         goto err;
 
     client->log = mp_client_get_log(client->client);
+    client->arena = json_arena_create(client);
 
-    pthread_t client_thr;
-    if (pthread_create(&client_thr, NULL, client_thread, client))
-        goto err;
+    fcntl(client->client_fd, F_SETFL,
+          fcntl(client->client_fd, F_GETFL, 0) | O_NONBLOCK);
 
+    MP_VERBOSE(client, "Client connected\n");
+
+    MP_TARRAY_APPEND(ctx, ctx->clients, ctx->num_clients, client);
+    mpv_set_wakeup_callback(client->client, wakeup_ipc_client, client);
     return;
 
 err:
@@ -295,23 +458,17 @@ static void ipc_start_client_text(struct mp_ipc_ctx *ctx, const char *path)
     ipc_start_client(ctx, client);
 }
 
-static void *ipc_thread(void *p)
+static int ipc_listen(struct mp_ipc_ctx *arg)
 {
     int rc;
 
     int ipc_fd;
     struct sockaddr_un ipc_un = {0};
 
-    struct mp_ipc_ctx *arg = p;
-
-    mpthread_set_name("ipc socket listener");
-
-    MP_VERBOSE(arg, "Starting IPC master\n");
-
     ipc_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (ipc_fd < 0) {
         MP_ERR(arg, "Could not create IPC socket\n");
-        goto done;
+        goto error;
     }
 
 #if HAVE_FCHMOD
@@ -321,7 +478,7 @@ static void *ipc_thread(void *p)
     size_t path_len = strlen(arg->path);
     if (path_len >= sizeof(ipc_un.sun_path) - 1) {
         MP_ERR(arg, "Could not create IPC socket\n");
-        goto done;
+        goto error;
     }
 
     ipc_un.sun_family = AF_UNIX,
@@ -338,48 +495,163 @@ static void *ipc_thread(void *p)
     rc = bind(ipc_fd, (struct sockaddr *) &ipc_un, addr_len);
     if (rc < 0) {
         MP_ERR(arg, "Could not bind IPC socket\n");
-        goto done;
+        goto error;
     }
 
-    rc = listen(ipc_fd, 10);
+    rc = listen(ipc_fd, 128);
     if (rc < 0) {
         MP_ERR(arg, "Could not listen on IPC socket\n");
-        goto done;
+        goto error;
     }
 
+    fcntl(ipc_fd, F_SETFL, fcntl(ipc_fd, F_GETFL, 0) | O_NONBLOCK);
+
     MP_VERBOSE(arg, "Listening to IPC socket.\n");
 
-    int client_num = 0;
+    return ipc_fd;
 
-    struct pollfd fds[2] = {
-        {.events = POLLIN, .fd = arg->death_pipe[0]},
-        {.events = POLLIN, .fd = ipc_fd},
-    };
+error:
+    if (ipc_fd >= 0)
+        close(ipc_fd);
+    return -1;
+}
+
+static void close_pipes(struct mp_ipc_ctx *arg)
+{
+    for (int n = 0; n < 2; n++) {
+        if (arg->death_pipe[n] >= 0)
+            close(arg->death_pipe[n]);
+        if (arg->wakeup_pipe[n] >= 0)
+            close(arg->wakeup_pipe[n]);
+    }
+}
+
+static void destroy_ctx(struct mp_ipc_ctx *arg)
+{
+    // Waits for the worker threads, which might still access the wakeup pipe.
+    talloc_free(arg->pool);
+    close_pipes(arg);
+    pthread_cond_destroy(&arg->wakeup);
+    pthread_mutex_destroy(&arg->lock);
+    talloc_free(arg);
+}
+
+// A single thread serves all clients (and accepts new connections).
+static void *ipc_thread(void *p)
+{
+    struct mp_ipc_ctx *arg = p;
+
+    mpthread_set_name("ipc");
 
-    while (1) {
-        rc = poll(fds, 2, -1);
+    // We don't use MSG_NOSIGNAL because the moldy fruit OS doesn't support it.
+    struct sigaction sa = { .sa_handler = SIG_IGN, .sa_flags = SA_RESTART };
+    sigfillset(&sa.sa_mask);
+    sigaction(SIGPIPE, &sa, NULL);
+
+    int ipc_fd = -1;
+    if (arg->path && arg->path[0]) {
+        MP_VERBOSE(arg, "Starting IPC master\n");
+        ipc_fd = ipc_listen(arg);
+    }
+
+    struct pollfd *fds = NULL;
+    int num_fds = 0;
+    bool stopping = false;
+
+    while (!stopping || arg->num_clients) {
+        // Fixed entries: death pipe, wakeup pipe, listen socket. (poll()
+        // ignores entries with a negative FD.)
+        MP_TARRAY_GROW(arg, fds, 3 + arg->num_clients);
+        fds[0] = (struct pollfd){.events = POLLIN,
+                                 .fd = stopping ? -1 : arg->death_pipe[0]};
+        fds[1] = (struct pollfd){.events = POLLIN, .fd = arg->wakeup_pipe[0]};
+        fds[2] = (struct pollfd){.events = POLLIN, .fd = ipc_fd};
+        num_fds = 3;
+        for (int n = 0; n < arg->num_clients; n++) {
+            struct client_arg *client = arg->clients[n];
+            short events = 0;
+            if (!client->dead) {
+                if (!client->read_eof && !client->busy &&
+                    !client_throttled(client))
+                    events |= POLLIN;
+                if (client->out_pos < client->out_buf.len)
+                    events |= POLLOUT;
+            }
+            // Always add it, so that the index of the entry is n + 3. If
+            // there's nothing to wait for, disable it, because POLLHUP is
+            // returned even with events==0 (e.g. after EOF was read).
+            fds[num_fds++] = (struct pollfd){.events = events,
+                .fd = events ? client->client_fd : -1};
+        }
+
+        int rc = poll(fds, num_fds, -1);
         if (rc < 0) {
-            MP_ERR(arg, "Poll error\n");
+            if (errno != EINTR)
+                MP_ERR(arg, "Poll error\n");
             continue;
         }
 
-        if (fds[0].revents & POLLIN)
-            goto done;
+        if (fds[0].revents & POLLIN) {
+            // Stop listening. Connected clients are kept until they
+            // disconnect, in which case the context is freed by this thread.
+            stopping = true;
+            if (ipc_fd >= 0)
+                close(ipc_fd);
+            ipc_fd = -1;
+            pthread_mutex_lock(&arg->lock);
+            arg->stopping = true;
+            arg->orphaned = arg->num_clients > 0;
+            if (arg->orphaned)
+                pthread_detach(pthread_self());
+            pthread_cond_broadcast(&arg->wakeup);
+            pthread_mutex_unlock(&arg->lock);
+            continue;
+        }
 
         if (fds[1].revents & POLLIN) {
-            int client_fd = accept(ipc_fd, NULL, NULL);
-            if (client_fd < 0) {
-                MP_ERR(arg, "Could not accept IPC client\n");
-                goto done;
+            mp_flush_wakeup_pipe(arg->wakeup_pipe[0]);
+            // Reset before checking the clients' flags, so that no wakeup
+            // can get lost.
+            atomic_store(&arg->wakeup_pending, false);
+        }
+
+        int num_clients = arg->num_clients;
+        for (int n = 0; n < num_clients; n++)
+            process_client(arg->clients[n], fds[n + 3].revents);
+
+        for (int n = arg->num_clients - 1; n >= 0; n--) {
+            struct client_arg *client = arg->clients[n];
+            // If commands are still running, wait until the worker is done.
+            if (client->dead && !client->busy) {
+                MP_TARRAY_REMOVE_AT(arg->clients, arg->num_clients, n);
+                destroy_client(client);
             }
+        }
+
+        if (fds[2].revents & POLLIN) {
+            // Accept all pending connections at once.
+            while (1) {
+                int client_fd = accept(ipc_fd, NULL, NULL);
+                if (client_fd < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        break;
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+                    MP_ERR(arg, "Could not accept IPC client\n");
+                    close(ipc_fd);
+                    ipc_fd = -1;
+                    break;
+                }
 
-            ipc_start_client_json(arg, client_num++, client_fd);
+                ipc_start_client_json(arg, arg->client_num++, client_fd);
+            }
         }
     }
 
-done:
-    if (ipc_fd >= 0)
-        close(ipc_fd);
+    talloc_free(fds);
+
+    if (arg->orphaned)
+        destroy_ctx(arg);
 
     return NULL;
 }
@@ -395,18 +667,28 @@ struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
         .client_api = client_api,
         .path       = mp_get_user_path(arg, global, opts->ipc_path),
         .death_pipe = {-1, -1},
+        .wakeup_pipe = {-1, -1},
     };
+    pthread_mutex_init(&arg->lock, NULL);
+    pthread_cond_init(&arg->wakeup, NULL);
     char *input_file = mp_get_user_path(arg, global, opts->input_file);
 
     talloc_free(opts);
 
-    if (input_file && *input_file)
-        ipc_start_client_text(arg, input_file);
+    if (mp_make_wakeup_pipe(arg->death_pipe) < 0)
+        goto out;
 
-    if (!arg->path || !arg->path[0])
+    if (mp_make_wakeup_pipe(arg->wakeup_pipe) < 0)
         goto out;
 
-    if (mp_make_wakeup_pipe(arg->death_pipe) < 0)
+    arg->pool = mp_thread_pool_create(arg, 1, 1, MAX_COMMAND_THREADS);
+    if (!arg->pool)
+        goto out;
+
+    if (input_file && *input_file)
+        ipc_start_client_text(arg, input_file);
+
+    if (!arg->num_clients && (!arg->path || !arg->path[0]))
         goto out;
 
     if (pthread_create(&arg->thread, NULL, ipc_thread, arg))
@@ -415,11 +697,9 @@ struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
     return arg;
 
 out:
-    if (arg->death_pipe[0] >= 0) {
-        close(arg->death_pipe[0]);
-        close(arg->death_pipe[1]);
-    }
-    talloc_free(arg);
+    for (int n = 0; n < arg->num_clients; n++)
+        destroy_client(arg->clients[n]);
+    destroy_ctx(arg);
     return NULL;
 }
 
@@ -429,9 +709,19 @@ void mp_uninit_ipc(struct mp_ipc_ctx *arg)
         return;
 
     (void)write(arg->death_pipe[1], &(char){0}, 1);
-    pthread_join(arg->thread, NULL);
 
-    close(arg->death_pipe[0]);
-    close(arg->death_pipe[1]);
-    talloc_free(arg);
+    // If clients are still connected (e.g. --input-ipc-server was changed at
+    // runtime), the IPC thread keeps serving them, and frees the context on
+    // its own. Waiting for it could deadlock, because it might wait for a
+    // command that is blocked on the core.
+    pthread_mutex_lock(&arg->lock);
+    while (!arg->stopping)
+        pthread_cond_wait(&arg->wakeup, &arg->lock);
+    bool orphaned = arg->orphaned;
+    pthread_mutex_unlock(&arg->lock);
+    if (orphaned)
+        return;
+
+    pthread_join(arg->thread, NULL);
+    destroy_ctx(arg);
 }
@@ -26,6 +26,8 @@
 #include "options/path.h"
 #include "player/client.h"
 
+#define APPEND(b, s) bstr_xappend(NULL, (b), bstr0(s))
+
 static mpv_node *mpv_node_array_get(mpv_node *src, int index)
 {
     if (src->format != MPV_FORMAT_NODE_ARRAY)
@@ -37,164 +39,162 @@ static mpv_node *mpv_node_array_get(mpv_node *src, int index)
     return &src->u.list->values[index];
 }
 
-static void mpv_node_array_add(void *ta_parent, mpv_node *src,  mpv_node *val)
-{
-    if (src->format != MPV_FORMAT_NODE_ARRAY)
-        return;
-
-    if (!src->u.list)
-        src->u.list = talloc_zero(ta_parent, mpv_node_list);
-
-    MP_TARRAY_GROW(src->u.list, src->u.list->values, src->u.list->num);
-
-    static const struct m_option type = { .type = CONF_TYPE_NODE };
-    m_option_get_node(&type, ta_parent, &src->u.list->values[src->u.list->num], val);
-
-    src->u.list->num++;
-}
-
-static void mpv_node_array_add_string(void *ta_parent, mpv_node *src, const char *val)
-{
-    mpv_node val_node = {.format = MPV_FORMAT_STRING, .u.string = (char *)val};
-    mpv_node_array_add(ta_parent, src, &val_node);
-}
-
-static void mpv_node_map_add(void *ta_parent, mpv_node *src, const char *key, mpv_node *val)
+static void write_event(struct json_writer *w, mpv_event *event)
 {
-    if (src->format != MPV_FORMAT_NODE_MAP)
-        return;
+    json_writer_key(w, "event");
+    json_writer_string(w, mpv_event_name(event->event_id));
 
-    if (!src->u.list)
-        src->u.list = talloc_zero(ta_parent, mpv_node_list);
-
-    MP_TARRAY_GROW(src->u.list, src->u.list->keys, src->u.list->num);
-    MP_TARRAY_GROW(src->u.list, src->u.list->values, src->u.list->num);
-
-    src->u.list->keys[src->u.list->num] = talloc_strdup(ta_parent, key);
-
-    static const struct m_option type = { .type = CONF_TYPE_NODE };
-    m_option_get_node(&type, ta_parent, &src->u.list->values[src->u.list->num], val);
-
-    src->u.list->num++;
-}
-
-static void mpv_node_map_add_null(void *ta_parent, mpv_node *src, const char *key)
-{
-    mpv_node val_node = {.format = MPV_FORMAT_NONE};
-    mpv_node_map_add(ta_parent, src, key, &val_node);
-}
-
-static void mpv_node_map_add_flag(void *ta_parent, mpv_node *src, const char *key, bool val)
-{
-    mpv_node val_node = {.format = MPV_FORMAT_FLAG, .u.flag = val};
-
-    mpv_node_map_add(ta_parent, src, key, &val_node);
-}
-
-static void mpv_node_map_add_int64(void *ta_parent, mpv_node *src, const char *key, int64_t val)
-{
-    mpv_node val_node = {.format = MPV_FORMAT_INT64, .u.int64 = val};
-    mpv_node_map_add(ta_parent, src, key, &val_node);
-}
-
-static void mpv_node_map_add_double(void *ta_parent, mpv_node *src, const char *key, double val)
-{
-    mpv_node val_node = {.format = MPV_FORMAT_DOUBLE, .u.double_ = val};
-    mpv_node_map_add(ta_parent, src, key, &val_node);
-}
-
-static void mpv_node_map_add_string(void *ta_parent, mpv_node *src, const char *key, const char *val)
-{
-    mpv_node val_node = {.format = MPV_FORMAT_STRING, .u.string = (char*)val};
-    mpv_node_map_add(ta_parent, src, key, &val_node);
-}
-
-static void mpv_event_to_node(void *ta_parent, mpv_event *event, mpv_node *dst)
-{
-    mpv_node_map_add_string(ta_parent, dst, "event", mpv_event_name(event->event_id));
-
-    if (event->reply_userdata)
-        mpv_node_map_add_int64(ta_parent, dst, "id", event->reply_userdata);
+    if (event->reply_userdata) {
+        json_writer_key(w, "id");
+        json_writer_int64(w, event->reply_userdata);
+    }
 
-    if (event->error < 0)
-        mpv_node_map_add_string(ta_parent, dst, "error", mpv_error_string(event->error));
+    if (event->error < 0) {
+        json_writer_key(w, "error");
+        json_writer_string(w, mpv_error_string(event->error));
+    }
 
     switch (event->event_id) {
     case MPV_EVENT_LOG_MESSAGE: {
         mpv_event_log_message *msg = event->data;
 
-        mpv_node_map_add_string(ta_parent, dst, "prefix", msg->prefix);
-        mpv_node_map_add_string(ta_parent, dst, "level",  msg->level);
-        mpv_node_map_add_string(ta_parent, dst, "text",   msg->text);
-
+        json_writer_key(w, "prefix");
+        json_writer_string(w, msg->prefix);
+        json_writer_key(w, "level");
+        json_writer_string(w, msg->level);
+        json_writer_key(w, "text");
+        json_writer_string(w, msg->text);
         break;
     }
 
     case MPV_EVENT_CLIENT_MESSAGE: {
         mpv_event_client_message *msg = event->data;
 
-        mpv_node args_node = {.format = MPV_FORMAT_NODE_ARRAY, .u.list = NULL};
+        json_writer_key(w, "args");
+        json_writer_begin_array(w);
         for (int n = 0; n < msg->num_args; n++)
-            mpv_node_array_add_string(ta_parent, &args_node, msg->args[n]);
-        mpv_node_map_add(ta_parent, dst, "args", &args_node);
+            json_writer_string(w, msg->args[n]);
+        json_writer_end_array(w);
         break;
     }
 
     case MPV_EVENT_PROPERTY_CHANGE: {
         mpv_event_property *prop = event->data;
 
-        mpv_node_map_add_string(ta_parent, dst, "name", prop->name);
+        json_writer_key(w, "name");
+        json_writer_string(w, prop->name);
 
+        json_writer_key(w, "data");
         switch (prop->format) {
         case MPV_FORMAT_NODE:
-            mpv_node_map_add(ta_parent, dst, "data", prop->data);
+            json_writer_node(w, prop->data);
             break;
         case MPV_FORMAT_DOUBLE:
-            mpv_node_map_add_double(ta_parent, dst, "data", *(double *)prop->data);
+            json_writer_double(w, *(double *)prop->data);
             break;
         case MPV_FORMAT_FLAG:
-            mpv_node_map_add_flag(ta_parent, dst, "data", *(int *)prop->data);
+            json_writer_flag(w, *(int *)prop->data);
             break;
         case MPV_FORMAT_STRING:
-            mpv_node_map_add_string(ta_parent, dst, "data", *(char **)prop->data);
+            json_writer_string(w, *(char **)prop->data);
             break;
         default:
-            mpv_node_map_add_null(ta_parent, dst, "data");
+            json_writer_null(w);
         }
         break;
     }
     }
 }
 
-char *mp_json_encode_event(mpv_event *event)
+// Write the reply to an asynchronous request in the same form as the reply
+// json_execute_command() would have sent for a synchronous request.
+static void write_async_reply(struct json_writer *w, mpv_event *event)
+{
+    if (event->event_id == MPV_EVENT_COMMAND_REPLY) {
+        mpv_event_command *cmd = event->data;
+        if (event->error >= 0) {
+            json_writer_key(w, "data");
+            json_writer_node(w, &cmd->result);
+        }
+    } else if (event->event_id == MPV_EVENT_GET_PROPERTY_REPLY) {
+        mpv_event_property *prop = event->data;
+        if (event->error >= 0 && prop->format == MPV_FORMAT_NODE) {
+            json_writer_key(w, "data");
+            json_writer_node(w, prop->data);
+        }
+    }
+
+    json_writer_key(w, "request_id");
+    json_writer_int64(w, (int64_t)event->reply_userdata);
+    json_writer_key(w, "error");
+    json_writer_string(w, mpv_error_string(event->error));
+}
+
+int mp_json_write_event(struct bstr *dst, mpv_event *event)
 {
-    void *ta_parent = talloc_new(NULL);
-    mpv_node event_node = {.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
+    struct json_writer w = {.dst = dst};
+
+    json_writer_begin_object(&w);
+    if ((event->event_id == MPV_EVENT_COMMAND_REPLY ||
+         event->event_id == MPV_EVENT_GET_PROPERTY_REPLY ||
+         event->event_id == MPV_EVENT_SET_PROPERTY_REPLY) &&
+        event->reply_userdata)
+    {
+        write_async_reply(&w, event);
+    } else {
+        write_event(&w, event);
+    }
+    json_writer_end_object(&w);
+    APPEND(dst, "\n");
 
-    mpv_event_to_node(ta_parent, event, &event_node);
+    return 0;
+}
 
-    char *output = talloc_strdup(NULL, "");
-    json_write(&output, &event_node);
-    output = ta_talloc_strdup_append(output, "\n");
+char *mp_json_encode_event(mpv_event *event)
+{
+    bstr output = {0};
+    if (mp_json_write_event(&output, event) < 0) {
+        talloc_free(output.start);
+        return NULL;
+    }
+    return output.start;
+}
 
-    talloc_free(ta_parent);
+// IPC-specific commands which are always run synchronously.
+static const char *const sync_only_cmds[] = {
+    "client_name", "get_time_us", "get_version", "get_properties",
+    "get_property_string", "observe_property", "observe_property_string",
+    "unobserve_property", "request_log_messages", "enable_event",
+    "disable_event", NULL
+};
 
-    return output;
+static bool is_sync_only(const char *cmd)
+{
+    for (int n = 0; sync_only_cmds[n]; n++) {
+        if (!strcmp(cmd, sync_only_cmds[n]))
+            return true;
+    }
+    return false;
 }
 
-// Function is allowed to modify src[n].
-static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
-                                  char *src)
+// Function is allowed to modify src[n]. Appends the reply (if any) to *out.
+static void json_execute_command(struct mpv_handle *client,
+                                 struct json_arena *arena, char *src, bstr *out)
 {
     int rc;
     const char *cmd = NULL;
     struct mp_log *log = mp_client_get_log(client);
 
     mpv_node msg_node;
-    mpv_node reply_node = {.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
     mpv_node *reqid_node = NULL;
 
-    rc = json_parse(ta_parent, &msg_node, &src, 50);
+    // Reply data. Written directly to the output buffer at the end.
+    mpv_node data = {.format = MPV_FORMAT_NONE};
+    bool have_data = false;
+    bool free_data = false; // data was returned by mpv_get_property() etc.
+    struct json_writer w = {.dst = out};
+
+    rc = json_parse_arena(arena, &msg_node, &src, 50);
     if (rc < 0) {
         mp_err(log, "malformed JSON received: '%s'\n", src);
         rc = MPV_ERROR_INVALID_PARAMETER;
@@ -212,6 +212,17 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
                 "deprecated and will trigger an error in the future!\n");
     }
 
+    // Requests with a (non-0) integer request_id can be run asynchronously.
+    // The reply is then sent as soon as the request has finished, possibly
+    // after the replies to requests sent later (see mp_json_write_event()).
+    uint64_t async_id = 0;
+    if (reqid_node && reqid_node->format == MPV_FORMAT_INT64)
+        async_id = reqid_node->u.int64;
+    mpv_node *async_node = node_map_get(&msg_node, "async");
+    if (async_node && async_node->format == MPV_FORMAT_FLAG &&
+        !async_node->u.flag)
+        async_id = 0;
+
     mpv_node *cmd_node = node_map_get(&msg_node, "command");
     if (!cmd_node ||
         (cmd_node->format != MPV_FORMAT_NODE_ARRAY) ||
@@ -229,21 +240,30 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
 
     cmd = cmd_str_node->u.string;
 
+    // A request that is run synchronously must not overtake asynchronous
+    // requests sent earlier on this connection, which might still be queued
+    // on the core, so wait until they have finished.
+    if (is_sync_only(cmd))
+        async_id = 0;
+    if (!async_id)
+        mpv_wait_async_requests(client);
+
     if (!strcmp("client_name", cmd)) {
-        const char *client_name = mpv_client_name(client);
-        mpv_node_map_add_string(ta_parent, &reply_node, "data", client_name);
+        data.format = MPV_FORMAT_STRING;
+        data.u.string = (char *)mpv_client_name(client);
+        have_data = true;
         rc = MPV_ERROR_SUCCESS;
     } else if (!strcmp("get_time_us", cmd)) {
-        int64_t time_us = mpv_get_time_us(client);
-        mpv_node_map_add_int64(ta_parent, &reply_node, "data", time_us);
+        data.format = MPV_FORMAT_INT64;
+        data.u.int64 = mpv_get_time_us(client);
+        have_data = true;
         rc = MPV_ERROR_SUCCESS;
     } else if (!strcmp("get_version", cmd)) {
-        int64_t ver = mpv_client_api_version();
-        mpv_node_map_add_int64(ta_parent, &reply_node, "data", ver);
+        data.format = MPV_FORMAT_INT64;
+        data.u.int64 = mpv_client_api_version();
+        have_data = true;
         rc = MPV_ERROR_SUCCESS;
     } else if (!strcmp("get_property", cmd)) {
-        mpv_node result_node;
-
         if (cmd_node->u.list->num != 2) {
             rc = MPV_ERROR_INVALID_PARAMETER;
             goto error;
@@ -254,12 +274,35 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             goto error;
         }
 
+        if (async_id) {
+            rc = mpv_get_property_async(client, async_id,
+                                        cmd_node->u.list->values[1].u.string,
+                                        MPV_FORMAT_NODE);
+            if (rc >= 0)
+                return;
+            goto error;
+        }
+
         rc = mpv_get_property(client, cmd_node->u.list->values[1].u.string,
-                              MPV_FORMAT_NODE, &result_node);
-        if (rc >= 0) {
-            mpv_node_map_add(ta_parent, &reply_node, "data", &result_node);
-            mpv_free_node_contents(&result_node);
+                              MPV_FORMAT_NODE, &data);
+        have_data = free_data = rc >= 0;
+    } else if (!strcmp("get_properties", cmd)) {
+        int num = cmd_node->u.list->num - 1;
+        const char **names = talloc_array(NULL, const char *, num + 1);
+        for (int n = 0; n < num; n++) {
+            mpv_node *name = &cmd_node->u.list->values[n + 1];
+            if (name->format != MPV_FORMAT_STRING) {
+                talloc_free(names);
+                rc = MPV_ERROR_INVALID_PARAMETER;
+                goto error;
+            }
+            names[n] = name->u.string;
         }
+        names[num] = NULL;
+
+        rc = mpv_get_properties(client, names, &data);
+        have_data = free_data = rc >= 0;
+        talloc_free(names);
     } else if (!strcmp("get_property_string", cmd)) {
         if (cmd_node->u.list->num != 2) {
             rc = MPV_ERROR_INVALID_PARAMETER;
@@ -274,11 +317,11 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
         char *result = mpv_get_property_string(client,
                                         cmd_node->u.list->values[1].u.string);
         if (result) {
-            mpv_node_map_add_string(ta_parent, &reply_node, "data", result);
-            mpv_free(result);
-        } else {
-            mpv_node_map_add_null(ta_parent, &reply_node, "data");
+            data.format = MPV_FORMAT_STRING;
+            data.u.string = result;
+            free_data = true;
         }
+        have_data = true;
     } else if (!strcmp("set_property", cmd) ||
         !strcmp("set_property_string", cmd))
     {
@@ -292,6 +335,16 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             goto error;
         }
 
+        if (async_id) {
+            rc = mpv_set_property_async(client, async_id,
+                                        cmd_node->u.list->values[1].u.string,
+                                        MPV_FORMAT_NODE,
+                                        &cmd_node->u.list->values[2]);
+            if (rc >= 0)
+                return;
+            goto error;
+        }
+
         rc = mpv_set_property(client, cmd_node->u.list->values[1].u.string,
                               MPV_FORMAT_NODE, &cmd_node->u.list->values[2]);
     } else if (!strcmp("observe_property", cmd)) {
@@ -394,62 +447,79 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             rc = mpv_request_event(client, event, enable);
         }
     } else {
-        mpv_node result_node;
+        if (async_id) {
+            rc = mpv_command_node_async(client, async_id, cmd_node);
+            if (rc >= 0)
+                return;
+            goto error;
+        }
 
-        rc = mpv_command_node(client, cmd_node, &result_node);
-        if (rc >= 0)
-            mpv_node_map_add(ta_parent, &reply_node, "data", &result_node);
+        rc = mpv_command_node(client, cmd_node, &data);
+        have_data = free_data = rc >= 0;
     }
 
 error:
+    json_writer_begin_object(&w);
+
+    if (have_data) {
+        json_writer_key(&w, "data");
+        json_writer_node(&w, &data);
+    }
+
     /* If the request contains a "request_id", copy it back into the response.
      * This makes it easier on the requester to match up the IPC results with
      * the original requests.
      */
+    json_writer_key(&w, "request_id");
     if (reqid_node) {
-        mpv_node_map_add(ta_parent, &reply_node, "request_id", reqid_node);
+        json_writer_node(&w, reqid_node);
     } else {
-        mpv_node_map_add_int64(ta_parent, &reply_node, "request_id", 0);
+        json_writer_int64(&w, 0);
     }
 
-    mpv_node_map_add_string(ta_parent, &reply_node, "error", mpv_error_string(rc));
+    json_writer_key(&w, "error");
+    json_writer_string(&w, mpv_error_string(rc));
 
-    char *output = talloc_strdup(ta_parent, "");
-    json_write(&output, &reply_node);
-    output = ta_talloc_strdup_append(output, "\n");
+    json_writer_end_object(&w);
+    APPEND(out, "\n");
 
-    return output;
+    if (free_data)
+        mpv_free_node_contents(&data);
 }
 
-static char *text_execute_command(struct mpv_handle *client, void *tmp, char *src)
+static void text_execute_command(struct mpv_handle *client, char *src)
 {
+    // Synchronous, see json_execute_command().
+    mpv_wait_async_requests(client);
     mpv_command_string(client, src);
+}
+
+void mp_ipc_run_line(struct mpv_handle *client, struct json_arena *arena,
+                     char *line, bstr *out)
+{
+    json_skip_whitespace(&line);
 
-    return NULL;
+    if (line[0] == '\0' || line[0] == '#') {
+        // skip
+    } else if (line[0] == '{') {
+        json_execute_command(client, arena, line, out);
+    } else {
+        text_execute_command(client, line);
+    }
+
+    json_arena_reset(arena);
 }
 
 char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf)
 {
     void *tmp = talloc_new(NULL);
-
     bstr rest;
     bstr line = bstr_getline(*buf, &rest);
-    char *line0 = bstrto0(tmp, line);
-    talloc_steal(tmp, buf->start);
+    bstr reply = {0};
+    mp_ipc_run_line(client, json_arena_create(tmp), bstrto0(tmp, line), &reply);
+    void *old = buf->start;
     *buf = bstrdup(NULL, rest);
-
-    json_skip_whitespace(&line0);
-
-    char *reply_msg = NULL;
-    if (line0[0] == '\0' || line0[0] == '#') {
-        // skip
-    } else if (line0[0] == '{') {
-        reply_msg = json_execute_command(client, tmp, line0);
-    } else {
-        reply_msg = text_execute_command(client, tmp, line0);
-    }
-
-    talloc_steal(ctx, reply_msg);
+    talloc_free(old);
     talloc_free(tmp);
-    return reply_msg;
+    return talloc_steal(ctx, reply.start);
 }
@@ -223,7 +223,7 @@ extern "C" {
  * relational operators (<, >, <=, >=).
  */
 #define MPV_MAKE_VERSION(major, minor) (((major) << 16) | (minor) | 0UL)
-#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 103)
+#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 105)
 
 /**
  * The API user is allowed to "#define MPV_ENABLE_DEPRECATED 0" before
@@ -1149,6 +1149,24 @@ char *mpv_get_property_string(mpv_handle *ctx, const char *name);
  */
 char *mpv_get_property_osd_string(mpv_handle *ctx, const char *name);
 
+/**
+ * Read the values of multiple properties at once. This is the same as calling
+ * mpv_get_property() with MPV_FORMAT_NODE for each name, except that the
+ * player does nothing else while the properties are read. This makes sure
+ * the values are consistent with each other, and is faster than reading them
+ * one by one.
+ *
+ * The result is a MPV_FORMAT_NODE_MAP with an entry for each name, in the
+ * same order. Properties which could not be read (for example because they
+ * don't exist, or are unavailable) have the format MPV_FORMAT_NONE.
+ *
+ * @param names NULL-terminated list of property names.
+ * @param[out] data Set to the node map. Free it with mpv_free_node_contents().
+ *                  It is not touched if the function fails.
+ * @return error code (reading a single property can't make this fail)
+ */
+int mpv_get_properties(mpv_handle *ctx, const char **names, mpv_node *data);
+
 /**
  * Get a property asynchronously. You will receive the result of the operation
  * as well as the property data with the MPV_EVENT_GET_PROPERTY_REPLY event.
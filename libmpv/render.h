@@ -50,6 +50,26 @@ extern "C" {
  * ------------------
  *
  * OpenGL: via MPV_RENDER_API_TYPE_OPENGL, see render_gl.h header.
+ * Software: via MPV_RENDER_API_TYPE_SW, see section "Software renderer"
+ *
+ * Software renderer
+ * -----------------
+ *
+ * MPV_RENDER_API_TYPE_SW renders into a memory buffer provided by the API
+ * user, using the CPU only (libswscale for conversion, and the software OSD
+ * renderer for OSD and subtitles). It requires no GPU or windowing system,
+ * and is mainly intended for compositors and headless setups. It does not
+ * support hardware decoding.
+ *
+ * Each mpv_render_context_render() call must pass all of
+ * MPV_RENDER_PARAM_SW_SIZE, MPV_RENDER_PARAM_SW_FORMAT,
+ * MPV_RENDER_PARAM_SW_STRIDE and MPV_RENDER_PARAM_SW_POINTER. The buffer is
+ * completely overwritten (including borders around the video). Changing the
+ * size or format between calls is allowed, but slower, as the conversion
+ * needs to be reinitialized.
+ *
+ * Conversion can be split across multiple threads with the "sws-threads"
+ * option.
  *
  * Threading
  * ---------
@@ -141,6 +161,9 @@ typedef enum mpv_render_param_type {
      *      It is expected that an OpenGL context is valid and "current" when
      *      calling mpv_render_* functions (unless specified otherwise). It
      *      must be the same context for the same mpv_render_context.
+     *   MPV_RENDER_API_TYPE_SW:
+     *      Rendering with the CPU into memory. See "Software renderer"
+     *      section.
      */
     MPV_RENDER_PARAM_API_TYPE = 1,
     /**
@@ -288,6 +311,55 @@ typedef enum mpv_render_param_type {
      * Type : struct mpv_opengl_drm_draw_surface_size*
      */
     MPV_RENDER_PARAM_DRM_DRAW_SURFACE_SIZE = 15,
+    /**
+     * MPV_RENDER_API_TYPE_SW only: rendering target surface size, mandatory.
+     * Valid for MPV_RENDER_API_TYPE_SW & mpv_render_context_render().
+     * Type: int[2] (e.g.: int s[2] = {w, h}; param.data = &s[0];)
+     *
+     * The video frame is transformed as with other VOs. Typically, this means
+     * the video gets scaled and letter-boxed to fit the target surface.
+     */
+    MPV_RENDER_PARAM_SW_SIZE = 16,
+    /**
+     * MPV_RENDER_API_TYPE_SW only: rendering target surface pixel format,
+     * mandatory.
+     * Valid for MPV_RENDER_API_TYPE_SW & mpv_render_context_render().
+     * Type: char* (e.g.: char *f = "rgb0"; param.data = f;)
+     *
+     * Valid values are any mpv format names with a single plane and a whole
+     * number of bytes per pixel, such as:
+     *  "rgb0", "bgr0", "0bgr", "0rgb": 4 bytes per pixel, with an ignored
+     *      padding byte at the position of the "0"
+     *  "rgba", "bgra", "abgr", "argb": 4 bytes per pixel, with alpha
+     *  "rgb24", "bgr24": 3 bytes per pixel
+     *  "yuyv422", "uyvy422": packed 4:2:2 YUV
+     * The exact set depends on libswscale. mpv_render_context_render() returns
+     * MPV_ERROR_UNSUPPORTED for unsupported formats.
+     */
+    MPV_RENDER_PARAM_SW_FORMAT = 17,
+    /**
+     * MPV_RENDER_API_TYPE_SW only: rendering target surface bytes per line,
+     * mandatory.
+     * Valid for MPV_RENDER_API_TYPE_SW & mpv_render_context_render().
+     * Type: size_t*
+     *
+     * This is the number of bytes between a pixel (x, y) and (x, y + 1) on the
+     * target surface. It must be at least as large as the number of bytes used
+     * by a line of pixels. Performance is better if it's a multiple of 16.
+     */
+    MPV_RENDER_PARAM_SW_STRIDE = 18,
+    /**
+     * MPV_RENDER_API_TYPE_SW only: rendering target surface pixel data pointer,
+     * mandatory.
+     * Valid for MPV_RENDER_API_TYPE_SW & mpv_render_context_render().
+     * Type: void*
+     *
+     * This points to the first pixel at the left/top corner (0, 0). The
+     * memory must have at least size*stride bytes (where size is the height
+     * set with MPV_RENDER_PARAM_SW_SIZE). Performance is better if the
+     * pointer is 16 byte aligned.
+     */
+    MPV_RENDER_PARAM_SW_POINTER = 19,
 } mpv_render_param_type;
 
 /**
@@ -331,6 +403,10 @@ typedef struct mpv_render_param {
  * Predefined values for MPV_RENDER_PARAM_API_TYPE.
  */
 #define MPV_RENDER_API_TYPE_OPENGL "opengl"
+/**
+ * See section "Software renderer" above.
+ */
+#define MPV_RENDER_API_TYPE_SW "sw"
 
 /**
  * Flags used in mpv_render_frame_info.flags. Each value represents a bit in it.
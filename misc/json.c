@@ -29,12 +29,19 @@
  *    and contain only characters in [A-Za-z0-9_]
  *  - byte escapes with "\xAB" are allowed (with AB being a 2 digit hex number)
  *
+ * json_parse_arena() is the same parser, but allocates from a reusable arena,
+ * which avoids allocation churn when parsing many small messages (IPC).
+ *
  * Also see: http://tools.ietf.org/html/rfc8259
  *
  * JSON writer:
  *
  * Doesn't insert whitespace. It's literally a waste of space.
  *
+ * json_write() serializes a mpv_node tree. The json_writer_*() functions write
+ * values directly to a buffer instead, for callers which would otherwise have
+ * to build a temporary tree.
+ *
  * Can output invalid UTF-8, if input is invalid UTF-8. Consumers are supposed
  * to deal with somehow: either by using byte-strings for JSON, or by running
  * a "fixup" pass on the input data. The latter could for example change
@@ -78,7 +85,81 @@ void json_skip_whitespace(char **src)
     eat_ws(src);
 }
 
-static int read_id(void *ta_parent, struct mpv_node *dst, char **src)
+// Size limits for json_arena. The arena is grown to fit the largest message
+// seen so far, but not beyond ARENA_MAX_SIZE (larger messages fall back to
+// normal talloc allocations).
+#define ARENA_MIN_SIZE (4 * 1024)
+#define ARENA_MAX_SIZE (256 * 1024)
+
+struct stack_entry {
+    char *key;
+    struct mpv_node value;
+};
+
+struct json_arena {
+    char *mem;
+    size_t size, used;
+    size_t overflow;            // bytes allocated from tmp since last reset
+    void *tmp;                  // fallback allocations, freed on reset
+    // Temporary storage for array/object items, until the number of items is
+    // known and they can be copied to a single allocation.
+    struct stack_entry *stack;
+    int num_stack;
+};
+
+struct parser {
+    struct json_arena *arena;   // if NULL, use talloc
+};
+
+struct json_arena *json_arena_create(void *ta_parent)
+{
+    struct json_arena *a = talloc_zero(ta_parent, struct json_arena);
+    a->size = ARENA_MIN_SIZE;
+    a->mem = talloc_size(a, a->size);
+    a->tmp = talloc_new(a);
+    return a;
+}
+
+void json_arena_reset(struct json_arena *a)
+{
+    if (a->overflow && a->size < ARENA_MAX_SIZE) {
+        a->size = MPMIN(a->used + a->overflow, ARENA_MAX_SIZE);
+        talloc_free(a->mem);
+        a->mem = talloc_size(a, a->size);
+    }
+    a->used = 0;
+    a->overflow = 0;
+    a->num_stack = 0;
+    talloc_free_children(a->tmp);
+}
+
+static void *arena_alloc(struct json_arena *a, size_t size)
+{
+    size = MP_ALIGN_UP(size, 16);
+    if (size > a->size - a->used) {
+        a->overflow += size;
+        return talloc_size(a->tmp, size);
+    }
+    void *res = a->mem + a->used;
+    a->used += size;
+    return res;
+}
+
+static char *p_strndup(struct parser *p, void *ta_parent, char *s, size_t len)
+{
+    if (!p->arena)
+        return talloc_strndup(ta_parent, s, len);
+    char *res = arena_alloc(p->arena, len + 1);
+    memcpy(res, s, len);
+    res[len] = '\0';
+    return res;
+}
+
+static int parse_value(struct parser *p, void *ta_parent, struct mpv_node *dst,
+                       char **src, int max_depth);
+
+static int read_id(struct parser *p, void *ta_parent, struct mpv_node *dst,
+                   char **src)
 {
     char *start = *src;
     if (!mp_isalpha(**src) && **src != '_')
@@ -89,14 +170,15 @@ static int read_id(void *ta_parent, struct mpv_node *dst, char **src)
         **src = '\0'; // we're allowed to mutate it => can avoid the strndup
         *src += 1;
     } else {
-        start = talloc_strndup(ta_parent, start, *src - start);
+        start = p_strndup(p, ta_parent, start, *src - start);
     }
     dst->format = MPV_FORMAT_STRING;
     dst->u.string = start;
     return 0;
 }
 
-static int read_str(void *ta_parent, struct mpv_node *dst, char **src)
+static int read_str(struct parser *p, void *ta_parent, struct mpv_node *dst,
+                    char **src)
 {
     if (!eat_c(src, '"'))
         return -1; // not a string
@@ -121,7 +203,8 @@ static int read_str(void *ta_parent, struct mpv_node *dst, char **src)
     if (has_escapes) {
         bstr unescaped = {0};
         bstr r = bstr0(str);
-        if (!mp_append_escaped_string(ta_parent, &unescaped, &r))
+        void *parent = p->arena ? p->arena->tmp : ta_parent;
+        if (!mp_append_escaped_string(parent, &unescaped, &r))
             return -1; // broken escapes
         str = unescaped.start; // the function guarantees null-termination
     }
@@ -130,15 +213,23 @@ static int read_str(void *ta_parent, struct mpv_node *dst, char **src)
     return 0;
 }
 
-static int read_sub(void *ta_parent, struct mpv_node *dst, char **src,
-                    int max_depth)
+static int read_sub(struct parser *p, void *ta_parent, struct mpv_node *dst,
+                    char **src, int max_depth)
 {
     bool is_arr = eat_c(src, '[');
     bool is_obj = !is_arr && eat_c(src, '{');
     if (!is_arr && !is_obj)
         return -1; // not an array or object
     char term = is_obj ? '}' : ']';
-    struct mpv_node_list *list = talloc_zero(ta_parent, struct mpv_node_list);
+    struct json_arena *a = p->arena;
+    struct mpv_node_list *list;
+    if (a) {
+        list = arena_alloc(a, sizeof(*list));
+        *list = (struct mpv_node_list){0};
+    } else {
+        list = talloc_zero(ta_parent, struct mpv_node_list);
+    }
+    int stack_base = a ? a->num_stack : 0;
     while (1) {
         eat_ws(src);
         if (eat_c(src, term))
@@ -149,42 +240,54 @@ static int read_sub(void *ta_parent, struct mpv_node *dst, char **src,
         // non-standard extension: allow a trailing ","
         if (eat_c(src, term))
             break;
+        struct stack_entry item = {0};
         if (is_obj) {
             struct mpv_node keynode;
             // non-standard extension: allow unquoted strings as keys
-            if (read_id(list, &keynode, src) < 0 &&
-                read_str(list, &keynode, src) < 0)
+            if (read_id(p, list, &keynode, src) < 0 &&
+                read_str(p, list, &keynode, src) < 0)
                 return -1; // key is not a string
             eat_ws(src);
             // non-standard extension: allow "=" instead of ":"
             if (!eat_c(src, ':') && !eat_c(src, '='))
                 return -1; // ':' missing
             eat_ws(src);
-            MP_TARRAY_GROW(list, list->keys, list->num);
-            list->keys[list->num] = keynode.u.string;
+            item.key = keynode.u.string;
         }
-        MP_TARRAY_GROW(list, list->values, list->num);
-        if (json_parse(ta_parent, &list->values[list->num], src, max_depth) < 0)
+        if (parse_value(p, ta_parent, &item.value, src, max_depth) < 0)
             return -1;
+        if (a) {
+            MP_TARRAY_APPEND(a, a->stack, a->num_stack, item);
+        } else {
+            if (is_obj) {
+                MP_TARRAY_GROW(list, list->keys, list->num);
+                list->keys[list->num] = item.key;
+            }
+            MP_TARRAY_GROW(list, list->values, list->num);
+            list->values[list->num] = item.value;
+        }
         list->num++;
     }
+    if (a && list->num) {
+        // Now the number of items is known; copy them out of the stack.
+        struct stack_entry *items = &a->stack[stack_base];
+        list->values = arena_alloc(a, list->num * sizeof(list->values[0]));
+        if (is_obj)
+            list->keys = arena_alloc(a, list->num * sizeof(list->keys[0]));
+        for (int n = 0; n < list->num; n++) {
+            list->values[n] = items[n].value;
+            if (is_obj)
+                list->keys[n] = items[n].key;
+        }
+        a->num_stack = stack_base;
+    }
     dst->format = is_obj ? MPV_FORMAT_NODE_MAP : MPV_FORMAT_NODE_ARRAY;
     dst->u.list = list;
     return 0;
 }
 
-/* Parse the string in *src as JSON, and write the result into *dst.
- * max_depth limits the recursion and JSON tree depth.
- * Warning: this overwrites the input string (what *src points to)!
- * Returns:
- *   0: success, *dst is valid, *src points to the end (the caller must check
- *      whether *src really terminates)
- *  -1: failure, *dst is invalid, there may be dead allocs under ta_parent
- *      (ta_free_children(ta_parent) is the only way to free them)
- * The input string can be mutated in both cases. *dst might contain string
- * elements, which point into the (mutated) input string.
- */
-int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
+static int parse_value(struct parser *p, void *ta_parent, struct mpv_node *dst,
+                       char **src, int max_depth)
 {
     max_depth -= 1;
     if (max_depth < 0)
@@ -210,9 +313,9 @@ int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
         dst->u.flag = 0;
         return 0;
     } else if (c == '"') {
-        return read_str(ta_parent, dst, src);
+        return read_str(p, ta_parent, dst, src);
     } else if (c == '[' || c == '{') {
-        return read_sub(ta_parent, dst, src, max_depth);
+        return read_sub(p, ta_parent, dst, src, max_depth);
     } else if (c == '-' || (c >= '0' && c <= '9')) {
         // The number could be either a float or an int. JSON doesn't make a
         // difference, but the client API does.
@@ -242,6 +345,36 @@ int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
     return -1; // character doesn't start a valid token
 }
 
+/* Parse the string in *src as JSON, and write the result into *dst.
+ * max_depth limits the recursion and JSON tree depth.
+ * Warning: this overwrites the input string (what *src points to)!
+ * Returns:
+ *   0: success, *dst is valid, *src points to the end (the caller must check
+ *      whether *src really terminates)
+ *  -1: failure, *dst is invalid, there may be dead allocs under ta_parent
+ *      (ta_free_children(ta_parent) is the only way to free them)
+ * The input string can be mutated in both cases. *dst might contain string
+ * elements, which point into the (mutated) input string.
+ */
+int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
+{
+    struct parser p = {0};
+    return parse_value(&p, ta_parent, dst, src, max_depth);
+}
+
+/* Like json_parse(), but allocate all memory from the arena. *dst is valid
+ * only until the next json_arena_reset() call, which should be called after
+ * each message. Once the arena has grown to the size of typical messages,
+ * parsing performs no memory allocations.
+ */
+int json_parse_arena(struct json_arena *arena, struct mpv_node *dst,
+                     char **src, int max_depth)
+{
+    struct parser p = {.arena = arena};
+    arena->num_stack = 0;
+    return parse_value(&p, NULL, dst, src, max_depth);
+}
+
 
 #define APPEND(b, s) bstr_xappend(NULL, (b), bstr0(s))
 
@@ -352,3 +485,85 @@ int json_write_pretty(char **dst, struct mpv_node *src)
 {
     return json_append_str(dst, src, 0);
 }
+
+// Streaming writer. Each function writes one JSON token to w->dst, and
+// inserts the "," separators as needed.
+
+static void writer_sep(struct json_writer *w)
+{
+    if (w->comma)
+        APPEND(w->dst, ",");
+    w->comma = true;
+}
+
+void json_writer_begin_object(struct json_writer *w)
+{
+    writer_sep(w);
+    APPEND(w->dst, "{");
+    w->comma = false;
+}
+
+void json_writer_end_object(struct json_writer *w)
+{
+    APPEND(w->dst, "}");
+    w->comma = true;
+}
+
+void json_writer_begin_array(struct json_writer *w)
+{
+    writer_sep(w);
+    APPEND(w->dst, "[");
+    w->comma = false;
+}
+
+void json_writer_end_array(struct json_writer *w)
+{
+    APPEND(w->dst, "]");
+    w->comma = true;
+}
+
+// Write an object key. Must be followed by exactly one value.
+void json_writer_key(struct json_writer *w, const char *key)
+{
+    writer_sep(w);
+    write_json_str(w->dst, (unsigned char *)key);
+    APPEND(w->dst, ":");
+    w->comma = false;
+}
+
+void json_writer_null(struct json_writer *w)
+{
+    writer_sep(w);
+    APPEND(w->dst, "null");
+}
+
+void json_writer_flag(struct json_writer *w, bool val)
+{
+    writer_sep(w);
+    APPEND(w->dst, val ? "true" : "false");
+}
+
+void json_writer_int64(struct json_writer *w, int64_t val)
+{
+    writer_sep(w);
+    bstr_xappend_asprintf(NULL, w->dst, "%"PRId64, val);
+}
+
+void json_writer_double(struct json_writer *w, double val)
+{
+    writer_sep(w);
+    bstr_xappend_asprintf(NULL, w->dst, "%f", val);
+}
+
+void json_writer_string(struct json_writer *w, const char *val)
+{
+    writer_sep(w);
+    write_json_str(w->dst, (unsigned char *)val);
+}
+
+// Write the node tree (without copying it, unlike building a mpv_node tree).
+int json_writer_node(struct json_writer *w, const struct mpv_node *src)
+{
+    writer_sep(w);
+    return json_append(w->dst, src, -1);
+}
@@ -21,9 +21,39 @@
 // We reuse mpv_node.
 #include "libmpv/client.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+
+struct bstr;
+struct json_arena;
+
 int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth);
 void json_skip_whitespace(char **src);
 int json_write(char **s, struct mpv_node *src);
 int json_write_pretty(char **s, struct mpv_node *src);
 
+// Reusable memory for parsing many messages with json_parse_arena().
+struct json_arena *json_arena_create(void *ta_parent);
+void json_arena_reset(struct json_arena *arena);
+int json_parse_arena(struct json_arena *arena, struct mpv_node *dst,
+                     char **src, int max_depth);
+
+// Write JSON directly to a buffer, without building a mpv_node tree first.
+struct json_writer {
+    struct bstr *dst;   // output is appended with bstr_xappend()
+    bool comma;         // internal: "," needed before the next item
+};
+
+void json_writer_begin_object(struct json_writer *w);
+void json_writer_end_object(struct json_writer *w);
+void json_writer_begin_array(struct json_writer *w);
+void json_writer_end_array(struct json_writer *w);
+void json_writer_key(struct json_writer *w, const char *key);
+void json_writer_null(struct json_writer *w);
+void json_writer_flag(struct json_writer *w, bool val);
+void json_writer_int64(struct json_writer *w, int64_t val);
+void json_writer_double(struct json_writer *w, double val);
+void json_writer_string(struct json_writer *w, const char *val);
+int json_writer_node(struct json_writer *w, const struct mpv_node *src);
+
 #endif
@@ -59,6 +59,8 @@ struct m_config_shadow {
     pthread_mutex_t lock;
     // -- protected by lock
     struct m_config_data *data; // protected shadow copy of the option data
+    long long *opt_ts;          // per m_config.opts[] entry: data->ts value
+                                // of the last change (0 if never changed)
     struct m_config_cache **listeners;
     int num_listeners;
 };
@@ -302,6 +304,37 @@ static void config_destroy(void *p)
     talloc_free(config->data);
 }
 
+// FNV-1a
+static uint32_t opt_name_hash(struct bstr name)
+{
+    uint32_t h = 2166136261u;
+    for (size_t n = 0; n < name.len; n++)
+        h = (h ^ name.start[n]) * 16777619u;
+    return h;
+}
+
+// Options can't be added after m_config_new(), so the index is built once.
+static void build_opt_index(struct m_config *config)
+{
+    unsigned size = 16;
+    while (size < config->num_opts * 2)
+        size *= 2;
+
+    config->opt_index = talloc_array(config, int, size);
+    config->opt_index_mask = size - 1;
+    for (unsigned n = 0; n < size; n++)
+        config->opt_index[n] = -1;
+
+    // In case of duplicate names, the first option wins (like with a linear
+    // search), because it's inserted first and found first.
+    for (int n = 0; n < config->num_opts; n++) {
+        unsigned i = opt_name_hash(bstr0(config->opts[n].name));
+        while (config->opt_index[i & config->opt_index_mask] >= 0)
+            i++;
+        config->opt_index[i & config->opt_index_mask] = n;
+    }
+}
+
 struct m_config *m_config_new(void *talloc_ctx, struct mp_log *log,
                               size_t size, const void *defaults,
                               const struct m_option *options)
@@ -317,6 +350,7 @@ struct m_config *m_config_new(void *talloc_ctx, struct mp_log *log,
         .defaults = defaults,
     };
     add_sub_group(config, NULL, -1, -1, subopts);
+    build_opt_index(config);
 
     if (!size)
         return config;
@@ -586,14 +620,15 @@ struct m_config_option *m_config_get_co_raw(const struct m_config *config,
     if (!name.len)
         return NULL;
 
-    for (int n = 0; n < config->num_opts; n++) {
-        struct m_config_option *co = &config->opts[n];
-        struct bstr coname = bstr0(co->name);
-        if (bstrcmp(coname, name) == 0)
+    unsigned i = opt_name_hash(name);
+    for (;; i++) {
+        int index = config->opt_index[i & config->opt_index_mask];
+        if (index < 0)
+            return NULL;
+        struct m_config_option *co = &config->opts[index];
+        if (bstr_equals0(name, co->name))
             return co;
     }
-
-    return NULL;
 }
 
 // Like m_config_get_co_raw(), but resolve aliases.
@@ -1248,6 +1283,8 @@ void m_config_create_shadow(struct m_config *config)
     config->shadow->data =
         allocate_option_data(config->shadow, config, 0, config->data);
     config->shadow->root = config;
+    config->shadow->opt_ts =
+        talloc_zero_array(config->shadow, long long, config->num_opts);
     pthread_mutex_init(&config->shadow->lock, NULL);
 
     config->global->config = config->shadow;
@@ -1294,7 +1331,12 @@ struct m_config_cache *m_config_cache_alloc(void *ta_parent,
     return cache;
 }
 
-static bool update_options(struct m_config_data *dst, struct m_config_data *src)
+// Copy the options that changed in src since dst was last updated. opt_ts is
+// the per-option change timestamp array for src (see m_config_shadow).
+// Each copied option is appended to cache->changed.
+static bool update_options(struct m_config_cache *cache,
+                           struct m_config_data *dst, struct m_config_data *src,
+                           long long *opt_ts)
 {
     assert(dst->root == src->root);
 
@@ -1314,14 +1356,20 @@ static bool update_options(struct m_config_data *dst, struct m_config_data *src)
 
         if (gdst->ts >= gsrc->ts)
             continue;
+        long long last_ts = gdst->ts;
         gdst->ts = gsrc->ts;
         res = true;
 
+        // Copy only options changed since the last update, which avoids
+        // reallocating all strings and lists in the group.
         for (int i = g->co_index; i < g->co_end_index; i++) {
             struct m_config_option *co = &dst->root->opts[i];
-            if (co->opt->offset >= 0 && co->opt->type->size) {
+            if (opt_ts[i] > last_ts && co->opt->offset >= 0 &&
+                co->opt->type->size)
+            {
                 m_option_copy(co->opt, gdst->udata + co->opt->offset,
                                        gsrc->udata + co->opt->offset);
+                MP_TARRAY_APPEND(cache, cache->changed, cache->num_changed, i);
             }
         }
     }
@@ -1333,6 +1381,9 @@ bool m_config_cache_update(struct m_config_cache *cache)
 {
     struct m_config_shadow *shadow = cache->shadow;
 
+    cache->num_changed = 0;
+    cache->next_changed = 0;
+
     // Using atomics and checking outside of the lock - it's unknown whether
     // this makes it faster or slower. Just cargo culting it.
     if (atomic_load_explicit(&cache->data->ts, memory_order_relaxed) >=
@@ -1340,11 +1391,26 @@ bool m_config_cache_update(struct m_config_cache *cache)
         return false;
 
     pthread_mutex_lock(&shadow->lock);
-    bool res = update_options(cache->data, shadow->data);
+    bool res = update_options(cache, cache->data, shadow->data, shadow->opt_ts);
     pthread_mutex_unlock(&shadow->lock);
     return res;
 }
 
+bool m_config_cache_get_next_changed(struct m_config_cache *cache, void **opt)
+{
+    if (cache->next_changed >= cache->num_changed) {
+        *opt = NULL;
+        return false;
+    }
+
+    struct m_config_option *co =
+        &cache->data->root->opts[cache->changed[cache->next_changed++]];
+    struct m_group_data *gdata = m_config_gdata(cache->data, co->group_index);
+    assert(gdata);
+    *opt = gdata->udata + co->opt->offset;
+    return true;
+}
+
 void m_config_notify_change_co(struct m_config *config,
                                struct m_config_option *co)
 {
@@ -1359,6 +1425,7 @@ void m_config_notify_change_co(struct m_config *config,
         assert(gdata);
 
         gdata->ts = atomic_fetch_add(&data->ts, 1) + 1;
+        shadow->opt_ts[co - config->opts] = gdata->ts;
 
         m_option_copy(co->opt, gdata->udata + co->opt->offset, co->data);
 
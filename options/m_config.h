@@ -97,6 +97,11 @@ typedef struct m_config {
     // Private. Non-NULL if data was allocated. m_config_option.data uses it.
     struct m_config_data *data;
 
+    // Private. Hash table of indexes into opts (-1 for free slots), using
+    // open addressing. Immutable after init.
+    int *opt_index;
+    unsigned opt_index_mask;
+
     // Private. Thread-safe shadow memory; only set for the main m_config.
     struct m_config_shadow *shadow;
 } m_config_t;
@@ -269,6 +274,9 @@ struct m_config_cache {
     struct m_config_shadow *shadow; // real data
     struct m_config_data *data;     // copy for the cache user
     bool in_list;                   // registered as listener with root config
+    int *changed;                   // m_config.opts[] indexes changed by the
+    int num_changed;                // last m_config_cache_update() call
+    int next_changed;               // for m_config_cache_get_next_changed()
     // --- Implicitly synchronized by setting/unsetting wakeup_cb.
     struct mp_dispatch_queue *wakeup_dispatch_queue;
     void (*wakeup_dispatch_cb)(void *ctx);
@@ -316,6 +324,13 @@ void m_config_cache_set_dispatch_change_cb(struct m_config_cache *cache,
 // data itself will (e.g. string options might be reallocated).
 bool m_config_cache_update(struct m_config_cache *cache);
 
+// Iterate the options changed by the last m_config_cache_update() call. Each
+// call sets *opt to the next changed option's field in cache->opts (or one of
+// its sub-structs), and returns true. Returns false and sets *opt to NULL if
+// there are no more changed options. Options which were written, but kept the
+// same value, are considered changed too.
+bool m_config_cache_get_next_changed(struct m_config_cache *cache, void **opt);
+
 // Like m_config_cache_alloc(), but return the struct (m_config_cache->opts)
 // directly, with no way to update the config. Basically this returns a copy
 // with a snapshot of the current option values.
@@ -65,6 +65,7 @@ extern const struct m_sub_options demux_rawaudio_conf;
 extern const struct m_sub_options demux_rawvideo_conf;
 extern const struct m_sub_options demux_lavf_conf;
 extern const struct m_sub_options demux_mkv_conf;
+extern const struct m_sub_options demux_timeline_conf;
 extern const struct m_sub_options vd_lavc_conf;
 extern const struct m_sub_options ad_lavc_conf;
 extern const struct m_sub_options input_config;
@@ -382,6 +383,7 @@ const m_option_t mp_opts[] = {
     OPT_STRING("ytdl-format", lua_ytdl_format, 0),
     OPT_KEYVALUELIST("ytdl-raw-options", lua_ytdl_raw_options, 0),
     OPT_FLAG("load-stats-overlay", lua_load_stats, UPDATE_BUILTIN_SCRIPTS),
+    OPT_INTRANGE("script-threads", script_threads, 0, 0, 64),
 #endif
 
 // ------------------------- stream options --------------------
@@ -521,6 +523,7 @@ const m_option_t mp_opts[] = {
     OPT_SUBSTRUCT("demuxer-rawaudio", demux_rawaudio, demux_rawaudio_conf, 0),
     OPT_SUBSTRUCT("demuxer-rawvideo", demux_rawvideo, demux_rawvideo_conf, 0),
     OPT_SUBSTRUCT("demuxer-mkv", demux_mkv, demux_mkv_conf, 0),
+    OPT_SUBSTRUCT("demuxer-timeline", demux_timeline, demux_timeline_conf, 0),
 
 // ------------------------- subtitles options --------------------
 
@@ -602,6 +605,7 @@ const m_option_t mp_opts[] = {
     OPT_FLAG("video-latency-hacks", video_latency_hacks, 0),
 
     OPT_FLAG("untimed", untimed, 0),
+    OPT_STRING("benchmark-report", benchmark_report, M_OPT_FILE),
 
     OPT_STRING("stream-dump", stream_dump, M_OPT_FILE),
 
@@ -633,6 +637,7 @@ const m_option_t mp_opts[] = {
 
     OPT_FLAG("load-unsafe-playlists", load_unsafe_playlists, 0),
     OPT_FLAG("merge-files", merge_files, 0),
+    OPT_FLAG("playlist-incremental", playlist_incremental, 0),
 
     // a-v sync stuff:
     OPT_FLAG("correct-pts", correct_pts, 0),
@@ -656,6 +661,7 @@ const m_option_t mp_opts[] = {
                ({"no", -1}, {"absolute", 0}, {"yes", 1}, {"always", 1})),
     OPT_FLOAT("hr-seek-demuxer-offset", hr_seek_demuxer_offset, 0),
     OPT_FLAG("hr-seek-framedrop", hr_seek_framedrop, 0),
+    OPT_BYTE_SIZE("hr-seek-cache", hr_seek_cache, 0, 0, INT64_MAX),
     OPT_CHOICE_OR_INT("autosync", autosync, 0, 0, 10000,
                       ({"no", -1})),
 
@@ -131,6 +131,7 @@ typedef struct MPOpts {
     char *lua_ytdl_format;
     char **lua_ytdl_raw_options;
     int lua_load_stats;
+    int script_threads;
 
     int auto_load_scripts;
 
@@ -176,6 +177,7 @@ typedef struct MPOpts {
     int video_osd;
 
     int untimed;
+    char *benchmark_report;
     char *stream_dump;
     char *record_file;
     int stop_playback_on_init_failure;
@@ -189,6 +191,7 @@ typedef struct MPOpts {
     char *chapter_file;
     int load_unsafe_playlists;
     int merge_files;
+    int playlist_incremental;
     int quiet;
     int load_config;
     char *force_configdir;
@@ -205,6 +208,7 @@ typedef struct MPOpts {
     int hr_seek;
     float hr_seek_demuxer_offset;
     int hr_seek_framedrop;
+    int64_t hr_seek_cache;
     float audio_delay;
     float default_max_pts_correction;
     int autosync;
@@ -300,6 +304,7 @@ typedef struct MPOpts {
     struct demux_rawvideo_opts *demux_rawvideo;
     struct demux_lavf_opts *demux_lavf;
     struct demux_mkv_opts *demux_mkv;
+    struct demux_timeline_opts *demux_timeline;
 
     struct demux_opts *demux_opts;
 
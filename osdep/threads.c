@@ -18,9 +18,13 @@
 #include <stdio.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
 
 #include "config.h"
 
+#include "atomic.h"
 #include "threads.h"
 #include "timer.h"
 
@@ -34,8 +38,146 @@ int mpthread_mutex_init_recursive(pthread_mutex_t *mutex)
     return r;
 }
 
+static atomic_bool cpu_enabled;
+
+void mpthread_enable_cpu_accounting(void)
+{
+    atomic_store(&cpu_enabled, true);
+}
+
+#if HAVE_PTHREAD_CPU_CLOCK
+
+#define MAX_NAMES 64
+#define MAX_LIVE_THREADS 256
+
+// CPU time accounting. Time of exited threads is added to the name entry on
+// exit (from a TLS destructor, while the thread still exists), so no clock of
+// an exited thread is ever queried.
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cpu_key;
+static pthread_mutex_t cpu_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mpthread_cpu_time cpu_names[MAX_NAMES];
+static int cpu_num_names;
+static struct live_thread {
+    pthread_t thread;
+    clockid_t clock;
+    int name;           // index into cpu_names
+    int64_t base_ns;    // CPU time accounted to a previous name
+} cpu_live[MAX_LIVE_THREADS];
+static int cpu_num_live;
+
+static int64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts))
+        return 0;
+    return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+static struct live_thread *find_live(pthread_t thread)
+{
+    for (int n = 0; n < cpu_num_live; n++) {
+        if (pthread_equal(cpu_live[n].thread, thread))
+            return &cpu_live[n];
+    }
+    return NULL;
+}
+
+static void thread_exit(void *arg)
+{
+    pthread_mutex_lock(&cpu_lock);
+    struct live_thread *t = find_live(pthread_self());
+    if (t) {
+        cpu_names[t->name].cpu_ns +=
+            clock_ns(CLOCK_THREAD_CPUTIME_ID) - t->base_ns;
+        *t = cpu_live[--cpu_num_live];
+    }
+    pthread_mutex_unlock(&cpu_lock);
+}
+
+static void cpu_init(void)
+{
+    pthread_key_create(&cpu_key, thread_exit);
+}
+
+static int get_name(const char *name)
+{
+    for (int n = 0; n < cpu_num_names; n++) {
+        if (strncmp(cpu_names[n].name, name, sizeof(cpu_names[n].name) - 1) == 0)
+            return n;
+    }
+    if (cpu_num_names == MAX_NAMES)
+        return -1;
+    struct mpthread_cpu_time *e = &cpu_names[cpu_num_names];
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    return cpu_num_names++;
+}
+
+void mpthread_account_cpu_time(const char *name)
+{
+    pthread_once(&cpu_once, cpu_init);
+
+    pthread_mutex_lock(&cpu_lock);
+    int index = get_name(name);
+    struct live_thread *t = find_live(pthread_self());
+    if (index < 0) {
+        // out of space
+    } else if (t) {
+        // Renamed: the time so far stays with the old name.
+        if (t->name != index) {
+            int64_t now = clock_ns(t->clock);
+            cpu_names[t->name].cpu_ns += now - t->base_ns;
+            t->base_ns = now;
+            t->name = index;
+            cpu_names[index].threads += 1;
+        }
+    } else if (cpu_num_live < MAX_LIVE_THREADS &&
+               pthread_getcpuclockid(pthread_self(),
+                                     &cpu_live[cpu_num_live].clock) == 0)
+    {
+        cpu_live[cpu_num_live].thread = pthread_self();
+        cpu_live[cpu_num_live].name = index;
+        cpu_live[cpu_num_live].base_ns = 0;
+        cpu_num_live++;
+        cpu_names[index].threads += 1;
+        pthread_setspecific(cpu_key, &cpu_live); // any non-NULL value
+    }
+    pthread_mutex_unlock(&cpu_lock);
+}
+
+int mpthread_get_cpu_times(struct mpthread_cpu_time *out, int max)
+{
+    pthread_mutex_lock(&cpu_lock);
+    int num = cpu_num_names < max ? cpu_num_names : max;
+    for (int n = 0; n < num; n++)
+        out[n] = cpu_names[n];
+    for (int n = 0; n < cpu_num_live; n++) {
+        struct live_thread *t = &cpu_live[n];
+        if (t->name < num)
+            out[t->name].cpu_ns += clock_ns(t->clock) - t->base_ns;
+    }
+    pthread_mutex_unlock(&cpu_lock);
+    return num;
+}
+
+#else
+
+void mpthread_account_cpu_time(const char *name)
+{
+}
+
+int mpthread_get_cpu_times(struct mpthread_cpu_time *out, int max)
+{
+    return -1;
+}
+
+#endif
+
 void mpthread_set_name(const char *name)
 {
+    if (atomic_load_explicit(&cpu_enabled, memory_order_relaxed))
+        mpthread_account_cpu_time(name);
+
     char tname[80];
     snprintf(tname, sizeof(tname), "mpv/%s", name);
 #if HAVE_GLIBC_THREAD_NAME
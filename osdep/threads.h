@@ -7,7 +7,29 @@
 // Helper to reduce boiler plate.
 int mpthread_mutex_init_recursive(pthread_mutex_t *mutex);
 
-// Set thread name (for debuggers).
+// Set thread name (for debuggers). If CPU time accounting is enabled, this
+// also registers the thread for it under this name.
 void mpthread_set_name(const char *name);
 
+// Make mpthread_set_name() register threads for CPU time accounting (used by
+// --benchmark-report). Threads named before this are not accounted. It can't
+// be disabled again.
+void mpthread_enable_cpu_accounting(void);
+
+// Register the calling thread for CPU time accounting, without setting the
+// thread name (e.g. for the main thread, whose name is the process name).
+// This works even if accounting is not enabled.
+void mpthread_account_cpu_time(const char *name);
+
+struct mpthread_cpu_time {
+    char name[32];
+    int threads;        // number of threads with this name (including exited)
+    int64_t cpu_ns;     // summed CPU time of these threads
+};
+
+// Return the CPU time of all registered threads, summed per name. Exited
+// threads are included. Returns the number of entries written to out (at
+// most max), or -1 if not supported on this platform.
+int mpthread_get_cpu_times(struct mpthread_cpu_time *out, int max);
+
 #endif
@@ -586,7 +586,7 @@ static void dump_audio_stats(struct MPContext *mpctx)
     }
     double current_audio = mpctx->written_audio - delay;
     double current_time = (mp_time_us() - mpctx->audio_stat_start) / 1e6;
-    MP_STATS(mpctx, "value %f ao-dev", current_audio - current_time);
+    MP_STATS_VALUE(mpctx, "ao-dev", current_audio - current_time);
 }
 
 // Return the number of samples that must be skipped or prepended to reach the
@@ -924,10 +924,10 @@ void fill_audio_out_buffers(struct MPContext *mpctx)
         mpctx->last_av_difference += skip_duplicate / play_samplerate;
         if (skip_duplicate >= 0) {
             mp_audio_buffer_skip(ao_c->ao_buffer, skip_duplicate);
-            MP_STATS(mpctx, "drop-audio");
+            MP_STATS_SIGNAL(mpctx, "drop-audio");
         } else {
             mp_audio_buffer_duplicate(ao_c->ao_buffer, -skip_duplicate);
-            MP_STATS(mpctx, "duplicate-audio");
+            MP_STATS_SIGNAL(mpctx, "duplicate-audio");
         }
         MP_VERBOSE(mpctx, "audio skip_duplicate=%d\n", skip_duplicate);
     }
@@ -972,12 +972,11 @@ void fill_audio_out_buffers(struct MPContext *mpctx)
     if (audio_eof && !opts->gapless_audio)
         playflags |= AOPLAY_FINAL_CHUNK;
 
-    uint8_t **planes;
-    int samples;
-    mp_audio_buffer_peek(ao_c->ao_buffer, &planes, &samples);
+    int samples = mp_audio_buffer_samples(ao_c->ao_buffer);
     if (audio_eof || samples >= align)
         samples = samples / align * align;
     samples = MPMIN(samples, mpctx->paused ? 0 : playsize);
+    uint8_t **planes = mp_audio_buffer_peek_linear(ao_c->ao_buffer, samples);
     int played = write_to_ao(mpctx, planes, samples, playflags);
     assert(played >= 0 && played <= samples);
     mp_audio_buffer_skip(ao_c->ao_buffer, played);
@@ -0,0 +1,341 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+
+#if HAVE_POSIX
+#include <sys/resource.h>
+#endif
+
+#include "mpv_talloc.h"
+#include "core.h"
+#include "audio/out/ao.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "filters/f_decoder_wrapper.h"
+#include "filters/filter.h"
+#include "misc/bstr.h"
+#include "misc/json.h"
+#include "options/options.h"
+#include "options/path.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
+#include "video/out/vo.h"
+
+#define MAX_THREAD_NAMES 64
+
+// --benchmark-report state for the currently playing file.
+struct mp_benchmark {
+    double start_time;
+    int64_t start_cpu_us;       // -1 if unknown
+    struct mpthread_cpu_time threads[MAX_THREAD_NAMES];
+    int num_threads;            // -1 if unsupported
+};
+
+// CPU time of the whole process, or -1 if unknown.
+static int64_t process_cpu_us(void)
+{
+#if HAVE_POSIX
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * INT64_C(1000000) +
+               ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+    }
+#endif
+    return -1;
+}
+
+static int64_t peak_rss_bytes(void)
+{
+#if HAVE_POSIX
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#ifdef __APPLE__
+        return ru.ru_maxrss;
+#else
+        return ru.ru_maxrss * INT64_C(1024);
+#endif
+    }
+#endif
+    return -1;
+}
+
+// Enable thread CPU time accounting if --benchmark-report is set. Called on
+// init and before opening each file, so that all threads of the file are
+// registered when they are started and named.
+void benchmark_prepare(struct MPContext *mpctx)
+{
+    char *path = mpctx->opts->benchmark_report;
+    if (path && path[0])
+        mpthread_enable_cpu_accounting();
+}
+
+void benchmark_start(struct MPContext *mpctx)
+{
+    char *path = mpctx->opts->benchmark_report;
+    if (!path || !path[0])
+        return;
+
+    struct mp_benchmark *b = talloc_zero(NULL, struct mp_benchmark);
+    mpctx->benchmark = b;
+
+    // With the CLI, the core runs on the main thread, which we must not rename
+    // (it would change the process name).
+    mpthread_account_cpu_time("mpv core");
+    b->num_threads = mpthread_get_cpu_times(b->threads, MAX_THREAD_NAMES);
+    b->start_cpu_us = process_cpu_us();
+
+    mp_filter_root_set_stats(mpctx->filter_root, true);
+
+    b->start_time = mp_time_sec();
+}
+
+static void write_rate(struct json_writer *w, const char *key, int64_t count,
+                       double secs)
+{
+    json_writer_key(w, key);
+    json_writer_double(w, secs > 0 ? count / secs : 0);
+}
+
+static void write_decoder(struct json_writer *w, struct mp_decoder_wrapper *dec,
+                          double secs)
+{
+    json_writer_key(w, "decoder");
+    json_writer_string(w, dec->decoder_desc ? dec->decoder_desc : "");
+    json_writer_key(w, "packets");
+    json_writer_int64(w, dec->num_packets);
+    json_writer_key(w, "packet_bytes");
+    json_writer_int64(w, dec->packet_bytes);
+    json_writer_key(w, "decoded_frames");
+    json_writer_int64(w, dec->num_frames);
+    write_rate(w, "decoded_frames_per_sec", dec->num_frames, secs);
+}
+
+static void write_threads(struct json_writer *w, struct mp_benchmark *b,
+                          int64_t cpu_us)
+{
+    struct mpthread_cpu_time now[MAX_THREAD_NAMES];
+    int num = mpthread_get_cpu_times(now, MAX_THREAD_NAMES);
+    if (num < 0 || b->num_threads < 0)
+        return;
+
+    int64_t total_ns = 0;
+    json_writer_key(w, "threads");
+    json_writer_begin_array(w);
+    for (int n = 0; n < num; n++) {
+        // Entries are only ever appended, so indexes match.
+        int64_t ns = now[n].cpu_ns;
+        int threads = now[n].threads;
+        if (n < b->num_threads) {
+            ns -= b->threads[n].cpu_ns;
+            threads -= b->threads[n].threads;
+        }
+        if (ns <= 0)
+            continue;
+        total_ns += ns;
+        json_writer_begin_object(w);
+        json_writer_key(w, "name");
+        json_writer_string(w, now[n].name);
+        json_writer_key(w, "new_threads");
+        json_writer_int64(w, threads);
+        json_writer_key(w, "cpu_time");
+        json_writer_double(w, ns / 1e9);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+
+    // Threads not created by mpv (libavcodec workers etc.).
+    if (cpu_us >= 0) {
+        json_writer_key(w, "other_threads_cpu_time");
+        json_writer_double(w, MPMAX(0, cpu_us * 1000 - total_ns) / 1e9);
+    }
+}
+
+static int compare_filter_stats(const void *pa, const void *pb)
+{
+    const struct mp_filter_stats *a = pa, *b = pb;
+    return MPCLAMP(b->time_us - a->time_us, -1, 1);
+}
+
+static void write_filters(struct json_writer *w, struct MPContext *mpctx,
+                          double secs)
+{
+    struct mp_filter_stats *stats;
+    int num = mp_filter_root_get_stats(mpctx->filter_root, &stats);
+    struct mp_filter_stats *sorted = talloc_memdup(NULL, stats,
+                                                   num * sizeof(stats[0]));
+    qsort(sorted, num, sizeof(sorted[0]), compare_filter_stats);
+
+    json_writer_key(w, "filters");
+    json_writer_begin_array(w);
+    for (int n = 0; n < num; n++) {
+        json_writer_begin_object(w);
+        json_writer_key(w, "name");
+        json_writer_string(w, sorted[n].name);
+        json_writer_key(w, "calls");
+        json_writer_int64(w, sorted[n].calls);
+        json_writer_key(w, "time");
+        json_writer_double(w, sorted[n].time_us / 1e6);
+        json_writer_key(w, "share");
+        json_writer_double(w, secs > 0 ? sorted[n].time_us / 1e6 / secs : 0);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+
+    talloc_free(sorted);
+}
+
+static void write_report(struct MPContext *mpctx, struct mp_benchmark *b,
+                         struct bstr *dst)
+{
+    double secs = mp_time_sec() - b->start_time;
+    int64_t cpu_us = process_cpu_us();
+    if (cpu_us >= 0 && b->start_cpu_us >= 0) {
+        cpu_us -= b->start_cpu_us;
+    } else {
+        cpu_us = -1;
+    }
+
+    struct mp_decoder_wrapper *vdec =
+        mpctx->vo_chain && mpctx->vo_chain->track
+            ? mpctx->vo_chain->track->dec : NULL;
+    struct mp_decoder_wrapper *adec =
+        mpctx->ao_chain && mpctx->ao_chain->track
+            ? mpctx->ao_chain->track->dec : NULL;
+
+    struct json_writer w = {.dst = dst};
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "file");
+    json_writer_string(&w, mpctx->filename);
+    json_writer_key(&w, "eof");
+    json_writer_flag(&w, mpctx->stop_play == AT_END_OF_FILE);
+    json_writer_key(&w, "wall_time");
+    json_writer_double(&w, secs);
+
+    // Packets read by the decoders (not counting subtitles).
+    int64_t packets = 0, bytes = 0;
+    if (vdec) {
+        packets += vdec->num_packets;
+        bytes += vdec->packet_bytes;
+    }
+    if (adec) {
+        packets += adec->num_packets;
+        bytes += adec->packet_bytes;
+    }
+    json_writer_key(&w, "demux");
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "packets");
+    json_writer_int64(&w, packets);
+    write_rate(&w, "packets_per_sec", packets, secs);
+    json_writer_key(&w, "bytes");
+    json_writer_int64(&w, bytes);
+    write_rate(&w, "bytes_per_sec", bytes, secs);
+    json_writer_end_object(&w);
+
+    if (mpctx->vo_chain) {
+        json_writer_key(&w, "video");
+        json_writer_begin_object(&w);
+        if (vdec) {
+            write_decoder(&w, vdec, secs);
+            json_writer_key(&w, "decoder_drops");
+            json_writer_int64(&w, vdec->dropped_frames);
+        }
+        json_writer_key(&w, "output_frames");
+        json_writer_int64(&w, mpctx->shown_vframes);
+        write_rate(&w, "output_frames_per_sec", mpctx->shown_vframes, secs);
+        json_writer_key(&w, "output_drops");
+        json_writer_int64(&w, vo_get_drop_count(mpctx->video_out));
+        json_writer_key(&w, "mistimed_frames");
+        json_writer_int64(&w, mpctx->mistimed_frames_total);
+        json_writer_end_object(&w);
+    }
+
+    if (mpctx->ao_chain) {
+        json_writer_key(&w, "audio");
+        json_writer_begin_object(&w);
+        if (adec) {
+            write_decoder(&w, adec, secs);
+            json_writer_key(&w, "decoded_samples");
+            json_writer_int64(&w, adec->num_samples);
+            write_rate(&w, "decoded_samples_per_sec", adec->num_samples, secs);
+        }
+        json_writer_key(&w, "output_samples");
+        json_writer_int64(&w, mpctx->shown_aframes);
+        write_rate(&w, "output_samples_per_sec", mpctx->shown_aframes, secs);
+        json_writer_key(&w, "output_timed");
+        json_writer_flag(&w, mpctx->ao && !ao_untimed(mpctx->ao));
+        json_writer_end_object(&w);
+    }
+
+    write_filters(&w, mpctx, secs);
+
+    if (cpu_us >= 0) {
+        json_writer_key(&w, "cpu_time");
+        json_writer_double(&w, cpu_us / 1e6);
+    }
+    write_threads(&w, b, cpu_us);
+
+    int64_t rss = peak_rss_bytes();
+    if (rss >= 0) {
+        json_writer_key(&w, "peak_rss");
+        json_writer_int64(&w, rss);
+    }
+
+    json_writer_end_object(&w);
+    bstr_xappend(NULL, dst, bstr0("\n"));
+}
+
+// Called after the playloop has ended, before anything is uninitialized.
+void benchmark_report(struct MPContext *mpctx)
+{
+    struct mp_benchmark *b = mpctx->benchmark;
+    if (!b)
+        return;
+    mpctx->benchmark = NULL;
+
+    if (mpctx->ao_chain && mpctx->ao && !ao_untimed(mpctx->ao)) {
+        MP_WARN(mpctx, "Audio output was timed, which limits playback speed. "
+                "Use --ao=null --ao-null-untimed or --no-audio.\n");
+    }
+
+    struct bstr report = {0};
+    write_report(mpctx, b, &report);
+
+    char *path = mp_get_user_path(NULL, mpctx->global,
+                                  mpctx->opts->benchmark_report);
+    bool to_stdout = strcmp(path, "-") == 0;
+    FILE *f = to_stdout ? stdout : fopen(path, "a");
+    if (f) {
+        fwrite(report.start, report.len, 1, f);
+        if (to_stdout) {
+            fflush(f);
+        } else if (fclose(f)) {
+            MP_ERR(mpctx, "Error writing benchmark report to '%s'.\n", path);
+        }
+        MP_VERBOSE(mpctx, "Benchmark report written to '%s'.\n", path);
+    } else {
+        MP_ERR(mpctx, "Could not open '%s' for the benchmark report.\n", path);
+    }
+
+    mp_filter_root_set_stats(mpctx->filter_root, false);
+    talloc_free(path);
+    talloc_free(report.start);
+    talloc_free(b);
+}
@@ -96,6 +96,13 @@ struct observe_property {
     struct mpv_handle *client;
 };
 
+// See mp_client_track_property().
+struct tracked_property {
+    int id;                 // ==mp_get_property_id(name)
+    uint64_t event_mask;    // ==mp_get_property_event_mask(name)
+    bool changed;
+};
+
 struct mpv_handle {
     // -- immmutable
     char name[MAX_CLIENT_NAME];
@@ -136,6 +143,8 @@ struct mpv_handle {
     int lowest_changed;     // attempt at making change processing incremental
     int properties_updating;
     uint64_t property_event_masks; // or-ed together event masks of all properties
+    struct tracked_property *tracked_properties;
+    int num_tracked_properties;
 
     bool fuzzy_initialized; // see scripting.c wait_loaded()
     bool is_weak;           // can not keep core alive on its own
@@ -243,6 +252,7 @@ struct mpv_handle *mp_new_client(struct mp_client_api *clients, const char *name
     int num_events = 1000;
 
     struct mpv_handle *client = talloc_ptrtype(NULL, client);
+    talloc_set_account(client, "client");
     *client = (struct mpv_handle){
         .log = mp_log_new(client, clients->mpctx->log, nname),
         .mpctx = clients->mpctx,
@@ -1404,6 +1414,53 @@ int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
     return req.status;
 }
 
+struct getproperties_request {
+    struct MPContext *mpctx;
+    const char **names;
+    struct mpv_node *res;
+};
+
+static void getproperties_fn(void *arg)
+{
+    struct getproperties_request *req = arg;
+
+    node_init(req->res, MPV_FORMAT_NODE_MAP, NULL);
+    for (int n = 0; req->names[n]; n++) {
+        struct mpv_node val = {0};
+        struct getproperty_request preq = {
+            .mpctx = req->mpctx,
+            .name = req->names[n],
+            .format = MPV_FORMAT_NODE,
+            .data = &val,
+        };
+        getproperty_fn(&preq);
+        // Unavailable properties and errors are reported as MPV_FORMAT_NONE.
+        if (preq.status < 0)
+            val = (struct mpv_node){0};
+        struct mpv_node *dst = node_map_add(req->res, req->names[n],
+                                            MPV_FORMAT_NONE);
+        *dst = val;
+        talloc_steal(req->res->u.list, node_get_alloc(dst));
+    }
+}
+
+int mpv_get_properties(mpv_handle *ctx, const char **names,
+                       struct mpv_node *data)
+{
+    if (!ctx->mpctx->initialized)
+        return MPV_ERROR_UNINITIALIZED;
+    if (!names || !data)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    struct getproperties_request req = {
+        .mpctx = ctx->mpctx,
+        .names = names,
+        .res = data,
+    };
+    run_locked(ctx, getproperties_fn, &req);
+    return 0;
+}
+
 char *mpv_get_property_string(mpv_handle *ctx, const char *name)
 {
     char *str = NULL;
@@ -1500,6 +1557,8 @@ int mpv_unobserve_property(mpv_handle *ctx, uint64_t userdata)
         if (!prop->dead)
             ctx->property_event_masks |= prop->event_mask;
     }
+    for (int n = 0; n < ctx->num_tracked_properties; n++)
+        ctx->property_event_masks |= ctx->tracked_properties[n].event_mask;
     ctx->lowest_changed = 0;
     pthread_mutex_unlock(&ctx->lock);
     invalidate_global_event_mask(ctx);
@@ -1529,6 +1588,10 @@ void mp_client_property_change(struct MPContext *mpctx, const char *name)
             if (client->properties[i]->id == id)
                 mark_property_changed(client, i);
         }
+        for (int i = 0; i < client->num_tracked_properties; i++) {
+            if (client->tracked_properties[i].id == id)
+                client->tracked_properties[i].changed = true;
+        }
         if (client->lowest_changed < client->num_properties)
             wakeup_client(client);
         pthread_mutex_unlock(&client->lock);
@@ -1545,10 +1608,58 @@ static void notify_property_events(struct mpv_handle *ctx, uint64_t event_mask)
         if (ctx->properties[i]->event_mask & event_mask)
             mark_property_changed(ctx, i);
     }
+    for (int i = 0; i < ctx->num_tracked_properties; i++) {
+        if (ctx->tracked_properties[i].event_mask & event_mask)
+            ctx->tracked_properties[i].changed = true;
+    }
     if (ctx->lowest_changed < ctx->num_properties)
         wakeup_client(ctx);
 }
 
+// Start tracking changes of the given property, without generating events.
+// This is for clients caching property values internally (like lua.c), and
+// only works for properties for which mp_property_is_cacheable() is true.
+// Returns a handle for mp_client_property_changed(), or -1 on failure.
+// There is no way to stop tracking, so this should be used for a small,
+// bounded set of names only.
+int mp_client_track_property(struct mpv_handle *ctx, const char *name)
+{
+    if (!mp_property_is_cacheable(name))
+        return -1;
+    int id = mp_get_property_id(ctx->mpctx, name);
+    if (id < 0)
+        return -1;
+
+    pthread_mutex_lock(&ctx->lock);
+    struct tracked_property prop = {
+        .id = id,
+        .event_mask = mp_get_property_event_mask(name),
+        .changed = true,
+    };
+    int handle = ctx->num_tracked_properties;
+    MP_TARRAY_APPEND(ctx, ctx->tracked_properties, ctx->num_tracked_properties,
+                     prop);
+    ctx->property_event_masks |= prop.event_mask;
+    pthread_mutex_unlock(&ctx->lock);
+    invalidate_global_event_mask(ctx);
+    return handle;
+}
+
+// Return whether the property tracked with the given handle might have changed
+// since the previous call (always true on the first call), and reset the
+// state. The flag is reset before returning, so reading the property value
+// after this call never misses a change.
+bool mp_client_property_changed(struct mpv_handle *ctx, int handle)
+{
+    pthread_mutex_lock(&ctx->lock);
+    assert(handle >= 0 && handle < ctx->num_tracked_properties);
+    struct tracked_property *prop = &ctx->tracked_properties[handle];
+    bool changed = prop->changed;
+    prop->changed = false;
+    pthread_mutex_unlock(&ctx->lock);
+    return changed;
+}
+
 static void update_prop(void *p)
 {
     struct observe_property *prop = p;
@@ -31,6 +31,8 @@ int mp_client_send_event_dup(struct MPContext *mpctx, const char *client_name,
                              int event, void *data);
 bool mp_client_event_is_registered(struct MPContext *mpctx, int event);
 void mp_client_property_change(struct MPContext *mpctx, const char *name);
+int mp_client_track_property(struct mpv_handle *ctx, const char *name);
+bool mp_client_property_changed(struct mpv_handle *ctx, int handle);
 
 struct mpv_handle *mp_new_client(struct mp_client_api *clients, const char *name);
 void mp_client_set_weak(struct mpv_handle *ctx);
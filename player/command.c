@@ -60,6 +60,7 @@
 #include "video/out/bitmap_packer.h"
 #include "options/path.h"
 #include "screenshot.h"
+#include "storyboard.h"
 #include "misc/dispatch.h"
 #include "misc/node.h"
 #include "misc/thread_pool.h"
@@ -2826,6 +2827,50 @@ out:
     return ret;
 }
 
+static int mp_property_memory_accounts(void *ctx, struct m_property *prop,
+                                       int action, void *arg)
+{
+    if (!ta_accounting_enabled())
+        return M_PROPERTY_UNAVAILABLE;
+
+    struct ta_account_stats stats[64];
+    int num = ta_get_account_stats(stats, MP_ARRAY_SIZE(stats));
+
+    switch (action) {
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_PRINT: {
+        char *res = talloc_strdup(NULL, "");
+        for (int n = 0; n < num; n++) {
+            char *size = format_file_size(stats[n].bytes);
+            res = talloc_asprintf_append(res, "%s: %s in %"PRId64" blocks, "
+                                         "%"PRId64" allocations\n",
+                                         stats[n].name, size, stats[n].blocks,
+                                         stats[n].allocs);
+            talloc_free(size);
+        }
+        *(char **)arg = res;
+        return M_PROPERTY_OK;
+    }
+    case M_PROPERTY_GET: {
+        struct mpv_node node;
+        node_init(&node, MPV_FORMAT_NODE_ARRAY, NULL);
+        for (int n = 0; n < num; n++) {
+            struct mpv_node *entry = node_array_add(&node, MPV_FORMAT_NODE_MAP);
+            node_map_add_string(entry, "name", stats[n].name);
+            node_map_add_int64(entry, "bytes", stats[n].bytes);
+            node_map_add_int64(entry, "blocks", stats[n].blocks);
+            node_map_add_int64(entry, "allocs", stats[n].allocs);
+            node_map_add_int64(entry, "alloc-bytes", stats[n].alloc_bytes);
+        }
+        *(struct mpv_node *)arg = node;
+        return M_PROPERTY_OK;
+    }
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
 static int mp_property_vo(void *ctx, struct m_property *p, int action, void *arg)
 {
     MPContext *mpctx = ctx;
@@ -3182,7 +3227,7 @@ static int mp_property_playlist_pos_x(void *ctx, struct m_property *prop,
 {
     MPContext *mpctx = ctx;
     struct playlist *pl = mpctx->playlist;
-    if (!pl->first)
+    if (!pl->num_entries)
         return M_PROPERTY_UNAVAILABLE;
 
     switch (action) {
@@ -3227,30 +3272,11 @@ static int mp_property_playlist_pos_1(void *ctx, struct m_property *prop,
     return mp_property_playlist_pos_x(ctx, prop, action, arg, 1);
 }
 
-struct get_playlist_ctx {
-    struct MPContext *mpctx;
-    int last_index;
-    struct playlist_entry *last_entry;
-};
-
 static int get_playlist_entry(int item, int action, void *arg, void *ctx)
 {
-    struct get_playlist_ctx *p = ctx;
-    struct MPContext *mpctx = p->mpctx;
-
-    struct playlist_entry *e;
-    // This is an optimization that prevents O(n^2) behaviour when the entire
-    // playlist is requested. If a request is made for the last requested entry
-    // or the entry immediately following it, it can be found without a full
-    // traversal of the linked list.
-    if (p->last_entry && item == p->last_index)
-        e = p->last_entry;
-    else if (p->last_entry && item == p->last_index + 1)
-        e = p->last_entry->next;
-    else
-        e = playlist_entry_from_index(mpctx->playlist, item);
-    p->last_index = item;
-    p->last_entry = e;
+    struct MPContext *mpctx = ctx;
+
+    struct playlist_entry *e = playlist_entry_from_index(mpctx->playlist, item);
     if (!e)
         return M_PROPERTY_ERROR;
 
@@ -3275,8 +3301,8 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
         struct playlist *pl = mpctx->playlist;
         char *res = talloc_strdup(NULL, "");
 
-        for (struct playlist_entry *e = pl->first; e; e = e->next)
-        {
+        for (int n = 0; n < pl->num_entries; n++) {
+            struct playlist_entry *e = pl->entries[n];
             char *p = e->filename;
             if (!mp_is_url(bstr0(p))) {
                 char *s = mp_basename(e->filename);
@@ -3284,7 +3310,7 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
                     p = s;
             }
             const char *m = pl->current == e ? list_current : list_normal;
-            res = talloc_asprintf_append(res, "%s%s\n", m, p);
+            res = talloc_asprintf_append_buffer(res, "%s%s\n", m, p);
         }
 
         *(char **)arg =
@@ -3292,9 +3318,8 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
         return M_PROPERTY_OK;
     }
 
-    struct get_playlist_ctx p = {.mpctx = mpctx};
     return m_property_read_list(action, arg, playlist_entry_count(mpctx->playlist),
-                                get_playlist_entry, &p);
+                                get_playlist_entry, mpctx);
 }
 
 static char *print_obj_osd_list(struct m_obj_settings *list)
@@ -3850,6 +3875,7 @@ static const struct m_property mp_properties_base[] = {
     {"window-scale", mp_property_window_scale},
     {"vo-configured", mp_property_vo_configured},
     {"vo-passes", mp_property_vo_passes},
+    {"memory-accounts", mp_property_memory_accounts},
     {"current-vo", mp_property_vo},
     {"container-fps", mp_property_fps},
     {"estimated-vf-fps", mp_property_vf_fps},
@@ -3957,7 +3983,7 @@ static const char *const *const mp_event_property_change[] = {
     E(MP_EVENT_CHANGE_ALL, "*"),
     E(MPV_EVENT_TRACKS_CHANGED, "track-list"),
     E(MPV_EVENT_TRACK_SWITCHED, "vid", "video", "aid", "audio", "sid", "sub",
-      "secondary-sid"),
+      "secondary-sid", "track-list"),
     E(MPV_EVENT_IDLE, "*"),
     E(MPV_EVENT_PAUSE,   "pause"),
     E(MPV_EVENT_UNPAUSE, "pause"),
@@ -4033,6 +4059,29 @@ uint64_t mp_get_property_event_mask(const char *name)
     return mask;
 }
 
+// Properties (and their sub-properties) whose value changes only together
+// with a change notification, either through mp_event_property_change[] or
+// mp_notify_property(). Most other properties change continuously, or are
+// not notified at all (like "vo-passes"). "track-list" is not included,
+// because fields like "decoder-desc" and "demux-w" change silently.
+static const char *const cacheable_properties[] = {
+    "chapter-list", "edition-list", "playlist", "metadata",
+    "filtered-metadata", "chapter-metadata", "vf", "af", NULL
+};
+
+// Whether clients can cache the property value until the next change
+// notification (see mp_client_track_property()).
+bool mp_property_is_cacheable(const char *name)
+{
+    for (int n = 0; cacheable_properties[n]; n++) {
+        const char *p = cacheable_properties[n];
+        size_t len = strlen(p);
+        if (strncmp(name, p, len) == 0 && (!name[len] || name[len] == '/'))
+            return true;
+    }
+    return false;
+}
+
 // Return an ID for the property. It might not be unique, but is good enough
 // for property change handling. Return -1 if property unknown.
 int mp_get_property_id(struct MPContext *mpctx, const char *name)
@@ -5171,7 +5220,8 @@ static void cmd_playlist_next_prev(void *p)
     int force = cmd->args[0].v.i;
 
     struct playlist_entry *e = mp_next_file(mpctx, dir, force, true);
-    if (!e && !force) {
+    // Don't stop playback if the next entries just weren't read yet.
+    if (!e && (!force || playlist_loader_pending(mpctx))) {
         cmd->success = false;
         return;
     }
@@ -5299,8 +5349,9 @@ static void cmd_loadlist(void *p)
         playlist_append_entries(mpctx->playlist, pl);
         talloc_free(pl);
 
-        if (!append && mpctx->playlist->first)
-            mp_set_playlist_entry(mpctx, new ? new : mpctx->playlist->first);
+        struct playlist_entry *first = playlist_get_first(mpctx->playlist);
+        if (!append && first)
+            mp_set_playlist_entry(mpctx, new ? new : first);
 
         mp_notify(mpctx, MP_EVENT_CHANGE_PLAYLIST, NULL);
         mp_wakeup_core(mpctx);
@@ -5318,14 +5369,11 @@ static void cmd_playlist_clear(void *p)
     // Supposed to clear the playlist, except the currently played item.
     if (mpctx->playlist->current_was_replaced)
         mpctx->playlist->current = NULL;
-    while (mpctx->playlist->first) {
-        struct playlist_entry *e = mpctx->playlist->first;
-        if (e == mpctx->playlist->current) {
-            e = e->next;
-            if (!e)
-                break;
-        }
-        playlist_remove(mpctx->playlist, e);
+    // Remove from the end, so that no entries need to be moved.
+    for (int n = mpctx->playlist->num_entries - 1; n >= 0; n--) {
+        struct playlist_entry *e = mpctx->playlist->entries[n];
+        if (e != mpctx->playlist->current)
+            playlist_remove(mpctx->playlist, e);
     }
     mp_notify(mpctx, MP_EVENT_CHANGE_PLAYLIST, NULL);
     mp_wakeup_core(mpctx);
@@ -6065,7 +6113,7 @@ const struct mp_cmd_def mp_cmds[] = {
                       ({"unused", 0}, {"single", 0},
                        {"each-frame", 8})),
         },
-        .spawn_thread = true,
+        .exec_async = true,
     },
     { "screenshot-to-file", cmd_screenshot_to_file,
         {
@@ -6076,7 +6124,7 @@ const struct mp_cmd_def mp_cmds[] = {
                         {"subtitles", 2}),
                        OPTDEF_INT(2)),
         },
-        .spawn_thread = true,
+        .exec_async = true,
     },
     { "screenshot-raw", cmd_screenshot_raw,
         {
@@ -6087,6 +6135,17 @@ const struct mp_cmd_def mp_cmds[] = {
                        OPTDEF_INT(2)),
         },
     },
+    { "storyboard", cmd_storyboard,
+        {
+            OPT_STRING("url", v.s, 0),
+            OPT_STRING("filename", v.s, 0),
+            OPT_DOUBLERANGE("interval", v.d, 0, 0.1, 1e9, OPTDEF_DOUBLE(10)),
+            OPT_INTRANGE("width", v.i, 0, 1, 4096, OPTDEF_INT(160)),
+            OPT_INTRANGE("columns", v.i, 0, 1, 1000, OPTDEF_INT(10)),
+        },
+        .spawn_thread = true,
+        .can_abort = true,
+    },
     { "loadfile", cmd_loadfile,
         {
             OPT_STRING("url", v.s, 0),
@@ -323,6 +323,15 @@ typedef struct MPContext {
     struct mp_image *next_frames[VO_MAX_REQ_FRAMES + 1];
     int num_next_frames;
     struct mp_image *saved_frame;   // for hrseek_lastframe and hrseek_backstep
+    // --hr-seek-cache: recent frames output by the video filters, in playback
+    // order. Frames starting at frame_cache_pos are replayed before new frames
+    // are read from the filters.
+    struct mp_image **frame_cache;
+    int num_frame_cache;
+    int frame_cache_pos;
+    int64_t frame_cache_size;
+    int frame_cache_dropped; // decoder dropped_frames at last cached frame
+    bool frame_cache_resync; // audio must be re-seeked before resuming
 
     enum playback_status video_status, audio_status;
     bool restart_complete;
@@ -340,6 +349,8 @@ typedef struct MPContext {
     double audio_drop_throttle;
     // Number of mistimed frames.
     int mistimed_frames_total;
+    // Set during playback with --benchmark-report.
+    struct mp_benchmark *benchmark;
     bool hrseek_active;     // skip all data until hrseek_pts
     bool hrseek_lastframe;  // drop everything until last frame reached
     bool hrseek_backstep;   // go to frame before seek target
@@ -439,6 +450,14 @@ typedef struct MPContext {
 
     struct mp_ipc_ctx *ipc_ctx;
 
+    // Threads shared by scripts (--script-threads); only accessed by the core.
+    struct script_host **script_hosts;
+    int num_script_hosts;
+
+    // Read the rest of large playlist files in the background.
+    struct playlist_loader **playlist_loaders;
+    int num_playlist_loaders;
+
     pthread_mutex_t abort_lock;
 
     // --- The following fields are protected by abort_lock
@@ -456,6 +475,7 @@ typedef struct MPContext {
     char *open_url;
     char *open_format;
     int open_url_flags;
+    bool open_playlist_incremental;
     // --- All fields below are owned by open_thread, unless open_done was set
     //     to true.
     struct demuxer *open_res_demuxer;
@@ -494,6 +514,11 @@ void audio_update_volume(struct MPContext *mpctx);
 void audio_update_balance(struct MPContext *mpctx);
 void reload_audio_output(struct MPContext *mpctx);
 
+// benchmark.c
+void benchmark_prepare(struct MPContext *mpctx);
+void benchmark_start(struct MPContext *mpctx);
+void benchmark_report(struct MPContext *mpctx);
+
 // configfiles.c
 void mp_parse_cfgfiles(struct MPContext *mpctx);
 void mp_load_auto_profiles(struct MPContext *mpctx);
@@ -532,6 +557,8 @@ void update_demuxer_properties(struct MPContext *mpctx);
 void print_track_list(struct MPContext *mpctx, const char *msg);
 void reselect_demux_stream(struct MPContext *mpctx, struct track *track);
 void prepare_playlist(struct MPContext *mpctx, struct playlist *pl);
+void handle_playlist_loader(struct MPContext *mpctx);
+bool playlist_loader_pending(struct MPContext *mpctx);
 void autoload_external_files(struct MPContext *mpctx, struct mp_cancel *cancel);
 struct track *select_default_track(struct MPContext *mpctx, int order,
                                    enum stream_type type);
@@ -611,8 +638,20 @@ struct mp_scripting {
     const char *name;       // e.g. "lua script"
     const char *file_ext;   // e.g. "lua"
     int (*load)(struct mpv_handle *client, const char *filename);
+    // Optional, for running the script on a thread shared with other scripts
+    // (--script-threads). init() loads the script and runs its top level code,
+    // and returns NULL on failure. run() handles pending events and timers
+    // without blocking, and returns after how many seconds it wants to be
+    // called again (it's also called on client wakeups), or a negative value
+    // once the script has exited. If init() sets *exclusive, the script
+    // has its own event loop, and run() blocks until the script exits.
+    void *(*init)(struct mpv_handle *client, const char *filename,
+                  bool *exclusive);
+    double (*run)(void *state);
+    void (*uninit)(void *state);
 };
 void mp_load_scripts(struct MPContext *mpctx);
+void mp_uninit_script_hosts(struct MPContext *mpctx);
 void mp_load_builtin_scripts(struct MPContext *mpctx);
 int mp_load_user_script(struct MPContext *mpctx, const char *fname);
 
@@ -629,6 +668,7 @@ bool update_subtitles(struct MPContext *mpctx, double video_pts);
 int video_get_colors(struct vo_chain *vo_c, const char *item, int *value);
 int video_set_colors(struct vo_chain *vo_c, const char *item, int value);
 void reset_video_state(struct MPContext *mpctx);
+bool video_frame_cache_seek(struct MPContext *mpctx, double pts, int dir);
 int init_video_decoder(struct MPContext *mpctx, struct track *track);
 void reinit_video_chain(struct MPContext *mpctx);
 void reinit_video_chain_src(struct MPContext *mpctx, struct track *track);
@@ -885,14 +885,14 @@ void prepare_playlist(struct MPContext *mpctx, struct playlist *pl)
         pl->current = mp_check_playlist_resume(mpctx, pl);
 
     if (!pl->current)
-        pl->current = pl->first;
+        pl->current = playlist_get_first(pl);
 }
 
 // Replace the current playlist entry with playlist contents. Moves the entries
 // from the given playlist pl, so the entries don't actually need to be copied.
 static void transfer_playlist(struct MPContext *mpctx, struct playlist *pl)
 {
-    if (pl->first) {
+    if (pl->num_entries) {
         prepare_playlist(mpctx, pl);
         struct playlist_entry *new = pl->current;
         if (mpctx->playlist->current)
@@ -908,6 +908,163 @@ static void transfer_playlist(struct MPContext *mpctx, struct playlist *pl)
     }
 }
 
+// Reads the rest of a playlist file, whose first entries were already added
+// to the playlist (see demuxer.playlist_incomplete).
+struct playlist_loader {
+    struct MPContext *mpctx;
+    struct demuxer *demuxer;
+    struct mp_abort_entry abort;
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    // --- Protected by lock
+    struct playlist *pending;   // entries read, but not added yet
+    bool done;                  // no more entries will be read
+
+    // --- Owned by the core
+    struct playlist_entry *last; // add new entries after this (reserved)
+    char *redirect;             // added to each entry, or NULL
+    int stream_flags;           // added to each entry
+};
+
+static void *playlist_loader_thread(void *p)
+{
+    struct playlist_loader *l = p;
+
+    mpthread_set_name("playlist");
+
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    bool eof = false;
+    while (!eof) {
+        struct demux_ctrl_read_playlist c = {.pl = pl};
+        int r = demux_control(l->demuxer, DEMUXER_CTRL_READ_PLAYLIST, &c);
+        if (r != CONTROL_OK)
+            break;
+        eof = c.eof;
+
+        pthread_mutex_lock(&l->lock);
+        playlist_append_entries(l->pending, pl);
+        pthread_mutex_unlock(&l->lock);
+        mp_wakeup_core(l->mpctx);
+    }
+    talloc_free(pl);
+
+    pthread_mutex_lock(&l->lock);
+    l->done = true;
+    pthread_mutex_unlock(&l->lock);
+    mp_wakeup_core(l->mpctx);
+    return NULL;
+}
+
+static void free_playlist_loader(struct playlist_loader *l)
+{
+    playlist_entry_unref(l->last);
+    demux_free(l->demuxer);
+    mp_abort_remove(l->mpctx, &l->abort);
+    pthread_mutex_destroy(&l->lock);
+    talloc_free(l);
+}
+
+static void stop_playlist_loader(struct MPContext *mpctx, int index)
+{
+    struct playlist_loader *l = mpctx->playlist_loaders[index];
+    MP_TARRAY_REMOVE_AT(mpctx->playlist_loaders, mpctx->num_playlist_loaders,
+                        index);
+
+    mp_cancel_trigger(l->abort.cancel);
+    pthread_join(l->thread, NULL);
+    free_playlist_loader(l);
+}
+
+static void stop_playlist_loaders(struct MPContext *mpctx)
+{
+    while (mpctx->num_playlist_loaders)
+        stop_playlist_loader(mpctx, mpctx->num_playlist_loaders - 1);
+}
+
+// Take over the demuxer, and add the remaining entries after "last".
+static void start_playlist_loader(struct MPContext *mpctx,
+                                  struct demuxer *demuxer,
+                                  struct playlist_entry *last,
+                                  const char *redirect, int stream_flags)
+{
+    struct playlist_loader *l = talloc_zero(NULL, struct playlist_loader);
+    l->mpctx = mpctx;
+    l->demuxer = demuxer;
+    l->pending = talloc_zero(l, struct playlist);
+    l->last = last;
+    l->last->reserved++;
+    l->redirect = talloc_strdup(l, redirect);
+    l->stream_flags = stream_flags;
+    pthread_mutex_init(&l->lock, NULL);
+
+    // Must not be aborted when playback of the playlist file itself ends, but
+    // on final termination.
+    mp_abort_add(mpctx, &l->abort);
+    mp_cancel_set_parent(demuxer->cancel, l->abort.cancel);
+
+    if (pthread_create(&l->thread, NULL, playlist_loader_thread, l)) {
+        MP_ERR(mpctx, "Could not read the rest of the playlist.\n");
+        free_playlist_loader(l);
+        return;
+    }
+
+    MP_TARRAY_APPEND(mpctx, mpctx->playlist_loaders,
+                     mpctx->num_playlist_loaders, l);
+}
+
+// Add the entries the playlist loaders read since the last call.
+void handle_playlist_loader(struct MPContext *mpctx)
+{
+    for (int i = mpctx->num_playlist_loaders - 1; i >= 0; i--) {
+        struct playlist_loader *l = mpctx->playlist_loaders[i];
+
+        if (l->last->pl != mpctx->playlist) {
+            // Nothing to add the entries to (e.g. the playlist was cleared).
+            MP_VERBOSE(mpctx, "Dropping rest of the playlist file.\n");
+            stop_playlist_loader(mpctx, i);
+            continue;
+        }
+
+        pthread_mutex_lock(&l->lock);
+        struct playlist *pl = l->pending;
+        bool added = pl->num_entries > 0;
+        if (added) {
+            struct playlist_entry *last = playlist_get_last(pl);
+            for (int n = 0; n < pl->num_entries; n++)
+                pl->entries[n]->stream_flags |= l->stream_flags;
+            if (l->redirect)
+                playlist_add_redirect(pl, l->redirect);
+            int at = l->last->pl_index + 1;
+            playlist_transfer_entries_to(mpctx->playlist, at, pl);
+            playlist_entry_unref(l->last);
+            l->last = last;
+            l->last->reserved++;
+        }
+        bool done = l->done;
+        pthread_mutex_unlock(&l->lock);
+
+        if (added)
+            mp_notify(mpctx, MP_EVENT_CHANGE_PLAYLIST, NULL);
+        if (done)
+            stop_playlist_loader(mpctx, i);
+    }
+}
+
+// Whether the current entry is the last one a playlist loader added so far,
+// i.e. the following entries were not read yet.
+bool playlist_loader_pending(struct MPContext *mpctx)
+{
+    struct playlist_entry *cur = mpctx->playlist->current;
+    if (!cur || mpctx->playlist->current_was_replaced)
+        return false;
+    for (int n = 0; n < mpctx->num_playlist_loaders; n++) {
+        if (mpctx->playlist_loaders[n]->last == cur)
+            return true;
+    }
+    return false;
+}
+
 static void process_hooks(struct MPContext *mpctx, char *name)
 {
     mp_hook_start(mpctx, name);
@@ -975,6 +1132,7 @@ static void *open_demux_thread(void *ctx)
         .force_format = mpctx->open_format,
         .stream_flags = mpctx->open_url_flags,
         .stream_record = true,
+        .playlist_incremental = mpctx->open_playlist_incremental,
     };
     mpctx->open_res_demuxer =
         demux_open_url(mpctx->open_url, &p, mpctx->open_cancel, mpctx->global);
@@ -1032,6 +1190,10 @@ static void start_open(struct MPContext *mpctx, char *url, int url_flags)
     mpctx->open_url_flags = url_flags;
     if (mpctx->opts->load_unsafe_playlists)
         mpctx->open_url_flags = 0;
+    // These options need all entries before the first can be played.
+    mpctx->open_playlist_incremental = mpctx->opts->playlist_incremental &&
+        !mpctx->opts->shuffle && !mpctx->opts->merge_files &&
+        mpctx->opts->playlist_pos < 0;
 
     if (pthread_create(&mpctx->open_thread, NULL, open_demux_thread, mpctx)) {
         cancel_open(mpctx);
@@ -1345,6 +1507,7 @@ static void play_current_file(struct MPContext *mpctx)
     assert(mpctx->stop_play);
 
     mp_notify(mpctx, MPV_EVENT_START_FILE, NULL);
+    benchmark_prepare(mpctx);
 
     mp_cancel_reset(mpctx->playback_abort);
 
@@ -1434,16 +1597,28 @@ static void play_current_file(struct MPContext *mpctx)
         goto terminate_playback;
 
     if (mpctx->demuxer->playlist) {
-        struct playlist *pl = mpctx->demuxer->playlist;
+        struct demuxer *demuxer = mpctx->demuxer;
+        struct playlist *pl = demuxer->playlist;
         int entry_stream_flags = 0;
         if (!pl->disable_safety) {
             entry_stream_flags = STREAM_SAFE_ONLY;
-            if (mpctx->demuxer->is_network)
+            if (demuxer->is_network)
                 entry_stream_flags |= STREAM_NETWORK_ONLY;
         }
-        for (struct playlist_entry *e = pl->first; e; e = e->next)
-            e->stream_flags |= entry_stream_flags;
+        bool incomplete = demuxer->playlist_incomplete;
+        for (int n = 0; n < pl->num_entries; n++)
+            pl->entries[n]->stream_flags |= entry_stream_flags;
+        struct playlist_entry *last = playlist_get_last(pl);
+        char *redirect = mpctx->playlist->current
+            ? talloc_strdup(NULL, mpctx->playlist->current->filename) : NULL;
         transfer_playlist(mpctx, pl);
+        if (incomplete && last) {
+            // The loader owns the demuxer now.
+            mpctx->demuxer = NULL;
+            start_playlist_loader(mpctx, demuxer, last, redirect,
+                                  entry_stream_flags);
+        }
+        talloc_free(redirect);
         mp_notify_property(mpctx, "playlist");
         mpctx->error_playing = 2;
         goto terminate_playback;
@@ -1560,6 +1735,7 @@ static void play_current_file(struct MPContext *mpctx)
 
     playback_start = mp_time_sec();
     mpctx->error_playing = 0;
+    benchmark_start(mpctx);
     mpctx->in_playloop = true;
     while (!mpctx->stop_play)
         run_playloop(mpctx);
@@ -1584,6 +1760,8 @@ terminate_playback:
 
     close_recorder(mpctx);
 
+    benchmark_report(mpctx);
+
     // time to uninit all, except global stuff:
     reinit_complex_filters(mpctx, true);
     uninit_audio_chain(mpctx);
@@ -1672,35 +1850,41 @@ terminate_playback:
 struct playlist_entry *mp_next_file(struct MPContext *mpctx, int direction,
                                     bool force, bool mutate)
 {
+    if (direction > 0) {
+        handle_playlist_loader(mpctx);
+        // The next entry is not known yet (see next_file_wait()).
+        if (playlist_loader_pending(mpctx))
+            return NULL;
+    }
+
     struct playlist_entry *next = playlist_get_next(mpctx->playlist, direction);
     if (next && direction < 0 && !force) {
         // Don't jump to files that would immediately go to next file anyway
         while (next && next->playback_short)
-            next = next->prev;
+            next = playlist_entry_get_rel(next, -1);
         // Always allow jumping to first file
         if (!next && mpctx->opts->loop_times == 1)
-            next = mpctx->playlist->first;
+            next = playlist_get_first(mpctx->playlist);
     }
     if (!next && mpctx->opts->loop_times != 1) {
         if (direction > 0) {
             if (mpctx->opts->shuffle)
                 playlist_shuffle(mpctx->playlist);
-            next = mpctx->playlist->first;
+            next = playlist_get_first(mpctx->playlist);
             if (next && mpctx->opts->loop_times > 1)
                 mpctx->opts->loop_times--;
         } else {
-            next = mpctx->playlist->last;
+            next = playlist_get_last(mpctx->playlist);
             // Don't jump to files that would immediately go to next file anyway
             while (next && next->playback_short)
-                next = next->prev;
+                next = playlist_entry_get_rel(next, -1);
         }
         bool ignore_failures = mpctx->opts->loop_times == -2;
         if (!force && next && next->init_failed && !ignore_failures) {
             // Don't endless loop if no file in playlist is playable
             bool all_failed = true;
-            struct playlist_entry *cur;
-            for (cur = mpctx->playlist->first; cur; cur = cur->next) {
-                all_failed &= cur->init_failed;
+            for (int n = 0; n < mpctx->playlist->num_entries; n++) {
+                all_failed &= mpctx->playlist->entries[n]->init_failed;
                 if (!all_failed)
                     break;
             }
@@ -1711,6 +1895,28 @@ struct playlist_entry *mp_next_file(struct MPContext *mpctx, int direction,
     return next;
 }
 
+// Like mp_next_file(mpctx, +1, false, true), but if the entries following the
+// current entry are still being read by a playlist loader, keep running the
+// core until they're available. Returns the entry set by a command if the
+// entry to play was changed meanwhile, and NULL on quit.
+static struct playlist_entry *next_file_wait(struct MPContext *mpctx)
+{
+    struct playlist_entry *cur = mpctx->playlist->current;
+    if (playlist_loader_pending(mpctx))
+        MP_VERBOSE(mpctx, "Waiting for the next playlist entries.\n");
+    while (1) {
+        struct playlist_entry *next = mp_next_file(mpctx, +1, false, true);
+        if (next || !playlist_loader_pending(mpctx))
+            return next;
+        // The playlist loader wakes up the core when it has read something.
+        mp_idle(mpctx);
+        if (mpctx->stop_play == PT_QUIT)
+            return NULL;
+        if (mpctx->playlist->current != cur)
+            return mpctx->playlist->current;
+    }
+}
+
 // Play all entries on the playlist, starting from the current entry.
 // Return if all done.
 void mp_play_files(struct MPContext *mpctx)
@@ -1740,7 +1946,9 @@ void mp_play_files(struct MPContext *mpctx)
         if (mpctx->stop_play == PT_NEXT_ENTRY || mpctx->stop_play == PT_ERROR ||
             mpctx->stop_play == AT_END_OF_FILE || mpctx->stop_play == PT_STOP)
         {
-            new_entry = mp_next_file(mpctx, +1, false, true);
+            new_entry = next_file_wait(mpctx);
+            if (mpctx->stop_play == PT_QUIT)
+                break;
         }
 
         mpctx->playlist->current = new_entry;
@@ -1752,6 +1960,7 @@ void mp_play_files(struct MPContext *mpctx)
     }
 
     cancel_open(mpctx);
+    stop_playlist_loaders(mpctx);
 
     if (mpctx->encode_lavc_ctx) {
         // Make sure all streams get finished.
@@ -1772,6 +1981,7 @@ void mp_set_playlist_entry(struct MPContext *mpctx, struct playlist_entry *e)
     assert(!e || playlist_entry_to_index(mpctx->playlist, e) >= 0);
     mpctx->playlist->current = e;
     mpctx->playlist->current_was_replaced = false;
+    mp_notify(mpctx, MP_EVENT_CHANGE_PLAYLIST, NULL);
     // Make it pick up the new entry.
     if (!mpctx->stop_play)
         mpctx->stop_play = PT_CURRENT_ENTRY;
@@ -16,6 +16,8 @@
  */
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <sys/types.h>
@@ -76,6 +78,19 @@ static const char * const builtin_lua_scripts[][2] = {
     {0}
 };
 
+// Maximum number of property values kept by script_get_property_native().
+#define MAX_CACHED_PROPERTIES 32
+
+// Value of a property that changes only together with a change notification.
+// It is kept between mp.get_property_native() calls, and fetched again only
+// if the core signals a change.
+struct cached_property {
+    char *name;
+    int tracker;            // mp_client_track_property() handle
+    int status;             // result of the last mpv_get_property() call
+    mpv_node node;          // valid if status >= 0
+};
+
 // Represents a loaded script. Each has its own Lua state.
 struct script_ctx {
     const char *name;
@@ -84,6 +99,12 @@ struct script_ctx {
     struct mp_log *log;
     struct mpv_handle *client;
     struct MPContext *mpctx;
+    struct cached_property *cached_props;
+    int num_cached_props;
+    mpv_node scratch_node;  // last uncached mp.get_property_native() value
+    bool own_event_loop;    // script replaced mp_event_loop()
+    bool exited;            // script errored or left its event loop
+    double timeout;         // see dispatch_events()
 };
 
 #if LUA_VERSION_NUM <= 501
@@ -256,17 +277,62 @@ static int load_scripts(lua_State *L)
 
     require(L, "mp.defaults");
 
+    lua_getglobal(L, "mp_event_loop"); // default_fn
+
     if (fname[0] == '@') {
         require(L, fname);
     } else {
         load_file(L, fname);
     }
 
-    lua_getglobal(L, "mp_event_loop"); // fn
+    lua_getglobal(L, "mp_event_loop"); // default_fn fn
+    ctx->own_event_loop = !lua_rawequal(L, -1, -2);
+    lua_pop(L, 2); // -
+
+    return 0;
+}
+
+// Run the script's event loop until the script exits.
+static int run_event_loop(lua_State *L)
+{
+    struct script_ctx *ctx = lua_touserdata(L, -1);
+    lua_pop(L, 1); // -
+
+    lua_pushcfunction(L, error_handler); // errf
+    lua_getglobal(L, "mp_event_loop"); // errf fn
     if (lua_isnil(L, -1))
         luaL_error(L, "no event loop function\n");
-    lua_call(L, 0, 0); // -
+    if (lua_pcall(L, 0, 0, -2)) { // errf [error]
+        const char *e = lua_tostring(L, -1);
+        MP_FATAL(ctx, "Lua error: %s\n", e ? e : "(unknown)");
+    }
+    ctx->exited = true;
+    return 0;
+}
 
+// Handle all pending events and timers without blocking, and set ctx->timeout
+// to the time until the next timer is due.
+static int dispatch_events(lua_State *L)
+{
+    struct script_ctx *ctx = lua_touserdata(L, -1);
+    lua_pop(L, 1); // -
+
+    lua_pushcfunction(L, error_handler); // errf
+    lua_getglobal(L, "mp"); // errf mp
+    lua_getfield(L, -1, "dispatch_events"); // errf mp fn
+    lua_remove(L, -2); // errf fn
+    lua_pushboolean(L, 0); // errf fn false
+    if (lua_pcall(L, 1, 1, -3)) { // errf [error]
+        const char *e = lua_tostring(L, -1);
+        MP_FATAL(ctx, "Lua error: %s\n", e ? e : "(unknown)");
+        ctx->exited = true;
+    } else if (lua_type(L, -1) == LUA_TNUMBER) { // errf timeout
+        ctx->timeout = lua_tonumber(L, -1);
+    } else {
+        // Returns nothing once mp.keep_running was unset.
+        ctx->exited = true;
+    }
+    lua_pop(L, 2); // -
     return 0;
 }
 
@@ -354,15 +420,65 @@ static int run_lua(lua_State *L)
     if (lua_pcall(L, 0, 0, -2)) { // errf [error]
         const char *e = lua_tostring(L, -1);
         MP_FATAL(ctx, "Lua error: %s\n", e ? e : "(unknown)");
+        ctx->exited = true;
     }
+    lua_settop(L, 0); // -
 
     return 0;
 }
 
-static int load_lua(struct mpv_handle *client, const char *fname)
+// Like the default Lua allocator, but with memory accounting.
+static void *lua_alloc_accounted(void *ud, void *ptr, size_t osize,
+                                 size_t nsize)
+{
+    struct ta_account *account = ud;
+    if (!ptr)
+        osize = 0; // Lua 5.2 passes the object type instead
+    if (!nsize) {
+        free(ptr);
+        ta_account_realloc(account, osize, 0);
+        return NULL;
+    }
+    void *res = realloc(ptr, nsize);
+    if (res)
+        ta_account_realloc(account, osize, nsize);
+    return res;
+}
+
+static int lua_panic(lua_State *L)
+{
+    const char *e = lua_tostring(L, -1);
+    fprintf(stderr, "Lua panic: %s\n", e ? e : "(unknown)");
+    return 0; // abort()s
+}
+
+// Log the error left on the stack by a failed mp_cpcall(), and pop it.
+static void report_cpcall_error(struct script_ctx *ctx)
+{
+    lua_State *L = ctx->state;
+    const char *err = "unknown error";
+    if (lua_type(L, -1) == LUA_TSTRING) // avoid allocation
+        err = lua_tostring(L, -1);
+    MP_FATAL(ctx, "Lua error: %s\n", err);
+    lua_pop(L, 1);
+}
+
+static void destroy_lua(struct script_ctx *ctx)
+{
+    if (ctx->state)
+        lua_close(ctx->state);
+    for (int n = 0; n < ctx->num_cached_props; n++)
+        mpv_free_node_contents(&ctx->cached_props[n].node);
+    mpv_free_node_contents(&ctx->scratch_node);
+    talloc_free(ctx);
+}
+
+// Create the Lua state and run the script's top level code (but not its
+// event loop). Returns NULL on failure.
+static struct script_ctx *create_lua(struct mpv_handle *client,
+                                     const char *fname)
 {
     struct MPContext *mpctx = mp_client_get_core(client);
-    int r = -1;
 
     struct script_ctx *ctx = talloc_ptrtype(NULL, ctx);
     *ctx = (struct script_ctx) {
@@ -370,7 +486,7 @@ static int load_lua(struct mpv_handle *client, const char *fname)
         .client = client,
         .name = mpv_client_name(client),
         .log = mp_client_get_log(client),
-        .filename = fname,
+        .filename = talloc_strdup(ctx, fname),
     };
 
     if (LUA_VERSION_NUM != 501 && LUA_VERSION_NUM != 502) {
@@ -378,29 +494,80 @@ static int load_lua(struct mpv_handle *client, const char *fname)
         goto error_out;
     }
 
-    lua_State *L = ctx->state = luaL_newstate();
+    struct ta_account *account = ta_get_account("scripts");
+    lua_State *L = ctx->state = account ?
+        lua_newstate(lua_alloc_accounted, account) : luaL_newstate();
+    if (L && account)
+        lua_atpanic(L, lua_panic);
     if (!L) {
         MP_FATAL(ctx, "Could not initialize Lua.\n");
         goto error_out;
     }
 
     if (mp_cpcall(L, run_lua, ctx)) {
-        const char *err = "unknown error";
-        if (lua_type(L, -1) == LUA_TSTRING) // avoid allocation
-            err = lua_tostring(L, -1);
-        MP_FATAL(ctx, "Lua error: %s\n", err);
+        report_cpcall_error(ctx);
         goto error_out;
     }
 
-    r = 0;
+    return ctx;
 
 error_out:
-    if (ctx->state)
-        lua_close(ctx->state);
-    talloc_free(ctx);
+    destroy_lua(ctx);
+    return NULL;
+}
+
+// Returns -1 if the event loop could not be run at all.
+static int run_lua_event_loop(struct script_ctx *ctx)
+{
+    if (ctx->exited)
+        return 0;
+    if (mp_cpcall(ctx->state, run_event_loop, ctx)) {
+        report_cpcall_error(ctx);
+        return -1;
+    }
+    return 0;
+}
+
+static int load_lua(struct mpv_handle *client, const char *fname)
+{
+    struct script_ctx *ctx = create_lua(client, fname);
+    if (!ctx)
+        return -1;
+    int r = run_lua_event_loop(ctx);
+    destroy_lua(ctx);
     return r;
 }
 
+// mp_scripting.init/run/uninit: run the script on a shared thread.
+
+static void *init_lua(struct mpv_handle *client, const char *fname,
+                      bool *exclusive)
+{
+    struct script_ctx *ctx = create_lua(client, fname);
+    if (ctx)
+        *exclusive = ctx->own_event_loop;
+    return ctx;
+}
+
+static double run_lua_step(void *p)
+{
+    struct script_ctx *ctx = p;
+    if (ctx->own_event_loop) {
+        run_lua_event_loop(ctx);
+        return -1;
+    }
+    if (!ctx->exited && mp_cpcall(ctx->state, dispatch_events, ctx)) {
+        report_cpcall_error(ctx);
+        ctx->exited = true;
+    }
+    return ctx->exited ? -1 : MPMAX(ctx->timeout, 0);
+}
+
+static void uninit_lua(void *p)
+{
+    destroy_lua(p);
+}
+
 static int check_loglevel(lua_State *L, int arg)
 {
     const char *level = luaL_checkstring(L, arg);
@@ -900,19 +1067,55 @@ static void pushnode(lua_State *L, mpv_node *node)
     }
 }
 
+// Return the cache entry for the property, or NULL if it can't be cached.
+static struct cached_property *get_cached_property(struct script_ctx *ctx,
+                                                   const char *name)
+{
+    for (int n = 0; n < ctx->num_cached_props; n++) {
+        if (strcmp(ctx->cached_props[n].name, name) == 0)
+            return &ctx->cached_props[n];
+    }
+    if (ctx->num_cached_props >= MAX_CACHED_PROPERTIES)
+        return NULL;
+    int tracker = mp_client_track_property(ctx->client, name);
+    if (tracker < 0)
+        return NULL;
+    struct cached_property prop = {
+        .name = talloc_strdup(ctx, name),
+        .tracker = tracker,
+    };
+    MP_TARRAY_APPEND(ctx, ctx->cached_props, ctx->num_cached_props, prop);
+    return &ctx->cached_props[ctx->num_cached_props - 1];
+}
+
+// The Lua value is built directly from the node returned by the property
+// getter. The node is owned by script_ctx (and freed on the next call or when
+// the value changes), so no temporary GC'ed object is needed to free it if
+// pushnode() raises a Lua error.
 static int script_get_property_native(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
     const char *name = luaL_checkstring(L, 1);
     mp_lua_optarg(L, 2);
-    void *tmp = mp_lua_PITA(L);
 
-    mpv_node node;
-    int err = mpv_get_property(ctx->client, name, MPV_FORMAT_NODE, &node);
+    mpv_node *node;
+    int err;
+    struct cached_property *prop = get_cached_property(ctx, name);
+    if (prop) {
+        if (mp_client_property_changed(ctx->client, prop->tracker)) {
+            mpv_free_node_contents(&prop->node);
+            prop->status = mpv_get_property(ctx->client, name,
+                                            MPV_FORMAT_NODE, &prop->node);
+        }
+        node = &prop->node;
+        err = prop->status;
+    } else {
+        node = &ctx->scratch_node;
+        mpv_free_node_contents(node);
+        err = mpv_get_property(ctx->client, name, MPV_FORMAT_NODE, node);
+    }
     if (err >= 0) {
-        auto_free_node(tmp, &node);
-        pushnode(L, &node);
-        talloc_free_children(tmp);
+        pushnode(L, node);
         return 1;
     }
     lua_pushvalue(L, 2);
@@ -1331,4 +1534,7 @@ const struct mp_scripting mp_scripting_lua = {
     .name = "lua script",
     .file_ext = "lua",
     .load = load_lua,
+    .init = init_lua,
+    .run = run_lua_step,
+    .uninit = uninit_lua,
 };
@@ -484,7 +484,7 @@ function mp.dispatch_events(allow_wait)
             -- suspended, and the error was handled, but no resume was done.
             mp.resume_all()
             if allow_wait ~= true then
-                return
+                return wait
             end
         end
         local e = mp.wait_event(wait)
@@ -602,12 +602,48 @@ local function filter_stats()
 end
 
 
+-- Allocation counters of the previous call, to compute allocation rates
+local mem_prev = {}
+
+-- Returns an ASS string with memory usage per subsystem
+local function memory_stats()
+    local stats = {}
+    eval_ass_formatting()
+    add_header(stats)
+    append(stats, "", {prefix="Memory:", nl="", indent=""})
+
+    local accounts = mp.get_property_native("memory-accounts")
+    if not accounts then
+        append(stats, "not enabled (set MPV_MEMORY_ACCOUNTING=1)",
+               {prefix_sep="", nl="", indent=""})
+        return table.concat(stats)
+    end
+
+    local now = mp.get_time()
+    local prev = mem_prev
+    mem_prev = {time = now}
+    table.sort(accounts, function(a, b) return a.bytes > b.bytes end)
+    for _, a in ipairs(accounts) do
+        mem_prev[a.name] = a.allocs
+        append(stats, utils.format_bytes_humanized(a.bytes), {prefix=a.name .. ":"})
+        append(stats, format("%d", a.blocks), {prefix="Blocks:", nl="",
+               indent=o.prefix_sep, no_prefix_markup=true})
+        if prev.time and prev[a.name] and now > prev.time then
+            local rate = (a.allocs - prev[a.name]) / (now - prev.time)
+            append(stats, format("%.0f/s", rate), {prefix="Allocations:", nl="",
+                   indent=o.prefix_sep, no_prefix_markup=true})
+        end
+    end
+    return table.concat(stats)
+end
+
+
 -- Current page and <page key>:<page function> mapping
 curr_page = o.key_page_1
 pages = {
     [o.key_page_1] = { f = default_stats, desc = "Default" },
     [o.key_page_2] = { f = vo_stats, desc = "Extended Frame Timings" },
-    --[o.key_page_3] = { f = filter_stats, desc = "Dummy" },
+    [o.key_page_3] = { f = memory_stats, desc = "Memory Usage" },
 }
 
 
@@ -158,6 +158,7 @@ void mp_print_version(struct mp_log *log, int always)
 void mp_destroy(struct MPContext *mpctx)
 {
     mp_shutdown_clients(mpctx);
+    mp_uninit_script_hosts(mpctx);
 
     mp_uninit_ipc(mpctx->ipc_ctx);
     mpctx->ipc_ctx = NULL;
@@ -268,9 +269,14 @@ struct MPContext *mp_create(void)
     if (enable_talloc && strcmp(enable_talloc, "1") == 0)
         talloc_enable_leak_report();
 
+    char *enable_accounting = getenv("MPV_MEMORY_ACCOUNTING");
+    if (enable_accounting && strcmp(enable_accounting, "1") == 0)
+        ta_enable_accounting();
+
     mp_time_init();
 
     struct MPContext *mpctx = talloc(NULL, MPContext);
+    talloc_set_account(mpctx, "player");
     *mpctx = (struct MPContext){
         .last_chapter = -2,
         .term_osd_contents = talloc_strdup(mpctx, ""),
@@ -378,6 +384,8 @@ int mp_initialize(struct MPContext *mpctx, char **options)
     // Run all update handlers.
     mp_option_change_callback(mpctx, NULL, UPDATE_OPTS_MASK);
 
+    benchmark_prepare(mpctx);
+
     if (handle_help_options(mpctx))
         return 1; // help
 
@@ -396,14 +404,14 @@ int mp_initialize(struct MPContext *mpctx, char **options)
         return -1;
     }
 
-    if (!mpctx->playlist->first && !opts->player_idle_mode) {
+    if (!mpctx->playlist->num_entries && !opts->player_idle_mode) {
         // nothing to play
         mp_print_version(mpctx->log, true);
         MP_INFO(mpctx, "%s", mp_help_text);
         return 1;
     }
 
-    MP_STATS(mpctx, "start init");
+    MP_STATS_START(mpctx, "init");
 
 #if HAVE_COCOA
     mpv_handle *ctx = mp_new_client(mpctx->clients, "osx");
@@ -430,7 +438,7 @@ int mp_initialize(struct MPContext *mpctx, char **options)
     if (opts->force_vo == 2 && handle_force_window(mpctx, false) < 0)
         return -1;
 
-    MP_STATS(mpctx, "end init");
+    MP_STATS_END(mpctx, "init");
 
     return 0;
 }
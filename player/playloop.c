@@ -55,14 +55,14 @@ void mp_wait_events(struct MPContext *mpctx)
 {
     bool sleeping = mpctx->sleeptime > 0;
     if (sleeping)
-        MP_STATS(mpctx, "start sleep");
+        MP_STATS_START(mpctx, "sleep");
 
     mp_dispatch_queue_process(mpctx->dispatch, mpctx->sleeptime);
 
     mpctx->sleeptime = INFINITY;
 
     if (sleeping)
-        MP_STATS(mpctx, "end sleep");
+        MP_STATS_END(mpctx, "sleep");
 }
 
 // Set the timeout used when the playloop goes to sleep. This means the
@@ -175,6 +175,12 @@ void set_pause_state(struct MPContext *mpctx, bool user_pause)
             mpctx->time_frame -= get_relative_time(mpctx);
         } else {
             (void)get_relative_time(mpctx); // ignore time that passed during pause
+            // Audio is not in sync after replaying frames from the
+            // --hr-seek-cache, so seek it to the current video position.
+            if (mpctx->frame_cache_resync && !mpctx->step_frames) {
+                queue_seek(mpctx, MPSEEK_ABSOLUTE, get_current_time(mpctx),
+                           MPSEEK_VERY_EXACT, 0);
+            }
         }
     }
 
@@ -204,6 +210,10 @@ void add_step_frame(struct MPContext *mpctx, int dir)
     if (!mpctx->vo_chain)
         return;
     if (dir > 0) {
+        // Unpausing for a step would play audio that is out of sync.
+        if (mpctx->frame_cache_resync &&
+            video_frame_cache_seek(mpctx, get_current_time(mpctx), 1))
+            return;
         mpctx->step_frames += 1;
         set_pause_state(mpctx, false);
     } else if (dir < 0) {
@@ -226,6 +236,7 @@ void reset_playback_state(struct MPContext *mpctx)
     mpctx->hrseek_active = false;
     mpctx->hrseek_lastframe = false;
     mpctx->hrseek_backstep = false;
+    mpctx->frame_cache_resync = false;
     mpctx->current_seek = (struct seek_params){0};
     mpctx->playback_pts = MP_NOPTS_VALUE;
     mpctx->step_frames = 0;
@@ -314,6 +325,12 @@ static void mp_seek(MPContext *mpctx, struct seek_params seek)
         demux_flags = (demux_flags | SEEK_HR) & ~SEEK_FORWARD;
     }
 
+    // Backsteps and short precise seeks can often be served from decoded
+    // frames, without seeking and decoding from the previous keyframe.
+    if (hr_seek && video_frame_cache_seek(mpctx, seek_pts,
+                                          seek.type == MPSEEK_BACKSTEP ? -1 : 0))
+        return;
+
     if (!mpctx->demuxer->seekable)
         demux_flags |= SEEK_CACHED;
 
@@ -1096,6 +1113,7 @@ void run_playloop(struct MPContext *mpctx)
     handle_cursor_autohide(mpctx);
     handle_vo_events(mpctx);
     handle_command_updates(mpctx);
+    handle_playlist_loader(mpctx);
 
     if (mpctx->lavfi && mp_filter_has_failed(mpctx->lavfi))
         mpctx->stop_play = AT_END_OF_FILE;
@@ -1151,6 +1169,7 @@ void mp_idle(struct MPContext *mpctx)
     mp_wait_events(mpctx);
     mp_process_input(mpctx);
     handle_command_updates(mpctx);
+    handle_playlist_loader(mpctx);
     handle_cursor_autohide(mpctx);
     handle_vo_events(mpctx);
     update_osd_msg(mpctx);
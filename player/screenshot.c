@@ -19,6 +19,8 @@
 #include <string.h>
 #include <time.h>
 
+#include <libavutil/cpu.h>
+
 #include "config.h"
 
 #include "osdep/io.h"
@@ -26,12 +28,12 @@
 #include "mpv_talloc.h"
 #include "screenshot.h"
 #include "core.h"
+#include "client.h"
 #include "command.h"
 #include "input/cmd.h"
 #include "misc/bstr.h"
 #include "misc/dispatch.h"
 #include "misc/node.h"
-#include "misc/thread_tools.h"
 #include "common/msg.h"
 #include "options/path.h"
 #include "video/mp_image.h"
@@ -54,8 +56,24 @@ typedef struct screenshot_ctx {
     struct mp_cmd *each_frame;
 
     int frameno;
+
+    // Images are encoded and written on these worker threads.
+    struct image_writer_queue *queue;
+
+    // Filenames of screenshots that were queued, but not written yet.
+    char **pending;
+    int num_pending;
 } screenshot_ctx;
 
+// A screenshot queued on screenshot_ctx.queue.
+struct screenshot_job {
+    struct MPContext *mpctx;
+    struct mp_cmd_ctx *cmd;
+    char *filename;
+    bool osd;
+    bool success;
+};
+
 void screenshot_init(struct MPContext *mpctx)
 {
     mpctx->screenshot_ctx = talloc(mpctx, screenshot_ctx);
@@ -63,6 +81,14 @@ void screenshot_init(struct MPContext *mpctx)
         .mpctx = mpctx,
         .frameno = 1,
     };
+    // Limit the number of pending screenshots, so each-frame mode can't pile
+    // up images faster than they can be written.
+    int threads = MPCLAMP(av_cpu_count(), 1, 16);
+    mpctx->screenshot_ctx->queue =
+        image_writer_queue_create(mpctx->screenshot_ctx, mpctx->log,
+                                  threads, threads * 2);
+    if (!mpctx->screenshot_ctx->queue)
+        MP_WARN(mpctx, "Could not create screenshot threads.\n");
 }
 
 static void screenshot_msg(screenshot_ctx *ctx, int status, const char *msg,
@@ -93,27 +119,77 @@ static char *stripext(void *talloc_ctx, const char *s)
     return talloc_asprintf(talloc_ctx, "%.*s", (int)(end - s), s);
 }
 
-static bool write_screenshot(struct MPContext *mpctx, struct mp_image *img,
-                             const char *filename, struct image_writer_opts *opts)
+// Runs on the core thread, in the order the screenshots were queued.
+static void screenshot_done(void *p)
 {
+    struct screenshot_job *job = p;
+    struct MPContext *mpctx = job->mpctx;
     screenshot_ctx *ctx = mpctx->screenshot_ctx;
-    struct image_writer_opts *gopts = mpctx->opts->screenshot_image_opts;
-    struct image_writer_opts opts_copy = opts ? *opts : *gopts;
 
-    screenshot_msg(ctx, MSGL_V, "Starting screenshot: '%s'", filename);
+    bool old_osd = ctx->osd;
+    ctx->osd = job->osd;
+    if (job->success) {
+        screenshot_msg(ctx, MSGL_INFO, "Screenshot: '%s'", job->filename);
+    } else {
+        screenshot_msg(ctx, MSGL_ERR, "Error writing screenshot!");
+    }
+    ctx->osd = old_osd;
+
+    for (int n = 0; n < ctx->num_pending; n++) {
+        if (ctx->pending[n] == job->filename) {
+            MP_TARRAY_REMOVE_AT(ctx->pending, ctx->num_pending, n);
+            break;
+        }
+    }
+
+    job->cmd->success = job->success;
+    mp_cmd_ctx_complete(job->cmd);
+    talloc_free(job);
+
+    mpctx->outstanding_async -= 1;
+    if (!mpctx->outstanding_async && mp_is_shutting_down(mpctx))
+        mp_wakeup_core(mpctx);
+}
+
+// Called on a worker thread of the image writer queue (or by
+// write_screenshot() if there is no queue).
+static void screenshot_written(void *p, bool success)
+{
+    struct screenshot_job *job = p;
+    job->success = success;
+    mp_dispatch_enqueue(job->mpctx->dispatch, screenshot_done, job);
+}
 
-    mp_core_unlock(mpctx);
+// Queue writing the image, and complete the command once it was written. This
+// takes over the image reference.
+static void write_screenshot(struct mp_cmd_ctx *cmd, struct mp_image *img,
+                             const char *filename, struct image_writer_opts *opts,
+                             bool osd)
+{
+    struct MPContext *mpctx = cmd->mpctx;
+    screenshot_ctx *ctx = mpctx->screenshot_ctx;
 
-    bool ok = img && write_image(img, &opts_copy, filename, mpctx->log);
+    screenshot_msg(ctx, MSGL_V, "Starting screenshot: '%s'", filename);
 
-    mp_core_lock(mpctx);
+    struct screenshot_job *job = talloc_ptrtype(NULL, job);
+    *job = (struct screenshot_job){
+        .mpctx = mpctx,
+        .cmd = cmd,
+        .filename = talloc_strdup(job, filename),
+        .osd = osd,
+    };
+    MP_TARRAY_APPEND(ctx, ctx->pending, ctx->num_pending, job->filename);
 
-    if (ok) {
-        screenshot_msg(ctx, MSGL_INFO, "Screenshot: '%s'", filename);
+    mpctx->outstanding_async += 1; // prevent that core disappears
+    if (ctx->queue) {
+        image_writer_queue_add(ctx->queue, img, opts, filename,
+                               screenshot_written, job);
     } else {
-        screenshot_msg(ctx, MSGL_ERR, "Error writing screenshot!");
+        // No worker threads; write it on the playloop thread instead.
+        bool ok = write_image(img, opts, filename, mpctx->log);
+        talloc_free(img);
+        screenshot_written(job, ok);
     }
-    return ok;
 }
 
 #ifdef _WIN32
@@ -323,7 +399,11 @@ static char *gen_fname(screenshot_ctx *ctx, const char *file_ext)
             mp_mkdirp(full_dir);
         }
 
-        if (!mp_path_exists(fname))
+        bool pending = false;
+        for (int n = 0; n < ctx->num_pending; n++)
+            pending |= strcmp(ctx->pending[n], fname) == 0;
+
+        if (!pending && !mp_path_exists(fname))
             return fname;
 
         if (sequence == prev_sequence) {
@@ -415,15 +495,18 @@ void cmd_screenshot_to_file(void *p)
     if (format)
         opts.format = format;
     bool high_depth = image_writer_high_depth(&opts);
+    cmd->completed = false;
+
     struct mp_image *image = screenshot_get(mpctx, mode, high_depth);
-    ctx->osd = old_osd;
     if (!image) {
         screenshot_msg(ctx, MSGL_ERR, "Taking screenshot failed.");
+        ctx->osd = old_osd;
         cmd->success = false;
+        mp_cmd_ctx_complete(cmd);
         return;
     }
-    cmd->success = write_screenshot(mpctx, image, filename, &opts);
-    talloc_free(image);
+    ctx->osd = old_osd;
+    write_screenshot(cmd, image, filename, &opts, osd);
 }
 
 void cmd_screenshot(void *p)
@@ -437,6 +520,8 @@ void cmd_screenshot(void *p)
 
     screenshot_ctx *ctx = mpctx->screenshot_ctx;
 
+    cmd->completed = false;
+
     if (mode == MODE_SUBTITLES && osd_get_render_subs_in_filter(mpctx->osd))
         mode = 0;
 
@@ -444,6 +529,7 @@ void cmd_screenshot(void *p)
         if (each_frame_toggle) {
             if (ctx->each_frame) {
                 TA_FREEP(&ctx->each_frame);
+                mp_cmd_ctx_complete(cmd);
                 return;
             }
             ctx->each_frame = talloc_steal(ctx, mp_cmd_clone(cmd->cmd));
@@ -464,14 +550,17 @@ void cmd_screenshot(void *p)
 
     if (image) {
         char *filename = gen_fname(ctx, image_writer_file_ext(opts));
-        if (filename)
-            cmd->success = write_screenshot(mpctx, image, filename, NULL);
-        talloc_free(filename);
+        if (filename) {
+            write_screenshot(cmd, image, filename, opts, osd);
+            talloc_free(filename);
+            return;
+        }
     } else {
         screenshot_msg(ctx, MSGL_ERR, "Taking screenshot failed.");
     }
 
     talloc_free(image);
+    mp_cmd_ctx_complete(cmd);
 }
 
 void cmd_screenshot_raw(void *p)
@@ -500,16 +589,6 @@ void cmd_screenshot_raw(void *p)
     talloc_steal(ba, img);
 }
 
-static void screenshot_fin(struct mp_cmd_ctx *cmd)
-{
-    void **a = cmd->on_completion_priv;
-    struct MPContext *mpctx = a[0];
-    struct mp_waiter *waiter = a[1];
-
-    mp_waiter_wakeup(waiter, 0);
-    mp_wakeup_core(mpctx);
-}
-
 void screenshot_flip(struct MPContext *mpctx)
 {
     screenshot_ctx *ctx = mpctx->screenshot_ctx;
@@ -517,14 +596,7 @@ void screenshot_flip(struct MPContext *mpctx)
     if (!ctx->each_frame)
         return;
 
-    struct mp_waiter wait = MP_WAITER_INITIALIZER;
-    void *a[] = {mpctx, &wait};
-    run_command(mpctx, mp_cmd_clone(ctx->each_frame), NULL, screenshot_fin, a);
-
-    // Block (in a reentrant way) until he screenshot was written. Otherwise,
-    // we could pile up screenshot requests forever.
-    while (!mp_waiter_poll(&wait))
-        mp_idle(mpctx);
-
-    mp_waiter_wait(&wait);
+    // This doesn't wait until the screenshot was written. The queue blocks
+    // if too many screenshots are pending, so requests can't pile up forever.
+    run_command(mpctx, mp_cmd_clone(ctx->each_frame), NULL, NULL, NULL);
 }
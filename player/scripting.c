@@ -27,9 +27,11 @@
 
 #include "osdep/io.h"
 #include "osdep/threads.h"
+#include "osdep/timer.h"
 
 #include "common/common.h"
 #include "common/msg.h"
+#include "options/options.h"
 #include "options/path.h"
 #include "misc/bstr.h"
 #include "core.h"
@@ -100,6 +102,222 @@ static void *script_thread(void *p)
     return NULL;
 }
 
+// A thread running the event loops of several scripts (--script-threads).
+// Scripts are run in turn whenever they get a client wakeup or a timer is due,
+// so a broadcast event wakes up one thread per host, instead of one per script.
+struct script_host {
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+
+    // -- protected by lock
+    struct hosted_script **scripts;
+    int num_scripts;
+    bool terminate;
+};
+
+struct hosted_script {
+    struct mp_log *log;
+    struct script_host *host;
+    const struct mp_scripting *backend;
+    mpv_handle *client;
+    const char *fname;
+    // -- only accessed by the host thread
+    void *state;            // NULL until backend->init() was called
+    int64_t next_run;       // mp_time_us() time the next timer is due
+    // -- protected by host->lock
+    bool wakeup;
+};
+
+static void wakeup_hosted_script(void *p)
+{
+    struct hosted_script *s = p;
+    struct script_host *host = s->host;
+    pthread_mutex_lock(&host->lock);
+    s->wakeup = true;
+    pthread_cond_signal(&host->wakeup);
+    pthread_mutex_unlock(&host->lock);
+}
+
+static void destroy_hosted_script(struct hosted_script *s)
+{
+    if (s->state)
+        s->backend->uninit(s->state);
+    mpv_destroy(s->client);
+    talloc_free(s);
+}
+
+// For scripts with their own event loop, which can't share a thread.
+static void *exclusive_script_thread(void *p)
+{
+    pthread_detach(pthread_self());
+
+    struct hosted_script *s = p;
+
+    char name[90];
+    snprintf(name, sizeof(name), "%s (%s)", s->backend->name,
+             mpv_client_name(s->client));
+    mpthread_set_name(name);
+
+    s->backend->run(s->state);
+    destroy_hosted_script(s);
+    return NULL;
+}
+
+// Initialize or run the script. Returns false if it was removed from the host
+// (and destroyed, or moved to a thread of its own).
+static bool run_hosted_script(struct hosted_script *s)
+{
+    if (!s->state) {
+        bool exclusive = false;
+        s->state = s->backend->init(s->client, s->fname, &exclusive);
+        if (!s->state) {
+            MP_ERR(s, "Could not load %s %s\n", s->backend->name, s->fname);
+            destroy_hosted_script(s);
+            return false;
+        }
+        if (exclusive) {
+            MP_VERBOSE(s, "Script has its own event loop, running it on a "
+                       "separate thread.\n");
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, exclusive_script_thread, s))
+                destroy_hosted_script(s);
+            return false;
+        }
+        // Also triggers a wakeup, so pending events are handled.
+        mpv_set_wakeup_callback(s->client, wakeup_hosted_script, s);
+    }
+
+    double timeout = s->backend->run(s->state);
+    if (timeout < 0) {
+        destroy_hosted_script(s);
+        return false;
+    }
+    s->next_run = mp_add_timeout(mp_time_us(), timeout);
+    return true;
+}
+
+static void *script_host_thread(void *p)
+{
+    struct script_host *host = p;
+    mpthread_set_name("script host");
+
+    pthread_mutex_lock(&host->lock);
+    while (1) {
+        int64_t now = mp_time_us();
+        int64_t wait_until = INT64_MAX;
+        bool ran = false;
+        for (int n = 0; n < host->num_scripts; n++) {
+            struct hosted_script *s = host->scripts[n];
+            if (s->state && !s->wakeup && s->next_run > now) {
+                wait_until = MPMIN(wait_until, s->next_run);
+                continue;
+            }
+            s->wakeup = false;
+            // New scripts are only appended, and only this thread removes
+            // them, so n stays valid while unlocked.
+            pthread_mutex_unlock(&host->lock);
+            bool alive = run_hosted_script(s);
+            pthread_mutex_lock(&host->lock);
+            if (!alive) {
+                MP_TARRAY_REMOVE_AT(host->scripts, host->num_scripts, n);
+                n--;
+            }
+            ran = true;
+        }
+        // Scripts could have been woken up while others were running.
+        if (ran)
+            continue;
+        if (host->terminate)
+            break;
+        if (wait_until == INT64_MAX) {
+            pthread_cond_wait(&host->wakeup, &host->lock);
+        } else {
+            struct timespec ts = mp_time_us_to_timespec(wait_until);
+            pthread_cond_timedwait(&host->wakeup, &host->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&host->lock);
+
+    return NULL;
+}
+
+// Return the least busy host, creating new ones up to --script-threads.
+static struct script_host *get_script_host(struct MPContext *mpctx)
+{
+    struct script_host *best = NULL;
+    int best_num = INT_MAX;
+    for (int n = 0; n < mpctx->num_script_hosts; n++) {
+        struct script_host *host = mpctx->script_hosts[n];
+        pthread_mutex_lock(&host->lock);
+        int num = host->num_scripts;
+        pthread_mutex_unlock(&host->lock);
+        if (num < best_num) {
+            best = host;
+            best_num = num;
+        }
+    }
+    if (best && (best_num == 0 ||
+                 mpctx->num_script_hosts >= mpctx->opts->script_threads))
+        return best;
+
+    struct script_host *host = talloc_zero(NULL, struct script_host);
+    pthread_mutex_init(&host->lock, NULL);
+    pthread_cond_init(&host->wakeup, NULL);
+    if (pthread_create(&host->thread, NULL, script_host_thread, host)) {
+        pthread_cond_destroy(&host->wakeup);
+        pthread_mutex_destroy(&host->lock);
+        talloc_free(host);
+        return best;
+    }
+    MP_TARRAY_APPEND(mpctx, mpctx->script_hosts, mpctx->num_script_hosts, host);
+    return host;
+}
+
+// Called after all clients were destroyed, so the hosts have no scripts left.
+void mp_uninit_script_hosts(struct MPContext *mpctx)
+{
+    for (int n = 0; n < mpctx->num_script_hosts; n++) {
+        struct script_host *host = mpctx->script_hosts[n];
+        pthread_mutex_lock(&host->lock);
+        host->terminate = true;
+        pthread_cond_signal(&host->wakeup);
+        pthread_mutex_unlock(&host->lock);
+        pthread_join(host->thread, NULL);
+        assert(!host->num_scripts);
+        pthread_cond_destroy(&host->wakeup);
+        pthread_mutex_destroy(&host->lock);
+        talloc_free(host);
+    }
+    TA_FREEP(&mpctx->script_hosts);
+    mpctx->num_script_hosts = 0;
+}
+
+static int host_script(struct MPContext *mpctx,
+                       const struct mp_scripting *backend, mpv_handle *client,
+                       const char *fname)
+{
+    struct script_host *host = get_script_host(mpctx);
+    if (!host)
+        return -1;
+
+    struct hosted_script *s = talloc_ptrtype(NULL, s);
+    *s = (struct hosted_script){
+        .log = mp_client_get_log(client),
+        .host = host,
+        .backend = backend,
+        .client = client,
+        .fname = talloc_strdup(s, fname),
+    };
+
+    pthread_mutex_lock(&host->lock);
+    MP_TARRAY_APPEND(host, host->scripts, host->num_scripts, s);
+    pthread_cond_signal(&host->wakeup);
+    pthread_mutex_unlock(&host->lock);
+    return 0;
+}
+
 static int mp_load_script(struct MPContext *mpctx, const char *fname)
 {
     char *ext = mp_splitext(fname, NULL);
@@ -131,11 +349,20 @@ static int mp_load_script(struct MPContext *mpctx, const char *fname)
         talloc_free(arg);
         return -1;
     }
+    talloc_set_account(arg->client, "scripts");
     mp_client_set_weak(arg->client);
     arg->log = mp_client_get_log(arg->client);
 
     MP_DBG(arg, "Loading %s %s...\n", backend->name, fname);
 
+    if (mpctx->opts->script_threads > 0 && backend->init) {
+        int r = host_script(mpctx, backend, arg->client, fname);
+        if (r < 0)
+            mpv_destroy(arg->client);
+        talloc_free(arg);
+        return r;
+    }
+
     pthread_t thread;
     if (pthread_create(&thread, NULL, script_thread, arg)) {
         mpv_destroy(arg->client);
@@ -0,0 +1,413 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include <libavutil/cpu.h>
+
+#include "mpv_talloc.h"
+
+#include "storyboard.h"
+#include "command.h"
+#include "core.h"
+
+#include "common/msg.h"
+#include "demux/demux.h"
+#include "demux/stheader.h"
+#include "filters/f_decoder_wrapper.h"
+#include "filters/filter.h"
+#include "input/cmd.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "misc/thread_pool.h"
+#include "misc/thread_tools.h"
+#include "options/path.h"
+#include "osdep/atomic.h"
+#include "video/image_writer.h"
+#include "video/mp_image.h"
+#include "video/sws_utils.h"
+
+// Thumbnails are taken from the first keyframe at or after each multiple of
+// the interval. If the file is seekable, each thumbnail is a seek plus the
+// decoding of a single keyframe, and the thumbnails are distributed over
+// several threads, each with its own demuxer and decoder. Otherwise, the file
+// is read linearly, but only keyframes are decoded.
+
+#define MAX_THREADS 16
+
+struct sb_tile {
+    double time;                // target time (relative to file start)
+    double pts;                 // actual keyframe time (relative)
+    struct mp_image *img;       // scaled thumbnail, or NULL if failed
+};
+
+struct storyboard {
+    struct mpv_global *global;
+    struct mp_log *log;
+    struct mp_cancel *cancel;
+    const char *url;
+    double interval;
+    int tile_w, tile_h;         // tile_h is determined by the first frame
+
+    struct sb_tile *tiles;
+    int num_tiles;
+    atomic_int next_tile;       // seek mode: next tile to be done by a thread
+};
+
+// One demuxer and decoder instance.
+struct sb_source {
+    struct storyboard *sb;
+    struct demuxer *demuxer;
+    struct mp_filter *root;
+    struct mp_decoder_wrapper *dec;
+    struct mp_sws_context *sws;
+};
+
+static void destroy_source(void *ptr)
+{
+    struct sb_source *src = ptr;
+    talloc_free(src->root);
+    demux_free(src->demuxer);
+}
+
+static struct sb_source *open_source(struct storyboard *sb)
+{
+    struct sb_source *src = talloc_zero(NULL, struct sb_source);
+    talloc_set_destructor(src, destroy_source);
+    src->sb = sb;
+
+    struct demuxer_params params = {0};
+    src->demuxer = demux_open_url(sb->url, &params, sb->cancel, sb->global);
+    if (!src->demuxer)
+        goto error;
+
+    struct sh_stream *sh = NULL;
+    for (int n = 0; n < demux_get_num_stream(src->demuxer); n++) {
+        struct sh_stream *s = demux_get_stream(src->demuxer, n);
+        if (s->type == STREAM_VIDEO && !s->attached_picture) {
+            sh = s;
+            break;
+        }
+    }
+    if (!sh) {
+        MP_ERR(sb, "No video stream in '%s'.\n", sb->url);
+        goto error;
+    }
+    demuxer_select_track(src->demuxer, sh, MP_NOPTS_VALUE, true);
+
+    src->root = mp_filter_create_root(sb->global);
+    src->dec = mp_decoder_wrapper_create(src->root, sh);
+    if (!src->dec || !mp_decoder_wrapper_reinit(src->dec))
+        goto error;
+    src->dec->keyframes_only = true;
+    mp_pin_set_manual_connection(src->dec->f->pins[0], true);
+
+    src->sws = mp_sws_alloc(src);
+    src->sws->log = sb->log;
+    mp_sws_set_from_cmdline(src->sws, sb->global);
+
+    return src;
+
+error:
+    talloc_free(src);
+    return NULL;
+}
+
+// Return the next decoded frame, or NULL on EOF, errors, or abort.
+static struct mp_image *decode_frame(struct sb_source *src)
+{
+    struct mp_pin *out = src->dec->f->pins[0];
+    while (!mp_cancel_test(src->sb->cancel)) {
+        struct mp_frame frame = mp_pin_out_read(out);
+        if (frame.type == MP_FRAME_VIDEO)
+            return frame.data;
+        bool eof = frame.type == MP_FRAME_EOF;
+        mp_frame_unref(&frame);
+        if (eof || mp_filter_has_failed(src->dec->f))
+            break;
+        mp_pin_out_request_data(out);
+        // The demuxer has no thread, so this blocks until there is output.
+        mp_filter_run(src->root);
+        if (!mp_pin_out_has_data(out))
+            break;
+    }
+    return NULL;
+}
+
+static struct mp_image *scale_tile(struct sb_source *src, struct mp_image *img)
+{
+    struct storyboard *sb = src->sb;
+    struct mp_image *tile = mp_image_alloc(IMGFMT_RGB24, sb->tile_w, sb->tile_h);
+    if (tile && mp_sws_scale(src->sws, tile, img) < 0)
+        TA_FREEP(&tile);
+    return tile;
+}
+
+static void set_tile(struct sb_source *src, struct sb_tile *tile,
+                     struct mp_image *img)
+{
+    tile->pts = img->pts - src->demuxer->start_time;
+    tile->img = scale_tile(src, img);
+}
+
+static struct mp_image *seek_decode(struct sb_source *src, double pts,
+                                    int flags)
+{
+    mp_filter_reset(src->root);
+    if (!demux_seek(src->demuxer, pts, flags))
+        return NULL;
+    return decode_frame(src);
+}
+
+// Seek mode: do tiles until all are taken. Runs on multiple threads.
+static void seek_worker(void *ptr)
+{
+    struct sb_source *src = ptr;
+    struct storyboard *sb = src->sb;
+
+    while (!mp_cancel_test(sb->cancel)) {
+        int n = atomic_fetch_add(&sb->next_tile, 1);
+        if (n >= sb->num_tiles)
+            break;
+        struct sb_tile *tile = &sb->tiles[n];
+        double pts = src->demuxer->start_time + tile->time;
+
+        struct mp_image *img = seek_decode(src, pts, SEEK_FORWARD);
+        // Near the end there may be no keyframe after the target.
+        if (!img)
+            img = seek_decode(src, pts, 0);
+        if (img) {
+            set_tile(src, tile, img);
+        } else {
+            MP_WARN(sb, "No keyframe found for %f.\n", tile->time);
+        }
+        talloc_free(img);
+    }
+}
+
+static void open_and_seek_worker(void *ptr)
+{
+    struct storyboard *sb = ptr;
+    struct sb_source *src = open_source(sb);
+    if (src)
+        seek_worker(src);
+    talloc_free(src);
+}
+
+static void run_seek_mode(struct storyboard *sb, struct sb_source *src,
+                          struct mp_image *first)
+{
+    double duration = src->demuxer->duration;
+    sb->num_tiles = MPMAX(1, (int)ceil(duration / sb->interval));
+    sb->tiles = talloc_zero_array(sb, struct sb_tile, sb->num_tiles);
+    for (int n = 0; n < sb->num_tiles; n++)
+        sb->tiles[n].time = n * sb->interval;
+
+    // The first frame is always a keyframe.
+    set_tile(src, &sb->tiles[0], first);
+    atomic_store(&sb->next_tile, 1);
+
+    // Each thread needs its own demuxer. Opening network streams multiple
+    // times isn't worth it.
+    int threads = src->demuxer->is_network ? 1 : av_cpu_count();
+    threads = MPCLAMP(threads, 1, MPMIN(sb->num_tiles, MAX_THREADS));
+    MP_VERBOSE(sb, "Seek mode, %d thumbnails, %d threads.\n", sb->num_tiles,
+               threads);
+
+    struct mp_thread_pool *pool = NULL;
+    if (threads > 1)
+        pool = mp_thread_pool_create(NULL, 0, 0, threads - 1);
+    for (int n = 0; pool && n < threads - 1; n++) {
+        if (!mp_thread_pool_queue(pool, open_and_seek_worker, sb))
+            break;
+    }
+    seek_worker(src);
+    talloc_free(pool);
+}
+
+static void add_tile(struct storyboard *sb, double time, double pts,
+                     struct mp_image *img)
+{
+    struct sb_tile tile = {
+        .time = time,
+        .pts = pts,
+        .img = img ? mp_image_new_ref(img) : NULL,
+    };
+    MP_TARRAY_APPEND(sb, sb->tiles, sb->num_tiles, tile);
+}
+
+// Linear mode: decode all keyframes in order, and assign each to the
+// intervals starting at or before it.
+static void run_linear_mode(struct storyboard *sb, struct sb_source *src,
+                            struct mp_image *first)
+{
+    MP_VERBOSE(sb, "Linear mode.\n");
+
+    struct mp_image *img = first;
+    double next = 0;
+    while (img) {
+        double pts = img->pts - src->demuxer->start_time;
+        if (img->pts == MP_NOPTS_VALUE)
+            pts = next; // make sure every frame is used
+        if (pts >= next) {
+            struct mp_image *tile = scale_tile(src, img);
+            while (next <= pts) {
+                add_tile(sb, next, pts, tile);
+                next += sb->interval;
+            }
+            talloc_free(tile);
+        }
+        if (img != first)
+            talloc_free(img);
+        img = decode_frame(src);
+    }
+}
+
+// Write all tiles into a single image, and the index to the result node.
+static struct mp_image *compose(struct storyboard *sb, int columns,
+                                struct mpv_node *res)
+{
+    int count = 0;
+    for (int n = 0; n < sb->num_tiles; n++)
+        count += !!sb->tiles[n].img;
+    if (!count)
+        return NULL;
+
+    columns = MPMIN(columns, count);
+    int rows = (count + columns - 1) / columns;
+    struct mp_image *sheet = mp_image_alloc(IMGFMT_RGB24, columns * sb->tile_w,
+                                            rows * sb->tile_h);
+    if (!sheet)
+        return NULL;
+    mp_image_clear(sheet, 0, 0, sheet->w, sheet->h);
+
+    node_init(res, MPV_FORMAT_NODE_MAP, NULL);
+    node_map_add_int64(res, "width", sb->tile_w);
+    node_map_add_int64(res, "height", sb->tile_h);
+    node_map_add_int64(res, "columns", columns);
+    node_map_add_int64(res, "rows", rows);
+    node_map_add_double(res, "interval", sb->interval);
+    struct mpv_node *list = node_map_add(res, "thumbnails", MPV_FORMAT_NODE_ARRAY);
+
+    int i = 0;
+    for (int n = 0; n < sb->num_tiles; n++) {
+        struct sb_tile *tile = &sb->tiles[n];
+        if (!tile->img)
+            continue;
+        int x = (i % columns) * sb->tile_w;
+        int y = (i / columns) * sb->tile_h;
+        struct mp_image area = *sheet;
+        mp_image_crop(&area, x, y, x + sb->tile_w, y + sb->tile_h);
+        mp_image_copy(&area, tile->img);
+
+        struct mpv_node *e = node_array_add(list, MPV_FORMAT_NODE_MAP);
+        node_map_add_double(e, "time", tile->time);
+        node_map_add_double(e, "pts", tile->pts);
+        node_map_add_int64(e, "x", x);
+        node_map_add_int64(e, "y", y);
+        i++;
+    }
+
+    return sheet;
+}
+
+static bool write_index(struct storyboard *sb, struct mpv_node *index,
+                        const char *filename)
+{
+    char *s = talloc_strdup(NULL, "");
+    bool ok = json_write_pretty(&s, index) >= 0;
+    FILE *f = ok ? fopen(filename, "wb") : NULL;
+    ok = f && fwrite(s, strlen(s), 1, f) == 1;
+    if (f)
+        ok &= fclose(f) == 0;
+    if (!ok)
+        MP_ERR(sb, "Error writing '%s'.\n", filename);
+    talloc_free(s);
+    return ok;
+}
+
+void cmd_storyboard(void *p)
+{
+    struct mp_cmd_ctx *cmd = p;
+    struct MPContext *mpctx = cmd->mpctx;
+    const char *filename = cmd->args[1].v.s;
+    int columns = cmd->args[4].v.i;
+
+    void *tmp = talloc_new(NULL);
+    struct storyboard *sb = talloc_zero(tmp, struct storyboard);
+    *sb = (struct storyboard){
+        .global = mpctx->global,
+        .log = mp_log_new(sb, mpctx->log, "storyboard"),
+        .cancel = cmd->abort->cancel,
+        .url = talloc_strdup(sb, cmd->args[0].v.s),
+        .interval = cmd->args[2].v.d,
+        .tile_w = cmd->args[3].v.i,
+    };
+
+    struct image_writer_opts opts = *mpctx->opts->screenshot_image_opts;
+    int format = image_writer_format_from_ext(mp_splitext(filename, NULL));
+    if (format)
+        opts.format = format;
+    bstr root = bstr0(filename);
+    mp_splitext(filename, &root);
+    char *index_file = talloc_asprintf(tmp, "%.*s.json", BSTR_P(root));
+
+    mp_core_unlock(mpctx);
+
+    struct mp_image *sheet = NULL;
+    struct mpv_node index = {0};
+
+    // The first frame determines the tile size.
+    struct sb_source *src = open_source(sb);
+    struct mp_image *first = src ? decode_frame(src) : NULL;
+    if (first) {
+        int d_w, d_h;
+        mp_image_params_get_dsize(&first->params, &d_w, &d_h);
+        sb->tile_h = MPMAX(1, lrint(sb->tile_w * (double)d_h / MPMAX(d_w, 1)));
+
+        if (src->demuxer->seekable && src->demuxer->duration > 0) {
+            run_seek_mode(sb, src, first);
+        } else {
+            run_linear_mode(sb, src, first);
+        }
+        talloc_free(first);
+        sheet = compose(sb, columns, &index);
+    }
+    talloc_free(src);
+
+    bool ok = sheet && !mp_cancel_test(sb->cancel) &&
+              write_image(sheet, &opts, filename, sb->log) &&
+              write_index(sb, &index, index_file);
+
+    mp_core_lock(mpctx);
+
+    if (ok) {
+        MP_INFO(mpctx, "Storyboard: '%s' (%d thumbnails)\n", filename,
+                node_map_get(&index, "thumbnails")->u.list->num);
+        cmd->result = index;
+    } else {
+        MP_ERR(mpctx, "Creating storyboard failed.\n");
+        mpv_free_node_contents(&index);
+        cmd->success = false;
+    }
+
+    for (int n = 0; n < sb->num_tiles; n++)
+        talloc_free(sb->tiles[n].img);
+    talloc_free(sheet);
+    talloc_free(tmp);
+}
@@ -21,6 +21,8 @@
 #include <math.h>
 #include <assert.h>
 
+#include <libavutil/buffer.h>
+
 #include "config.h"
 #include "mpv_talloc.h"
 
@@ -93,7 +95,72 @@ static void vo_chain_reset_state(struct vo_chain *vo_c)
     vo_seek_reset(vo_c->vo);
 }
 
-void reset_video_state(struct MPContext *mpctx)
+static void frame_cache_clear(struct MPContext *mpctx)
+{
+    for (int n = 0; n < mpctx->num_frame_cache; n++)
+        talloc_free(mpctx->frame_cache[n]);
+    mpctx->num_frame_cache = 0;
+    mpctx->frame_cache_pos = 0;
+    mpctx->frame_cache_size = 0;
+}
+
+static int64_t frame_cache_image_size(struct mp_image *img)
+{
+    int64_t size = 0;
+    for (int n = 0; n < MP_MAX_PLANES && img->bufs[n]; n++)
+        size += img->bufs[n]->size;
+    return size;
+}
+
+// Append a new frame read from the filters. The cache is only useful if it
+// contains a gapless sequence of frames, so it's restarted on discontinuities.
+static void frame_cache_add(struct MPContext *mpctx, struct mp_image *img)
+{
+    struct vo_chain *vo_c = mpctx->vo_chain;
+    int64_t max_size = mpctx->opts->hr_seek_cache;
+
+    if (!max_size || vo_c->is_coverart || vo_c->is_sparse || !img->bufs[0] ||
+        (img->fmt.flags & MP_IMGFLAG_HWACCEL) || img->pts == MP_NOPTS_VALUE)
+    {
+        frame_cache_clear(mpctx);
+        return;
+    }
+
+    assert(mpctx->frame_cache_pos == mpctx->num_frame_cache);
+
+    int dropped = vo_c->track && vo_c->track->dec ?
+                  vo_c->track->dec->dropped_frames : 0;
+    if (mpctx->num_frame_cache) {
+        struct mp_image *last = mpctx->frame_cache[mpctx->num_frame_cache - 1];
+        if (img->pts <= last->pts || dropped != mpctx->frame_cache_dropped)
+            frame_cache_clear(mpctx);
+    }
+    mpctx->frame_cache_dropped = dropped;
+
+    struct mp_image *ref = mp_image_new_ref(img);
+    if (!ref)
+        return;
+    MP_TARRAY_APPEND(mpctx, mpctx->frame_cache, mpctx->num_frame_cache, ref);
+    mpctx->frame_cache_size += frame_cache_image_size(ref);
+
+    while (mpctx->frame_cache_size > max_size && mpctx->num_frame_cache > 1) {
+        struct mp_image *old = mpctx->frame_cache[0];
+        mpctx->frame_cache_size -= frame_cache_image_size(old);
+        talloc_free(old);
+        MP_TARRAY_REMOVE_AT(mpctx->frame_cache, mpctx->num_frame_cache, 0);
+    }
+    mpctx->frame_cache_pos = mpctx->num_frame_cache;
+}
+
+// Return the next frame to replay, or NULL if new frames have to be read.
+static struct mp_image *frame_cache_read(struct MPContext *mpctx)
+{
+    if (mpctx->frame_cache_pos >= mpctx->num_frame_cache)
+        return NULL;
+    return mp_image_new_ref(mpctx->frame_cache[mpctx->frame_cache_pos++]);
+}
+
+static void reset_video_frames(struct MPContext *mpctx)
 {
     if (mpctx->vo_chain)
         vo_chain_reset_state(mpctx->vo_chain);
@@ -118,6 +185,79 @@ void reset_video_state(struct MPContext *mpctx)
     mpctx->video_status = mpctx->vo_chain ? STATUS_SYNCING : STATUS_EOF;
 }
 
+void reset_video_state(struct MPContext *mpctx)
+{
+    reset_video_frames(mpctx);
+    frame_cache_clear(mpctx);
+}
+
+// Try to seek by replaying frames from the --hr-seek-cache. dir selects the
+// frame: 0 for the first frame at pts (like a hr-seek), -1 for the frame
+// before pts (like a backstep), 1 for the frame after pts.
+// Returns false if the target is not cached; then a normal seek is needed.
+bool video_frame_cache_seek(struct MPContext *mpctx, double pts, int dir)
+{
+    int num = mpctx->num_frame_cache;
+    if (!num || pts == MP_NOPTS_VALUE)
+        return false;
+
+    // The audio decoder keeps running ahead of the replayed video, so with
+    // audio this is only used while paused, and resuming seeks again.
+    bool audio = mpctx->ao_chain && mpctx->audio_status != STATUS_EOF;
+    if (audio && !mpctx->paused)
+        return false;
+
+    struct mp_image **frames = mpctx->frame_cache;
+    int index = -1;
+    if (dir < 0) {
+        for (int n = 0; n < num - 1; n++) {
+            if (frames[n]->pts < pts - .005 && frames[n + 1]->pts >= pts - .005)
+                index = n;
+        }
+    } else if (dir > 0) {
+        for (int n = 1; n < num; n++) {
+            if (frames[n - 1]->pts <= pts + .005 && frames[n]->pts > pts + .005)
+                index = n;
+        }
+    } else if (frames[0]->pts <= pts + .005) {
+        for (int n = 0; n < num; n++) {
+            if (frames[n]->pts >= pts - .005) {
+                index = n;
+                break;
+            }
+        }
+    }
+    if (index < 0)
+        return false;
+
+    MP_VERBOSE(mpctx, "seeking to %f from frame cache (%d/%d frames)\n",
+               frames[index]->pts, index, num);
+
+    reset_video_frames(mpctx);
+    mpctx->frame_cache_pos = index;
+    mpctx->frame_cache_resync |= audio;
+
+    mpctx->hrseek_active = false;
+    mpctx->hrseek_lastframe = false;
+    mpctx->hrseek_backstep = false;
+    mpctx->current_seek = (struct seek_params){0};
+    mpctx->playback_pts = MP_NOPTS_VALUE;
+    mpctx->last_seek_pts = frames[index]->pts;
+    mpctx->step_frames = 0;
+    mpctx->restart_complete = false;
+    mpctx->ab_loop_clip = mpctx->last_seek_pts < mpctx->opts->ab_loop[1];
+
+    if (mpctx->stop_play == AT_END_OF_FILE)
+        mpctx->stop_play = KEEP_PLAYING;
+
+    mpctx->start_timestamp = mp_time_sec();
+    mp_wakeup_core(mpctx);
+
+    mp_notify(mpctx, MPV_EVENT_SEEK, NULL);
+    mp_notify(mpctx, MPV_EVENT_TICK, NULL);
+    return true;
+}
+
 void uninit_video_out(struct MPContext *mpctx)
 {
     uninit_video_chain(mpctx);
@@ -296,6 +436,9 @@ void mp_force_video_refresh(struct MPContext *mpctx)
     if (!vo_c)
         return;
 
+    // Cached frames were filtered with the old settings.
+    frame_cache_clear(mpctx);
+
     // If not paused, the next frame should come soon enough.
     if (opts->pause || mpctx->time_frame >= 0.5 ||
         mpctx->video_status == STATUS_EOF)
@@ -398,6 +541,14 @@ static void shift_frames(struct MPContext *mpctx)
     mpctx->num_next_frames -= 1;
 }
 
+// Output frames as soon as they are available, without waiting for their
+// display time.
+static bool video_untimed(struct MPContext *mpctx)
+{
+    return mpctx->opts->untimed || mpctx->video_out->driver->untimed ||
+           mpctx->benchmark;
+}
+
 static int get_req_frames(struct MPContext *mpctx, bool eof)
 {
     // On EOF, drain all frames.
@@ -410,7 +561,7 @@ static int get_req_frames(struct MPContext *mpctx, bool eof)
     if (mpctx->vo_chain && mpctx->vo_chain->is_sparse)
         return 1;
 
-    if (mpctx->opts->untimed || mpctx->video_out->driver->untimed)
+    if (video_untimed(mpctx))
         return 1;
 
     int min = mpctx->opts->video_latency_hacks ? 1 : 2;
@@ -467,9 +618,14 @@ static int video_output_image(struct MPContext *mpctx)
     int r = VD_PROGRESS;
     if (needs_new_frame(mpctx)) {
         // Filter a new frame.
-        struct mp_image *img = NULL;
-        struct mp_frame frame = mp_pin_out_read(vo_c->filter->f->pins[1]);
-        if (frame.type == MP_FRAME_NONE) {
+        struct mp_image *img = frame_cache_read(mpctx);
+        bool from_cache = !!img;
+        struct mp_frame frame = MP_NO_FRAME;
+        if (!from_cache)
+            frame = mp_pin_out_read(vo_c->filter->f->pins[1]);
+        if (from_cache) {
+            // replaying
+        } else if (frame.type == MP_FRAME_NONE) {
             r = vo_c->filter->got_output_eof ? VD_EOF : VD_WAIT;
         } else if (frame.type == MP_FRAME_EOF) {
             r = VD_EOF;
@@ -483,10 +639,17 @@ static int video_output_image(struct MPContext *mpctx)
         }
         if (img) {
             double endpts = get_play_end_pts(mpctx);
-            if ((endpts != MP_NOPTS_VALUE && img->pts >= endpts) ||
-                mpctx->max_frames == 0)
-            {
-                mp_pin_out_unread(vo_c->filter->f->pins[1], frame);
+            bool at_end = (endpts != MP_NOPTS_VALUE && img->pts >= endpts) ||
+                          mpctx->max_frames == 0;
+            if (!at_end && !from_cache)
+                frame_cache_add(mpctx, img);
+            if (at_end) {
+                if (from_cache) {
+                    mpctx->frame_cache_pos -= 1;
+                    talloc_free(img);
+                } else {
+                    mp_pin_out_unread(vo_c->filter->f->pins[1], frame);
+                }
                 img = NULL;
                 r = VD_EOF;
             } else if (hrseek && mpctx->hrseek_lastframe) {
@@ -548,7 +711,6 @@ static bool check_for_hwdec_fallback(struct MPContext *mpctx)
 static void update_avsync_before_frame(struct MPContext *mpctx)
 {
     struct MPOpts *opts = mpctx->opts;
-    struct vo *vo = mpctx->video_out;
 
     if (mpctx->vo_chain->is_coverart || mpctx->video_status < STATUS_READY) {
         mpctx->time_frame = 0;
@@ -563,7 +725,7 @@ static void update_avsync_before_frame(struct MPContext *mpctx)
         double predicted = mpctx->delay / mpctx->video_speed +
                            mpctx->time_frame;
         double difference = buffered_audio - predicted;
-        MP_STATS(mpctx, "value %f audio-diff", difference);
+        MP_STATS_VALUE(mpctx, "audio-diff", difference);
 
         if (opts->autosync) {
             /* Smooth reported playback position from AO by averaging
@@ -585,7 +747,7 @@ static void update_avsync_before_frame(struct MPContext *mpctx)
          * If untimed is set always output frames immediately
          * without sleeping.
          */
-        if (mpctx->time_frame < -0.2 || opts->untimed || vo->driver->untimed)
+        if (mpctx->time_frame < -0.2 || video_untimed(mpctx))
             mpctx->time_frame = 0;
     }
 }
@@ -823,7 +985,7 @@ static void handle_display_sync_frame(struct MPContext *mpctx,
             mpctx->display_sync_error, mpctx->display_sync_error / vsync,
             mpctx->display_sync_error / frame_duration);
 
-    MP_STATS(mpctx, "value %f avdiff", av_diff);
+    MP_STATS_VALUE(mpctx, "avdiff", av_diff);
 
     // Intended number of additional display frames to drop (<0) or repeat (>0)
     int drop_repeat = 0;
@@ -862,7 +1024,7 @@ static void handle_display_sync_frame(struct MPContext *mpctx,
 
     if (drop_repeat) {
         mpctx->mistimed_frames_total += 1;
-        MP_STATS(mpctx, "mistimed");
+        MP_STATS_SIGNAL(mpctx, "mistimed");
     }
 
     mpctx->total_avsync_change = 0;
@@ -889,8 +1051,8 @@ static void handle_display_sync_frame(struct MPContext *mpctx,
     mpctx->display_sync_active = true;
     update_playback_speed(mpctx);
 
-    MP_STATS(mpctx, "value %f aspeed", mpctx->speed_factor_a - 1);
-    MP_STATS(mpctx, "value %f vspeed", mpctx->speed_factor_v - 1);
+    MP_STATS_VALUE(mpctx, "aspeed", mpctx->speed_factor_a - 1);
+    MP_STATS_VALUE(mpctx, "vspeed", mpctx->speed_factor_v - 1);
 }
 
 static void schedule_frame(struct MPContext *mpctx, struct vo_frame *frame)
@@ -965,8 +1127,8 @@ static void calculate_frame_duration(struct MPContext *mpctx)
     mpctx->past_frames[0].duration = duration;
     mpctx->past_frames[0].approx_duration = approx_duration;
 
-    MP_STATS(mpctx, "value %f frame-duration", MPMAX(0, duration));
-    MP_STATS(mpctx, "value %f frame-duration-approx", MPMAX(0, approx_duration));
+    MP_STATS_VALUE(mpctx, "frame-duration", MPMAX(0, duration));
+    MP_STATS_VALUE(mpctx, "frame-duration-approx", MPMAX(0, approx_duration));
 }
 
 void write_video(struct MPContext *mpctx)
@@ -1130,7 +1292,7 @@ void write_video(struct MPContext *mpctx)
     struct vo_frame *frame = vo_frame_ref(&dummy);
 
     double diff = mpctx->past_frames[0].approx_duration;
-    if (opts->untimed || vo->driver->untimed)
+    if (video_untimed(mpctx))
         diff = -1; // disable frame dropping and aspects of frame timing
     if (diff >= 0) {
         // expected A/V sync correction is ignored
@@ -17,6 +17,16 @@
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <pthread.h>
+
+// Memory accounting counters. ta doesn't depend on the rest of mpv, so use C11
+// atomics directly, and a mutex if they're not available.
+#ifndef __STDC_NO_ATOMICS__
+#include <stdatomic.h>
+#define ACCOUNT_ATOMICS 1
+#else
+#define ACCOUNT_ATOMICS 0
+#endif
 
 #define TA_NO_WRAPPERS
 #include "ta.h"
@@ -34,6 +44,7 @@ struct ta_header {
     struct ta_header *prev;     // ring list containing siblings
     struct ta_header *next;
     struct ta_ext_header *ext;
+    struct ta_account *account; // see ta_enable_accounting()
 #ifdef TA_MEMORY_DEBUGGING
     unsigned int canary;
     struct ta_header *leak_next;
@@ -64,6 +75,7 @@ struct ta_ext_header {
     struct ta_header *header;  // points back to normal header
     struct ta_header children; // list of children, with this as sentinel
     void (*destructor)(void *);
+    bool account_root;         // set with ta_set_account()
 };
 
 // ta_ext_header.children.size is set to this
@@ -73,6 +85,12 @@ static void ta_dbg_add(struct ta_header *h);
 static void ta_dbg_check_header(struct ta_header *h);
 static void ta_dbg_remove(struct ta_header *h);
 
+static bool enable_accounting; // pretty much constant
+static void account_move(struct ta_header *h, struct ta_account *account);
+static void account_count(struct ta_account *account, size_t size);
+static void account_add(struct ta_account *account, int64_t bytes,
+                        int64_t blocks);
+
 static struct ta_header *get_header(void *ptr)
 {
     struct ta_header *h = ptr ? PTR_TO_HEADER(ptr) : NULL;
@@ -108,6 +126,9 @@ static struct ta_ext_header *get_or_alloc_ext_header(void *ptr)
  * parent of ptr. Operations ptr==NULL always succeed and do nothing.
  * Returns true on success, false on OOM.
  *
+ * With memory accounting enabled, this walks the subtree of ptr if it moves to
+ * a different account, so it takes O(size of subtree) time instead of O(1).
+ *
  * Warning: if ta_parent is a direct or indirect child of ptr, things will go
  *          wrong. The function will apparently succeed, but creates circular
  *          parent links, which are not allowed.
@@ -134,6 +155,13 @@ bool ta_set_parent(void *ptr, void *ta_parent)
         children->prev->next = ch;
         children->prev = ch;
     }
+    // Memory is attributed to the closest ancestor with an account.
+    if (enable_accounting && !(ch->ext && ch->ext->account_root)) {
+        struct ta_account *account =
+            parent_eh ? parent_eh->header->account : NULL;
+        if (ch->account != account)
+            account_move(ch, account);
+    }
     return true;
 }
 
@@ -156,6 +184,8 @@ void *ta_alloc_size(void *ta_parent, size_t size)
         ta_free(ptr);
         return NULL;
     }
+    if (h->account)
+        account_count(h->account, size);
     return ptr;
 }
 
@@ -176,6 +206,8 @@ void *ta_zalloc_size(void *ta_parent, size_t size)
         ta_free(ptr);
         return NULL;
     }
+    if (h->account)
+        account_count(h->account, size);
     return ptr;
 }
 
@@ -203,6 +235,7 @@ void *ta_realloc_size(void *ta_parent, void *ptr, size_t size)
         return ta_alloc_size(ta_parent, size);
     struct ta_header *h = get_header(ptr);
     struct ta_header *old_h = h;
+    size_t old_size = h->size;
     if (h->size == size)
         return ptr;
     ta_dbg_remove(h);
@@ -211,6 +244,10 @@ void *ta_realloc_size(void *ta_parent, void *ptr, size_t size)
     if (!h)
         return NULL;
     h->size = size;
+    if (h->account) {
+        account_add(h->account, (int64_t)size - (int64_t)old_size, 0);
+        account_count(h->account, size);
+    }
     if (h != old_h) {
         if (h->next) {
             // Relink siblings
@@ -266,6 +303,8 @@ void ta_free(void *ptr)
         h->prev->next = h->next;
     }
     ta_dbg_remove(h);
+    if (h->account)
+        account_add(h->account, -(int64_t)h->size, -1);
     free(h->ext);
     free(h);
 }
@@ -307,9 +346,170 @@ void *ta_find_parent(void *ptr)
     return NULL;
 }
 
-#ifdef TA_MEMORY_DEBUGGING
+#define MAX_ACCOUNTS 64
 
-#include <pthread.h>
+#if ACCOUNT_ATOMICS
+typedef _Atomic int64_t account_counter;
+#define counter_add(c, v) atomic_fetch_add_explicit(c, v, memory_order_relaxed)
+#define counter_get(c) atomic_load_explicit(c, memory_order_relaxed)
+#define counter_lock() ((void)0)
+#define counter_unlock() ((void)0)
+#else
+typedef int64_t account_counter;
+#define counter_add(c, v) (*(c) += (v))
+#define counter_get(c) (*(c))
+#define counter_lock() pthread_mutex_lock(&account_mutex)
+#define counter_unlock() pthread_mutex_unlock(&account_mutex)
+#endif
+
+struct ta_account {
+    const char *name;
+    account_counter bytes;
+    account_counter blocks;
+    account_counter allocs;
+    account_counter alloc_bytes;
+};
+
+// Protects the account list (and the counters if there are no atomics).
+static pthread_mutex_t account_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct ta_account accounts[MAX_ACCOUNTS];
+static int num_accounts;
+
+static void account_add(struct ta_account *account, int64_t bytes,
+                        int64_t blocks)
+{
+    counter_lock();
+    counter_add(&account->bytes, bytes);
+    counter_add(&account->blocks, blocks);
+    counter_unlock();
+}
+
+static void account_count(struct ta_account *account, size_t size)
+{
+    counter_lock();
+    counter_add(&account->allocs, 1);
+    counter_add(&account->alloc_bytes, (int64_t)size);
+    counter_unlock();
+}
+
+// Attribute h, and all children that were attributed to the same account as
+// h, to the given account. This visits every child with the old account, so
+// it's O(size of subtree).
+static void account_move(struct ta_header *h, struct ta_account *account)
+{
+    struct ta_account *old = h->account;
+    if (old)
+        account_add(old, -(int64_t)h->size, -1);
+    if (account)
+        account_add(account, h->size, 1);
+    h->account = account;
+    if (h->ext) {
+        struct ta_header *s;
+        for (s = h->ext->children.next; s != &h->ext->children; s = s->next) {
+            if (s->account == old && !(s->ext && s->ext->account_root))
+                account_move(s, account);
+        }
+    }
+}
+
+/* Enable memory accounting. Must be called before ta_set_account() has any
+ * effect, and before other threads are started. Allocations made before this
+ * call are never accounted.
+ * Note that this makes ta_set_parent() (talloc_steal()) O(size of subtree)
+ * when the moved memory changes its account.
+ */
+void ta_enable_accounting(void)
+{
+    enable_accounting = true;
+}
+
+bool ta_accounting_enabled(void)
+{
+    return enable_accounting;
+}
+
+/* Return the account with the given name, and create it if it doesn't exist.
+ * name must be a static string. Returns NULL if accounting is disabled, or if
+ * there are too many accounts.
+ */
+struct ta_account *ta_get_account(const char *name)
+{
+    if (!enable_accounting)
+        return NULL;
+    struct ta_account *res = NULL;
+    pthread_mutex_lock(&account_mutex);
+    for (int n = 0; n < num_accounts; n++) {
+        if (strcmp(accounts[n].name, name) == 0) {
+            res = &accounts[n];
+            break;
+        }
+    }
+    if (!res && num_accounts < MAX_ACCOUNTS) {
+        res = &accounts[num_accounts++];
+        res->name = name;
+    }
+    pthread_mutex_unlock(&account_mutex);
+    return res;
+}
+
+/* Attribute the memory of ptr and its (current and future) children to the
+ * named account, instead of the account of its parents. Children with their
+ * own account are not affected. name must be a static string.
+ * Does nothing and returns true if accounting is disabled.
+ * Returns false on OOM, or if there are too many accounts. The memory is then
+ * still attributed to the parent's account.
+ */
+bool ta_set_account(void *ptr, const char *name)
+{
+    if (!enable_accounting || !ptr)
+        return true;
+    struct ta_account *account = ta_get_account(name);
+    struct ta_ext_header *eh = get_or_alloc_ext_header(ptr);
+    if (!account || !eh)
+        return false;
+    eh->account_root = true;
+    if (eh->header->account != account)
+        account_move(eh->header, account);
+    return true;
+}
+
+/* Update the account for memory not allocated by ta (such as custom
+ * allocators). Works like realloc(): old_size==0 adds a new allocation,
+ * new_size==0 removes one. Does nothing if account==NULL.
+ */
+void ta_account_realloc(struct ta_account *account, size_t old_size,
+                        size_t new_size)
+{
+    if (!account)
+        return;
+    account_add(account, (int64_t)new_size - (int64_t)old_size,
+                (new_size > 0) - (old_size > 0));
+    if (new_size)
+        account_count(account, new_size);
+}
+
+/* Write the current state of up to max accounts to stats, and return the
+ * number of written entries.
+ */
+size_t ta_get_account_stats(struct ta_account_stats *stats, size_t max)
+{
+    pthread_mutex_lock(&account_mutex);
+    size_t num = 0;
+    for (; num < num_accounts && num < max; num++) {
+        struct ta_account *account = &accounts[num];
+        stats[num] = (struct ta_account_stats){
+            .name = account->name,
+            .bytes = counter_get(&account->bytes),
+            .blocks = counter_get(&account->blocks),
+            .allocs = counter_get(&account->allocs),
+            .alloc_bytes = counter_get(&account->alloc_bytes),
+        };
+    }
+    pthread_mutex_unlock(&account_mutex);
+    return num;
+}
+
+#ifdef TA_MEMORY_DEBUGGING
 
 static pthread_mutex_t ta_dbg_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool enable_leak_check; // pretty much constant
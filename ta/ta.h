@@ -19,6 +19,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdint.h>
 
 #ifdef __GNUC__
 #define TA_PRF(a1, a2) __attribute__ ((format(printf, a1, a2)))
@@ -158,4 +159,23 @@ void ta_enable_leak_report(void);
 void *ta_dbg_set_loc(void *ptr, const char *name);
 void *ta_dbg_mark_as_string(void *ptr);
 
+// Memory accounting
+struct ta_account;
+
+struct ta_account_stats {
+    const char *name;
+    int64_t bytes;          // currently allocated bytes
+    int64_t blocks;         // currently allocated blocks
+    int64_t allocs;         // total number of allocations and reallocations
+    int64_t alloc_bytes;    // total number of bytes (re)allocated
+};
+
+void ta_enable_accounting(void);
+bool ta_accounting_enabled(void);
+struct ta_account *ta_get_account(const char *name);
+bool ta_set_account(void *ptr, const char *name);
+void ta_account_realloc(struct ta_account *account, size_t old_size,
+                        size_t new_size);
+size_t ta_get_account_stats(struct ta_account_stats *stats, size_t max);
+
 #endif
@@ -0,0 +1,90 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+// Play generated audio through the AO push API (audio/out/push.c) with
+// ao_pcm, which accepts data as fast as it's sent, so the result doesn't
+// depend on timing. Every sample must arrive, in order, regardless of how the
+// data is split up by the buffers between the player and the AO thread.
+
+#define DURATION 3
+#define RATE 192000
+#define CHANNELS 8
+#define SOURCE "av://lavfi:sine=frequency=440:sample_rate=192000:duration=3:" \
+               "samples_per_frame=1000"
+
+static void *read_file(void *ta_parent, const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    assert_non_null(f);
+    assert_int_equal(fseek(f, 0, SEEK_END), 0);
+    long len = ftell(f);
+    assert_true(len >= 0);
+    rewind(f);
+    void *data = talloc_size(ta_parent, len + 1);
+    assert_int_equal(fread(data, 1, len, f), len);
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+static void play(const char *out, const char *audio_buffer)
+{
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "ao", "pcm"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "ao-pcm-file", out), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "ao-pcm-waveheader", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "audio-format", "s16"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "audio-channels", "7.1"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "audio-buffer", audio_buffer),
+                     0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+
+    const char *cmd[] = {"loadfile", SOURCE, NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+    while (1) {
+        mpv_event *ev = mpv_wait_event(ctx, -1);
+        if (ev->event_id == MPV_EVENT_END_FILE) {
+            mpv_event_end_file *end = ev->data;
+            assert_int_equal(end->reason, MPV_END_FILE_REASON_EOF);
+            break;
+        }
+    }
+
+    // Closes the output file.
+    mpv_terminate_destroy(ctx);
+}
+
+static void test_push(void **state)
+{
+    char *dir = test_create_temp_dir(NULL);
+    char *out_a = talloc_asprintf(dir, "%s/a.pcm", dir);
+    char *out_b = talloc_asprintf(dir, "%s/b.pcm", dir);
+
+    // Large and small buffers, so the data is split up differently.
+    play(out_a, "0.2");
+    play(out_b, "0.02");
+
+    size_t size_a, size_b;
+    void *a = read_file(dir, out_a, &size_a);
+    void *b = read_file(dir, out_b, &size_b);
+
+    assert_int_equal(size_a, (size_t)DURATION * RATE * CHANNELS * 2);
+    assert_int_equal(size_b, size_a);
+    assert_memory_equal(a, b, size_a);
+
+    test_remove_temp_dir(dir);
+    talloc_free(dir);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_push),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
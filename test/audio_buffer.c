@@ -0,0 +1,100 @@
+#include "test_helpers.h"
+
+#include "audio/audio_buffer.h"
+#include "audio/chmap.h"
+#include "audio/format.h"
+#include "common/common.h"
+
+// Reference: the buffer contents as a linear array (per plane).
+struct ref {
+    int16_t *data[MP_NUM_CHANNELS];
+    int num_samples;
+};
+
+static int16_t next_value = 1;
+
+static void check(struct mp_audio_buffer *ab, struct ref *r, int planes)
+{
+    assert_int_equal(mp_audio_buffer_samples(ab), r->num_samples);
+
+    uint8_t **ptr;
+    int samples;
+    mp_audio_buffer_peek(ab, &ptr, &samples);
+    assert_true(samples <= r->num_samples);
+    assert_true(samples > 0 || r->num_samples == 0);
+    for (int p = 0; p < planes; p++)
+        assert_true(!memcmp(ptr[p], r->data[p], samples * 2));
+
+    int linear = rand() % (r->num_samples + 1);
+    ptr = mp_audio_buffer_peek_linear(ab, linear);
+    for (int p = 0; p < planes; p++)
+        assert_true(!memcmp(ptr[p], r->data[p], linear * 2));
+}
+
+static void test_ring(void **state)
+{
+    const int planes = 3;
+    struct mp_chmap map;
+    mp_chmap_from_channels(&map, planes);
+    struct mp_audio_buffer *ab = mp_audio_buffer_create(NULL);
+    mp_audio_buffer_reinit_fmt(ab, AF_FORMAT_S16P, &map, 48000);
+    mp_audio_buffer_preallocate_min(ab, 100);
+
+    struct ref r = {0};
+    for (int p = 0; p < planes; p++)
+        r.data[p] = talloc_zero_array(NULL, int16_t, 100000);
+
+    srand(1);
+    for (int i = 0; i < 20000; i++) {
+        int op = rand() % 10;
+        int n = rand() % 150;
+        if (op < 4) {
+            // Keep the total size bounded, so the ring wraps often.
+            if (r.num_samples + n > 1000)
+                continue;
+            int16_t src[MP_NUM_CHANNELS][150];
+            void *ptrs[MP_NUM_CHANNELS];
+            for (int p = 0; p < planes; p++) {
+                for (int s = 0; s < n; s++)
+                    src[p][s] = next_value++;
+                ptrs[p] = src[p];
+                memcpy(r.data[p] + r.num_samples, src[p], n * 2);
+            }
+            mp_audio_buffer_append(ab, ptrs, n);
+            r.num_samples += n;
+        } else if (op < 8) {
+            n = MPMIN(n, r.num_samples);
+            mp_audio_buffer_skip(ab, n);
+            r.num_samples -= n;
+            for (int p = 0; p < planes; p++)
+                memmove(r.data[p], r.data[p] + n, r.num_samples * 2);
+        } else if (op == 8) {
+            mp_audio_buffer_prepend_silence(ab, n);
+            for (int p = 0; p < planes; p++) {
+                memmove(r.data[p] + n, r.data[p], r.num_samples * 2);
+                memset(r.data[p], 0, n * 2);
+            }
+            r.num_samples += n;
+        } else {
+            n = MPMIN(n, r.num_samples);
+            mp_audio_buffer_duplicate(ab, n);
+            for (int p = 0; p < planes; p++) {
+                memcpy(r.data[p] + r.num_samples,
+                       r.data[p] + r.num_samples - n, n * 2);
+            }
+            r.num_samples += n;
+        }
+        check(ab, &r, planes);
+    }
+
+    for (int p = 0; p < planes; p++)
+        talloc_free(r.data[p]);
+    talloc_free(ab);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_ring),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,89 @@
+#include <math.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+// Step backwards through a file with a single keyframe, with and without
+// --hr-seek-cache. Without the cache, every step decodes from the start; with
+// it, the steps are served from the cache, which is checked with the log.
+
+#define FPS 25 // must match the source
+#define STEPS 50
+#define START 8.0
+#define START_STR "8"
+#define SOURCE "av://lavfi:testsrc=duration=10:size=640x360:rate=25"
+
+// Count the seeks served from the frame cache.
+static void count_cache_seeks(mpv_event *ev, void *arg)
+{
+    if (ev->event_id == MPV_EVENT_LOG_MESSAGE) {
+        mpv_event_log_message *msg = ev->data;
+        if (strstr(msg->text, "from frame cache"))
+            *(int *)arg += 1;
+    }
+}
+
+static void wait_restart(mpv_handle *ctx, int *cache_seeks)
+{
+    test_wait_event(ctx, MPV_EVENT_PLAYBACK_RESTART, count_cache_seeks,
+                    cache_seeks);
+}
+
+static void command(mpv_handle *ctx, const char *a, const char *b,
+                    const char *c)
+{
+    const char *cmd[] = {a, b, c, NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+}
+
+// Returns the number of seeks served from the frame cache.
+static int run(const char *file, const char *cache)
+{
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "pause", "yes"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "hr-seek-cache", cache), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+    assert_int_equal(mpv_request_log_messages(ctx, "v"), 0);
+
+    int cache_seeks = 0;
+    command(ctx, "loadfile", file, NULL);
+    wait_restart(ctx, &cache_seeks);
+    command(ctx, "seek", START_STR, "absolute+exact");
+    wait_restart(ctx, &cache_seeks);
+
+    for (int n = 1; n <= STEPS; n++) {
+        command(ctx, "frame-back-step", NULL, NULL);
+        wait_restart(ctx, &cache_seeks);
+
+        double pos = 0;
+        assert_int_equal(mpv_get_property(ctx, "time-pos", MPV_FORMAT_DOUBLE,
+                                          &pos), 0);
+        assert_true(fabs(pos - (START - n / (double)FPS)) < 0.5 / FPS);
+    }
+
+    mpv_terminate_destroy(ctx);
+    return cache_seeks;
+}
+
+static void test_backstep(void **state)
+{
+    // Encode a test file with only one keyframe.
+    char *file = talloc_asprintf(*state, "%s/backstep.mkv", (char *)*state);
+    test_encode_clip(file, SOURCE, 1000);
+
+    assert_int_equal(run(file, "0"), 0);
+    // Frames skipped by the initial precise seek are cached as well, but
+    // allow the first step to decode from the keyframe.
+    assert_true(run(file, "256MiB") >= STEPS - 1);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_backstep, test_setup_temp_dir,
+                                        test_teardown_temp_dir),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "libmpv/client.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "mpv_talloc.h"
+
+// Play a 10 second source with --benchmark-report, and check the per-stage
+// numbers in the report.
+
+#define FRAMES 250
+#define SOURCE "av://lavfi:testsrc=duration=10:size=320x240:rate=25"
+
+static mpv_node *get(mpv_node *map, const char *key, int format)
+{
+    assert_int_equal(map->format, MPV_FORMAT_NODE_MAP);
+    mpv_node *val = node_map_get(map, key);
+    if (!val)
+        fail_msg("missing key %s", key);
+    assert_int_equal(val->format, format);
+    return val;
+}
+
+static void test_report(void **state)
+{
+    void *tmp = talloc_new(NULL);
+    char *dir = test_create_temp_dir(tmp);
+    char *report_file = talloc_asprintf(tmp, "%s/report.json", dir);
+
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "audio", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "benchmark-report",
+                                           report_file), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+    const char *cmd[] = {"loadfile", SOURCE, NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+    while (mpv_wait_event(ctx, -1)->event_id != MPV_EVENT_END_FILE) {}
+    mpv_terminate_destroy(ctx);
+
+    FILE *f = fopen(report_file, "rb");
+    assert_non_null(f);
+    char *data = talloc_size(tmp, 100000);
+    size_t len = fread(data, 1, 100000 - 1, f);
+    data[len] = '\0';
+    fclose(f);
+    // One line per file.
+    assert_true(len > 0 && data[len - 1] == '\n');
+    assert_null(memchr(data, '\n', len - 1));
+
+    mpv_node report;
+    char *src = data;
+    assert_true(json_parse(tmp, &report, &src, 10) >= 0);
+
+    assert_true(get(&report, "eof", MPV_FORMAT_FLAG)->u.flag);
+    assert_true(get(&report, "wall_time", MPV_FORMAT_DOUBLE)->u.double_ > 0);
+
+    mpv_node *demux = get(&report, "demux", MPV_FORMAT_NODE_MAP);
+    assert_int_equal(get(demux, "packets", MPV_FORMAT_INT64)->u.int64, FRAMES);
+    assert_true(get(demux, "bytes", MPV_FORMAT_INT64)->u.int64 > 0);
+
+    mpv_node *video = get(&report, "video", MPV_FORMAT_NODE_MAP);
+    assert_int_equal(get(video, "decoded_frames", MPV_FORMAT_INT64)->u.int64,
+                     FRAMES);
+    assert_int_equal(get(video, "output_frames", MPV_FORMAT_INT64)->u.int64,
+                     FRAMES);
+    assert_int_equal(get(video, "output_drops", MPV_FORMAT_INT64)->u.int64, 0);
+
+    // The decoder is the lavc filter; it must have been called at least once
+    // per frame.
+    mpv_node *filters = get(&report, "filters", MPV_FORMAT_NODE_ARRAY);
+    bool found = false;
+    for (int n = 0; n < filters->u.list->num; n++) {
+        mpv_node *f = &filters->u.list->values[n];
+        if (strcmp(get(f, "name", MPV_FORMAT_STRING)->u.string, "vd_lavc") == 0) {
+            assert_true(get(f, "calls", MPV_FORMAT_INT64)->u.int64 >= FRAMES);
+            found = true;
+        }
+    }
+    assert_true(found);
+
+    test_remove_temp_dir(dir);
+    talloc_free(tmp);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_report),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
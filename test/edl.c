@@ -0,0 +1,100 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+// Load a generated EDL with many segments and seek around in it. The segments
+// reference a number of copies of the same clip, so that each needs its own
+// demuxer. Runs both with normal loading and with the !lazy_open header.
+
+#define NUM_FILES 50
+#define NUM_PARTS 500
+#define PART_LEN 0.5
+#define NUM_SEEKS 20
+#define SOURCE "av://lavfi:testsrc=duration=10:size=160x90:rate=10"
+
+static char *file_name(void *ta_parent, const char *dir, int n)
+{
+    return talloc_asprintf(ta_parent, "%s/%d.mkv", dir, n);
+}
+
+static void write_edl(const char *name, bool lazy)
+{
+    FILE *f = fopen(name, "w");
+    assert_non_null(f);
+    fprintf(f, "# mpv EDL v0\n");
+    if (lazy)
+        fprintf(f, "!lazy_open\n");
+    for (int n = 0; n < NUM_PARTS; n++) {
+        fprintf(f, "%d.mkv,%f,%f\n", n % NUM_FILES,
+                (n / NUM_FILES) * PART_LEN, PART_LEN);
+    }
+    fclose(f);
+}
+
+static void run(const char *dir, bool lazy)
+{
+    char *edl = talloc_asprintf(NULL, "%s/test.edl", dir);
+    write_edl(edl, lazy);
+
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "pause", "yes"), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+
+    const char *cmd[] = {"loadfile", edl, NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+    test_wait_event(ctx, MPV_EVENT_PLAYBACK_RESTART, NULL, NULL);
+
+    double duration = 0;
+    assert_int_equal(mpv_get_property(ctx, "duration", MPV_FORMAT_DOUBLE,
+                                      &duration), 0);
+    assert_true(fabs(duration - NUM_PARTS * PART_LEN) < 0.01);
+
+    srand(1);
+    for (int n = 0; n < NUM_SEEKS; n++) {
+        // Seek to keyframes only (the clip has one per segment).
+        double target = (rand() % NUM_PARTS) * PART_LEN;
+        char arg[40];
+        snprintf(arg, sizeof(arg), "%f", target);
+        const char *seek[] = {"seek", arg, "absolute", NULL};
+        assert_int_equal(mpv_command(ctx, seek), 0);
+        test_wait_event(ctx, MPV_EVENT_PLAYBACK_RESTART, NULL, NULL);
+
+        double pos = 0;
+        assert_int_equal(mpv_get_property(ctx, "time-pos", MPV_FORMAT_DOUBLE,
+                                          &pos), 0);
+        assert_true(fabs(pos - target) < PART_LEN / 2);
+    }
+
+    mpv_terminate_destroy(ctx);
+    unlink(edl);
+    talloc_free(edl);
+}
+
+static void test_edl(void **state)
+{
+    char *dir = *state;
+    char *clip = talloc_asprintf(dir, "%s/clip.mkv", dir);
+
+    // Encode a clip with a keyframe at each segment start.
+    test_encode_clip(clip, SOURCE, 5);
+    for (int n = 0; n < NUM_FILES; n++)
+        test_copy_file(clip, file_name(dir, dir, n));
+
+    run(dir, false);
+    run(dir, true);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_edl, test_setup_temp_dir,
+                                        test_teardown_temp_dir),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,85 @@
+#include "test_helpers.h"
+
+#include "input/input.h"
+#include "libmpv/client.h"
+#include "misc/bstr.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "mpv_talloc.h"
+
+// mpv_get_properties() and the get_properties IPC command.
+
+static void check_result(mpv_node *res)
+{
+    assert_int_equal(res->format, MPV_FORMAT_NODE_MAP);
+    mpv_node_list *list = res->u.list;
+    assert_int_equal(list->num, 4);
+
+    // Same order as requested.
+    assert_string_equal(list->keys[0], "pause");
+    assert_int_equal(list->values[0].format, MPV_FORMAT_FLAG);
+    assert_true(list->values[0].u.flag);
+    assert_string_equal(list->keys[1], "volume-max");
+    assert_int_equal(list->values[1].format, MPV_FORMAT_DOUBLE);
+    assert_string_equal(list->keys[2], "does-not-exist");
+    assert_int_equal(list->values[2].format, MPV_FORMAT_NONE);
+    // Unavailable without a file.
+    assert_string_equal(list->keys[3], "time-pos");
+    assert_int_equal(list->values[3].format, MPV_FORMAT_NONE);
+}
+
+static void test_get_properties(void **state)
+{
+    mpv_handle *ctx = mpv_create();
+    assert_non_null(ctx);
+    assert_int_equal(mpv_set_option_string(ctx, "config", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "terminal", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "pause", "yes"), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+
+    const char *names[] = {"pause", "volume-max", "does-not-exist", "time-pos",
+                           NULL};
+    mpv_node res;
+    assert_int_equal(mpv_get_properties(ctx, names, &res), 0);
+    check_result(&res);
+    mpv_free_node_contents(&res);
+
+    const char *none[] = {NULL};
+    assert_int_equal(mpv_get_properties(ctx, none, &res), 0);
+    assert_int_equal(res.format, MPV_FORMAT_NODE_MAP);
+    assert_int_equal(res.u.list->num, 0);
+    mpv_free_node_contents(&res);
+
+    void *tmp = talloc_new(NULL);
+    struct json_arena *arena = json_arena_create(tmp);
+    bstr out = {0};
+    char *line = talloc_strdup(tmp, "{\"command\": [\"get_properties\", "
+        "\"pause\", \"volume-max\", \"does-not-exist\", \"time-pos\"]}");
+    mp_ipc_run_line(ctx, arena, line, &out);
+    char *reply = bstrto0(tmp, out);
+    mpv_node msg;
+    assert_true(json_parse(tmp, &msg, &reply, 10) >= 0);
+    mpv_node *err = node_map_get(&msg, "error");
+    assert_non_null(err);
+    assert_string_equal(err->u.string, "success");
+    mpv_node *data = node_map_get(&msg, "data");
+    assert_non_null(data);
+    check_result(data);
+
+    // Names must be strings.
+    out.len = 0;
+    line = talloc_strdup(tmp, "{\"command\": [\"get_properties\", 1]}");
+    mp_ipc_run_line(ctx, arena, line, &out);
+    assert_non_null(strstr(bstrto0(tmp, out), "invalid parameter"));
+
+    talloc_free(out.start);
+    talloc_free(tmp);
+    mpv_terminate_destroy(ctx);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_get_properties),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libavcodec/avcodec.h>
+
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "mpv_talloc.h"
+#include "video/image_writer.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+
+// Write PNGs through image_writer_queue, as vo_image does, and check that
+// completion callbacks arrive in order, with one and with multiple threads.
+
+#define NUM_IMAGES 48
+#define MAX_PENDING 4
+
+struct order {
+    pthread_mutex_t lock;
+    int next;
+    int pending;
+    int max_pending;
+    bool ok;
+};
+
+struct cb_ctx {
+    struct order *order;
+    int index;
+};
+
+static void written(void *p, bool success)
+{
+    struct cb_ctx *ctx = p;
+    struct order *order = ctx->order;
+    pthread_mutex_lock(&order->lock);
+    order->ok &= success && ctx->index == order->next;
+    order->next++;
+    order->pending--;
+    pthread_mutex_unlock(&order->lock);
+}
+
+static struct mp_image *gen_image(int seed)
+{
+    struct mp_image *img = mp_image_alloc(IMGFMT_RGB24, 640, 360);
+    assert_non_null(img);
+    uint32_t v = seed * 2654435761u;
+    for (int y = 0; y < img->h; y++) {
+        uint8_t *line = img->planes[0] + y * img->stride[0];
+        for (int x = 0; x < img->w * 3; x++) {
+            v = v * 1103515245u + 12345u;
+            line[x] = (x + y) / 4 + (v >> 28); // some noise to compress
+        }
+    }
+    return img;
+}
+
+static void run(const char *dir, int threads)
+{
+    struct image_writer_opts opts = image_writer_opts_defaults;
+    opts.format = AV_CODEC_ID_PNG;
+
+    struct order order = {.lock = PTHREAD_MUTEX_INITIALIZER, .ok = true};
+    struct cb_ctx ctx[NUM_IMAGES];
+    struct image_writer_queue *q =
+        image_writer_queue_create(NULL, mp_null_log, threads, MAX_PENDING);
+    assert_non_null(q);
+
+    for (int n = 0; n < NUM_IMAGES; n++) {
+        char *name = talloc_asprintf(q, "%s/%d.png", dir, n);
+        ctx[n] = (struct cb_ctx){&order, n};
+        pthread_mutex_lock(&order.lock);
+        order.pending++;
+        order.max_pending = MPMAX(order.max_pending, order.pending);
+        pthread_mutex_unlock(&order.lock);
+        image_writer_queue_add(q, gen_image(n), &opts, name, written, &ctx[n]);
+    }
+    image_writer_queue_flush(q);
+
+    assert_true(order.ok);
+    assert_int_equal(order.next, NUM_IMAGES);
+    // The new image is counted before add() can block on a full queue.
+    assert_true(order.max_pending <= MAX_PENDING + 1);
+
+    for (int n = 0; n < NUM_IMAGES; n++) {
+        char *name = talloc_asprintf(q, "%s/%d.png", dir, n);
+        struct stat st;
+        assert_int_equal(stat(name, &st), 0);
+        assert_true(st.st_size > 0);
+        unlink(name);
+    }
+
+    talloc_free(q);
+    pthread_mutex_destroy(&order.lock);
+}
+
+static void test_queue(void **state)
+{
+    char *dir = test_create_temp_dir(NULL);
+    run(dir, 1);
+    run(dir, 4);
+    test_remove_temp_dir(dir);
+    talloc_free(dir);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_queue),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
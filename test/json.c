@@ -1,6 +1,7 @@
 #include "test_helpers.h"
 
 #include "common/common.h"
+#include "misc/bstr.h"
 #include "misc/json.h"
 #include "misc/node.h"
 
@@ -88,9 +89,56 @@ static void test_json(void **state)
     }
 }
 
+static void test_json_arena(void **state)
+{
+    struct json_arena *arena = json_arena_create(NULL);
+    for (int n = 0; n < MP_ARRAY_SIZE(entries); n++) {
+        const struct entry *e = &entries[n];
+        void *tmp = talloc_new(NULL);
+        char *s = talloc_strdup(tmp, e->src);
+        json_skip_whitespace(&s);
+        struct mpv_node res;
+        bool ok = json_parse_arena(arena, &res, &s, MAX_DEPTH) >= 0;
+        assert_true(ok != e->expect_fail);
+        if (ok)
+            assert_true(equal_mpv_node(&e->out_data, &res));
+        json_arena_reset(arena);
+        talloc_free(tmp);
+    }
+    talloc_free(arena);
+}
+
+static void test_json_writer(void **state)
+{
+    bstr out = {0};
+    struct json_writer w = {.dst = &out};
+    struct mpv_node node = NODE_ARRAY(NODE_INT64(1), NODE_STR("x"));
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "a");
+    json_writer_int64(&w, -3);
+    json_writer_key(&w, "b");
+    json_writer_begin_array(&w);
+    json_writer_flag(&w, true);
+    json_writer_null(&w);
+    json_writer_begin_object(&w);
+    json_writer_end_object(&w);
+    json_writer_node(&w, &node);
+    json_writer_end_array(&w);
+    json_writer_key(&w, "c\n");
+    json_writer_string(&w, "\"q\"");
+    json_writer_key(&w, "d");
+    json_writer_double(&w, 0.5);
+    json_writer_end_object(&w);
+    assert_string_equal(out.start, "{\"a\":-3,\"b\":[true,null,{},[1,\"x\"]],"
+                                   "\"c\\n\":\"\\\"q\\\"\",\"d\":0.500000}");
+    talloc_free(out.start);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_json),
+        cmocka_unit_test(test_json_arena),
+        cmocka_unit_test(test_json_writer),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,123 @@
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "config.h"
+
+#if HAVE_LCMS2
+
+#include <lcms2.h>
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "osdep/timer.h"
+#include "video/out/gpu/lcms.h"
+
+// 3D LUT generation, as done by vo_gpu with --icc-profile, without a GPU.
+// The result must not depend on the number of threads.
+
+static struct gl_lcms *create(void *ta_parent, struct mp_icc_opts *opts)
+{
+    *opts = (struct mp_icc_opts){
+        .profile_auto = 1,
+        .size_str = "64x64x64",
+        .intent = MP_INTENT_RELATIVE_COLORIMETRIC,
+    };
+
+    struct gl_lcms *p = gl_lcms_init(ta_parent, mp_null_log, NULL, opts);
+
+    // Use sRGB as display profile, with BT.2020/BT.1886 video, so that the
+    // transform is not trivial.
+    cmsHPROFILE srgb = cmsCreate_sRGBProfile();
+    assert_non_null(srgb);
+    cmsUInt32Number size = 0;
+    assert_true(cmsSaveProfileToMem(srgb, NULL, &size));
+    void *data = talloc_size(NULL, size);
+    assert_true(cmsSaveProfileToMem(srgb, data, &size));
+    cmsCloseProfile(srgb);
+
+    assert_true(gl_lcms_set_memory_profile(p, (bstr){data, size}));
+    assert_true(gl_lcms_has_profile(p));
+    return p;
+}
+
+static struct lut3d *get_lut(struct gl_lcms *p)
+{
+    struct lut3d *lut = NULL;
+    assert_true(gl_lcms_get_lut3d(p, &lut, MP_CSP_PRIM_BT_2020,
+                                  MP_CSP_TRC_BT_1886, NULL));
+    return lut;
+}
+
+static void test_threads(void **state)
+{
+    void *tmp = talloc_new(NULL);
+    struct mp_icc_opts opts;
+    struct gl_lcms *p = create(tmp, &opts);
+
+    // Including a count that doesn't divide the LUT evenly.
+    static const int thread_counts[] = {1, 2, 4, 7};
+    struct lut3d *ref = NULL;
+    for (int n = 0; n < MP_ARRAY_SIZE(thread_counts); n++) {
+        gl_lcms_set_threads(p, thread_counts[n]);
+        gl_lcms_update_options(p); // force regeneration
+
+        struct lut3d *lut = get_lut(p);
+        assert_non_null(lut);
+
+        if (ref) {
+            assert_memory_equal(lut->data, ref->data,
+                                talloc_get_size(ref->data));
+            talloc_free(lut);
+        } else {
+            ref = talloc_steal(tmp, lut);
+        }
+    }
+
+    talloc_free(tmp);
+}
+
+static void test_async(void **state)
+{
+    void *tmp = talloc_new(NULL);
+    struct mp_icc_opts opts;
+    struct gl_lcms *p = create(tmp, &opts);
+
+    struct lut3d *ref = talloc_steal(tmp, get_lut(p));
+    assert_non_null(ref);
+
+    opts.async = 1;
+    gl_lcms_update_options(p);
+
+    // Returns immediately; the result is picked up by polling.
+    struct lut3d *lut = get_lut(p);
+    while (!lut) {
+        mp_sleep_us(1000);
+        lut = get_lut(p);
+    }
+    assert_non_null(lut);
+    assert_memory_equal(lut->data, ref->data, talloc_get_size(ref->data));
+    talloc_free(lut);
+
+    // Destroying with a pending job must cancel and wait for it.
+    gl_lcms_update_options(p);
+    assert_null(get_lut(p));
+
+    talloc_free(tmp);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_threads),
+        cmocka_unit_test(test_async),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
+
+#else
+
+int main(void) {
+    return 0;
+}
+
+#endif
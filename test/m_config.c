@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "common/global.h"
+#include "libmpv/client.h"
+#include "options/m_config.h"
+#include "options/m_option.h"
+
+// Load a config file with many profiles, and apply all of them, as a player
+// with a big per-file/per-protocol setup would.
+
+#define NUM_PROFILES 50
+
+static const char *const lines[] = {
+    "volume=%d",
+    "osd-level=2",
+    "osd-duration=%d",
+    "sub-font-size=%d",
+    "sub-border-size=2",
+    "sub-text-border-size=3",           // alias
+    "ass-style-override=yes",           // alias of an alias
+    "demuxer-max-bytes=%dKiB",
+    "demuxer-readahead-secs=%d",
+    "cache-secs=%d",
+    "speed=1.5",
+    "loop-file=%d",
+    "keep-open=yes",
+    "audio-channels=stereo",
+    "screenshot-format=png",
+    "screenshot-jpeg-quality=%d",
+    "vo-null-fps=%d",                   // sub-option near the end
+    "ao-null-buffer=0.%d",
+    "no-resume-playback",
+    "sub-auto=no",
+};
+
+static char *write_config(void)
+{
+    char *path = talloc_strdup(NULL, "/tmp/mpv-test-config-XXXXXX");
+    int fd = mkstemp(path);
+    assert_true(fd >= 0);
+    FILE *f = fdopen(fd, "w");
+    assert_non_null(f);
+
+    for (int n = 0; n < MP_ARRAY_SIZE(lines); n++) {
+        fprintf(f, lines[n], 1 + n);
+        fprintf(f, "\n");
+    }
+    for (int p = 0; p < NUM_PROFILES; p++) {
+        fprintf(f, "[profile%d]\n", p);
+        for (int n = 0; n < MP_ARRAY_SIZE(lines); n++) {
+            fprintf(f, lines[n], 1 + (p + n) % 90);
+            fprintf(f, "\n");
+        }
+    }
+    fclose(f);
+    return path;
+}
+
+static void test_config_load(void **state)
+{
+    char *path = write_config();
+
+    mpv_handle *ctx = mpv_create();
+    assert_non_null(ctx);
+    assert_int_equal(mpv_set_option_string(ctx, "config", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "terminal", "no"), 0);
+
+    assert_int_equal(mpv_load_config_file(ctx, path), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+
+    char name[40];
+    for (int p = 0; p < NUM_PROFILES; p++) {
+        snprintf(name, sizeof(name), "profile%d", p);
+        const char *cmd[] = {"apply-profile", name, NULL};
+        assert_int_equal(mpv_command(ctx, cmd), 0);
+    }
+
+    char *val = mpv_get_property_string(ctx, "options/sub-border-size");
+    assert_non_null(val);
+    assert_float_equal(atof(val), 3);
+    mpv_free(val);
+    val = mpv_get_property_string(ctx, "options/sub-ass-override");
+    assert_non_null(val);
+    assert_string_equal(val, "yes");
+    mpv_free(val);
+
+    mpv_terminate_destroy(ctx);
+    unlink(path);
+    talloc_free(path);
+}
+
+// A group with many string options, and a frequently changed option, like a
+// script setting a single option on every frame.
+#define CACHE_STRINGS 200
+#define CACHE_LISTENERS 16
+#define CACHE_CHANGES 100
+
+struct cache_opts {
+    char *strings[CACHE_STRINGS];
+    int value;
+};
+
+static void test_cache_changes(void **state)
+{
+    struct m_option *opts = talloc_zero_array(NULL, struct m_option,
+                                              CACHE_STRINGS + 2);
+    for (int n = 0; n < CACHE_STRINGS; n++) {
+        opts[n] = (struct m_option){
+            .name = talloc_asprintf(opts, "string-%d", n),
+            .type = &m_option_type_string,
+            .offset = offsetof(struct cache_opts, strings[n]),
+        };
+    }
+    opts[CACHE_STRINGS] = (struct m_option){
+        .name = "value",
+        .type = &m_option_type_int,
+        .offset = offsetof(struct cache_opts, value),
+    };
+
+    struct mpv_global *global = talloc_zero(NULL, struct mpv_global);
+    struct m_config *config = m_config_new(global, NULL,
+                                           sizeof(struct cache_opts), NULL, opts);
+    config->global = global;
+    m_config_create_shadow(config);
+    for (int n = 0; n < CACHE_STRINGS; n++) {
+        char *val = talloc_asprintf(NULL, "some string value %d", n);
+        assert_true(m_config_set_option_raw(config,
+                        m_config_get_co(config, bstr0(opts[n].name)),
+                        &val, 0) >= 0);
+        talloc_free(val);
+    }
+
+    struct m_config_cache *caches[CACHE_LISTENERS];
+    for (int n = 0; n < CACHE_LISTENERS; n++)
+        caches[n] = m_config_cache_alloc(NULL, global, GLOBAL_CONFIG);
+
+    struct m_config_option *co = m_config_get_co(config, bstr0("value"));
+    assert_non_null(co);
+
+    for (int i = 1; i <= CACHE_CHANGES; i++) {
+        *(int *)co->data = i;
+        m_config_notify_change_co(config, co);
+
+        for (int n = 0; n < CACHE_LISTENERS; n++) {
+            struct cache_opts *copts = caches[n]->opts;
+            assert_true(m_config_cache_update(caches[n]));
+            void *opt;
+            assert_true(m_config_cache_get_next_changed(caches[n], &opt));
+            assert_ptr_equal(opt, &copts->value);
+            assert_false(m_config_cache_get_next_changed(caches[n], &opt));
+            assert_int_equal(copts->value, i);
+        }
+    }
+
+    for (int n = 0; n < CACHE_LISTENERS; n++) {
+        struct cache_opts *copts = caches[n]->opts;
+        assert_string_equal(copts->strings[CACHE_STRINGS - 1],
+                            "some string value 199");
+        assert_false(m_config_cache_update(caches[n]));
+        talloc_free(caches[n]);
+    }
+
+    talloc_free(config);
+    talloc_free(global);
+    talloc_free(opts);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_config_load),
+        cmocka_unit_test(test_cache_changes),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,103 @@
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "common/playlist.h"
+
+static void check_indexes(struct playlist *pl)
+{
+    for (int n = 0; n < pl->num_entries; n++) {
+        struct playlist_entry *e = pl->entries[n];
+        assert_ptr_equal(e->pl, pl);
+        assert_int_equal(playlist_entry_to_index(pl, e), n);
+        assert_ptr_equal(playlist_entry_from_index(pl, n), e);
+        assert_ptr_equal(playlist_entry_get_rel(e, -1),
+                         n > 0 ? pl->entries[n - 1] : NULL);
+        assert_ptr_equal(playlist_entry_get_rel(e, +1),
+                         n + 1 < pl->num_entries ? pl->entries[n + 1] : NULL);
+    }
+    assert_null(playlist_entry_from_index(pl, -1));
+    assert_null(playlist_entry_from_index(pl, pl->num_entries));
+}
+
+static struct playlist_entry *add(struct playlist *pl, int n)
+{
+    char name[20];
+    snprintf(name, sizeof(name), "%d", n);
+    struct playlist_entry *e = playlist_entry_new(name);
+    playlist_add(pl, e);
+    return e;
+}
+
+static int entry_num(struct playlist_entry *e)
+{
+    return e ? atoi(e->filename) : -1;
+}
+
+static void test_ops(void **state)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+
+    for (int n = 0; n < 5; n++)
+        add(pl, n);
+    check_indexes(pl);
+    assert_int_equal(playlist_entry_count(pl), 5);
+    assert_int_equal(entry_num(playlist_get_first(pl)), 0);
+    assert_int_equal(entry_num(playlist_get_last(pl)), 4);
+
+    // Move forward: 1 takes 3's place, i.e. 0 2 1 3 4.
+    playlist_move(pl, pl->entries[1], pl->entries[3]);
+    check_indexes(pl);
+    assert_int_equal(entry_num(pl->entries[1]), 2);
+    assert_int_equal(entry_num(pl->entries[2]), 1);
+
+    // Move backward: 4 to the start, i.e. 4 0 2 1 3.
+    playlist_move(pl, pl->entries[4], pl->entries[0]);
+    check_indexes(pl);
+    assert_int_equal(entry_num(pl->entries[0]), 4);
+    assert_int_equal(entry_num(pl->entries[4]), 3);
+
+    // Move to the end: 4 0 1 3 2.
+    playlist_move(pl, pl->entries[2], NULL);
+    check_indexes(pl);
+    assert_int_equal(entry_num(pl->entries[4]), 2);
+
+    // Removing the current entry makes the next entry current.
+    pl->current = pl->entries[1];
+    playlist_remove(pl, pl->entries[1]);
+    check_indexes(pl);
+    assert_int_equal(entry_num(pl->current), 1);
+    assert_true(pl->current_was_replaced);
+    assert_int_equal(entry_num(playlist_get_next(pl, +1)), 1);
+    assert_int_equal(entry_num(playlist_get_next(pl, -1)), 4);
+    pl->current_was_replaced = false;
+
+    // Transfer after the current entry: 4 1 10 11 3 2.
+    struct playlist *src = talloc_zero(NULL, struct playlist);
+    add(src, 10);
+    add(src, 11);
+    playlist_transfer_entries(pl, src);
+    assert_int_equal(src->num_entries, 0);
+    check_indexes(pl);
+    assert_int_equal(entry_num(pl->entries[2]), 10);
+    assert_int_equal(entry_num(pl->entries[3]), 11);
+    assert_int_equal(entry_num(pl->entries[4]), 3);
+    talloc_free(src);
+
+    playlist_shuffle(pl);
+    check_indexes(pl);
+    assert_int_equal(playlist_entry_count(pl), 6);
+
+    pl->current = NULL;
+    playlist_clear(pl);
+    assert_int_equal(playlist_entry_count(pl), 0);
+    assert_null(playlist_get_first(pl));
+
+    talloc_free(pl);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_ops),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
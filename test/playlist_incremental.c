@@ -0,0 +1,97 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+// Large playlist files are read in chunks: the first entries are played while
+// the rest is added in the background, which must end up in the same playlist.
+
+#define NUM_ENTRIES 12000
+#define SOURCE "av://lavfi:testsrc=duration=100:size=64x64:rate=25"
+
+static void write_playlist(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    assert_non_null(f);
+    fprintf(f, "#EXTM3U\n%s\n", SOURCE);
+    for (int n = 1; n < NUM_ENTRIES; n++)
+        fprintf(f, "#EXTINF:10,title %d\nentries/%d.mkv\n", n, n);
+    assert_int_equal(fclose(f), 0);
+}
+
+static void check_string(mpv_handle *ctx, const char *name, const char *val)
+{
+    char *s = mpv_get_property_string(ctx, name);
+    assert_non_null(s);
+    assert_string_equal(s, val);
+    mpv_free(s);
+}
+
+static void check_entry(mpv_handle *ctx, const char *dir, int n)
+{
+    char *prop = talloc_asprintf(NULL, "playlist/%d/filename", n);
+    char *val = talloc_asprintf(NULL, "%s/entries/%d.mkv", dir, n);
+    check_string(ctx, prop, val);
+    talloc_free(prop);
+    talloc_free(val);
+}
+
+static void test_incremental(void **state)
+{
+    char *dir = test_create_temp_dir(NULL);
+    char *list = talloc_asprintf(dir, "%s/list.m3u", dir);
+    write_playlist(list);
+
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "pause", "yes"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "playlist-incremental", "yes"),
+                     0);
+    assert_int_equal(mpv_set_option_string(ctx, "resume-playback", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "load-unsafe-playlists", "yes"),
+                     0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+    assert_int_equal(mpv_observe_property(ctx, 0, "playlist-count",
+                                          MPV_FORMAT_INT64), 0);
+    const char *cmd[] = {"loadfile", list, NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+
+    bool restarted = false;
+    int64_t count = 0;
+    while (!restarted || count < NUM_ENTRIES) {
+        mpv_event *ev = mpv_wait_event(ctx, 10);
+        assert_int_not_equal(ev->event_id, MPV_EVENT_NONE); // timeout
+        if (ev->event_id == MPV_EVENT_PLAYBACK_RESTART)
+            restarted = true;
+        if (ev->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+            mpv_event_property *prop = ev->data;
+            if (prop->format == MPV_FORMAT_INT64)
+                count = *(int64_t *)prop->data;
+            assert_true(count <= NUM_ENTRIES);
+        }
+    }
+
+    // Still playing the first entry; everything else is in file order, with
+    // the same processing as the first entries.
+    check_string(ctx, "playlist-pos", "0");
+    check_string(ctx, "playlist/0/filename", SOURCE);
+    check_entry(ctx, dir, 1);
+    check_entry(ctx, dir, 7000);
+    check_entry(ctx, dir, 11999);
+    check_string(ctx, "playlist/11999/title", "title 11999");
+
+    mpv_terminate_destroy(ctx);
+
+    test_remove_temp_dir(dir);
+    talloc_free(dir);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_incremental),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,86 @@
+#include "test_helpers.h"
+
+#include "libmpv/client.h"
+#include "player/client.h"
+
+// Change tracking for client-side property caching (used by lua.c's
+// mp.get_property_native()). A tracked property must be flagged as changed
+// whenever its value can change.
+
+#define SOURCE "av://lavfi:testsrc=duration=100:size=320x240:rate=25"
+
+static void wait_for(mpv_handle *ctx, mpv_event_id id)
+{
+    while (1) {
+        mpv_event *ev = mpv_wait_event(ctx, -1);
+        if (ev->event_id == id)
+            break;
+        // Switching files ends the previous one, which is fine.
+        if (ev->event_id == MPV_EVENT_END_FILE) {
+            mpv_event_end_file *end = ev->data;
+            assert_int_not_equal(end->reason, MPV_END_FILE_REASON_ERROR);
+        }
+    }
+}
+
+static void test_tracking(void **state)
+{
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "pause", "yes"), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+    const char *cmd[] = {"loadfile", SOURCE, NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+    wait_for(ctx, MPV_EVENT_PLAYBACK_RESTART);
+
+    // Continuously changing or never notified properties can't be tracked.
+    assert_true(mp_client_track_property(ctx, "time-pos") < 0);
+    assert_true(mp_client_track_property(ctx, "vo-passes") < 0);
+    assert_true(mp_client_track_property(ctx, "playlistx") < 0);
+    // Some fields change without notification.
+    assert_true(mp_client_track_property(ctx, "track-list") < 0);
+    assert_true(mp_client_track_property(ctx, "track-list/count") < 0);
+
+    int list = mp_client_track_property(ctx, "playlist");
+    int count = mp_client_track_property(ctx, "playlist/count");
+    int vf = mp_client_track_property(ctx, "vf");
+    assert_true(list >= 0 && count >= 0 && vf >= 0);
+
+    // Initially always changed.
+    assert_true(mp_client_property_changed(ctx, list));
+    assert_true(mp_client_property_changed(ctx, count));
+    assert_true(mp_client_property_changed(ctx, vf));
+    assert_false(mp_client_property_changed(ctx, list));
+    assert_false(mp_client_property_changed(ctx, vf));
+
+    const char *append[] = {"loadfile", SOURCE, "append", NULL};
+    assert_int_equal(mpv_command(ctx, append), 0);
+    assert_true(mp_client_property_changed(ctx, list));
+    assert_true(mp_client_property_changed(ctx, count));
+    assert_false(mp_client_property_changed(ctx, list));
+    assert_false(mp_client_property_changed(ctx, vf));
+
+    assert_int_equal(mpv_set_property_string(ctx, "vf", "format=yuv420p"), 0);
+    assert_true(mp_client_property_changed(ctx, vf));
+    assert_false(mp_client_property_changed(ctx, vf));
+
+    // Setting the current entry changes the "current" field of the playlist.
+    assert_int_equal(mpv_set_property_string(ctx, "playlist-pos", "1"), 0);
+    assert_true(mp_client_property_changed(ctx, list));
+    wait_for(ctx, MPV_EVENT_FILE_LOADED);
+
+    // A new file changes everything.
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+    wait_for(ctx, MPV_EVENT_FILE_LOADED);
+    assert_true(mp_client_property_changed(ctx, list));
+    assert_true(mp_client_property_changed(ctx, count));
+    assert_true(mp_client_property_changed(ctx, vf));
+
+    mpv_terminate_destroy(ctx);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_tracking),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "libmpv/client.h"
+#include "libmpv/render.h"
+
+// Render video with the software render API backend into a memory buffer, as
+// a compositor would.
+
+#define W 1920
+#define H 1080
+#define FRAMES 10
+
+static int render(mpv_render_context *rctx, void *buf, size_t stride)
+{
+    int size[2] = {W, H};
+    mpv_render_param params[] = {
+        {MPV_RENDER_PARAM_SW_SIZE, size},
+        {MPV_RENDER_PARAM_SW_FORMAT, "rgb0"},
+        {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+        {MPV_RENDER_PARAM_SW_POINTER, buf},
+        {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &(int){0}},
+        {0}
+    };
+    return mpv_render_context_render(rctx, params);
+}
+
+static void test_render(void **state)
+{
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "vo", "libmpv"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "untimed", "yes"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "osd-level", "3"), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+
+    mpv_render_context *rctx;
+    mpv_render_param params[] = {
+        {MPV_RENDER_PARAM_API_TYPE, MPV_RENDER_API_TYPE_SW},
+        {0}
+    };
+    assert_int_equal(mpv_render_context_create(&rctx, ctx, params), 0);
+
+    size_t stride = W * 4;
+    uint8_t *buf = malloc(stride * H);
+    assert_non_null(buf);
+
+    // Invalid parameters are rejected.
+    int size[2] = {W, H};
+    mpv_render_param bad[] = {
+        {MPV_RENDER_PARAM_SW_SIZE, size},
+        {MPV_RENDER_PARAM_SW_FORMAT, "yuv420p"},
+        {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+        {MPV_RENDER_PARAM_SW_POINTER, buf},
+        {0}
+    };
+    assert_int_equal(mpv_render_context_render(rctx, bad), MPV_ERROR_UNSUPPORTED);
+    size_t small_stride = W;
+    assert_int_equal(render(rctx, buf, small_stride), MPV_ERROR_INVALID_PARAMETER);
+
+    const char *cmd[] = {"loadfile",
+        "av://lavfi:testsrc2=duration=100:size=1920x1080:rate=25", NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+
+    int frames = 0;
+    while (frames < FRAMES) {
+        uint64_t flags = mpv_render_context_update(rctx);
+        if (!(flags & MPV_RENDER_UPDATE_FRAME)) {
+            usleep(1000);
+            continue;
+        }
+        assert_int_equal(render(rctx, buf, stride), 0);
+        frames++;
+    }
+
+    // testsrc2 has no large black areas, so most of the image must be set.
+    int lit = 0;
+    for (int y = 0; y < H; y += 8) {
+        uint8_t *px = buf + y * stride;
+        for (int x = 0; x < W; x += 8)
+            lit += px[x * 4] || px[x * 4 + 1] || px[x * 4 + 2];
+    }
+    assert_true(lit > (W / 8) * (H / 8) / 2);
+
+    mpv_render_context_free(rctx);
+    mpv_terminate_destroy(ctx);
+    free(buf);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_render),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
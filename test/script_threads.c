@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "config.h"
+
+#if HAVE_LUA
+
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+// Lua scripts on threads shared with --script-threads: all scripts must get
+// their events and timers, including scripts with their own event loop.
+
+#define NUM_SCRIPTS 6
+
+// Answers "ping" after a timer, to check that timers are run too.
+static const char script[] =
+    "mp.register_script_message('ping', function()\n"
+    "    mp.add_timeout(0.05, function()\n"
+    "        mp.commandv('script-message', 'pong', mp.get_script_name())\n"
+    "    end)\n"
+    "end)\n"
+    "mp.commandv('script-message', 'hello', mp.get_script_name())\n";
+
+// A custom event loop, which must not be run on a shared thread.
+static const char script_own_loop[] =
+    "mp.register_script_message('ping', function()\n"
+    "    mp.commandv('script-message', 'pong', mp.get_script_name())\n"
+    "end)\n"
+    "function mp_event_loop()\n"
+    "    mp.commandv('script-message', 'hello', mp.get_script_name())\n"
+    "    while mp.keep_running do\n"
+    "        mp.dispatch_events(true)\n"
+    "    end\n"
+    "end\n";
+
+static void write_file(const char *path, const char *data)
+{
+    FILE *f = fopen(path, "wb");
+    assert_non_null(f);
+    assert_int_equal(fwrite(data, strlen(data), 1, f), 1);
+    assert_int_equal(fclose(f), 0);
+}
+
+// Wait until every script sent the given message once.
+static void wait_messages(mpv_handle *ctx, const char *msg, int num)
+{
+    int count = 0;
+    while (count < num) {
+        mpv_event *ev = mpv_wait_event(ctx, 10);
+        assert_int_not_equal(ev->event_id, MPV_EVENT_NONE); // timeout
+        if (ev->event_id != MPV_EVENT_CLIENT_MESSAGE)
+            continue;
+        mpv_event_client_message *m = ev->data;
+        if (m->num_args == 2 && strcmp(m->args[0], msg) == 0)
+            count++;
+    }
+}
+
+static void test_scripts(void **state)
+{
+    char *dir = test_create_temp_dir(NULL);
+
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "idle", "yes"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "script-threads", "2"), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+
+    for (int n = 0; n <= NUM_SCRIPTS; n++) {
+        char *path = talloc_asprintf(dir, "%s/s%d.lua", dir, n);
+        write_file(path, n < NUM_SCRIPTS ? script : script_own_loop);
+        const char *cmd[] = {"load-script", path, NULL};
+        assert_int_equal(mpv_command(ctx, cmd), 0);
+    }
+    wait_messages(ctx, "hello", NUM_SCRIPTS + 1);
+
+    // Broadcast events reach every script, repeatedly.
+    for (int n = 0; n < 3; n++) {
+        const char *cmd[] = {"script-message", "ping", NULL};
+        assert_int_equal(mpv_command(ctx, cmd), 0);
+        wait_messages(ctx, "pong", NUM_SCRIPTS + 1);
+    }
+
+    // Must terminate all scripts and join the shared threads.
+    mpv_terminate_destroy(ctx);
+
+    test_remove_temp_dir(dir);
+    talloc_free(dir);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_scripts),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
+
+#else
+
+int main(void) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+// Create storyboards with the "storyboard" command, from a non-seekable
+// source (linear mode), and from a seekable file (seek mode, multithreaded).
+
+#define DURATION 60
+#define INTERVAL 5 // must match the command argument
+#define SOURCE "av://lavfi:testsrc=duration=60:size=640x360:rate=25"
+
+static int64_t map_int(mpv_node *map, const char *key)
+{
+    for (int n = 0; n < map->u.list->num; n++) {
+        if (strcmp(map->u.list->keys[n], key) == 0) {
+            assert_int_equal(map->u.list->values[n].format, MPV_FORMAT_INT64);
+            return map->u.list->values[n].u.int64;
+        }
+    }
+    fail_msg("missing key %s", key);
+    return 0;
+}
+
+static mpv_node *map_get(mpv_node *map, const char *key)
+{
+    for (int n = 0; n < map->u.list->num; n++) {
+        if (strcmp(map->u.list->keys[n], key) == 0)
+            return &map->u.list->values[n];
+    }
+    fail_msg("missing key %s", key);
+    return NULL;
+}
+
+static void run(const char *url, const char *dir)
+{
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_initialize(ctx), 0);
+
+    char *out = talloc_asprintf(NULL, "%s/storyboard.jpg", dir);
+    char *index = talloc_asprintf(NULL, "%s/storyboard.json", dir);
+    char *args[] = {"storyboard", (char *)url, out, "5"};
+    mpv_node arg_nodes[MP_ARRAY_SIZE(args)];
+    for (int n = 0; n < MP_ARRAY_SIZE(args); n++)
+        arg_nodes[n] = (mpv_node){.format = MPV_FORMAT_STRING, .u.string = args[n]};
+    mpv_node_list arg_list = {.num = MP_ARRAY_SIZE(args), .values = arg_nodes};
+    mpv_node cmd = {.format = MPV_FORMAT_NODE_ARRAY, .u.list = &arg_list};
+    mpv_node res;
+    assert_int_equal(mpv_command_node(ctx, &cmd, &res), 0);
+
+    assert_int_equal(res.format, MPV_FORMAT_NODE_MAP);
+    assert_int_equal(map_int(&res, "width"), 160);
+    assert_int_equal(map_int(&res, "height"), 90);
+    assert_int_equal(map_int(&res, "columns"), 10);
+    mpv_node *list = map_get(&res, "thumbnails");
+    assert_int_equal(list->format, MPV_FORMAT_NODE_ARRAY);
+    int count = list->u.list->num;
+    assert_int_equal(count, DURATION / INTERVAL);
+    assert_int_equal(map_int(&res, "rows"), (count + 9) / 10);
+
+    mpv_node *last = &list->u.list->values[count - 1];
+    assert_int_equal(map_int(last, "x"), ((count - 1) % 10) * 160);
+    assert_int_equal(map_int(last, "y"), ((count - 1) / 10) * 90);
+
+    struct stat st;
+    assert_int_equal(stat(out, &st), 0);
+    assert_true(st.st_size > 0);
+    assert_int_equal(stat(index, &st), 0);
+    assert_true(st.st_size > 0);
+
+    mpv_free_node_contents(&res);
+    unlink(out);
+    unlink(index);
+    talloc_free(out);
+    talloc_free(index);
+    mpv_terminate_destroy(ctx);
+}
+
+static void test_linear(void **state)
+{
+    run(SOURCE, *state);
+}
+
+static void test_seek(void **state)
+{
+    // Encode the test source to a seekable file with a keyframe per second.
+    char *file = talloc_asprintf(*state, "%s/source.mkv", (char *)*state);
+    test_encode_clip(file, SOURCE, 25);
+    run(file, *state);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_linear, test_setup_temp_dir,
+                                        test_teardown_temp_dir),
+        cmocka_unit_test_setup_teardown(test_seek, test_setup_temp_dir,
+                                        test_teardown_temp_dir),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,95 @@
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+#include "video/sws_utils.h"
+
+// Convert 4K images between common formats, with and without slice threading,
+// and check that the results are identical. Slicing is only done for some of
+// the conversions (those without vertical filtering); for the others, this
+// checks that they fall back to a single context.
+
+#define W 3840
+#define H 2160
+
+struct conv {
+    int src, dst;
+    int dst_w, dst_h;
+};
+
+static const struct conv convs[] = {
+    {IMGFMT_420P, IMGFMT_BGR0, W, H},
+    {IMGFMT_NV12, IMGFMT_RGB0, W, H},
+    {IMGFMT_BGR0, IMGFMT_420P, W, H},
+    {IMGFMT_NV12, IMGFMT_420P, W, H},
+    {IMGFMT_P010, IMGFMT_420P, W, H},
+    {IMGFMT_420P, IMGFMT_BGR0, 1920, 1080},
+    {IMGFMT_420P, IMGFMT_BGR0, 1280, 720},
+    {IMGFMT_BGR0, IMGFMT_BGR0, 1920, 1080},
+    {IMGFMT_444P, IMGFMT_BGR0, W, H},
+    {IMGFMT_BGR0, IMGFMT_RGB0, W, H},
+};
+
+static struct mp_image *gen_image(int imgfmt)
+{
+    struct mp_image *img = mp_image_alloc(imgfmt, W, H);
+    assert_non_null(img);
+    uint32_t v = 1;
+    for (int p = 0; p < img->num_planes; p++) {
+        int bytes = mp_image_plane_w(img, p) * img->fmt.bpp[p] / 8;
+        for (int y = 0; y < mp_image_plane_h(img, p); y++) {
+            uint8_t *line = img->planes[p] + y * img->stride[p];
+            for (int x = 0; x < bytes; x++) {
+                v = v * 1103515245u + 12345u;
+                line[x] = (x + y) / 8 + (v >> 29);
+            }
+        }
+    }
+    return img;
+}
+
+static void run(struct mp_image *src, struct mp_image *dst, int threads)
+{
+    struct mp_sws_context *sws = mp_sws_alloc(NULL);
+    sws->flags = mp_sws_fast_flags;
+    sws->threads = threads;
+    assert_int_equal(mp_sws_scale(sws, dst, src), 0);
+    // Again with the initialized context.
+    assert_int_equal(mp_sws_scale(sws, dst, src), 0);
+    talloc_free(sws);
+}
+
+static void test_sws(void **state)
+{
+    for (int n = 0; n < MP_ARRAY_SIZE(convs); n++) {
+        const struct conv *c = &convs[n];
+        struct mp_image *src = gen_image(c->src);
+        struct mp_image *ref = mp_image_alloc(c->dst, c->dst_w, c->dst_h);
+        struct mp_image *dst = mp_image_alloc(c->dst, c->dst_w, c->dst_h);
+        assert_non_null(ref);
+        assert_non_null(dst);
+
+        run(src, ref, 1);
+        run(src, dst, 4);
+
+        for (int p = 0; p < dst->num_planes; p++) {
+            int bytes = mp_image_plane_w(dst, p) * dst->fmt.bpp[p] / 8;
+            for (int y = 0; y < mp_image_plane_h(dst, p); y++) {
+                assert_memory_equal(ref->planes[p] + y * ref->stride[p],
+                                    dst->planes[p] + y * dst->stride[p], bytes);
+            }
+        }
+
+        talloc_free(src);
+        talloc_free(ref);
+        talloc_free(dst);
+    }
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_sws),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
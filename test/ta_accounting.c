@@ -0,0 +1,73 @@
+#include "test_helpers.h"
+
+#include "common/common.h"
+#include "mpv_talloc.h"
+
+static struct ta_account_stats get(const char *name)
+{
+    struct ta_account_stats stats[64];
+    size_t num = ta_get_account_stats(stats, MP_ARRAY_SIZE(stats));
+    for (size_t n = 0; n < num; n++) {
+        if (strcmp(stats[n].name, name) == 0)
+            return stats[n];
+    }
+    fail_msg("missing account %s", name);
+    return (struct ta_account_stats){0};
+}
+
+static void test_accounting(void **state)
+{
+    ta_enable_accounting();
+    assert_true(ta_accounting_enabled());
+
+    void *a = talloc_size(NULL, 10);
+    void *a_child = talloc_size(a, 100);
+    assert_true(talloc_set_account(a, "test-a"));
+    assert_int_equal(get("test-a").bytes, 110);
+    assert_int_equal(get("test-a").blocks, 2);
+
+    void *b = talloc_size(NULL, 5);
+    assert_true(talloc_set_account(b, "test-b"));
+    void *b_child = talloc_size(b, 7);
+    b_child = talloc_realloc_size(NULL, b_child, 70);
+    assert_int_equal(get("test-b").bytes, 75);
+    assert_int_equal(get("test-b").allocs, 2);
+
+    // Moving a subtree moves its memory, except for sub-accounts.
+    void *own = talloc_size(a_child, 1);
+    assert_true(talloc_set_account(own, "test-b"));
+    talloc_size(a_child, 1000);
+    talloc_steal(b, a_child);
+    assert_int_equal(get("test-a").bytes, 10);
+    assert_int_equal(get("test-b").bytes, 75 + 100 + 1 + 1000);
+
+    // Account of the closest ancestor with an account wins.
+    talloc_steal(a, own);
+    assert_int_equal(get("test-b").bytes, 75 + 100 + 1000 + 1);
+    assert_true(talloc_set_account(a, "test-a"));
+    assert_int_equal(get("test-a").bytes, 10);
+
+    talloc_free(b);
+    assert_int_equal(get("test-b").bytes, 1);
+    assert_int_equal(get("test-b").blocks, 1);
+    talloc_free(a);
+    assert_int_equal(get("test-a").bytes, 0);
+    assert_int_equal(get("test-b").bytes, 0);
+    assert_int_equal(get("test-b").blocks, 0);
+
+    // Allocations are counted; freed memory is subtracted again.
+    void *root = talloc_new(NULL);
+    assert_true(talloc_set_account(root, "test-storm"));
+    for (int n = 0; n < 1000; n++)
+        talloc_free(talloc_size(root, 64));
+    talloc_free(root);
+    assert_int_equal(get("test-storm").allocs, 1000);
+    assert_int_equal(get("test-storm").bytes, 0);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_accounting),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,123 @@
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "test_helpers.h"
+
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+struct mpv_handle *test_create_player(void)
+{
+    mpv_handle *ctx = mpv_create();
+    assert_non_null(ctx);
+    assert_int_equal(mpv_set_option_string(ctx, "config", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "terminal", "no"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "vo", "null"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "ao", "null"), 0);
+    return ctx;
+}
+
+char *test_create_temp_dir(void *ta_parent)
+{
+    const char *tmp = getenv("TMPDIR");
+    if (!tmp || !tmp[0])
+        tmp = "/tmp";
+    char *path = talloc_asprintf(ta_parent, "%s/mpv-test-XXXXXX", tmp);
+    assert_non_null(mkdtemp(path));
+    return path;
+}
+
+void test_remove_temp_dir(const char *path)
+{
+    DIR *dir = opendir(path);
+    assert_non_null(dir);
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+            continue;
+        char *name = talloc_asprintf(NULL, "%s/%s", path, ent->d_name);
+        struct stat st;
+        if (lstat(name, &st) == 0 && S_ISDIR(st.st_mode)) {
+            test_remove_temp_dir(name);
+        } else {
+            unlink(name);
+        }
+        talloc_free(name);
+    }
+    closedir(dir);
+    assert_int_equal(rmdir(path), 0);
+}
+
+int test_setup_temp_dir(void **state)
+{
+    *state = test_create_temp_dir(NULL);
+    return 0;
+}
+
+int test_teardown_temp_dir(void **state)
+{
+    test_remove_temp_dir(*state);
+    talloc_free(*state);
+    return 0;
+}
+
+void test_encode_clip(const char *path, const char *source, int gop)
+{
+    mpv_handle *ctx = test_create_player();
+    char *gop_opt = talloc_asprintf(NULL, "g=%d", gop);
+    bool ok = mpv_set_option_string(ctx, "o", path) >= 0 &&
+              mpv_set_option_string(ctx, "ovc", "mpeg4") >= 0 &&
+              mpv_set_option_string(ctx, "ovcopts", gop_opt) >= 0 &&
+              mpv_initialize(ctx) >= 0;
+    talloc_free(gop_opt);
+    if (ok) {
+        const char *cmd[] = {"loadfile", source, NULL};
+        ok = mpv_command(ctx, cmd) >= 0;
+    }
+    if (ok) {
+        mpv_event_end_file *end =
+            test_wait_event(ctx, MPV_EVENT_END_FILE, NULL, NULL)->data;
+        ok = end->reason == MPV_END_FILE_REASON_EOF;
+    }
+    mpv_terminate_destroy(ctx);
+
+    struct stat st;
+    if (!ok || stat(path, &st) != 0 || st.st_size == 0) {
+        print_message("Can't encode %s, skipping.\n", source);
+        unlink(path);
+        skip();
+    }
+}
+
+void test_copy_file(const char *src, const char *dst)
+{
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    assert_non_null(in);
+    assert_non_null(out);
+    char buf[64 * 1024];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), in)) > 0)
+        assert_int_equal(fwrite(buf, 1, len, out), len);
+    fclose(in);
+    assert_int_equal(fclose(out), 0);
+}
+
+struct mpv_event *test_wait_event(struct mpv_handle *ctx, int id,
+                                  void (*on_event)(struct mpv_event *ev,
+                                                   void *arg),
+                                  void *arg)
+{
+    while (1) {
+        mpv_event *ev = mpv_wait_event(ctx, -1);
+        if (ev->event_id == id)
+            return ev;
+        assert_int_not_equal(ev->event_id, MPV_EVENT_END_FILE);
+        if (on_event)
+            on_event(ev, arg);
+    }
+}
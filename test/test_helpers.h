@@ -13,4 +13,40 @@
 #define assert_double_equal(a, b) assert_true(fabs((a) - (b)) <= DBL_EPSILON * fmax(fabs(a), fabs(b)))
 #define assert_float_equal(a, b) assert_true(fabsf((a) - (b)) <= FLT_EPSILON * fmaxf(fabsf(a), fabsf(b)))
 
+struct mpv_handle;
+struct mpv_event;
+
+// Create a player instance without config files, terminal and audio/video
+// output. It's not initialized yet, so that tests can set more options.
+struct mpv_handle *test_create_player(void);
+
+// Create a new, empty directory for temporary files (in $TMPDIR or /tmp).
+// The returned path is allocated with talloc under ta_parent.
+char *test_create_temp_dir(void *ta_parent);
+
+// Remove a directory created with test_create_temp_dir(), and everything in
+// it.
+void test_remove_temp_dir(const char *path);
+
+// cmocka setup/teardown functions, which pass a new temporary directory to the
+// test as *state, and remove it after the test, even if it failed or was
+// skipped.
+int test_setup_temp_dir(void **state);
+int test_teardown_temp_dir(void **state);
+
+// Encode a libavfilter source ("av://lavfi:...") to path, as mpeg4 video with
+// a keyframe every gop frames. Skips the test if this is not possible, e.g.
+// because mpv was built without the required encoder or filters.
+void test_encode_clip(const char *path, const char *source, int gop);
+
+void test_copy_file(const char *src, const char *dst);
+
+// Wait for an event with the given ID, and return it. Fails the test if the
+// file ends before (unless id is MPV_EVENT_END_FILE). If on_event is not NULL,
+// it's called with all other events, e.g. to inspect log messages.
+struct mpv_event *test_wait_event(struct mpv_handle *ctx, int id,
+                                  void (*on_event)(struct mpv_event *ev,
+                                                   void *arg),
+                                  void *arg);
+
 #endif
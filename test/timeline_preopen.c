@@ -0,0 +1,97 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+#include "libmpv/client.h"
+#include "mpv_talloc.h"
+
+// Play an EDL whose segments are opened on demand (!lazy_open), with and
+// without opening the next segment in the background
+// (--demuxer-timeline-preopen-secs). Each segment is a separate file, so every
+// segment after the first is lazy.
+
+#define NUM_PARTS 4
+#define PART_LEN 2 // must match the source
+#define SOURCE "av://lavfi:testsrc=duration=2:size=160x90:rate=10"
+
+struct play_state {
+    mpv_handle *ctx;
+    bool loaded;
+    int preopened;
+};
+
+static void on_event(mpv_event *ev, void *arg)
+{
+    struct play_state *st = arg;
+    if (ev->event_id == MPV_EVENT_FILE_LOADED) {
+        double duration = 0;
+        assert_int_equal(mpv_get_property(st->ctx, "duration",
+                                          MPV_FORMAT_DOUBLE, &duration), 0);
+        assert_true(fabs(duration - NUM_PARTS * PART_LEN) < 0.01);
+        st->loaded = true;
+    }
+    if (ev->event_id == MPV_EVENT_LOG_MESSAGE) {
+        mpv_event_log_message *msg = ev->data;
+        assert_null(strstr(msg->text, "failed to load segment"));
+        if (strstr(msg->text, "was pre-opened"))
+            st->preopened += 1;
+    }
+}
+
+// Play the EDL to the end, and return the number of pre-opened segments that
+// were switched to.
+static int play(const char *edl, const char *preopen_secs)
+{
+    mpv_handle *ctx = test_create_player();
+    assert_int_equal(mpv_set_option_string(ctx, "untimed", "yes"), 0);
+    assert_int_equal(mpv_set_option_string(ctx, "demuxer-timeline-preopen-secs",
+                                           preopen_secs), 0);
+    assert_int_equal(mpv_initialize(ctx), 0);
+    assert_int_equal(mpv_request_log_messages(ctx, "v"), 0);
+
+    const char *cmd[] = {"loadfile", edl, NULL};
+    assert_int_equal(mpv_command(ctx, cmd), 0);
+
+    struct play_state st = {.ctx = ctx};
+    mpv_event *ev = test_wait_event(ctx, MPV_EVENT_END_FILE, on_event, &st);
+    mpv_event_end_file *end = ev->data;
+    assert_int_equal(end->reason, MPV_END_FILE_REASON_EOF);
+    assert_true(st.loaded);
+
+    mpv_terminate_destroy(ctx);
+    return st.preopened;
+}
+
+static void test_preopen(void **state)
+{
+    char *dir = *state;
+    char *clip = talloc_asprintf(dir, "%s/clip.mkv", dir);
+    test_encode_clip(clip, SOURCE, 5);
+
+    char *edl = talloc_asprintf(dir, "%s/test.edl", dir);
+    FILE *f = fopen(edl, "w");
+    assert_non_null(f);
+    fprintf(f, "# mpv EDL v0\n!lazy_open\n");
+    for (int n = 0; n < NUM_PARTS; n++) {
+        char *file = talloc_asprintf(dir, "%s/%d.mkv", dir, n);
+        test_copy_file(clip, file);
+        fprintf(f, "%d.mkv,0,%d\n", n, PART_LEN);
+    }
+    assert_int_equal(fclose(f), 0);
+
+    // Every segment after the first is opened in the background.
+    assert_int_equal(play(edl, "1"), NUM_PARTS - 1);
+    // Only opened when playback reaches them.
+    assert_int_equal(play(edl, "0"), 0);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_preopen, test_setup_temp_dir,
+                                        test_teardown_temp_dir),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -943,6 +943,8 @@ static bool prepare_decoding(struct mp_filter *vd)
         // Can be much more aggressive for true intra codecs.
         if (ctx->intra_only)
             avctx->skip_frame = AVDISCARD_ALL;
+    } else if (drop == 3) {
+        avctx->skip_frame = AVDISCARD_NONKEY;   // keyframes only
     } else {
         avctx->skip_frame = ctx->skip_frame;    // normal playback
     }
@@ -981,7 +983,9 @@ static bool do_send_packet(struct mp_filter *vd, struct demux_packet *pkt)
     AVPacket avpkt;
     mp_set_av_packet(&avpkt, pkt, &ctx->codec_timebase);
 
+    MP_STATS_START(vd, "video-decode-send");
     int ret = avcodec_send_packet(avctx, pkt ? &avpkt : NULL);
+    MP_STATS_END(vd, "video-decode-send");
     if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
         return false;
 
@@ -1025,7 +1029,9 @@ static bool decode_frame(struct mp_filter *vd)
     if (!prepare_decoding(vd))
         return true;
 
+    MP_STATS_START(vd, "video-decode");
     int ret = avcodec_receive_frame(avctx, ctx->pic);
+    MP_STATS_END(vd, "video-decode");
     if (ret == AVERROR_EOF) {
         // If flushing was initialized earlier and has ended now, make it start
         // over in case we get new packets at some point in the future. This
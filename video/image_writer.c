@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
+#include <pthread.h>
 
 #include <libavcodec/avcodec.h>
 #include <libavutil/mem.h>
@@ -38,6 +39,7 @@
 #include "video/mp_image.h"
 #include "video/fmt-conversion.h"
 #include "video/sws_utils.h"
+#include "misc/thread_pool.h"
 
 #include "options/m_option.h"
 
@@ -383,3 +385,120 @@ void dump_png(struct mp_image *image, const char *filename, struct mp_log *log)
     opts.format = AV_CODEC_ID_PNG;
     write_image(image, &opts, filename, log);
 }
+
+struct image_writer_queue {
+    struct mp_log *log;
+    struct mp_thread_pool *pool;
+    int max_pending;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    // --- protected by lock
+    struct writer_job **jobs;   // pending jobs, in the order they were queued
+    int num_jobs;
+    bool completing;            // a thread is running completion callbacks
+};
+
+struct writer_job {
+    struct image_writer_queue *q;
+    struct mp_image *image;
+    struct image_writer_opts opts;
+    char *filename;
+    void (*cb)(void *cb_ctx, bool success);
+    void *cb_ctx;
+    bool done, success;         // protected by q->lock
+};
+
+static void queue_worker(void *ptr)
+{
+    struct writer_job *job = ptr;
+    struct image_writer_queue *q = job->q;
+
+    bool success = write_image(job->image, &job->opts, job->filename, q->log);
+    mp_image_unrefp(&job->image);
+
+    pthread_mutex_lock(&q->lock);
+    job->done = true;
+    job->success = success;
+    // Only one thread runs callbacks at a time, so they're never reordered.
+    // If another thread is busy with it, it will pick up this job too.
+    if (!q->completing) {
+        q->completing = true;
+        while (q->num_jobs && q->jobs[0]->done) {
+            struct writer_job *cur = q->jobs[0];
+            pthread_mutex_unlock(&q->lock);
+            if (cur->cb)
+                cur->cb(cur->cb_ctx, cur->success);
+            pthread_mutex_lock(&q->lock);
+            // Remove it only now, so flushing waits for the callback.
+            MP_TARRAY_REMOVE_AT(q->jobs, q->num_jobs, 0);
+            talloc_free(cur);
+            pthread_cond_broadcast(&q->wakeup);
+        }
+        q->completing = false;
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void queue_destroy(void *ptr)
+{
+    struct image_writer_queue *q = ptr;
+    image_writer_queue_flush(q);
+    talloc_free(q->pool);
+    pthread_cond_destroy(&q->wakeup);
+    pthread_mutex_destroy(&q->lock);
+}
+
+struct image_writer_queue *image_writer_queue_create(void *ta_parent,
+                                                     struct mp_log *log,
+                                                     int threads,
+                                                     int max_pending)
+{
+    struct image_writer_queue *q = talloc_zero(ta_parent, struct image_writer_queue);
+    q->log = log;
+    q->max_pending = MPMAX(max_pending, 1);
+    q->pool = mp_thread_pool_create(q, 1, 1, MPMAX(threads, 1));
+    if (!q->pool) {
+        talloc_free(q);
+        return NULL;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wakeup, NULL);
+    talloc_set_destructor(q, queue_destroy);
+    return q;
+}
+
+void image_writer_queue_add(struct image_writer_queue *q,
+                            struct mp_image *image,
+                            const struct image_writer_opts *opts,
+                            const char *filename,
+                            void (*cb)(void *cb_ctx, bool success),
+                            void *cb_ctx)
+{
+    struct writer_job *job = talloc_ptrtype(NULL, job);
+    *job = (struct writer_job){
+        .q = q,
+        .image = image,
+        .opts = opts ? *opts : image_writer_opts_defaults,
+        .filename = talloc_strdup(job, filename),
+        .cb = cb,
+        .cb_ctx = cb_ctx,
+    };
+
+    pthread_mutex_lock(&q->lock);
+    while (q->num_jobs >= q->max_pending)
+        pthread_cond_wait(&q->wakeup, &q->lock);
+    MP_TARRAY_APPEND(q, q->jobs, q->num_jobs, job);
+    pthread_mutex_unlock(&q->lock);
+
+    // Can't fail, because the pool has at least 1 thread.
+    mp_thread_pool_queue(q->pool, queue_worker, job);
+}
+
+void image_writer_queue_flush(struct image_writer_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->num_jobs)
+        pthread_cond_wait(&q->wakeup, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+}
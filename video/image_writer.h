@@ -69,3 +69,30 @@ struct mp_image *convert_image(struct mp_image *image, int destfmt,
 
 // Debugging helper.
 void dump_png(struct mp_image *image, const char *filename, struct mp_log *log);
+
+struct image_writer_queue;
+
+// Create a queue that writes images with write_image() on up to threads worker
+// threads. At most max_pending images can be queued or in progress at once.
+// talloc_free() waits until all queued images are written.
+struct image_writer_queue *image_writer_queue_create(void *ta_parent,
+                                                     struct mp_log *log,
+                                                     int threads,
+                                                     int max_pending);
+
+/* Queue writing the image to the given file. This takes over the image
+ * reference. Blocks while max_pending images are pending (backpressure).
+ *
+ * When done, cb(cb_ctx, success) is called (if cb is not NULL). This happens
+ * on a worker thread, but always in the order the images were queued. The
+ * callback must not block on the queue.
+ */
+void image_writer_queue_add(struct image_writer_queue *q,
+                            struct mp_image *image,
+                            const struct image_writer_opts *opts,
+                            const char *filename,
+                            void (*cb)(void *cb_ctx, bool success),
+                            void *cb_ctx);
+
+// Wait until all queued images are written and their callbacks have returned.
+void image_writer_queue_flush(struct image_writer_queue *q);
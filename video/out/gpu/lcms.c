@@ -17,6 +17,7 @@
 
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "mpv_talloc.h"
 
@@ -38,6 +39,10 @@
 #include <lcms2.h>
 #include <libavutil/sha.h>
 #include <libavutil/mem.h>
+#include <libavutil/cpu.h>
+
+#include "misc/thread_pool.h"
+#include "osdep/atomic.h"
 
 struct gl_lcms {
     void *icc_data;
@@ -48,10 +53,46 @@ struct gl_lcms {
     bool changed;
     enum mp_csp_prim current_prim;
     enum mp_csp_trc current_trc;
+    int threads;
 
     struct mp_log *log;
     struct mpv_global *global;
     struct mp_icc_opts *opts;
+
+    // For --icc-3dlut-async. The pool has at most 1 thread, so jobs run one
+    // after another, and freeing the pool waits for the running job.
+    struct mp_thread_pool *job_pool;
+    struct lut_job *job;            // last started job (or NULL)
+
+    pthread_mutex_t lock;
+    // --- protected by lock
+    void (*wakeup_cb)(void *ctx);
+    void *wakeup_cb_ctx;
+};
+
+// Everything needed to generate a LUT, so it can run on another thread.
+struct lut_job {
+    struct mp_log *log;
+    struct mpv_global *global;
+    struct gl_lcms *owner;          // only for wakeup_cb
+
+    // Parameters (immutable after creation)
+    void *icc_data;
+    size_t icc_size;
+    struct AVBufferRef *vid_profile;
+    enum mp_csp_prim prim;
+    enum mp_csp_trc trc;
+    int size[3];
+    int intent;
+    int contrast;
+    bool use_embedded;
+    char *cache_dir;
+    int threads;
+
+    atomic_bool cancel;             // result not needed anymore
+    atomic_bool done;               // result is set
+    atomic_int refcount;            // owner + background thread
+    struct lut3d *result;           // NULL on failure
 };
 
 static bool parse_3dlut_size(const char *arg, int *p1, int *p2, int *p3)
@@ -85,6 +126,7 @@ const struct m_sub_options mp_icc_conf = {
         OPT_INT("icc-intent", intent, 0),
         OPT_CHOICE_OR_INT("icc-contrast", contrast, 0, 0, 1000000, ({"inf", -1})),
         OPT_STRING_VALIDATE("icc-3dlut-size", size_str, 0, validate_3dlut_size_opt),
+        OPT_FLAG("icc-3dlut-async", async, 0),
 
         OPT_REPLACED("3dlut-size", "icc-3dlut-size"),
         OPT_REMOVED("icc-cache", "see icc-cache-dir"),
@@ -101,8 +143,8 @@ const struct m_sub_options mp_icc_conf = {
 static void lcms2_error_handler(cmsContext ctx, cmsUInt32Number code,
                                 const char *msg)
 {
-    struct gl_lcms *p = cmsGetContextUserData(ctx);
-    MP_ERR(p, "lcms2: %s\n", msg);
+    struct lut_job *job = cmsGetContextUserData(ctx);
+    MP_ERR(job, "lcms2: %s\n", msg);
 }
 
 static void load_profile(struct gl_lcms *p)
@@ -132,10 +174,25 @@ static void load_profile(struct gl_lcms *p)
     p->current_profile = talloc_strdup(p, p->opts->profile);
 }
 
+static void lut_job_unref(struct lut_job *job)
+{
+    if (job && atomic_fetch_add(&job->refcount, -1) == 1) {
+        av_buffer_unref(&job->vid_profile);
+        talloc_free(job->result);
+        talloc_free(job);
+    }
+}
+
 static void gl_lcms_destructor(void *ptr)
 {
     struct gl_lcms *p = ptr;
+    if (p->job)
+        atomic_store(&p->job->cancel, true);
+    // Waits until the job is done (canceled jobs stop early).
+    talloc_free(p->job_pool);
+    lut_job_unref(p->job);
     av_buffer_unref(&p->vid_profile);
+    pthread_mutex_destroy(&p->lock);
 }
 
 struct gl_lcms *gl_lcms_init(void *talloc_ctx, struct mp_log *log,
@@ -149,10 +206,25 @@ struct gl_lcms *gl_lcms_init(void *talloc_ctx, struct mp_log *log,
         .log = log,
         .opts = opts,
     };
+    pthread_mutex_init(&p->lock, NULL);
     gl_lcms_update_options(p);
     return p;
 }
 
+void gl_lcms_set_threads(struct gl_lcms *p, int threads)
+{
+    p->threads = threads;
+}
+
+void gl_lcms_set_wakeup_cb(struct gl_lcms *p, void (*cb)(void *ctx),
+                           void *cb_ctx)
+{
+    pthread_mutex_lock(&p->lock);
+    p->wakeup_cb = cb;
+    p->wakeup_cb_ctx = cb_ctx;
+    pthread_mutex_unlock(&p->lock);
+}
+
 void gl_lcms_update_options(struct gl_lcms *p)
 {
     if ((p->using_memory_profile && !p->opts->profile_auto) ||
@@ -222,11 +294,13 @@ bool gl_lcms_has_profile(struct gl_lcms *p)
     return p->icc_size > 0;
 }
 
-static cmsHPROFILE get_vid_profile(struct gl_lcms *p, cmsContext cms,
-                                   cmsHPROFILE disp_profile,
-                                   enum mp_csp_prim prim, enum mp_csp_trc trc)
+static cmsHPROFILE get_vid_profile(struct lut_job *p, cmsContext cms,
+                                   cmsHPROFILE disp_profile)
 {
-    if (p->opts->use_embedded && p->vid_profile) {
+    enum mp_csp_prim prim = p->prim;
+    enum mp_csp_trc trc = p->trc;
+
+    if (p->use_embedded && p->vid_profile) {
         // Try using the embedded ICC profile
         cmsHPROFILE prof = cmsOpenProfileFromMemTHR(cms, p->vid_profile->data,
                                                     p->vid_profile->size);
@@ -297,15 +371,15 @@ static cmsHPROFILE get_vid_profile(struct gl_lcms *p, cmsContext cms,
         cmsDeleteTransform(xyz2src);
 
         // Contrast limiting
-        if (p->opts->contrast > 0) {
+        if (p->contrast > 0) {
             for (int i = 0; i < 3; i++)
-                src_black[i] = MPMAX(src_black[i], 1.0 / p->opts->contrast);
+                src_black[i] = MPMAX(src_black[i], 1.0 / p->contrast);
         }
 
         // Built-in contrast failsafe
         double contrast = 3.0 / (src_black[0] + src_black[1] + src_black[2]);
         MP_VERBOSE(p, "Detected ICC profile contrast: %f\n", contrast);
-        if (contrast > 100000 && !p->opts->contrast) {
+        if (contrast > 100000 && !p->contrast) {
             MP_WARN(p, "ICC profile detected contrast very high (>100000),"
                     " falling back to contrast 1000 for sanity. Set the"
                     " icc-contrast option to silence this warning.\n");
@@ -342,48 +416,122 @@ static cmsHPROFILE get_vid_profile(struct gl_lcms *p, cmsContext cms,
     return vid_profile;
 }
 
-bool gl_lcms_get_lut3d(struct gl_lcms *p, struct lut3d **result_lut3d,
-                       enum mp_csp_prim prim, enum mp_csp_trc trc,
-                       struct AVBufferRef *vid_profile)
-{
-    int s_r, s_g, s_b;
-    bool result = false;
+// Transform slices (planes along the b axis) of the cube, until all are
+// taken. Multiple threads can run this on the same state.
+struct lut_slices {
+    cmsHTRANSFORM trafo;
+    int size[3];
+    uint16_t *output;
+    struct lut_job *job;
+    atomic_int next_slice;
+};
 
-    p->changed = false;
-    p->current_prim = prim;
-    p->current_trc = trc;
+static void transform_slices(void *ptr)
+{
+    struct lut_slices *sl = ptr;
+    int s_r = sl->size[0], s_g = sl->size[1], s_b = sl->size[2];
 
-    // We need to hold on to a reference to the video's ICC profile for as long
-    // as we still need to perform equality checking, so generate a new
-    // reference here
-    av_buffer_unref(&p->vid_profile);
-    if (vid_profile) {
-        MP_VERBOSE(p, "Got an embedded ICC profile.\n");
-        p->vid_profile = av_buffer_ref(vid_profile);
-        if (!p->vid_profile)
-            abort();
+    // transform a (s_r)x(s_g)x(s_b) cube, with 3 components per channel
+    uint16_t *input = talloc_array(NULL, uint16_t, s_r * 3);
+    while (!atomic_load_explicit(&sl->job->cancel, memory_order_relaxed)) {
+        int b = atomic_fetch_add(&sl->next_slice, 1);
+        if (b >= s_b)
+            break;
+        for (int g = 0; g < s_g; g++) {
+            for (int r = 0; r < s_r; r++) {
+                input[r * 3 + 0] = r * 65535 / (s_r - 1);
+                input[r * 3 + 1] = g * 65535 / (s_g - 1);
+                input[r * 3 + 2] = b * 65535 / (s_b - 1);
+            }
+            size_t base = (b * s_r * s_g + g * s_r) * 4;
+            cmsDoTransform(sl->trafo, input, sl->output + base, s_r);
+        }
     }
+    talloc_free(input);
+}
 
-    if (!parse_3dlut_size(p->opts->size_str, &s_r, &s_g, &s_b))
-        return false;
+static bool compute_lut(struct lut_job *job, uint16_t *output)
+{
+    bool ok = false;
 
-    if (!gl_lcms_has_profile(p))
+    cmsContext cms = cmsCreateContext(NULL, job);
+    if (!cms)
         return false;
+    cmsSetLogErrorHandlerTHR(cms, lcms2_error_handler);
+
+    cmsHPROFILE profile =
+        cmsOpenProfileFromMemTHR(cms, job->icc_data, job->icc_size);
+    if (!profile)
+        goto done;
+
+    cmsHPROFILE vid_hprofile = get_vid_profile(job, cms, profile);
+    if (!vid_hprofile) {
+        cmsCloseProfile(profile);
+        goto done;
+    }
+
+    // The transform is shared by all threads, so disable its 1 pixel cache,
+    // which is the only part that isn't thread-safe.
+    cmsHTRANSFORM trafo = cmsCreateTransformTHR(cms, vid_hprofile, TYPE_RGB_16,
+                                                profile, TYPE_RGBA_16,
+                                                job->intent,
+                                                cmsFLAGS_HIGHRESPRECALC |
+                                                cmsFLAGS_BLACKPOINTCOMPENSATION |
+                                                cmsFLAGS_NOCACHE);
+    cmsCloseProfile(profile);
+    cmsCloseProfile(vid_hprofile);
+
+    if (!trafo)
+        goto done;
+
+    struct lut_slices sl = {
+        .trafo = trafo,
+        .size = {job->size[0], job->size[1], job->size[2]},
+        .output = output,
+        .job = job,
+    };
+
+    int threads = job->threads > 0 ? job->threads : av_cpu_count();
+    threads = MPCLAMP(threads, 1, job->size[2]);
+
+    // This thread works on the slices too, so the work gets done even if no
+    // worker threads can be created. Freeing the pool waits for the workers.
+    struct mp_thread_pool *pool = NULL;
+    if (threads > 1)
+        pool = mp_thread_pool_create(NULL, 0, 0, threads - 1);
+    for (int n = 0; pool && n < threads - 1; n++) {
+        if (!mp_thread_pool_queue(pool, transform_slices, &sl))
+            break;
+    }
+    transform_slices(&sl);
+    talloc_free(pool);
+
+    cmsDeleteTransform(trafo);
+
+    ok = !atomic_load(&job->cancel);
+
+done:
+    cmsDeleteContext(cms);
+    return ok;
+}
+
+static struct lut3d *generate_lut(struct lut_job *job)
+{
+    int s_r = job->size[0], s_g = job->size[1], s_b = job->size[2];
 
     void *tmp = talloc_new(NULL);
     uint16_t *output = talloc_array(tmp, uint16_t, s_r * s_g * s_b * 4);
     struct lut3d *lut = NULL;
-    cmsContext cms = NULL;
 
     char *cache_file = NULL;
-    if (p->opts->cache_dir && p->opts->cache_dir[0]) {
+    if (job->cache_dir && job->cache_dir[0]) {
         // Gamma is included in the header to help uniquely identify it,
         // because we may change the parameter in the future or make it
         // customizable, same for the primaries.
         char *cache_info = talloc_asprintf(tmp,
                 "ver=1.4, intent=%d, size=%dx%dx%d, prim=%d, trc=%d, "
                 "contrast=%d\n",
-                p->opts->intent, s_r, s_g, s_b, prim, trc, p->opts->contrast);
+                job->intent, s_r, s_g, s_b, job->prim, job->trc, job->contrast);
 
         uint8_t hash[32];
         struct AVSHA *sha = av_sha_alloc();
@@ -391,13 +539,13 @@ bool gl_lcms_get_lut3d(struct gl_lcms *p, struct lut3d **result_lut3d,
             abort();
         av_sha_init(sha, 256);
         av_sha_update(sha, cache_info, strlen(cache_info));
-        if (vid_profile)
-            av_sha_update(sha, vid_profile->data, vid_profile->size);
-        av_sha_update(sha, p->icc_data, p->icc_size);
+        if (job->vid_profile)
+            av_sha_update(sha, job->vid_profile->data, job->vid_profile->size);
+        av_sha_update(sha, job->icc_data, job->icc_size);
         av_sha_final(sha, hash);
         av_free(sha);
 
-        char *cache_dir = mp_get_user_path(tmp, p->global, p->opts->cache_dir);
+        char *cache_dir = mp_get_user_path(tmp, job->global, job->cache_dir);
         cache_file = talloc_strdup(tmp, "");
         for (int i = 0; i < sizeof(hash); i++)
             cache_file = talloc_asprintf_append(cache_file, "%02X", hash[i]);
@@ -408,59 +556,19 @@ bool gl_lcms_get_lut3d(struct gl_lcms *p, struct lut3d **result_lut3d,
 
     // check cache
     if (cache_file && stat(cache_file, &(struct stat){0}) == 0) {
-        MP_VERBOSE(p, "Opening 3D LUT cache in file '%s'.\n", cache_file);
-        struct bstr cachedata = stream_read_file(cache_file, tmp, p->global,
+        MP_VERBOSE(job, "Opening 3D LUT cache in file '%s'.\n", cache_file);
+        struct bstr cachedata = stream_read_file(cache_file, tmp, job->global,
                                                  1000000000); // 1 GB
         if (cachedata.len == talloc_get_size(output)) {
             memcpy(output, cachedata.start, cachedata.len);
             goto done;
         } else {
-            MP_WARN(p, "3D LUT cache invalid!\n");
+            MP_WARN(job, "3D LUT cache invalid!\n");
         }
     }
 
-    cms = cmsCreateContext(NULL, p);
-    if (!cms)
+    if (!compute_lut(job, output))
         goto error_exit;
-    cmsSetLogErrorHandlerTHR(cms, lcms2_error_handler);
-
-    cmsHPROFILE profile =
-        cmsOpenProfileFromMemTHR(cms, p->icc_data, p->icc_size);
-    if (!profile)
-        goto error_exit;
-
-    cmsHPROFILE vid_hprofile = get_vid_profile(p, cms, profile, prim, trc);
-    if (!vid_hprofile) {
-        cmsCloseProfile(profile);
-        goto error_exit;
-    }
-
-    cmsHTRANSFORM trafo = cmsCreateTransformTHR(cms, vid_hprofile, TYPE_RGB_16,
-                                                profile, TYPE_RGBA_16,
-                                                p->opts->intent,
-                                                cmsFLAGS_HIGHRESPRECALC |
-                                                cmsFLAGS_BLACKPOINTCOMPENSATION);
-    cmsCloseProfile(profile);
-    cmsCloseProfile(vid_hprofile);
-
-    if (!trafo)
-        goto error_exit;
-
-    // transform a (s_r)x(s_g)x(s_b) cube, with 3 components per channel
-    uint16_t *input = talloc_array(tmp, uint16_t, s_r * 3);
-    for (int b = 0; b < s_b; b++) {
-        for (int g = 0; g < s_g; g++) {
-            for (int r = 0; r < s_r; r++) {
-                input[r * 3 + 0] = r * 65535 / (s_r - 1);
-                input[r * 3 + 1] = g * 65535 / (s_g - 1);
-                input[r * 3 + 2] = b * 65535 / (s_b - 1);
-            }
-            size_t base = (b * s_r * s_g + g * s_r) * 4;
-            cmsDoTransform(trafo, input, output + base, s_r);
-        }
-    }
-
-    cmsDeleteTransform(trafo);
 
     if (cache_file) {
         FILE *out = fopen(cache_file, "wb");
@@ -478,19 +586,128 @@ done: ;
         .size = {s_r, s_g, s_b},
     };
 
-    *result_lut3d = lut;
-    result = true;
-
 error_exit:
 
-    if (cms)
-        cmsDeleteContext(cms);
-
-    if (!lut)
-        MP_FATAL(p, "Error loading ICC profile.\n");
+    if (!lut && !atomic_load(&job->cancel))
+        MP_FATAL(job, "Error loading ICC profile.\n");
 
     talloc_free(tmp);
-    return result;
+    return lut;
+}
+
+static void run_job(void *ptr)
+{
+    struct lut_job *job = ptr;
+
+    if (!atomic_load(&job->cancel)) {
+        job->result = generate_lut(job);
+        atomic_store(&job->done, true);
+
+        struct gl_lcms *p = job->owner;
+        pthread_mutex_lock(&p->lock);
+        if (p->wakeup_cb && !atomic_load(&job->cancel))
+            p->wakeup_cb(p->wakeup_cb_ctx);
+        pthread_mutex_unlock(&p->lock);
+    }
+
+    lut_job_unref(job);
+}
+
+static struct lut_job *create_job(struct gl_lcms *p, enum mp_csp_prim prim,
+                                  enum mp_csp_trc trc)
+{
+    struct lut_job *job = talloc_zero(NULL, struct lut_job);
+    *job = (struct lut_job) {
+        .log = p->log,
+        .global = p->global,
+        .owner = p,
+        .icc_data = talloc_memdup(job, p->icc_data, p->icc_size),
+        .icc_size = p->icc_size,
+        .prim = prim,
+        .trc = trc,
+        .intent = p->opts->intent,
+        .contrast = p->opts->contrast,
+        .use_embedded = p->opts->use_embedded,
+        .cache_dir = talloc_strdup(job, p->opts->cache_dir),
+        .threads = p->threads,
+    };
+    atomic_store(&job->refcount, 1);
+    if (p->vid_profile) {
+        job->vid_profile = av_buffer_ref(p->vid_profile);
+        if (!job->vid_profile)
+            abort();
+    }
+    return job;
+}
+
+bool gl_lcms_get_lut3d(struct gl_lcms *p, struct lut3d **result_lut3d,
+                       enum mp_csp_prim prim, enum mp_csp_trc trc,
+                       struct AVBufferRef *vid_profile)
+{
+    int s_r, s_g, s_b;
+
+    *result_lut3d = NULL;
+
+    // Poll the background job (if the caller got NULL last time).
+    if (p->job && !gl_lcms_has_changed(p, prim, trc, vid_profile)) {
+        if (!atomic_load(&p->job->done))
+            return true;
+        *result_lut3d = talloc_steal(NULL, p->job->result);
+        p->job->result = NULL;
+        lut_job_unref(p->job);
+        p->job = NULL;
+        return !!*result_lut3d;
+    }
+
+    if (p->job) {
+        atomic_store(&p->job->cancel, true);
+        lut_job_unref(p->job);
+        p->job = NULL;
+    }
+
+    p->changed = false;
+    p->current_prim = prim;
+    p->current_trc = trc;
+
+    // We need to hold on to a reference to the video's ICC profile for as long
+    // as we still need to perform equality checking, so generate a new
+    // reference here
+    av_buffer_unref(&p->vid_profile);
+    if (vid_profile) {
+        MP_VERBOSE(p, "Got an embedded ICC profile.\n");
+        p->vid_profile = av_buffer_ref(vid_profile);
+        if (!p->vid_profile)
+            abort();
+    }
+
+    if (!parse_3dlut_size(p->opts->size_str, &s_r, &s_g, &s_b))
+        return false;
+
+    if (!gl_lcms_has_profile(p))
+        return false;
+
+    struct lut_job *job = create_job(p, prim, trc);
+    job->size[0] = s_r;
+    job->size[1] = s_g;
+    job->size[2] = s_b;
+
+    if (p->opts->async) {
+        if (!p->job_pool)
+            p->job_pool = mp_thread_pool_create(p, 1, 1, 1);
+        if (p->job_pool) {
+            atomic_fetch_add(&job->refcount, 1);
+            if (mp_thread_pool_queue(p->job_pool, run_job, job)) {
+                MP_VERBOSE(p, "Generating 3D LUT in the background.\n");
+                p->job = job;
+                return true;
+            }
+            atomic_fetch_add(&job->refcount, -1);
+        }
+    }
+
+    *result_lut3d = generate_lut(job);
+    lut_job_unref(job);
+    return !!*result_lut3d;
 }
 
 #else /* HAVE_LCMS2 */
@@ -529,4 +746,8 @@ bool gl_lcms_get_lut3d(struct gl_lcms *p, struct lut3d **result_lut3d,
     return false;
 }
 
+void gl_lcms_set_threads(struct gl_lcms *p, int threads) { }
+void gl_lcms_set_wakeup_cb(struct gl_lcms *p, void (*cb)(void *ctx),
+                           void *cb_ctx) { }
+
 #endif
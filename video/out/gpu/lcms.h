@@ -17,6 +17,7 @@ struct mp_icc_opts {
     char *size_str;
     int intent;
     int contrast;
+    int async;
 };
 
 struct lut3d {
@@ -34,6 +35,9 @@ struct gl_lcms *gl_lcms_init(void *talloc_ctx, struct mp_log *log,
 void gl_lcms_update_options(struct gl_lcms *p);
 bool gl_lcms_set_memory_profile(struct gl_lcms *p, bstr profile);
 bool gl_lcms_has_profile(struct gl_lcms *p);
+void gl_lcms_set_threads(struct gl_lcms *p, int threads);
+void gl_lcms_set_wakeup_cb(struct gl_lcms *p, void (*cb)(void *ctx),
+                           void *cb_ctx);
 bool gl_lcms_get_lut3d(struct gl_lcms *p, struct lut3d **,
                        enum mp_csp_prim prim, enum mp_csp_trc trc,
                        struct AVBufferRef *vid_profile);
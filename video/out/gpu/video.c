@@ -621,13 +621,18 @@ static bool gl_video_get_lut3d(struct gl_video *p, enum mp_csp_prim prim,
     }
 
     struct lut3d *lut3d = NULL;
-    if (!fmt || !gl_lcms_get_lut3d(p->cms, &lut3d, prim, trc, icc) || !lut3d) {
+    if (!fmt || !gl_lcms_get_lut3d(p->cms, &lut3d, prim, trc, icc)) {
         p->use_lut_3d = false;
         return false;
     }
 
     ra_tex_free(p->ra, &p->lut_3d_texture);
 
+    // Still being generated in the background (--icc-3dlut-async); render
+    // without it until it's done.
+    if (!lut3d)
+        return false;
+
     struct ra_tex_params params = {
         .dimensions = 3,
         .w = lut3d->size[0],
@@ -2486,6 +2491,7 @@ static void pass_colormanage(struct gl_video *p, struct mp_colorspace src, bool
         .sig_peak = p->opts.target_peak / MP_REF_WHITE,
     };
 
+    bool lut3d_ready = false;
     if (p->use_lut_3d) {
         // The 3DLUT is always generated against the video's original source
         // space, *not* the reference space. (To avoid having to regenerate
@@ -2501,6 +2507,7 @@ static void pass_colormanage(struct gl_video *p, struct mp_colorspace src, bool
             trc_orig = MP_CSP_TRC_GAMMA22;
 
         if (gl_video_get_lut3d(p, prim_orig, trc_orig)) {
+            lut3d_ready = true;
             dst.primaries = prim_orig;
             dst.gamma = trc_orig;
             assert(dst.primaries && dst.gamma);
@@ -2583,7 +2590,7 @@ static void pass_colormanage(struct gl_video *p, struct mp_colorspace src, bool
     // Adapt from src to dst as necessary
     pass_color_map(p->sc, p->use_linear && !osd, src, dst, &tone_map);
 
-    if (p->use_lut_3d) {
+    if (lut3d_ready) {
         gl_sc_uniform_texture(p->sc, "lut_3d", p->lut_3d_texture);
         GLSL(vec3 cpos;)
         for (int i = 0; i < 3; i++)
@@ -3995,10 +4002,18 @@ static void reinit_from_options(struct gl_video *p)
     }
 }
 
+static void lut3d_ready_cb(void *ctx)
+{
+    vo_redraw(ctx);
+}
+
 void gl_video_configure_queue(struct gl_video *p, struct vo *vo)
 {
     gl_video_update_options(p);
 
+    // Redraw as soon as an asynchronously generated 3D LUT is available.
+    gl_lcms_set_wakeup_cb(p->cms, lut3d_ready_cb, vo);
+
     int queue_size = 1;
 
     // Figure out an adequate size for the interpolation queue. The larger
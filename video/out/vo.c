@@ -272,6 +272,7 @@ static struct vo *vo_create(bool probing, struct mpv_global *global,
         return NULL;
     };
     struct vo *vo = talloc_ptrtype(NULL, vo);
+    talloc_set_account(vo, "vo");
     *vo = (struct vo) {
         .log = mp_log_new(vo, log, name),
         .driver = desc.p,
@@ -467,7 +468,7 @@ static void vsync_skip_detection(struct vo *vo)
         in->base_vsync = in->prev_vsync;
         in->delayed_count += 1;
         in->drop_point = 0;
-        MP_STATS(vo, "vo-delayed");
+        MP_STATS_SIGNAL(vo, "vo-delayed");
     }
     if (in->drop_point > 10)
         in->base_vsync += desync / 10;  // smooth out drift
@@ -514,8 +515,8 @@ static void update_vsync_timing_after_swap(struct vo *vo,
     check_estimated_display_fps(vo);
     vsync_skip_detection(vo);
 
-    MP_STATS(vo, "value %f jitter", in->estimated_vsync_jitter);
-    MP_STATS(vo, "value %f vsync-diff", in->vsync_samples[0] / 1e6);
+    MP_STATS_VALUE(vo, "jitter", in->estimated_vsync_jitter);
+    MP_STATS_VALUE(vo, "vsync-diff", in->vsync_samples[0] / 1e6);
 }
 
 // to be called from VO thread only
@@ -894,7 +895,7 @@ bool vo_render_frame_external(struct vo *vo)
         pthread_mutex_unlock(&in->lock);
         wakeup_core(vo); // core can queue new video now
 
-        MP_STATS(vo, "start video-draw");
+        MP_STATS_START(vo, "video-draw");
 
         if (vo->driver->draw_frame) {
             vo->driver->draw_frame(vo, frame);
@@ -902,11 +903,11 @@ bool vo_render_frame_external(struct vo *vo)
             vo->driver->draw_image(vo, mp_image_new_ref(frame->current));
         }
 
-        MP_STATS(vo, "end video-draw");
+        MP_STATS_END(vo, "video-draw");
 
         wait_until(vo, target);
 
-        MP_STATS(vo, "start video-flip");
+        MP_STATS_START(vo, "video-flip");
 
         vo->driver->flip_page(vo);
 
@@ -921,7 +922,7 @@ bool vo_render_frame_external(struct vo *vo)
         if (vsync.last_queue_display_time < 0)
             vsync.last_queue_display_time = mp_time_us();
 
-        MP_STATS(vo, "end video-flip");
+        MP_STATS_END(vo, "video-flip");
 
         pthread_mutex_lock(&in->lock);
         in->dropped_frame = prev_drop_count < vo->in->drop_count;
@@ -936,7 +937,7 @@ bool vo_render_frame_external(struct vo *vo)
     }
 
     if (in->dropped_frame) {
-        MP_STATS(vo, "drop-vo");
+        MP_STATS_SIGNAL(vo, "drop-vo");
     } else {
         in->request_redraw = false;
     }
@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <sys/stat.h>
 
+#include <libavutil/cpu.h>
 #include <libswscale/swscale.h>
 
 #include "config.h"
@@ -65,6 +66,7 @@ static const struct m_sub_options vo_image_conf = {
 
 struct priv {
     struct vo_image_opts *opts;
+    struct image_writer_queue *queue;
 
     struct mp_image *current;
     int frame;
@@ -120,10 +122,11 @@ static void flip_page(struct vo *vo)
         filename = mp_path_join(t, p->opts->outdir, filename);
 
     MP_INFO(vo, "Saving %s\n", filename);
-    write_image(p->current, p->opts->opts, filename, vo->log);
+    image_writer_queue_add(p->queue, p->current, p->opts->opts, filename,
+                           NULL, NULL);
+    p->current = NULL;
 
     talloc_free(t);
-    mp_image_unrefp(&p->current);
 }
 
 static int query_format(struct vo *vo, int fmt)
@@ -138,6 +141,7 @@ static void uninit(struct vo *vo)
     struct priv *p = vo->priv;
 
     mp_image_unrefp(&p->current);
+    talloc_free(p->queue); // waits until all images are written
 }
 
 static int preinit(struct vo *vo)
@@ -146,6 +150,13 @@ static int preinit(struct vo *vo)
     p->opts = mp_get_config_group(vo, vo->global, &vo_image_conf);
     if (p->opts->outdir && !checked_mkdir(vo, p->opts->outdir))
         return -1;
+    // Encode frames on all cores (up to the same limit as screenshots).
+    // Limiting the number of pending frames makes the VO block if encoding
+    // can't keep up with decoding.
+    int threads = MPCLAMP(av_cpu_count(), 1, 16);
+    p->queue = image_writer_queue_create(vo, vo->log, threads, threads * 2);
+    if (!p->queue)
+        return -1;
     return 0;
 }
 
@@ -108,6 +108,7 @@ struct mpv_render_context {
 
 const struct render_backend_fns *render_backends[] = {
     &render_backend_gpu,
+    &render_backend_sw,
     NULL
 };
 
@@ -386,7 +387,7 @@ int mpv_render_context_render(mpv_render_context *ctx, mpv_render_param *params)
         frame = vo_frame_ref(ctx->cur_frame);
         if (frame)
             frame->redraw = true;
-        MP_STATS(ctx, "glcb-noframe");
+        MP_STATS_SIGNAL(ctx, "glcb-noframe");
     }
     struct vo_frame dummy = {0};
     if (!frame)
@@ -394,7 +395,7 @@ int mpv_render_context_render(mpv_render_context *ctx, mpv_render_param *params)
 
     pthread_mutex_unlock(&ctx->lock);
 
-    MP_STATS(ctx, "glcb-render");
+    MP_STATS_SIGNAL(ctx, "glcb-render");
 
     int err = 0;
 
@@ -418,7 +419,7 @@ int mpv_render_context_render(mpv_render_context *ctx, mpv_render_param *params)
 
 void mpv_render_context_report_swap(mpv_render_context *ctx)
 {
-    MP_STATS(ctx, "glcb-reportflip");
+    MP_STATS_SIGNAL(ctx, "glcb-reportflip");
 
     pthread_mutex_lock(&ctx->lock);
     ctx->flip_count += 1;
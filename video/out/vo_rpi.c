@@ -258,7 +258,7 @@ static void update_osd(struct vo *vo)
         return;
     }
 
-    MP_STATS(vo, "start rpi_osd");
+    MP_STATS_START(vo, "rpi_osd");
 
     struct vo_frame frame = {0};
     struct ra_fbo target = {
@@ -269,7 +269,7 @@ static void update_osd(struct vo *vo)
     gl_video_render_frame(p->gl_video, &frame, target, RENDER_FRAME_DEF);
     ra_tex_free(p->egl.ra, &target.tex);
 
-    MP_STATS(vo, "stop rpi_osd");
+    MP_STATS_END(vo, "rpi_osd");
 }
 
 static void resize(struct vo *vo)
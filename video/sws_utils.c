@@ -16,10 +16,12 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 
 #include <libswscale/swscale.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/bswap.h>
+#include <libavutil/cpu.h>
 #include <libavutil/opt.h>
 
 #include "config.h"
@@ -34,8 +36,16 @@
 #include "fmt-conversion.h"
 #include "csputils.h"
 #include "common/msg.h"
+#include "misc/thread_pool.h"
 #include "osdep/endian.h"
 
+// Don't split the conversion into slices smaller than this many lines.
+#define MIN_SLICE_H 32
+
+// Maximum for --sws-threads. The calling thread converts one of the slices,
+// so the thread pool needs one thread less.
+#define MAX_SLICE_THREADS 64
+
 //global sws_flags from the command line
 struct sws_opts {
     int scaler;
@@ -45,6 +55,7 @@ struct sws_opts {
     int chr_hshift;
     float chr_sharpen;
     float lum_sharpen;
+    int threads;
 };
 
 #define OPT_BASE_STRUCT struct sws_opts
@@ -68,11 +79,14 @@ const struct m_sub_options sws_conf = {
         OPT_INT("chs", chr_hshift, 0),
         OPT_FLOATRANGE("ls", lum_sharpen, 0, -100.0, 100.0),
         OPT_FLOATRANGE("cs", chr_sharpen, 0, -100.0, 100.0),
+        OPT_CHOICE_OR_INT("threads", threads, 0, 1, MAX_SLICE_THREADS,
+                          ({"auto", 0})),
         {0}
     },
     .size = sizeof(struct sws_opts),
     .defaults = &(const struct sws_opts){
         .scaler = SWS_BICUBIC,
+        .threads = 1,
     },
 };
 
@@ -98,6 +112,8 @@ void mp_sws_set_from_cmdline(struct mp_sws_context *ctx, struct mpv_global *g)
     ctx->flags = SWS_PRINT_INFO;
     ctx->flags |= opts->scaler;
 
+    ctx->threads = opts->threads;
+
     talloc_free(opts);
 }
 
@@ -119,7 +135,7 @@ static int mp_csp_to_sws_colorspace(enum mp_csp csp)
 static bool cache_valid(struct mp_sws_context *ctx)
 {
     struct mp_sws_context *old = ctx->cached;
-    if (ctx->force_reload)
+    if (ctx->force_reload || !ctx->sws)
         return false;
     return mp_image_params_equal(&ctx->src, &old->src) &&
            mp_image_params_equal(&ctx->dst, &old->dst) &&
@@ -149,6 +165,7 @@ struct mp_sws_context *mp_sws_alloc(void *talloc_ctx)
         .saturation = 1 << 16,
         .force_reload = true,
         .params = {SWS_PARAM_DEFAULT, SWS_PARAM_DEFAULT},
+        .threads = 1,
         .cached = talloc_zero(ctx, struct mp_sws_context),
     };
     talloc_set_destructor(ctx, free_mp_sws);
@@ -251,6 +268,161 @@ int mp_sws_reinit(struct mp_sws_context *ctx)
     return 1;
 }
 
+struct mp_sws_slice {
+    struct mp_sws_slices *slices;
+    struct mp_sws_context *sws;
+    struct mp_image src, dst;
+    int res;
+};
+
+struct mp_sws_slices {
+    struct mp_thread_pool *pool;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    int pending;
+    struct mp_sws_slice *list;
+    int num_list;
+};
+
+static void destroy_slices(void *p)
+{
+    struct mp_sws_slices *s = p;
+
+    talloc_free(s->pool); // waits for workers
+    pthread_cond_destroy(&s->wakeup);
+    pthread_mutex_destroy(&s->lock);
+}
+
+// Determine how to split the conversion into horizontal slices. Each slice is
+// converted with its own libswscale context on cropped images, so a filter
+// tap at a slice boundary would see clamped lines instead of the neighbouring
+// ones, which shows up as seams. Thus only slice if every destination line
+// depends on the source line at the same position only: no vertical scaling,
+// no vertical chroma resampling, and no extra filters. Slice boundaries are
+// aligned so that ordered dithering (which depends on the line number within
+// the context) continues across them. Returns the number of slices, and the
+// granularity of the boundaries in *units and *step.
+static int get_num_slices(struct mp_sws_context *ctx, struct mp_image *dst,
+                          struct mp_image *src, int *units, int *step)
+{
+    int threads = ctx->threads > 0 ? ctx->threads : av_cpu_count();
+    threads = MPMIN(threads, MAX_SLICE_THREADS);
+    if (threads < 2 || src->h < 1 || src->h != dst->h)
+        return 1;
+
+    if (src->fmt.chroma_ys != dst->fmt.chroma_ys ||
+        (src->fmt.chroma_ys &&
+         src->params.chroma_location != dst->params.chroma_location))
+        return 1;
+
+    if (ctx->src_filter || ctx->dst_filter || (ctx->flags & SWS_ERROR_DIFFUSE))
+        return 1;
+
+    *step = 8 << src->fmt.chroma_ys;
+    while (*step % MPMAX(src->fmt.align_y, 1) ||
+           *step % MPMAX(dst->fmt.align_y, 1))
+        *step *= 2;
+    *units = dst->h / *step;
+
+    return MPCLAMP(dst->h / MIN_SLICE_H, 1, MPMIN(*units, threads));
+}
+
+static void scale_slice(void *ptr)
+{
+    struct mp_sws_slice *slice = ptr;
+    struct mp_sws_slices *s = slice->slices;
+
+    slice->res = mp_sws_scale(slice->sws, &slice->dst, &slice->src);
+
+    pthread_mutex_lock(&s->lock);
+    s->pending--;
+    pthread_cond_broadcast(&s->wakeup);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static int scale_sliced(struct mp_sws_context *ctx, struct mp_image *dst,
+                        struct mp_image *src, int num, int units, int step)
+{
+    if (!ctx->slices) {
+        struct mp_sws_slices *s = talloc_zero(ctx, struct mp_sws_slices);
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->wakeup, NULL);
+        talloc_set_destructor(s, destroy_slices);
+        ctx->slices = s;
+    }
+    struct mp_sws_slices *s = ctx->slices;
+
+    // Threads are created on demand, and exit after some idle time.
+    if (!s->pool)
+        s->pool = mp_thread_pool_create(s, 0, 0, MAX_SLICE_THREADS - 1);
+
+    while (s->num_list < num) {
+        struct mp_sws_slice slice = {
+            .slices = s,
+            .sws = mp_sws_alloc(s),
+        };
+        MP_TARRAY_APPEND(s, s->list, s->num_list, slice);
+    }
+
+    // The per-slice contexts have no own state that can be reloaded, so make
+    // them reinit if the user requested it.
+    if (ctx->force_reload) {
+        for (int n = 0; n < s->num_list; n++)
+            s->list[n].sws->force_reload = true;
+        ctx->force_reload = false;
+        // Make the next unsliced call reinit too.
+        sws_freeContext(ctx->sws);
+        ctx->sws = NULL;
+    }
+
+    for (int n = 0; n < num; n++) {
+        struct mp_sws_slice *slice = &s->list[n];
+        struct mp_sws_context *sws = slice->sws;
+        sws->log = ctx->log;
+        sws->flags = ctx->flags;
+        sws->brightness = ctx->brightness;
+        sws->contrast = ctx->contrast;
+        sws->saturation = ctx->saturation;
+        sws->params[0] = ctx->params[0];
+        sws->params[1] = ctx->params[1];
+        // Borrowed; only read on init. Unset again below, before they could
+        // be freed by the slice context.
+        sws->src_filter = ctx->src_filter;
+        sws->dst_filter = ctx->dst_filter;
+
+        int u0 = units * n / num;
+        int u1 = units * (n + 1) / num;
+        slice->src = *src;
+        slice->dst = *dst;
+        int y1 = n < num - 1 ? u1 * step : dst->h;
+        mp_image_crop(&slice->src, 0, u0 * step, src->w, y1);
+        mp_image_crop(&slice->dst, 0, u0 * step, dst->w, y1);
+        slice->res = -1;
+    }
+
+    s->pending = num;
+    for (int n = 1; n < num; n++) {
+        if (!mp_thread_pool_queue(s->pool, scale_slice, &s->list[n]))
+            scale_slice(&s->list[n]);
+    }
+    scale_slice(&s->list[0]);
+
+    pthread_mutex_lock(&s->lock);
+    while (s->pending)
+        pthread_cond_wait(&s->wakeup, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+
+    int res = 0;
+    for (int n = 0; n < num; n++) {
+        struct mp_sws_slice *slice = &s->list[n];
+        slice->sws->src_filter = slice->sws->dst_filter = NULL;
+        ctx->supports_csp = slice->sws->supports_csp;
+        if (slice->res < 0)
+            res = slice->res;
+    }
+    return res;
+}
+
 // Scale from src to dst - if src/dst have different parameters from previous
 // calls, the context is reinitialized. Return error code. (It can fail if
 // reinitialization was necessary, and swscale returned an error.)
@@ -260,6 +432,11 @@ int mp_sws_scale(struct mp_sws_context *ctx, struct mp_image *dst,
     ctx->src = src->params;
     ctx->dst = dst->params;
 
+    int units = 1, step = 0;
+    int num = get_num_slices(ctx, dst, src, &units, &step);
+    if (num > 1)
+        return scale_sliced(ctx, dst, src, num, units, step);
+
     int r = mp_sws_reinit(ctx);
     if (r < 0) {
         MP_ERR(ctx, "libswscale initialization failed.\n");
@@ -32,6 +32,10 @@ struct mp_sws_context {
     int flags;
     int brightness, contrast, saturation;
     bool force_reload;
+    // Split conversion into this many slices converted in parallel (0 means
+    // number of CPUs, 1 disables it). Slicing is skipped if the image is too
+    // small, or if the scale factor doesn't allow exact slice boundaries.
+    int threads;
     // These are also implicitly set by mp_sws_scale(), and thus optional.
     // Setting them before that call makes sense when using mp_sws_reinit().
     struct mp_image_params src, dst;
@@ -48,6 +52,9 @@ struct mp_sws_context {
 
     // Contains parameters for which sws is valid
     struct mp_sws_context *cached;
+
+    // Per-slice contexts etc., if slicing was used
+    struct mp_sws_slices *slices;
 };
 
 struct mp_sws_context *mp_sws_alloc(void *talloc_ctx);
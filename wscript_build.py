@@ -267,6 +267,7 @@ def build(ctx):
         ( "common/playlist.c" ),
         ( "common/recorder.c" ),
         ( "common/tags.c" ),
+        ( "common/trace.c" ),
         ( "common/version.c" ),
 
         ## Demuxers
@@ -336,6 +337,7 @@ def build(ctx):
 
         ## Player
         ( "player/audio.c" ),
+        ( "player/benchmark.c" ),
         ( "player/client.c" ),
         ( "player/command.c" ),
         ( "player/configfiles.c" ),
@@ -349,6 +351,7 @@ def build(ctx):
         ( "player/playloop.c" ),
         ( "player/screenshot.c" ),
         ( "player/scripting.c" ),
+        ( "player/storyboard.c" ),
         ( "player/sub.c" ),
         ( "player/video.c" ),
 
@@ -450,6 +453,7 @@ def build(ctx):
         ( "video/out/hwdec/hwdec_cuda_gl.c",     "cuda-hwaccel && gl" ),
         ( "video/out/hwdec/hwdec_cuda_vk.c",     "cuda-hwaccel && vulkan" ),
         ( "video/out/hwdec/hwdec_vaapi.c",       "vaapi-egl || vaapi-vulkan" ),
+        ( "video/out/libmpv_sw.c" ),
         ( "video/out/placebo/ra_pl.c",           "libplacebo" ),
         ( "video/out/placebo/utils.c",           "libplacebo" ),
         ( "video/out/opengl/angle_dynamic.c",    "egl-angle" ),
@@ -578,7 +582,8 @@ def build(ctx):
                 ctx.path.find_node('osdep/mpv.rc'),
                 version)
 
-    if ctx.dependency_satisfied('cplayer') or ctx.dependency_satisfied('test'):
+    if ctx.dependency_satisfied('cplayer') or ctx.dependency_satisfied('test') \
+            or ctx.dependency_satisfied('bench'):
         ctx(
             target       = "objects",
             source       = ctx.filtered_sources(sources),
@@ -622,10 +627,22 @@ def build(ctx):
             wrapctx.env.LAST_LINKFLAGS = ctx.env.LAST_LINKFLAGS + wrapflags
 
     if ctx.dependency_satisfied('test'):
-        for test in ctx.path.ant_glob("test/*.c"):
+        for test in ctx.path.ant_glob("test/*.c",
+                                      excl=["test/test_helpers.c"]):
             ctx(
                 target       = os.path.splitext(test.srcpath())[0],
-                source       = test.srcpath(),
+                source       = [test.srcpath(), "test/test_helpers.c"],
+                use          = ctx.dependencies_use() + ['objects'],
+                includes     = _all_includes(ctx),
+                features     = "c cprogram",
+                install_path = None,
+            )
+
+    if ctx.dependency_satisfied('bench'):
+        for bench in ctx.path.ant_glob("bench/*.c"):
+            ctx(
+                target       = os.path.splitext(bench.srcpath())[0],
+                source       = bench.srcpath(),
                 use          = ctx.dependencies_use() + ['objects'],
                 includes     = _all_includes(ctx),
                 features     = "c cprogram",